@@ -1,10 +1,11 @@
 #include "pch.h"
 #include "MusicSync.h"
+#include "media/SmtcMediaSource.h"
+#include "media/ScriptedMediaSource.h"
+#include "rendering/ImGuiDrawTarget.h"
 
-namespace winrt_foundation = winrt::Windows::Foundation;
-namespace winrt_media = winrt::Windows::Media::Control;
-namespace winrt_streams = winrt::Windows::Storage::Streams;
-namespace winrt_storage = winrt::Windows::Storage;
+#include <chrono>
+#include <cmath>
 
 BAKKESMOD_PLUGIN(MusicSync, "MusicSync for Windows API", plugin_version, PLUGINTYPE_FREEPLAY)
 
@@ -18,13 +19,15 @@ void MusicSync::InitializePaths()
 
 	// Create directory if it doesn't exist
 	std::filesystem::create_directories(dataDir);
+	coverPipeline = std::make_unique<CoverPipeline>(dataDir / "covers", defaultCoverCacheMegabytes * 1024 * 1024);
 
 	LOG("Data directory: {}", dataDir.string());
-	LOG("Cover path: {}", coverPath.string());
+	LOG("Cover export path: {}.*", coverPath.string());
 }
 
 void MusicSync::onLoad()
 {
+    auto loadStart = std::chrono::steady_clock::now();
     _globalCvarManager = cvarManager;
     LOG("MusicSync plugin loaded!");
 
@@ -55,26 +58,78 @@ void MusicSync::onLoad()
 
     // Register overlay CVars with percentage-based positions (0-100)
     cvarManager->registerCvar("music_overlay_enabled", "1", "Enable music overlay", true, true, 0, true, 1);
-    cvarManager->registerCvar("music_overlay_scale", "1.0", "Music overlay scale", true, true, 0.5f, true, 2.5f);
+    cvarManager->registerCvar("music_overlay_scale", "1.0", "Music overlay scale", true, true, 0.5f, true, 2.5f)
+        .addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) {
+            // The cover is resampled to the new size on the media thread, debounced while dragging
+            coverScale = cvar.getFloatValue();
+            pollScheduler.NotifyChanged();
+        });
     cvarManager->registerCvar("music_overlay_x", std::to_string(overlayPercentX), "Music overlay X position (percentage)", true, true, 0.0f, true, 100.0f);
     cvarManager->registerCvar("music_overlay_y", std::to_string(overlayPercentY), "Music overlay Y position (percentage)", true, true, 0.0f, true, 100.0f);
     cvarManager->registerCvar("music_overlay_show_cover", "1", "Show album cover", true, true, 0, true, 1);
+    cvarManager->registerCvar("music_overlay_cover_backdrop", "0", "Use a blurred copy of the album cover as the background", true, true, 0, true, 1);
+    cvarManager->registerCvar("music_overlay_show_progress", "1", "Show playback progress bar", true, true, 0, true, 1);
+    cvarManager->registerCvar("music_overlay_auto_width", "0", "Fit the overlay background to the text width", true, true, 0, true, 1);
+    cvarManager->registerCvar("music_overlay_marquee", "0", "Scroll long lines instead of cutting them", true, true, 0, true, 1);
+    cvarManager->registerCvar("music_overlay_transition", "1", "Track change animation: 0 none, 1 fade, 2 slide, 3 scale", true, true, 0, true, 3);
+    cvarManager->registerCvar("music_overlay_backend", "0", "Overlay renderer: 0 canvas, 1 ImGui draw list", true, true, 0, true, 1)
+        .addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) {
+            UpdateOverlayMenu(cvar.getIntValue() == 1);
+        });
+    cvarManager->registerCvar("music_overlay_corner_radius", "0", "Round the overlay background, pixels at scale 1", true, true, 0, true, 32);
+    cvarManager->registerCvar("music_overlay_shadow", "0", "Drop shadow size of the overlay background, pixels at scale 1", true, true, 0, true, 32);
+    cvarManager->registerCvar("music_overlay_outline", "0", "Outline width of the overlay background, pixels at scale 1", true, true, 0, true, 8);
+    cvarManager->registerCvar("music_overlay_recent_covers", "0", "Show the covers of this many previous tracks under the overlay", true, true, 0, true, 8);
+    cvarManager->registerCvar("music_overlay_composited", "0", "Compose the overlay into one texture on a worker thread", true, true, 0, true, 1);
 	cvarManager->registerCvar("music_overlay_always_enabled", "0", "Always show overlay", true, true, 0, true, 1);
 
+    // Preview swaps the live media source for a scripted track list
+    cvarManager->registerCvar("musicsync_preview", "0", "Show scripted preview tracks instead of live media", true, true, 0, true, 1)
+        .addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) {
+            usePreviewSource = cvar.getBoolValue();
+            pollScheduler.RequestRefresh();
+        });
+
+    // Album cover export for other tools, the overlay does not need it
+    cvarManager->registerCvar("musicsync_export_cover", "0", "Also write the album cover to the plugin data folder", true, true, 0, true, 1)
+        .addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) {
+            exportCover = cvar.getBoolValue();
+        });
+
+    // Decoded covers are kept across sessions up to this size
+    cvarManager->registerCvar("musicsync_cover_cache_mb", std::to_string(defaultCoverCacheMegabytes), "Album cover cache size in MB", true, true, 1, true, 1024)
+        .addOnValueChanged([this](std::string oldValue, CVarWrapper cvar) {
+            coverPipeline->SetCacheCapacity(static_cast<uint64_t>(cvar.getIntValue()) * 1024 * 1024);
+        });
+
+    // Session selection when several media apps are active, comma separated app ids
+    auto onPolicyChanged = [this](std::string oldValue, CVarWrapper cvar) { UpdateSessionPolicy(); };
+    cvarManager->registerCvar("musicsync_source_allow", "", "Only show these media apps (comma separated app ids, empty for all)")
+        .addOnValueChanged(onPolicyChanged);
+    cvarManager->registerCvar("musicsync_source_deny", "", "Never show these media apps (comma separated app ids)")
+        .addOnValueChanged(onPolicyChanged);
+    cvarManager->registerCvar("musicsync_source_priority", "", "Preferred media apps, highest priority first (comma separated app ids)")
+        .addOnValueChanged(onPolicyChanged);
+    UpdateSessionPolicy();
+
     // Register color CVars
     cvarManager->registerCvar("music_overlay_text_color", "(255,255,255,255)", "Text color");
     cvarManager->registerCvar("music_overlay_background_color", "(0,0,0,255)", "Background color");
     cvarManager->registerCvar("music_overlay_background_opacity", "100", "Background opacity");
+    cvarManager->registerCvar("music_overlay_outline_color", "(255,255,255,96)", "Background outline color");
+    cvarManager->registerCvar("music_overlay_auto_theme", "0", "Take text and background colors from the album cover", true, true, 0, true, 1);
 
     // Register notifier to get current media info
     cvarManager->registerNotifier("musicsync_get_info", [this](std::vector<std::string> args) {
+        // Logs what is known now and wakes the media thread so the next call is fresh
+        pollScheduler.RequestRefresh();
         MediaInfo info = GetCurrentMedia();
         if (info.isValid) {
             LOG("Current Song: {} - {}", info.artist, info.title);
             if (!info.album.empty()) {
                 LOG("Album: {}", info.album);
                 if (!info.albumCoverPath.empty()) {
-                    LOG("Album cover saved to: {}", info.albumCoverPath);
+                    LOG("Album cover exported to: {}", info.albumCoverPath);
                 }
             }
         }
@@ -83,6 +138,36 @@ void MusicSync::onLoad()
         }
     }, "Get current media info", PERMISSION_ALL);
 
+    cvarManager->registerNotifier("musicsync_media_stats", [this](std::vector<std::string> args) {
+        LogMediaStats();
+    }, "Dump media source counters", PERMISSION_ALL);
+
+    cvarManager->registerNotifier("musicsync_cover_stats", [this](std::vector<std::string> args) {
+        LogCoverStats();
+    }, "Dump album cover pipeline counters", PERMISSION_ALL);
+
+    cvarManager->registerNotifier("music_overlay_stats", [this](std::vector<std::string> args) {
+        if (overlay) {
+            // Reads the frame counters and layout the ImGui backend may be updating
+            std::lock_guard<std::mutex> lock(overlayRenderMutex);
+            overlay->LogFrameStats();
+        }
+    }, "Dump overlay frame cost", PERMISSION_ALL);
+
+    cvarManager->registerNotifier("musicsync_list_sessions", [this](std::vector<std::string> args) {
+        std::vector<std::string> sessions;
+        {
+            std::lock_guard<std::mutex> lock(mediaInfoMutex);
+            sessions = mediaSessions;
+        }
+        if (sessions.empty()) {
+            LOG("No media sessions");
+        }
+        for (const auto& session : sessions) {
+            LOG("{}", session);
+        }
+    }, "List media sessions and which one is shown", PERMISSION_ALL);
+
     // Scoreboard hook
     gameWrapper->HookEvent("Function TAGame.GFxData_GameEvent_TA.OnOpenScoreboard", 
         std::bind(&MusicSync::openScoreboard, this, std::placeholders::_1));
@@ -90,16 +175,25 @@ void MusicSync::onLoad()
     gameWrapper->HookEvent("Function TAGame.GFxData_GameEvent_TA.OnCloseScoreboard", 
         std::bind(&MusicSync::closeScoreboard, this, std::placeholders::_1));
 
-    // Initialize overlay
+    // Initialize overlay. The composited overlay's fonts and glyph atlas load
+    // on its worker thread from here on, not on the first frame.
     overlay = std::make_unique<MusicOverlay>(gameWrapper, cvarManager, this);
+    overlay->Preload();
     LOG("MusicSync overlay initialized!");
 
     // Register canvas drawable
     gameWrapper->RegisterDrawable(std::bind(&MusicSync::RenderCanvas, this, std::placeholders::_1));
     LOG("Canvas rendering drawable registered!");
 
+    // The ImGui backend's font is loaded either way, so switching needs no reload
+    LoadOverlayFont();
+    UpdateOverlayMenu(cvarManager->getCvar("music_overlay_backend").getIntValue() == 1);
+
     // Start the media update thread
     StartMediaUpdateThread();
+
+    auto loadMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStart).count();
+    LOG("MusicSync loaded in {:.1f} ms (the overlay font atlas loads in the background)", loadMicros / 1000.0);
 }
 
 void MusicSync::onUnload()
@@ -111,200 +205,370 @@ void MusicSync::onUnload()
 	
 	// Clean up overlay
 	if (overlay) {
+		std::lock_guard<std::mutex> lock(overlayRenderMutex);
 		overlay->OnUnload();
 		overlay.reset();
 		LOG("Overlay cleaned up");
 	}
 	
 	StopMediaUpdateThread();
+	coverPipeline.reset(); // Removes the staged textures
 	CleanupOldAlbumCovers();
 	winrt::uninit_apartment();
 }
 
-void MusicSync::SaveAlbumCoverToFile(
-	winrt::Windows::Storage::Streams::IRandomAccessStreamReference thumbnail,
-	const std::string& fileName)
+void MusicSync::CleanupOldAlbumCovers()
 {
 	try {
-		// Open the thumbnail stream synchronously 
-		auto streamOp = thumbnail.OpenReadAsync();
-		auto stream = streamOp.get();
-
-		if (stream != nullptr) {
-			auto size = stream.Size();
-			if (size > 0 && size < 10 * 1024 * 1024) { // Limit to 10MB
-				// Read the stream data
-				std::vector<uint8_t> buffer(static_cast<size_t>(size));
-				auto winrtBuffer = winrt_streams::Buffer(static_cast<uint32_t>(size));
-				auto readOp = stream.ReadAsync(winrtBuffer, static_cast<uint32_t>(size), winrt_streams::InputStreamOptions::None);
-				auto bytesRead = readOp.get();
-
-				if (bytesRead.Length() > 0) {
-					auto dataReader = winrt_streams::DataReader::FromBuffer(bytesRead);
-					dataReader.ReadBytes(buffer);
-
-					// Write to file using standard filesystem
-					std::ofstream file(coverPath, std::ios::binary);
-					if (file.is_open()) {
-						file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
-						file.close();
-						//LOG("Album cover saved successfully to: {}", coverPath.string());
-					}
-					else {
-						LOG("Failed to open file for writing: {}", coverPath.string());
-					}
-				}
+		for (auto format : { ImageFormat::Png, ImageFormat::Jpeg, ImageFormat::Bmp, ImageFormat::Gif, ImageFormat::Webp, ImageFormat::Unknown }) {
+			std::filesystem::path path = coverPath;
+			path += ImageFormatExtension(format);
+			if (std::filesystem::exists(path)) {
+				std::filesystem::remove(path);
 			}
 		}
-		stream.Close();
-	}
-	catch (const std::exception& e) {
-		LOG("Failed to save album cover: {} - Error: {}", fileName, e.what());
 	}
 	catch (...) {
-		LOG("Failed to save album cover: {} - Unknown error", fileName);
+		LOG("Error during album cover cleanup");
 	}
 }
 
-void MusicSync::CleanupOldAlbumCovers()
+// Albums are only told apart by name when there is an album title
+std::string MusicSync::AlbumKey(const MediaInfo& info)
 {
-	try {
-		if (std::filesystem::exists(coverPath)) {
-			std::filesystem::remove(coverPath);
-		}
+	return info.album.empty() ? std::string() : info.artist + '\n' + info.album;
+}
+
+void MusicSync::LogCoverStats()
+{
+	if (!coverPipeline) {
+		return;
 	}
-	catch (...) {
-		LOG("Error during album cover cleanup");
+
+	CoverPipelineStats stats = coverPipeline->GetStats();
+	auto average = [](uint64_t total, uint64_t count) {
+		return count > 0 ? total / count : 0;
+	};
+
+	LOG("Covers shown: {}, decoded: {} ({} failed), avg decode {} us on the media thread", stats.covers, stats.decoded,
+		stats.failures, average(stats.decodeMicros, stats.decoded));
+
+	uint64_t hits = stats.cacheHits + stats.albumHits;
+	uint64_t lookups = hits + stats.cacheMisses;
+	LOG("Cover cache: {}% hit rate ({} by content, {} by album, {} misses), avg hit {} us", lookups > 0 ? hits * 100 / lookups : 0,
+		stats.cacheHits, stats.albumHits, stats.cacheMisses, average(stats.cacheMicros, hits));
+	LOG("Cover cache: {} entries, {} KB, {} evicted", stats.cache.entries, stats.cache.bytes / 1024, stats.cache.evictions);
+
+	// The old path wrote every thumbnail to cover.png and had the render thread read and decode it at full size
+	LOG("Old path: {} KB written + {} KB read, {} KPix decoded on the render thread", stats.sourceBytes / 1024,
+		stats.sourceBytes / 1024, stats.sourcePixels / 1000);
+	LOG("Now: {} KB of uncompressed textures cached, {} KPix loaded on the render thread, {} KB exported",
+		stats.textureBytesWritten / 1024, stats.texturePixels / 1000, stats.exportBytesWritten / 1024);
+	LOG("Decoding: {} KPix decoded, {} of {} covers decoded smaller than their source", stats.decodedPixels / 1000,
+		stats.reducedDecodes, stats.decoded);
+	LOG("Resampling: {} KPix in, avg {} us ({})", stats.resampledPixels / 1000, average(stats.resampleMicros, stats.decoded),
+		SimdLevelName(BestSimdLevel()));
+	LOG("Cropped: {} video thumbnails, avg {} us", stats.cropped, average(stats.cropMicros, stats.decoded));
+	LOG("Themes: {} picked, avg {} us, {} over budget", stats.themes, average(stats.themeMicros, stats.themes), stats.themesOverBudget);
+	LOG("Backdrops: {} blurred, avg {} us", stats.backdrops, average(stats.backdropMicros, stats.backdrops));
+	LOG("Render thread texture loads: {} avg {} us", stats.textureLoads, average(stats.textureLoadMicros, stats.textureLoads));
+}
+
+void MusicSync::EnsureMediaSource()
+{
+	bool wantPreview = usePreviewSource;
+	if (mediaSource && wantPreview == previewSourceActive) {
+		return;
+	}
+
+	if (mediaSource) {
+		mediaSource->Unsubscribe();
+	}
+	mediaSource.reset();
+	if (wantPreview) {
+		mediaSource = std::make_unique<ScriptedMediaSource>(ScriptedMediaSource::PreviewScript());
 	}
+	else {
+		mediaSource = std::make_unique<SmtcMediaSource>();
+	}
+	previewSourceActive = wantPreview;
+	previousMediaInfo = MediaInfo{};
+	{
+		std::lock_guard<std::mutex> lock(mediaInfoMutex);
+		sessionPolicyChanged = true;
+	}
+
+	mediaSubscribed = mediaSource->Subscribe([this]() {
+		pollScheduler.NotifyChanged();
+	});
+	LOG("Media source: {} ({})", wantPreview ? "preview" : "Windows media",
+		mediaSubscribed ? "change events" : "polling only");
+}
+
+void MusicSync::UpdateSessionPolicy()
+{
+	auto cvarString = [this](const char* name) {
+		CVarWrapper cvar = cvarManager->getCvar(name);
+		return cvar ? cvar.getStringValue() : std::string();
+	};
+
+	SessionPolicy policy = SessionPolicy::Parse(
+		cvarString("musicsync_source_allow"),
+		cvarString("musicsync_source_deny"),
+		cvarString("musicsync_source_priority"));
+
+	std::lock_guard<std::mutex> lock(mediaInfoMutex);
+	sessionPolicy = std::move(policy);
+	sessionPolicyChanged = true;
+	pollScheduler.RequestRefresh();
 }
 
 MediaInfo MusicSync::GetCurrentMediaInfoSync()
 {
-    MediaInfo info;
+    EnsureMediaSource();
 
-    try {
-        // Get the session manager
-        auto sessionManagerOp = winrt_media::GlobalSystemMediaTransportControlsSessionManager::RequestAsync();
-        auto sessionManager = sessionManagerOp.get();
-        auto currentSession = sessionManager.GetCurrentSession();
-
-        if (currentSession != nullptr) {
-            // Get media properties
-            auto mediaPropertiesOp = currentSession.TryGetMediaPropertiesAsync();
-            auto mediaProperties = mediaPropertiesOp.get();
-
-            if (mediaProperties != nullptr) {
-                info.title = winrt::to_string(mediaProperties.Title());
-                info.artist = winrt::to_string(mediaProperties.Artist());
-                info.album = winrt::to_string(mediaProperties.AlbumTitle());
-                info.isValid = true;
-
-                // Try to get and save album artwork if media has changed
-                auto thumbnail = mediaProperties.Thumbnail();
-                if (thumbnail != nullptr) {
-                    try {
-                        info.albumCoverPath = coverPath.string();
-                        info.hasThumbnail = true;
-
-                        // Only save if this is different media than before
-                        if (info != previousMediaInfo) {
-                            LOG("Media changed - saving new album cover");
-                            LOG("Current Song: {} - {}", info.artist, info.title);
-                            
-                            // CLEAR THE OVERLAY IMAGE FIRST to release file lock
-                            if (overlay) {
-                                overlay->ClearAlbumCover();
-                            }
-                            
-                            std::string fileName = coverFile;
-
-                            // Save the album cover synchronously
-                            SaveAlbumCoverToFile(thumbnail, fileName);
-
-                            previousMediaInfo = info;
-                            
-                        } else {
-                            //LOG("Same media playing - skipping album cover save");
-                        }
-                    }
-                    catch (...) {
-                        // Failed to save thumbnail
-                        info.hasThumbnail = false;
-                    }
+    {
+        std::lock_guard<std::mutex> lock(mediaInfoMutex);
+        if (sessionPolicyChanged) {
+            mediaSource->SetSessionPolicy(sessionPolicy);
+            sessionPolicyChanged = false;
+        }
+    }
+
+    MediaInfo info = mediaSource->FetchCurrent();
+    // A failed fetch can drop the source's events until it reconnects, polls back off less meanwhile
+    mediaSubscribed = mediaSource->EventsActive();
+
+    // Covers are processed once per media change. Apps often send the metadata
+    // first and the thumbnail a moment later, or swap the thumbnail under the
+    // same title, so both count as a change too.
+    int maxSize = static_cast<int>(std::ceil(coverDisplaySize * coverScale));
+    bool trackChanged = info != previousMediaInfo;
+    if (trackChanged || info.hasThumbnail != previousMediaInfo.hasThumbnail ||
+        info.thumbnailRevision != previousMediaInfo.thumbnailRevision) {
+        previousMediaInfo = info;
+        currentCover.reset();
+        exportedCoverPath.clear();
+        failedCoverSize = 0;
+
+        if (info.isValid && info.hasThumbnail) {
+            LOG("Media changed - processing new album cover");
+            LOG("Current Song: {} - {}", info.artist, info.title);
+
+            std::string albumKey = AlbumKey(info);
+
+            // The next track of the same album reuses its cover without reading the thumbnail.
+            // A swapped thumbnail under the same title is always read and checked by content.
+            if (trackChanged && !albumKey.empty() && !exportCover) {
+                currentCover = coverPipeline->FindAlbum(albumKey, maxSize);
+                if (currentCover) {
+                    mediaSource->SkipThumbnail();
+                }
+            }
+
+            if (!currentCover) {
+                std::vector<uint8_t> bytes = mediaSource->ReadThumbnail();
+                currentCover = coverPipeline->Process(bytes, maxSize, albumKey);
+                if (exportCover) {
+                    exportedCoverPath = coverPipeline->Export(bytes, coverPath).string();
                 }
             }
         }
     }
-    catch (const std::exception& e) {
-        LOG("Error getting media info: {}", e.what());
-    }
-    catch (...) {
-        LOG("Unknown error getting media info");
+    else if (currentCover && currentCover->targetSize != maxSize && failedCoverSize != maxSize) {
+        // Overlay scale changed, resample from the original thumbnail. Sizes seen before come from the cache.
+        // A size that failed is not tried again until the thumbnail or the scale changes.
+        std::vector<uint8_t> bytes = mediaSource->ReadThumbnail();
+        if (auto cover = coverPipeline->Process(bytes, maxSize, AlbumKey(info))) {
+            currentCover = cover;
+        }
+        else {
+            failedCoverSize = maxSize;
+        }
     }
 
+    info.albumCoverPath = exportedCoverPath;
     return info;
 }
 
-void MusicSync::UpdateMediaInfo()
+// Returns true if the media or the playback state changed
+bool MusicSync::UpdateMediaInfo()
 {
 	try {
 		auto info = GetCurrentMediaInfoSync();
 
-		std::lock_guard<std::mutex> lock(mediaInfoMutex);
+		// Timeline updates are not media changes, they always go out. A position
+		// far from where the last sample extrapolates to means the user seeked.
+		const TimelineSample& timeline = info.timeline;
+		bool playbackChanged = timeline.playing != lastTimeline.playing ||
+			(timeline.valid && lastTimeline.valid &&
+				std::abs(timeline.positionSeconds - lastTimeline.PositionAt(timeline.capturedAtNanos)) > 2.0);
+		lastTimeline = timeline;
+		playbackClock.Publish(timeline);
 
-		// Check if media has changed
-		bool mediaChanged = (info != currentMediaInfo);
-		currentMediaInfo = std::move(info);
+		std::lock_guard<std::mutex> lock(mediaInfoMutex);
+		mediaStats = mediaSource->GetStats();
+		mediaSessions = mediaSource->DescribeSessions();
 
-		// Trigger overlay update if media changed
-		if (overlay && mediaChanged) {
-			// Set flag to update render data on next frame
-			overlay->needsUpdate = true;
+		// Only publish when something actually changed. The cover can change on its
+		// own when the thumbnail is swapped or the overlay is rescaled.
+		if (info == currentMediaInfo && info.hasThumbnail == currentMediaInfo.hasThumbnail && currentCover == publishedCover) {
+			return playbackChanged;
 		}
+		currentMediaInfo = info;
+		publishedCover = currentCover;
+		PublishMediaSnapshot(info, currentCover);
+		return true;
 	}
 	catch (...) {
+		lastTimeline = TimelineSample{};
+		playbackClock.Publish(lastTimeline);
 		std::lock_guard<std::mutex> lock(mediaInfoMutex);
 		currentMediaInfo = MediaInfo{};
+		publishedCover.reset();
+		PublishMediaSnapshot(currentMediaInfo, nullptr);
+		return true;
 	}
 }
 
 void MusicSync::StartMediaUpdateThread()
 {
-	shouldStopThread = false;
 	mediaUpdateThread = std::thread([this]() {
-		while (!shouldStopThread) {
-			if (*enabled) {
-				UpdateMediaInfo();
+		while (pollScheduler.WaitForNextPoll() != PollReason::Shutdown) {
+			if (!*enabled) {
+				pollScheduler.ReportPoll(false, false, mediaSubscribed);
+				continue;
 			}
 
-			// Update every 2 seconds
-			for (int i = 0; i < 20 && !shouldStopThread; ++i) {
-				std::this_thread::sleep_for(std::chrono::milliseconds(100));
-			}
+			bool changed = UpdateMediaInfo();
+			pollScheduler.ReportPoll(changed, lastTimeline.playing, mediaSubscribed);
+		}
+
+		if (mediaSource) {
+			mediaSource->Unsubscribe();
+			mediaSource.reset();
 		}
 		});
 }
 
 void MusicSync::StopMediaUpdateThread()
 {
-	shouldStopThread = true;
+	pollScheduler.Stop();
 	if (mediaUpdateThread.joinable()) {
 		mediaUpdateThread.join();
 	}
 }
 
+void MusicSync::LogMediaStats()
+{
+	MediaSourceStats stats;
+	{
+		std::lock_guard<std::mutex> lock(mediaInfoMutex);
+		stats = mediaStats;
+	}
+
+	auto average = [](uint64_t total, uint64_t count) {
+		return count > 0 ? total / count : 0;
+	};
+
+	LOG("Media fetches: {} (no session: {}, failed: {})", stats.fetches, stats.noSession, stats.failures);
+	LOG("Handle acquisitions: manager {}, session {}", stats.managerAcquisitions, stats.sessionAcquisitions);
+	LOG("Cold fetches: {} avg {} us, {} cycles", stats.coldFetches,
+		average(stats.coldMicros, stats.coldFetches), average(stats.coldCycles, stats.coldFetches));
+	LOG("Warm fetches: {} avg {} us, {} cycles", stats.warmFetches,
+		average(stats.warmMicros, stats.warmFetches), average(stats.warmCycles, stats.warmFetches));
+
+	// The old fixed loop woke every 100 ms no matter what
+	PollSchedulerStats schedule = pollScheduler.GetStats();
+	LOG("Poll period: {} ms, polls: {} timer, {} change, {} refresh", schedule.periodMillis,
+		schedule.timerPolls, schedule.changedPolls, schedule.refreshPolls);
+	LOG("Thread wakeups: {} (fixed 100 ms loop: {})", schedule.threadWakeups, schedule.uptimeMillis / 100);
+}
+
 MediaInfo MusicSync::GetCurrentMedia()
 {
 	std::lock_guard<std::mutex> lock(mediaInfoMutex);
 	return currentMediaInfo;
 }
 
+// Media thread only. The back slot keeps its string buffers between publishes,
+// so assigning into it rarely allocates.
+void MusicSync::PublishMediaSnapshot(const MediaInfo& info, std::shared_ptr<const CoverImage> cover)
+{
+	MediaSnapshot& snapshot = mediaSnapshots.Back();
+	snapshot.info = info;
+	snapshot.cover = std::move(cover);
+	snapshot.generation = ++mediaGeneration;
+	mediaSnapshots.Publish();
+}
+
+const MediaSnapshot& MusicSync::AcquireMediaSnapshot()
+{
+	mediaSnapshots.Acquire();
+	return mediaSnapshots.Front();
+}
+
 void MusicSync::RenderCanvas(CanvasWrapper canvas)
 {
 	// Only render when scoreboard is visible, this actually works in freeplay, may change this to include after match and on main menu
-	if (overlay && isScoreboardVisible) {
-		overlay->RenderOverlay(canvas);
+	if (overlay && isScoreboardVisible && overlay->SelectedBackend() == OverlayBackend::Canvas) {
+		std::lock_guard<std::mutex> lock(overlayRenderMutex);
+		CanvasDrawTarget target(canvas);
+		overlay->RenderOverlay(target);
+	}
+}
+
+// Same visibility rules as RenderCanvas, drawn behind every ImGui window
+void MusicSync::RenderImGuiOverlay()
+{
+	if (overlay && isScoreboardVisible && overlay->SelectedBackend() == OverlayBackend::ImGui) {
+		std::lock_guard<std::mutex> lock(overlayRenderMutex);
+		ImGuiDrawTarget target(ImGui::GetBackgroundDrawList(), GetOverlayFont(), ImGui::GetIO().DisplaySize);
+		overlay->RenderOverlay(target);
+	}
+}
+
+void MusicSync::UpdateOverlayMenu(bool imguiBackend)
+{
+	gameWrapper->Execute([this, imguiBackend](GameWrapper* gw) {
+		if (imguiBackend && !menuOpen) {
+			menuOpenedForOverlay = true;
+			cvarManager->executeCommand("openmenu " + GetMenuName());
+		}
+		else if (!imguiBackend && menuOpen && !isWindowOpen_) {
+			cvarManager->executeCommand("closemenu " + GetMenuName());
+		}
+	});
+}
+
+// LoadFont only reads from the BakkesMod fonts folder, Segoe UI is copied there once.
+// The font is ready a frame later, the default ImGui font stands in until then.
+void MusicSync::LoadOverlayFont()
+{
+	std::filesystem::path fontsDir = gameWrapper->GetDataFolder() / "fonts";
+	std::filesystem::path fontPath = fontsDir / overlayFontFile;
+	std::error_code ec;
+	if (!std::filesystem::exists(fontPath, ec)) {
+		std::filesystem::create_directories(fontsDir, ec);
+		std::filesystem::copy_file(MusicOverlay::SystemFontPaths().front(), fontPath, ec);
+		if (ec) {
+			LOG("Could not copy the overlay font: {}", ec.message());
+			return;
+		}
+	}
+	// Twice the canvas font, the overlay's default text scale
+	auto [result, message] = gameWrapper->GetGUIManager().LoadFont(overlayFontName, overlayFontFile, static_cast<int>(2 * canvasFontPixels));
+	if (result == 0) {
+		LOG("Could not load the overlay font: {}", message);
+	}
+}
+
+ImFont* MusicSync::GetOverlayFont()
+{
+	if (!overlayFont) {
+		overlayFont = gameWrapper->GetGUIManager().GetFont(overlayFontName);
 	}
+	return overlayFont ? overlayFont : ImGui::GetFont();
 }
 
 void MusicSync::openScoreboard(std::string eventName)
@@ -2,13 +2,17 @@
 
 #include "GuiBase.h"
 #include "rendering/Overlay.h"
+#include "media/MediaInfo.h"
+#include "media/MediaSource.h"
+#include "media/PollScheduler.h"
+#include "media/MediaSnapshot.h"
+#include "media/TripleBuffer.h"
+#include "imaging/CoverPipeline.h"
 #include "bakkesmod/plugin/bakkesmodplugin.h"
 #include "bakkesmod/plugin/pluginwindow.h"
 #include "bakkesmod/plugin/PluginSettingsWindow.h"
 
 #include <winrt/Windows.Foundation.h>
-#include <winrt/Windows.Media.Control.h>
-#include <winrt/Windows.Storage.Streams.h>
 #include <thread>
 #include <chrono>
 #include <vector>
@@ -23,27 +27,6 @@
 
 constexpr auto plugin_version = stringify(VERSION_MAJOR) "." stringify(VERSION_MINOR) "." stringify(VERSION_PATCH) "." stringify(VERSION_BUILD);
 
-struct MediaInfo {
-	std::string title;
-	std::string artist;
-	std::string album;
-	std::string albumCoverPath;
-	bool isValid = false;
-	bool hasThumbnail = false;
-
-	// Comparison operator for detecting changes
-	bool operator==(const MediaInfo& other) const {
-		return title == other.title &&
-			artist == other.artist &&
-			album == other.album &&
-			isValid == other.isValid;
-	}
-
-	bool operator!=(const MediaInfo& other) const {
-		return !(*this == other);
-	}
-};
-
 class MusicSync : public BakkesMod::Plugin::BakkesModPlugin, public PluginWindowBase, public SettingsWindowBase
 {
 private:
@@ -51,24 +34,69 @@ private:
 	MediaInfo currentMediaInfo;
 	MediaInfo previousMediaInfo; // Track previous state
 	std::mutex mediaInfoMutex;
+
+	// Lock-free copy of currentMediaInfo for the overlay, the only reader
+	TripleBuffer<MediaSnapshot> mediaSnapshots;
+	uint64_t mediaGeneration = 0; // Media thread only
 	std::thread mediaUpdateThread;
-	std::atomic<bool> shouldStopThread{ false };
+	PollScheduler pollScheduler;
 	std::unique_ptr<MusicOverlay> overlay;
+	// The canvas drawable and ImGui's Render may run on different threads, the overlay is drawn by one at a time
+	std::mutex overlayRenderMutex;
+
+	// The ImGui backend draws from Render, which only runs while the plugin menu
+	// is open. The menu is then kept open without showing the window.
+	std::atomic<bool> menuOpen{ false };
+	std::atomic<bool> menuOpenedForOverlay{ false };
+	ImFont* overlayFont = nullptr; // Render thread only
+	void UpdateOverlayMenu(bool imguiBackend);
+	void LoadOverlayFont();
+	ImFont* GetOverlayFont();
+	void RenderImGuiOverlay();
+
+	// Media source, owned by the media thread. Change events wake it through
+	// pollScheduler; polling continues as a fallback at an adaptive rate.
+	std::unique_ptr<MediaSource> mediaSource;
+	std::atomic<bool> usePreviewSource{ false };
+	bool previewSourceActive = false;
+	bool mediaSubscribed = false;
+	MediaSourceStats mediaStats; // Copy of the source counters, guarded by mediaInfoMutex
+	std::vector<std::string> mediaSessions; // Guarded by mediaInfoMutex
+	SessionPolicy sessionPolicy; // Guarded by mediaInfoMutex, applied by the media thread
+	bool sessionPolicyChanged = true;
+	PlaybackClock playbackClock; // Written by the media thread, read lock-free by the overlay
+	TimelineSample lastTimeline; // Media thread only, used to spot seeks
+
+	// Album covers are decoded in memory by the media thread. Writing the
+	// original bytes to disk is an opt-in export.
+	std::unique_ptr<CoverPipeline> coverPipeline;
+	std::shared_ptr<const CoverImage> currentCover; // Media thread only
+	std::shared_ptr<const CoverImage> publishedCover; // Media thread only, the one in the last snapshot
+	std::string exportedCoverPath; // Media thread only
+	int failedCoverSize = 0; // Media thread only, rescale of the current thumbnail that failed
+	std::atomic<float> coverScale{ 1.0f };
+	std::atomic<bool> exportCover{ false };
+	static constexpr int defaultCoverCacheMegabytes = 32;
+
 	// Simple file paths
-	inline static auto coverFile = "cover.png";
+	inline static auto coverFile = "cover"; // Export gets the extension of the actual image format
 	inline static std::filesystem::path dataDir;
+	inline static auto overlayFontName = "MusicSyncOverlay";
+	inline static auto overlayFontFile = "MusicSyncOverlay.ttf"; // Copy of Segoe UI in the BakkesMod fonts folder
 	inline static std::filesystem::path coverPath;
 
-	// Album cover file saving
-	void SaveAlbumCoverToFile(
-		winrt::Windows::Storage::Streams::IRandomAccessStreamReference thumbnail,
-		const std::string& fileName);
+	// Album cover file handling
 	void CleanupOldAlbumCovers();
+	void LogCoverStats();
+	static std::string AlbumKey(const MediaInfo& info);
 	void InitializePaths();
 
 	// Media control methods
+	void EnsureMediaSource();
 	MediaInfo GetCurrentMediaInfoSync();
-	void UpdateMediaInfo();
+	bool UpdateMediaInfo();
+	void LogMediaStats();
+	void UpdateSessionPolicy();
 	void StartMediaUpdateThread();
 	void StopMediaUpdateThread();
 
@@ -83,6 +111,12 @@ public:
 	void onLoad() override;
 	void onUnload() override;
 	MediaInfo GetCurrentMedia();
+	void PublishMediaSnapshot(const MediaInfo& info, std::shared_ptr<const CoverImage> cover);
+	CoverPipeline* GetCoverPipeline() { return coverPipeline.get(); }
+	static const std::filesystem::path& GetDataDir() { return dataDir; }
+	// Overlay only: picks up the newest snapshot, call once per frame
+	const MediaSnapshot& AcquireMediaSnapshot();
+	const PlaybackClock& GetPlaybackClock() const { return playbackClock; }
 	void RenderCanvas(CanvasWrapper canvas);
 
 	// Scoreboard event handlers
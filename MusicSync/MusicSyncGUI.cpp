@@ -25,25 +25,53 @@ void MusicSync::RenderSettings() {
     // Get CVars
     CVarWrapper enableCvar = cvarManager->getCvar("music_overlay_enabled");
     CVarWrapper coverEnableCvar = cvarManager->getCvar("music_overlay_show_cover");
+    CVarWrapper backdropCvar = cvarManager->getCvar("music_overlay_cover_backdrop");
+    CVarWrapper recentCoversCvar = cvarManager->getCvar("music_overlay_recent_covers");
+    CVarWrapper progressEnableCvar = cvarManager->getCvar("music_overlay_show_progress");
+    CVarWrapper autoWidthCvar = cvarManager->getCvar("music_overlay_auto_width");
+    CVarWrapper marqueeCvar = cvarManager->getCvar("music_overlay_marquee");
+    CVarWrapper transitionCvar = cvarManager->getCvar("music_overlay_transition");
+    CVarWrapper compositedCvar = cvarManager->getCvar("music_overlay_composited");
+    CVarWrapper backendCvar = cvarManager->getCvar("music_overlay_backend");
     CVarWrapper scaleCvar = cvarManager->getCvar("music_overlay_scale");
     CVarWrapper xposCvar = cvarManager->getCvar("music_overlay_x");
     CVarWrapper yposCvar = cvarManager->getCvar("music_overlay_y");
     CVarWrapper textColorCvar = cvarManager->getCvar("music_overlay_text_color");
     CVarWrapper bkgColorCvar = cvarManager->getCvar("music_overlay_background_color");
     CVarWrapper bkgOpacityCvar = cvarManager->getCvar("music_overlay_background_opacity");
+    CVarWrapper cornerRadiusCvar = cvarManager->getCvar("music_overlay_corner_radius");
+    CVarWrapper shadowCvar = cvarManager->getCvar("music_overlay_shadow");
+    CVarWrapper outlineCvar = cvarManager->getCvar("music_overlay_outline");
+    CVarWrapper outlineColorCvar = cvarManager->getCvar("music_overlay_outline_color");
+    CVarWrapper autoThemeCvar = cvarManager->getCvar("music_overlay_auto_theme");
 	CVarWrapper alwaysEnabledCvar = cvarManager->getCvar("music_overlay_always_enabled");
+    CVarWrapper previewCvar = cvarManager->getCvar("musicsync_preview");
 
-    if (!enableCvar || !coverEnableCvar || !scaleCvar || !xposCvar || !yposCvar || 
-        !textColorCvar || !bkgColorCvar || !bkgOpacityCvar || !alwaysEnabledCvar) { 
+    if (!enableCvar || !coverEnableCvar || !backdropCvar || !recentCoversCvar || !progressEnableCvar || !autoWidthCvar || !marqueeCvar || !transitionCvar || !compositedCvar || !backendCvar || !scaleCvar || !xposCvar || !yposCvar || 
+        !textColorCvar || !bkgColorCvar || !bkgOpacityCvar || !cornerRadiusCvar || !shadowCvar || !outlineCvar || !outlineColorCvar || !autoThemeCvar || !alwaysEnabledCvar || !previewCvar) { 
         return; 
     }
 
     LinearColor bkgColor = bkgColorCvar.getColorValue()/255;
     LinearColor textColor = textColorCvar.getColorValue()/255;
     int bkgOpacity = bkgOpacityCvar.getIntValue();
+    int cornerRadius = cornerRadiusCvar.getIntValue();
+    int shadow = shadowCvar.getIntValue();
+    int outline = outlineCvar.getIntValue();
+    LinearColor outlineColor = outlineColorCvar.getColorValue() / 255;
+    bool autoTheme = autoThemeCvar.getBoolValue();
     bool alwaysEnabled = alwaysEnabledCvar.getBoolValue();
     bool enabled = enableCvar.getBoolValue();
     bool coverEnabled = coverEnableCvar.getBoolValue();
+    bool backdrop = backdropCvar.getBoolValue();
+    int recentCovers = recentCoversCvar.getIntValue();
+    bool progressEnabled = progressEnableCvar.getBoolValue();
+    bool autoWidth = autoWidthCvar.getBoolValue();
+    bool marquee = marqueeCvar.getBoolValue();
+    int transition = transitionCvar.getIntValue();
+    bool composited = compositedCvar.getBoolValue();
+    int backend = backendCvar.getIntValue();
+    bool preview = previewCvar.getBoolValue();
     float scale = scaleCvar.getFloatValue();
     float xpos = xposCvar.getFloatValue();  // Now percentage (0-100)
     float ypos = yposCvar.getFloatValue();  // Now percentage (0-100)
@@ -59,6 +87,46 @@ void MusicSync::RenderSettings() {
     if (ImGui::Checkbox("Show Album Cover", &coverEnabled)) {
         coverEnableCvar.setValue(coverEnabled);
     }
+    if (ImGui::Checkbox("Blurred Cover Background", &backdrop)) {
+        backdropCvar.setValue(backdrop);
+    }
+    if (ImGui::SliderInt("Recent Covers", &recentCovers, 0, 8)) {
+        recentCoversCvar.setValue(recentCovers);
+    }
+    if (ImGui::Checkbox("Show Progress Bar", &progressEnabled)) {
+        progressEnableCvar.setValue(progressEnabled);
+    }
+    if (ImGui::Checkbox("Fit Background To Text", &autoWidth)) {
+        autoWidthCvar.setValue(autoWidth);
+    }
+    if (ImGui::Checkbox("Scroll Long Lines", &marquee)) {
+        marqueeCvar.setValue(marquee);
+    }
+    const char* transitionNames[] = { "None", "Fade", "Slide", "Scale" };
+    if (ImGui::Combo("Track Change Animation", &transition, transitionNames, IM_ARRAYSIZE(transitionNames))) {
+        transitionCvar.setValue(transition);
+    }
+    if (ImGui::Checkbox("Draw As One Texture", &composited)) {
+        compositedCvar.setValue(composited);
+    }
+    const char* backendNames[] = { "Canvas", "ImGui" };
+    if (ImGui::Combo("Overlay Renderer", &backend, backendNames, IM_ARRAYSIZE(backendNames))) {
+        backendCvar.setValue(backend);
+    }
+    if (overlay) {
+        // Last complete window of each renderer, switch between them to compare the same content
+        std::lock_guard<std::mutex> lock(overlayRenderMutex);
+        for (int i = 0; i < IM_ARRAYSIZE(backendNames); ++i) {
+            OverlayBackendStats stats = overlay->GetBackendStats(static_cast<OverlayBackend>(i));
+            if (stats.frames == 0) {
+                ImGui::Text("%s: not measured yet", backendNames[i]);
+                continue;
+            }
+            double frameCount = static_cast<double>(stats.frames);
+            ImGui::Text("%s: %.1f us per frame, %.1f draw calls, %.1f batches", backendNames[i],
+                stats.frameNanos / frameCount / 1000.0, stats.drawCalls / frameCount, stats.batches / frameCount);
+        }
+    }
     if (ImGui::Checkbox("Always render", &alwaysEnabled)) {
         if (alwaysEnabled) {
             isScoreboardVisible = true;
@@ -69,7 +137,9 @@ void MusicSync::RenderSettings() {
             alwaysEnabledCvar.setValue(alwaysEnabled);
         }
     }
-      
+    if (ImGui::Checkbox("Preview with sample tracks", &preview)) {
+        previewCvar.setValue(preview);
+    }
 
     if (ImGui::SliderFloat("Overlay Scale", &scale, 0.5f, 2.0f)) {
         scaleCvar.setValue(scale);
@@ -88,6 +158,9 @@ void MusicSync::RenderSettings() {
     ImGui::SameLine();
     ImGui::Text("(%d px)", static_cast<int>((ypos / 100.0f) * screenHeight));
 
+    if (ImGui::Checkbox("Colors From Album Cover", &autoTheme)) {
+        autoThemeCvar.setValue(autoTheme);
+    }
     if (ImGui::ColorEdit4("Text Color", &textColor.R, ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoLabel)) {
         textColorCvar.setValue(textColor * 255);
     }
@@ -97,6 +170,18 @@ void MusicSync::RenderSettings() {
     if (ImGui::SliderInt("Background Opacity", &bkgOpacity, 0, 255)) {
         bkgOpacityCvar.setValue(bkgOpacity);
     };
+    if (ImGui::SliderInt("Corner Radius", &cornerRadius, 0, 32)) {
+        cornerRadiusCvar.setValue(cornerRadius);
+    }
+    if (ImGui::SliderInt("Shadow Size", &shadow, 0, 32)) {
+        shadowCvar.setValue(shadow);
+    }
+    if (ImGui::SliderInt("Outline Width", &outline, 0, 8)) {
+        outlineCvar.setValue(outline);
+    }
+    if (ImGui::ColorEdit4("Outline color", &outlineColor.R, ImGuiColorEditFlags_NoInputs | ImGuiColorEditFlags_NoLabel)) {
+        outlineColorCvar.setValue(outlineColor * 255);
+    }
 }
 
 bool MusicSync::ShouldBlockInput()
@@ -104,23 +189,34 @@ bool MusicSync::ShouldBlockInput()
 	return ImGui::GetIO().WantCaptureMouse || ImGui::GetIO().WantCaptureKeyboard;
 }
 
+// Not while the menu is only open for the ImGui overlay, the game keeps its input
 bool MusicSync::IsActiveOverlay()
 {
-	return true;
+	return isWindowOpen_;
 }
 
 void MusicSync::OnOpen()
 {
-	isWindowOpen_ = true;
+	menuOpen = true;
+	isWindowOpen_ = !menuOpenedForOverlay.exchange(false);
 }
 
 void MusicSync::OnClose()
 {
+	menuOpen = false;
 	isWindowOpen_ = false;
+	// Menus also close on their own, e.g. when the game closes all of them
+	if (overlay && overlay->SelectedBackend() == OverlayBackend::ImGui) {
+		UpdateOverlayMenu(true);
+	}
 }
 
 void MusicSync::Render()
 {
+	RenderImGuiOverlay();
+	if (!isWindowOpen_) {
+		return;
+	}
 
 	if (!ImGui::Begin(menuTitle_.c_str(), &isWindowOpen_, ImGuiWindowFlags_None))
 	{
@@ -0,0 +1,168 @@
+#include "pch.h"
+#include "Blur.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+	constexpr int boxPasses = 3;
+
+	// Running sums of (2r + 1) rows divided by a 16-bit reciprocal: out = ((sum + d / 2) * m) >> 16.
+	// Not an exact division, but the same in every kernel.
+	struct BoxDivisor {
+		uint16_t half;
+		uint16_t multiplier;
+
+		explicit BoxDivisor(int radius)
+		{
+			int size = radius * 2 + 1;
+			half = static_cast<uint16_t>(size / 2);
+			multiplier = static_cast<uint16_t>((65536 + size / 2) / size);
+		}
+	};
+
+	void StepScalar(uint16_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, int start, int bytes,
+		const BoxDivisor& divisor)
+	{
+		for (int i = start; i < bytes; ++i) {
+			uint32_t value = (static_cast<uint32_t>(static_cast<uint16_t>(sums[i] + divisor.half)) * divisor.multiplier) >> 16;
+			out[i] = static_cast<uint8_t>((std::min)(value, 255u));
+			sums[i] = static_cast<uint16_t>(sums[i] + add[i] - sub[i]);
+		}
+	}
+
+	int StepSse2(uint16_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, int bytes, const BoxDivisor& divisor)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i half = _mm_set1_epi16(static_cast<short>(divisor.half));
+		const __m128i multiplier = _mm_set1_epi16(static_cast<short>(divisor.multiplier));
+		int i = 0;
+		for (; i + 16 <= bytes; i += 16) {
+			__m128i* sum = reinterpret_cast<__m128i*>(sums + i);
+			__m128i low = _mm_loadu_si128(sum);
+			__m128i high = _mm_loadu_si128(sum + 1);
+			__m128i outLow = _mm_mulhi_epu16(_mm_add_epi16(low, half), multiplier);
+			__m128i outHigh = _mm_mulhi_epu16(_mm_add_epi16(high, half), multiplier);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(outLow, outHigh));
+
+			__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i));
+			__m128i gone = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + i));
+			low = _mm_sub_epi16(_mm_add_epi16(low, _mm_unpacklo_epi8(in, zero)), _mm_unpacklo_epi8(gone, zero));
+			high = _mm_sub_epi16(_mm_add_epi16(high, _mm_unpackhi_epi8(in, zero)), _mm_unpackhi_epi8(gone, zero));
+			_mm_storeu_si128(sum, low);
+			_mm_storeu_si128(sum + 1, high);
+		}
+		return i;
+	}
+
+	// 16 sums per register. The pack at the end crosses the 128-bit lanes, so
+	// it is done on the halves instead.
+	SIMD_TARGET_AVX2 int StepAvx2(uint16_t* sums, const uint8_t* add, const uint8_t* sub, uint8_t* out, int bytes, const BoxDivisor& divisor)
+	{
+		const __m256i half = _mm256_set1_epi16(static_cast<short>(divisor.half));
+		const __m256i multiplier = _mm256_set1_epi16(static_cast<short>(divisor.multiplier));
+		int i = 0;
+		for (; i + 16 <= bytes; i += 16) {
+			__m256i* sum = reinterpret_cast<__m256i*>(sums + i);
+			__m256i current = _mm256_loadu_si256(sum);
+			__m256i value = _mm256_mulhi_epu16(_mm256_add_epi16(current, half), multiplier);
+			__m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+
+			__m256i in = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i)));
+			__m256i gone = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + i)));
+			_mm256_storeu_si256(sum, _mm256_sub_epi16(_mm256_add_epi16(current, in), gone));
+		}
+		return i;
+	}
+
+	// Box blur down every byte column of src into dst. sums holds rowBytes values.
+	void BoxColumns(const uint8_t* src, uint8_t* dst, int rowBytes, int rows, int radius, SimdLevel simd,
+		uint16_t* sums)
+	{
+		auto row = [&](int y) {
+			return src + static_cast<size_t>(std::clamp(y, 0, rows - 1)) * rowBytes;
+		};
+
+		// Window of the first row, the top edge repeated radius times
+		for (int i = 0; i < rowBytes; ++i) {
+			sums[i] = static_cast<uint16_t>(src[i] * (radius + 1));
+		}
+		for (int k = 1; k <= radius; ++k) {
+			const uint8_t* in = row(k);
+			for (int i = 0; i < rowBytes; ++i) {
+				sums[i] = static_cast<uint16_t>(sums[i] + in[i]);
+			}
+		}
+
+		BoxDivisor divisor(radius);
+		for (int y = 0; y < rows; ++y) {
+			const uint8_t* add = row(y + radius + 1);
+			const uint8_t* sub = row(y - radius);
+			uint8_t* out = dst + static_cast<size_t>(y) * rowBytes;
+			int done = 0;
+			switch (simd) {
+			case SimdLevel::Avx2: done = StepAvx2(sums, add, sub, out, rowBytes, divisor); break;
+			case SimdLevel::Sse2: done = StepSse2(sums, add, sub, out, rowBytes, divisor); break;
+			default: break;
+			}
+			StepScalar(sums, add, sub, out, done, rowBytes, divisor);
+		}
+	}
+
+	// Rows become columns, so the column pass can blur along the other axis
+	void Transpose(const uint8_t* src, uint8_t* dst, int width, int height)
+	{
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				std::memcpy(dst + (static_cast<size_t>(x) * height + y) * 4, src + (static_cast<size_t>(y) * width + x) * 4, 4);
+			}
+		}
+	}
+}
+
+int GaussianBoxRadius(float sigma)
+{
+	// Box width whose three passes have the variance of the Gaussian
+	float width = std::sqrt(12.0f * sigma * sigma / boxPasses + 1.0f);
+	return std::clamp(static_cast<int>(std::lround((width - 1.0f) / 2.0f)), 1, maxBoxRadius);
+}
+
+void BlurGaussian(uint8_t* rgba, int width, int height, float sigma, SimdLevel simd)
+{
+	if (width <= 0 || height <= 0 || sigma <= 0.0f) {
+		return;
+	}
+
+	int radius = GaussianBoxRadius(sigma);
+	size_t bytes = static_cast<size_t>(width) * height * 4;
+	std::vector<uint8_t> buffer(bytes);
+	std::vector<uint16_t> sums(static_cast<size_t>((std::max)(width, height)) * 4);
+
+	// Vertical passes ping-pong between the image and the buffer and end in the
+	// buffer, the transpose brings them back for the horizontal ones
+	for (int pass = 0; pass < boxPasses; ++pass) {
+		const uint8_t* src = pass % 2 == 0 ? rgba : buffer.data();
+		uint8_t* dst = pass % 2 == 0 ? buffer.data() : rgba;
+		BoxColumns(src, dst, width * 4, height, radius, simd, sums.data());
+	}
+	Transpose(buffer.data(), rgba, width, height);
+	for (int pass = 0; pass < boxPasses; ++pass) {
+		const uint8_t* src = pass % 2 == 0 ? rgba : buffer.data();
+		uint8_t* dst = pass % 2 == 0 ? buffer.data() : rgba;
+		BoxColumns(src, dst, height * 4, width, radius, simd, sums.data());
+	}
+	Transpose(buffer.data(), rgba, height, width);
+}
+
+void Darken(uint8_t* rgba, size_t pixels, int brightness)
+{
+	for (size_t i = 0; i < pixels * 4; i += 4) {
+		for (int channel = 0; channel < 3; ++channel) {
+			rgba[i + channel] = static_cast<uint8_t>((rgba[i + channel] * brightness) >> 8);
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "Simd.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Box radius is capped so the running sums of a column fit in 16 bits
+constexpr int maxBoxRadius = 64;
+
+// Approximates a Gaussian of the given sigma with three box blurs along each
+// axis, in place on tightly packed RGBA pixels. Edges repeat the outermost
+// pixels. Integer math throughout, so every kernel produces the same pixels.
+void BlurGaussian(uint8_t* rgba, int width, int height, float sigma, SimdLevel simd = BestSimdLevel());
+
+// Box radius of each of the three passes BlurGaussian uses for sigma
+int GaussianBoxRadius(float sigma);
+
+// Multiplies the color channels by brightness / 256, alpha is left alone
+void Darken(uint8_t* rgba, size_t pixels, int brightness);
@@ -0,0 +1,80 @@
+#include "pch.h"
+#include "BmpWriter.h"
+
+#include <fstream>
+#include <vector>
+
+namespace {
+	constexpr uint32_t fileHeaderSize = 14;
+	constexpr uint32_t infoHeaderSize = 124; // BITMAPV5HEADER, needed for the alpha mask to be honoured
+
+	void Put16(uint8_t*& out, uint16_t value)
+	{
+		*out++ = static_cast<uint8_t>(value);
+		*out++ = static_cast<uint8_t>(value >> 8);
+	}
+
+	void Put32(uint8_t*& out, uint32_t value)
+	{
+		Put16(out, static_cast<uint16_t>(value));
+		Put16(out, static_cast<uint16_t>(value >> 16));
+	}
+}
+
+size_t BmpFileSize(int width, int height)
+{
+	return fileHeaderSize + infoHeaderSize + static_cast<size_t>(width) * height * 4;
+}
+
+bool WriteBmp(const std::filesystem::path& path, const uint8_t* rgba, int width, int height)
+{
+	if (width <= 0 || height <= 0) {
+		return false;
+	}
+
+	std::vector<uint8_t> file(BmpFileSize(width, height), 0);
+	uint8_t* out = file.data();
+
+	// BITMAPFILEHEADER
+	Put16(out, 0x4D42); // "BM"
+	Put32(out, static_cast<uint32_t>(file.size()));
+	Put32(out, 0);
+	Put32(out, fileHeaderSize + infoHeaderSize);
+
+	// BITMAPV5HEADER, negative height for top-down rows
+	uint8_t* info = out;
+	Put32(out, infoHeaderSize);
+	Put32(out, static_cast<uint32_t>(width));
+	Put32(out, static_cast<uint32_t>(-height));
+	Put16(out, 1);  // Planes
+	Put16(out, 32); // Bits per pixel
+	Put32(out, 3);  // BI_BITFIELDS
+	Put32(out, static_cast<uint32_t>(width) * height * 4);
+	Put32(out, 2835); // 72 DPI
+	Put32(out, 2835);
+	Put32(out, 0);
+	Put32(out, 0);
+	Put32(out, 0x00FF0000); // Red mask
+	Put32(out, 0x0000FF00); // Green mask
+	Put32(out, 0x000000FF); // Blue mask
+	Put32(out, 0xFF000000); // Alpha mask
+	Put32(out, 0x73524742); // LCS_sRGB
+	out = info + infoHeaderSize;
+
+	// Pixels are stored BGRA
+	size_t pixels = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < pixels; ++i) {
+		out[0] = rgba[i * 4 + 2];
+		out[1] = rgba[i * 4 + 1];
+		out[2] = rgba[i * 4 + 0];
+		out[3] = rgba[i * 4 + 3];
+		out += 4;
+	}
+
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream.is_open()) {
+		return false;
+	}
+	stream.write(reinterpret_cast<const char*>(file.data()), file.size());
+	return stream.good();
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+// Writes straight-alpha RGBA pixels as an uncompressed top-down 32-bit BMP.
+// Loading it back is a copy, there is nothing to decompress.
+bool WriteBmp(const std::filesystem::path& path, const uint8_t* rgba, int width, int height);
+
+// Size of the file WriteBmp produces
+size_t BmpFileSize(int width, int height);
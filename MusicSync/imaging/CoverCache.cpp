@@ -0,0 +1,363 @@
+#include "pch.h"
+#include "CoverCache.h"
+#include "BmpWriter.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+namespace {
+	constexpr const char* indexFile = "index.txt";
+	constexpr const char* indexHeader = "MusicSyncCoverCache 4";
+
+	uint32_t Get32(const uint8_t* data)
+	{
+		return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+	}
+}
+
+CoverCache::CoverCache(std::filesystem::path directory, uint64_t capacityBytes)
+	: directory(std::move(directory)), capacity(capacityBytes)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(this->directory, ec);
+	LoadIndex();
+}
+
+CoverCache::~CoverCache()
+{
+	if (indexDirty) {
+		SaveIndex();
+	}
+}
+
+void CoverCache::SetCapacity(uint64_t bytes)
+{
+	capacity = bytes;
+}
+
+CoverCacheStats CoverCache::GetStats() const
+{
+	CoverCacheStats current = stats;
+	current.entries = entries.size();
+	current.bytes = totalBytes;
+	return current;
+}
+
+uint64_t CoverCache::Hash(const void* data, size_t size)
+{
+	// FNV-1a, plenty to tell covers apart
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string CoverCache::EntryName(uint64_t contentHash, int maxSize)
+{
+	char name[48];
+	std::snprintf(name, sizeof(name), "%016llx_%d.bmp", static_cast<unsigned long long>(contentHash), maxSize);
+	return name;
+}
+
+std::string CoverCache::BackdropName(uint64_t contentHash, int maxSize)
+{
+	char name[48];
+	std::snprintf(name, sizeof(name), "%016llx_%d_backdrop.bmp", static_cast<unsigned long long>(contentHash), maxSize);
+	return name;
+}
+
+uint64_t CoverCache::EntryBytes(const Entry& entry)
+{
+	uint64_t bytes = BmpFileSize(entry.width, entry.height);
+	if (entry.backdropWidth > 0) {
+		bytes += BmpFileSize(entry.backdropWidth, entry.backdropHeight);
+	}
+	return bytes;
+}
+
+std::filesystem::path CoverCache::EntryPath(const Entry& entry) const
+{
+	return directory / EntryName(entry.contentHash, entry.maxSize);
+}
+
+std::filesystem::path CoverCache::BackdropPath(const Entry& entry) const
+{
+	return directory / BackdropName(entry.contentHash, entry.maxSize);
+}
+
+void CoverCache::RemoveFiles(const Entry& entry)
+{
+	std::error_code ec;
+	std::filesystem::remove(EntryPath(entry), ec);
+	if (entry.backdropWidth > 0) {
+		std::filesystem::remove(BackdropPath(entry), ec);
+	}
+}
+
+bool CoverCache::Find(uint64_t contentHash, int maxSize, const std::shared_ptr<CoverImage>& image)
+{
+	CoverImage& cover = *image;
+	auto it = byName.find(EntryName(contentHash, maxSize));
+	if (it == byName.end()) {
+		return false;
+	}
+
+	Entry& entry = *it->second;
+	std::filesystem::path path = EntryPath(entry);
+	size_t pixelBytes = static_cast<size_t>(entry.width) * entry.height * 4;
+	bool loaded = false;
+	{
+		// Entries are exactly what WriteBmp produced, anything else was tampered with
+		MappedFile file(path);
+		if (file.size == BmpFileSize(entry.width, entry.height) &&
+			file.view[0] == 'B' && file.view[1] == 'M' &&
+			Get32(file.view + 10) == file.size - pixelBytes) {
+			const uint8_t* in = file.view + (file.size - pixelBytes);
+			cover.rgba.resize(pixelBytes);
+			uint8_t* out = cover.rgba.data();
+			for (size_t i = 0; i < pixelBytes; i += 4) {
+				out[i + 0] = in[i + 2];
+				out[i + 1] = in[i + 1];
+				out[i + 2] = in[i + 0];
+				out[i + 3] = in[i + 3];
+			}
+			loaded = true;
+		}
+	}
+
+	if (!loaded) {
+		RemoveFiles(entry);
+		totalBytes -= EntryBytes(entry);
+		entries.erase(it->second);
+		byName.erase(it);
+		indexDirty = true;
+		return false;
+	}
+
+	cover.width = entry.width;
+	cover.height = entry.height;
+	cover.targetSize = entry.maxSize;
+	cover.sourceFormat = entry.sourceFormat;
+	cover.sourceBytes = entry.sourceBytes;
+	cover.sourceWidth = entry.sourceWidth;
+	cover.sourceHeight = entry.sourceHeight;
+	cover.crop = entry.crop;
+	cover.theme = entry.theme;
+	cover.texturePath = path;
+
+	// The texture's size check is enough for the backdrop, the loader rejects a broken file
+	if (entry.backdropWidth > 0) {
+		cover.backdropPath = BackdropPath(entry);
+	}
+
+	// Only the order changed, written with the next insert or on shutdown
+	entry.image = image;
+	entries.splice(entries.begin(), entries, it->second);
+	indexDirty = true;
+	return true;
+}
+
+std::optional<uint64_t> CoverCache::FindAlbum(const std::string& albumKey) const
+{
+	auto it = albums.find(Hash(albumKey.data(), albumKey.size()));
+	if (it == albums.end()) {
+		return std::nullopt;
+	}
+	return it->second;
+}
+
+void CoverCache::SetAlbum(const std::string& albumKey, uint64_t contentHash)
+{
+	uint64_t& cached = albums[Hash(albumKey.data(), albumKey.size())];
+	if (cached != contentHash) {
+		cached = contentHash;
+		indexDirty = true;
+	}
+}
+
+bool CoverCache::Insert(uint64_t contentHash, int maxSize, const std::shared_ptr<CoverImage>& image)
+{
+	CoverImage& cover = *image;
+	Entry entry;
+	entry.contentHash = contentHash;
+	entry.maxSize = maxSize;
+	entry.width = cover.width;
+	entry.height = cover.height;
+	entry.sourceFormat = cover.sourceFormat;
+	entry.sourceBytes = cover.sourceBytes;
+	entry.sourceWidth = cover.sourceWidth;
+	entry.sourceHeight = cover.sourceHeight;
+	entry.crop = cover.crop;
+	entry.theme = cover.theme;
+	entry.image = image;
+
+	std::filesystem::path path = EntryPath(entry);
+	if (!WriteBmp(path, cover.rgba.data(), cover.width, cover.height)) {
+		return false;
+	}
+	cover.texturePath = path;
+
+	// A cover without its backdrop is still worth caching
+	const CoverMip& backdrop = cover.backdrop;
+	if (!backdrop.rgba.empty() && WriteBmp(BackdropPath(entry), backdrop.rgba.data(), backdrop.width, backdrop.height)) {
+		entry.backdropWidth = backdrop.width;
+		entry.backdropHeight = backdrop.height;
+		cover.backdropPath = BackdropPath(entry);
+	}
+
+	std::string name = EntryName(contentHash, maxSize);
+	if (auto existing = byName.find(name); existing != byName.end()) {
+		totalBytes -= EntryBytes(*existing->second);
+		entries.erase(existing->second);
+		byName.erase(existing);
+	}
+	entries.push_front(entry);
+	byName[name] = entries.begin();
+	totalBytes += EntryBytes(entry);
+
+	Evict();
+	SaveIndex();
+	return true;
+}
+
+// Oldest first, skipping covers still in use. Those stay over the cap until
+// an insert after they were released.
+void CoverCache::Evict()
+{
+	for (auto it = entries.end(); totalBytes > capacity && it != entries.begin();) {
+		--it;
+		if (!it->image.expired()) {
+			continue;
+		}
+		RemoveFiles(*it);
+		totalBytes -= EntryBytes(*it);
+		byName.erase(EntryName(it->contentHash, it->maxSize));
+		it = entries.erase(it);
+		stats.evictions++;
+	}
+}
+
+// One line per entry, most recently used first, then the album table:
+//   E <content hash> <max size> <width> <height> <format> <source bytes> <source width> <source height>
+//     <backdrop width> <backdrop height> <crop x> <crop y> <crop width> <crop height>
+//     <theme valid> <background r g b> <text r g b>
+//   A <album key hash> <content hash>
+void CoverCache::LoadIndex()
+{
+	std::ifstream index(directory / indexFile);
+	std::string line;
+	bool valid = std::getline(index, line) && line == indexHeader;
+
+	std::unordered_set<std::string> known;
+	while (valid && std::getline(index, line)) {
+		std::istringstream fields(line);
+		char type = 0;
+		fields >> type >> std::hex;
+		if (type == 'E') {
+			Entry entry;
+			int format = 0;
+			fields >> entry.contentHash >> std::dec >> entry.maxSize >> entry.width >> entry.height >> format
+				>> entry.sourceBytes >> entry.sourceWidth >> entry.sourceHeight >> entry.backdropWidth >> entry.backdropHeight
+				>> entry.crop.x >> entry.crop.y >> entry.crop.width >> entry.crop.height;
+			int theme[7] = {};
+			for (int& value : theme) {
+				fields >> value;
+			}
+			entry.theme.valid = theme[0] != 0;
+			for (int c = 0; c < 3; ++c) {
+				entry.theme.background[c] = static_cast<uint8_t>(theme[1 + c]);
+				entry.theme.text[c] = static_cast<uint8_t>(theme[4 + c]);
+			}
+			entry.sourceFormat = static_cast<ImageFormat>(format);
+
+			std::string name = EntryName(entry.contentHash, entry.maxSize);
+			std::error_code ec;
+			if (!fields || entry.width <= 0 || entry.height <= 0 || byName.contains(name) ||
+				std::filesystem::file_size(directory / name, ec) != BmpFileSize(entry.width, entry.height)) {
+				continue;
+			}
+			std::string backdropName = BackdropName(entry.contentHash, entry.maxSize);
+			if (entry.backdropWidth <= 0 || entry.backdropHeight <= 0 ||
+				std::filesystem::file_size(directory / backdropName, ec) != BmpFileSize(entry.backdropWidth, entry.backdropHeight)) {
+				entry.backdropWidth = 0;
+				entry.backdropHeight = 0;
+			}
+			else {
+				known.insert(backdropName);
+			}
+			entries.push_back(entry);
+			byName[name] = std::prev(entries.end());
+			totalBytes += EntryBytes(entry);
+			known.insert(name);
+		}
+		else if (type == 'A') {
+			uint64_t albumHash = 0;
+			uint64_t contentHash = 0;
+			if (fields >> albumHash >> contentHash) {
+				albums[albumHash] = contentHash;
+			}
+		}
+	}
+
+	// Files the index does not know about were left behind by a crash or an older version
+	std::error_code ec;
+	for (const auto& file : std::filesystem::directory_iterator(directory, ec)) {
+		std::string name = file.path().filename().string();
+		if (name != indexFile && !known.contains(name)) {
+			std::filesystem::remove(file.path(), ec);
+		}
+	}
+
+	Evict();
+	SaveIndex();
+	LOG("Cover cache: {} entries, {} KB", entries.size(), totalBytes / 1024);
+}
+
+void CoverCache::SaveIndex()
+{
+	// Albums whose cover was evicted are dropped with it
+	std::unordered_set<uint64_t> cached;
+	for (const Entry& entry : entries) {
+		cached.insert(entry.contentHash);
+	}
+	std::erase_if(albums, [&](const auto& album) { return !cached.contains(album.second); });
+
+	std::filesystem::path temporary = directory / (std::string(indexFile) + ".tmp");
+	{
+		std::ofstream index(temporary, std::ios::trunc);
+		if (!index.is_open()) {
+			return;
+		}
+		index << indexHeader << '\n';
+		for (const Entry& entry : entries) {
+			index << "E " << std::hex << entry.contentHash << std::dec << ' ' << entry.maxSize << ' ' << entry.width << ' '
+				<< entry.height << ' ' << static_cast<int>(entry.sourceFormat) << ' ' << entry.sourceBytes << ' '
+				<< entry.sourceWidth << ' ' << entry.sourceHeight << ' ' << entry.backdropWidth << ' ' << entry.backdropHeight << ' '
+				<< entry.crop.x << ' ' << entry.crop.y << ' ' << entry.crop.width << ' ' << entry.crop.height << ' '
+				<< entry.theme.valid;
+			for (uint8_t value : entry.theme.background) {
+				index << ' ' << static_cast<int>(value);
+			}
+			for (uint8_t value : entry.theme.text) {
+				index << ' ' << static_cast<int>(value);
+			}
+			index << '\n';
+		}
+		for (const auto& [albumHash, contentHash] : albums) {
+			index << "A " << std::hex << albumHash << ' ' << contentHash << std::dec << '\n';
+		}
+		if (!index.good()) {
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, directory / indexFile, ec);
+	indexDirty = static_cast<bool>(ec);
+}
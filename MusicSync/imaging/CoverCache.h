@@ -0,0 +1,91 @@
+#pragma once
+#include "CoverImage.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+struct CoverCacheStats {
+	uint64_t evictions = 0;
+	uint64_t entries = 0;
+	uint64_t bytes = 0;
+};
+
+// Persistent cache of decoded, pre-scaled covers in the plugin data folder.
+// Entries are keyed by a hash of the thumbnail bytes and the size they were
+// scaled to, and stored as the same uncompressed BMP the canvas loads, so a hit
+// is a file mapping and a copy. A second table maps artist/album to the content
+// hash of the last cover seen for it. The cover's backdrop is stored next to it
+// and goes with it. Least recently used entries are evicted once the byte cap
+// is exceeded, except those whose CoverImage is still held somewhere: the
+// overlay, a transition or the recent strip may have its files loaded. The
+// index is written when entries come or go and on shutdown, not on every hit.
+// Media thread only, except SetCapacity.
+class CoverCache
+{
+public:
+	CoverCache(std::filesystem::path directory, uint64_t capacityBytes);
+	~CoverCache();
+
+	void SetCapacity(uint64_t bytes);
+
+	// Fills cover with the entry for the hash and size, false on a miss.
+	// The entry is not evicted while the cover is alive.
+	bool Find(uint64_t contentHash, int maxSize, const std::shared_ptr<CoverImage>& cover);
+
+	// Content hash of the cover last stored for the album, if any
+	std::optional<uint64_t> FindAlbum(const std::string& albumKey) const;
+	void SetAlbum(const std::string& albumKey, uint64_t contentHash);
+
+	// Writes the cover as a new entry and sets its texturePath, the entry is
+	// not evicted while the cover is alive
+	bool Insert(uint64_t contentHash, int maxSize, const std::shared_ptr<CoverImage>& cover);
+
+	CoverCacheStats GetStats() const;
+
+	static uint64_t Hash(const void* data, size_t size);
+
+private:
+	struct Entry {
+		uint64_t contentHash = 0;
+		int maxSize = 0;
+		int width = 0;
+		int height = 0;
+		ImageFormat sourceFormat = ImageFormat::Unknown;
+		size_t sourceBytes = 0;
+		int sourceWidth = 0;
+		int sourceHeight = 0;
+		int backdropWidth = 0; // 0 without a backdrop
+		int backdropHeight = 0;
+		ImageRect crop;
+		CoverTheme theme;
+		std::weak_ptr<const CoverImage> image; // Last handed out, not persisted
+	};
+	using EntryList = std::list<Entry>;
+
+	static std::string EntryName(uint64_t contentHash, int maxSize);
+	static std::string BackdropName(uint64_t contentHash, int maxSize);
+	static uint64_t EntryBytes(const Entry& entry);
+	std::filesystem::path EntryPath(const Entry& entry) const;
+	std::filesystem::path BackdropPath(const Entry& entry) const;
+	void RemoveFiles(const Entry& entry);
+	void LoadIndex();
+	void SaveIndex();
+	void Evict();
+
+	std::filesystem::path directory;
+	std::atomic<uint64_t> capacity;
+
+	EntryList entries; // Most recently used first
+	std::unordered_map<std::string, EntryList::iterator> byName;
+	std::unordered_map<uint64_t, uint64_t> albums; // Hash of the album key to content hash
+	uint64_t totalBytes = 0;
+	bool indexDirty = false; // Recency or albums changed since the index was written
+
+	CoverCacheStats stats;
+};
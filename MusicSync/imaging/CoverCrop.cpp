@@ -0,0 +1,260 @@
+#include "pch.h"
+#include "CoverCrop.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+	// Borders wider than this are more likely a dark scene than bars
+	constexpr int maxBorderDivisor = 4;
+
+	// Per channel spread of JPEG noise in flat black bars
+	constexpr int borderTolerance = 24;
+
+	// Images this close to the slot's aspect are not cut at all
+	constexpr float aspectTolerance = 0.02f;
+
+	struct Range {
+		uint8_t low[4] = { 255, 255, 255, 255 };
+		uint8_t high[4] = { 0, 0, 0, 0 };
+
+		void Add(const uint8_t* pixel)
+		{
+			for (int c = 0; c < 4; ++c) {
+				low[c] = (std::min)(low[c], pixel[c]);
+				high[c] = (std::max)(high[c], pixel[c]);
+			}
+		}
+
+		void Add(const Range& other)
+		{
+			Add(other.low);
+			Add(other.high);
+		}
+
+		bool Within(int tolerance) const
+		{
+			for (int c = 0; c < 4; ++c) {
+				if (high[c] - low[c] > tolerance) {
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	// Folds 16 bytes of running minimums and maximums down to one pixel each
+	void FoldSse2(__m128i low, __m128i high, Range& range)
+	{
+		low = _mm_min_epu8(low, _mm_srli_si128(low, 8));
+		low = _mm_min_epu8(low, _mm_srli_si128(low, 4));
+		high = _mm_max_epu8(high, _mm_srli_si128(high, 8));
+		high = _mm_max_epu8(high, _mm_srli_si128(high, 4));
+		uint32_t lowPixel = static_cast<uint32_t>(_mm_cvtsi128_si32(low));
+		uint32_t highPixel = static_cast<uint32_t>(_mm_cvtsi128_si32(high));
+		uint8_t bytes[4];
+		std::memcpy(bytes, &lowPixel, 4);
+		range.Add(bytes);
+		std::memcpy(bytes, &highPixel, 4);
+		range.Add(bytes);
+	}
+
+	int RowRangeSse2(const uint8_t* row, int bytes, Range& range)
+	{
+		if (bytes < 16) {
+			return 0;
+		}
+		__m128i low = _mm_set1_epi8(-1);
+		__m128i high = _mm_setzero_si128();
+		int i = 0;
+		for (; i + 16 <= bytes; i += 16) {
+			__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			low = _mm_min_epu8(low, in);
+			high = _mm_max_epu8(high, in);
+		}
+		FoldSse2(low, high, range);
+		return i;
+	}
+
+	SIMD_TARGET_AVX2 int RowRangeAvx2(const uint8_t* row, int bytes, Range& range)
+	{
+		if (bytes < 32) {
+			return RowRangeSse2(row, bytes, range);
+		}
+		__m256i low = _mm256_set1_epi8(-1);
+		__m256i high = _mm256_setzero_si256();
+		int i = 0;
+		for (; i + 32 <= bytes; i += 32) {
+			__m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+			low = _mm256_min_epu8(low, in);
+			high = _mm256_max_epu8(high, in);
+		}
+		FoldSse2(_mm_min_epu8(_mm256_castsi256_si128(low), _mm256_extracti128_si256(low, 1)),
+			_mm_max_epu8(_mm256_castsi256_si128(high), _mm256_extracti128_si256(high, 1)), range);
+		return i + RowRangeSse2(row + i, bytes - i, range);
+	}
+
+	// Channel minimums and maximums of one row, pixels are 4 bytes so every
+	// vector starts on a pixel
+	Range RowRange(const uint8_t* row, int width, SimdLevel simd)
+	{
+		Range range;
+		int bytes = width * 4;
+		int done = 0;
+		switch (simd) {
+		case SimdLevel::Avx2: done = RowRangeAvx2(row, bytes, range); break;
+		case SimdLevel::Sse2: done = RowRangeSse2(row, bytes, range); break;
+		default: break;
+		}
+		for (int i = done; i < bytes; i += 4) {
+			range.Add(row + i);
+		}
+		return range;
+	}
+
+	int ColumnStepSse2(const uint8_t* row, uint8_t* low, uint8_t* high, int bytes)
+	{
+		int i = 0;
+		for (; i + 16 <= bytes; i += 16) {
+			__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			__m128i* lowOut = reinterpret_cast<__m128i*>(low + i);
+			__m128i* highOut = reinterpret_cast<__m128i*>(high + i);
+			_mm_storeu_si128(lowOut, _mm_min_epu8(_mm_loadu_si128(lowOut), in));
+			_mm_storeu_si128(highOut, _mm_max_epu8(_mm_loadu_si128(highOut), in));
+		}
+		return i;
+	}
+
+	SIMD_TARGET_AVX2 int ColumnStepAvx2(const uint8_t* row, uint8_t* low, uint8_t* high, int bytes)
+	{
+		int i = 0;
+		for (; i + 32 <= bytes; i += 32) {
+			__m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+			__m256i* lowOut = reinterpret_cast<__m256i*>(low + i);
+			__m256i* highOut = reinterpret_cast<__m256i*>(high + i);
+			_mm256_storeu_si256(lowOut, _mm256_min_epu8(_mm256_loadu_si256(lowOut), in));
+			_mm256_storeu_si256(highOut, _mm256_max_epu8(_mm256_loadu_si256(highOut), in));
+		}
+		return i;
+	}
+
+	// Minimum and maximum of every byte column over rows y0 to y1, in one pass
+	// down the image instead of one strided walk per column
+	void ColumnRanges(const uint8_t* rgba, int width, int y0, int y1, SimdLevel simd, std::vector<uint8_t>& low,
+		std::vector<uint8_t>& high)
+	{
+		int bytes = width * 4;
+		low.assign(bytes, 255);
+		high.assign(bytes, 0);
+		for (int y = y0; y < y1; ++y) {
+			const uint8_t* row = rgba + static_cast<size_t>(y) * bytes;
+			int done = 0;
+			if (simd == SimdLevel::Avx2) {
+				done = ColumnStepAvx2(row, low.data(), high.data(), bytes);
+			}
+			if (simd != SimdLevel::Scalar) {
+				done += ColumnStepSse2(row + done, low.data() + done, high.data() + done, bytes - done);
+			}
+			for (int i = done; i < bytes; ++i) {
+				low[i] = (std::min)(low[i], row[i]);
+				high[i] = (std::max)(high[i], row[i]);
+			}
+		}
+	}
+
+	// How many lines from one end belong to the border. line(i) is the range of
+	// the i-th line counted from that end.
+	template <typename LineRange>
+	int BorderLength(int lines, int tolerance, LineRange line)
+	{
+		Range border;
+		int length = 0;
+		while (length < lines) {
+			Range next = border;
+			next.Add(line(length));
+			if (!next.Within(tolerance)) {
+				break;
+			}
+			border = next;
+			length++;
+		}
+		return length;
+	}
+}
+
+ImageRect FindUniformBorders(const uint8_t* rgba, int width, int height, int tolerance, SimdLevel simd)
+{
+	ImageRect full{ 0, 0, width, height };
+	if (width <= 0 || height <= 0) {
+		return full;
+	}
+
+	auto row = [&](int y) {
+		return RowRange(rgba + static_cast<size_t>(y) * width * 4, width, simd);
+	};
+	int maxRows = height / maxBorderDivisor;
+	int top = BorderLength(maxRows, tolerance, [&](int i) { return row(i); });
+	// A border as long as allowed may be the whole image, which has nothing to cut
+	if (top > 0 && top == maxRows && BorderLength(height, tolerance, [&](int i) { return row(i); }) == height) {
+		return full;
+	}
+	int bottom = BorderLength(maxRows, tolerance, [&](int i) { return row(height - 1 - i); });
+
+	// Columns are only compared over the rows between the bars, where a
+	// pillarbox is uniform
+	std::vector<uint8_t> low;
+	std::vector<uint8_t> high;
+	ColumnRanges(rgba, width, top, height - bottom, simd, low, high);
+	auto column = [&](int x) {
+		Range range;
+		range.Add(&low[static_cast<size_t>(x) * 4]);
+		range.Add(&high[static_cast<size_t>(x) * 4]);
+		return range;
+	};
+	int maxColumns = width / maxBorderDivisor;
+	int left = BorderLength(maxColumns, tolerance, [&](int i) { return column(i); });
+	if (left > 0 && left == maxColumns && BorderLength(width, tolerance, [&](int i) { return column(i); }) == width) {
+		return full;
+	}
+	int right = BorderLength(maxColumns, tolerance, [&](int i) { return column(width - 1 - i); });
+
+	return ImageRect{ left, top, width - left - right, height - top - bottom };
+}
+
+ImageRect CenterCrop(const ImageRect& bounds, float aspect)
+{
+	ImageRect crop = bounds;
+	if (bounds.width <= 0 || bounds.height <= 0 || aspect <= 0.0f) {
+		return crop;
+	}
+	if (bounds.width > bounds.height * aspect) {
+		crop.width = (std::max)(1, static_cast<int>(std::lround(bounds.height * aspect)));
+		crop.x += (bounds.width - crop.width) / 2;
+	}
+	else {
+		crop.height = (std::max)(1, static_cast<int>(std::lround(bounds.width / aspect)));
+		crop.y += (bounds.height - crop.height) / 2;
+	}
+	return crop;
+}
+
+ImageRect FindCoverCrop(const uint8_t* rgba, int width, int height, float aspect, SimdLevel simd)
+{
+	ImageRect full{ 0, 0, width, height };
+	if (width <= 0 || height <= 0 || std::abs(static_cast<float>(width) / height / aspect - 1.0f) <= aspectTolerance) {
+		return full;
+	}
+	return CenterCrop(FindUniformBorders(rgba, width, height, borderTolerance, simd), aspect);
+}
+
+void CopyRect(const uint8_t* rgba, int width, const ImageRect& rect, uint8_t* dst)
+{
+	size_t rowBytes = static_cast<size_t>(rect.width) * 4;
+	for (int y = 0; y < rect.height; ++y) {
+		const uint8_t* row = rgba + (static_cast<size_t>(rect.y + y) * width + rect.x) * 4;
+		std::memcpy(dst + y * rowBytes, row, rowBytes);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "Simd.h"
+
+#include <cstdint>
+
+struct ImageRect {
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+
+	bool operator==(const ImageRect& other) const = default;
+};
+
+// The part of the image left after removing uniform borders, such as the black
+// bars of a letterboxed video thumbnail. Each border is the run of outermost
+// rows or columns whose pixels all stay within tolerance of each other in every
+// color channel. An image that is uniform all over is returned whole.
+ImageRect FindUniformBorders(const uint8_t* rgba, int width, int height, int tolerance,
+	SimdLevel simd = BestSimdLevel());
+
+// Largest rectangle of the given width / height ratio centered in bounds
+ImageRect CenterCrop(const ImageRect& bounds, float aspect);
+
+// Where to cut a thumbnail so it fills a cover slot of the given aspect: borders
+// are removed, then the rest is center cropped. Images that already have the
+// slot's aspect, like album art, are left alone so a designed frame survives.
+ImageRect FindCoverCrop(const uint8_t* rgba, int width, int height, float aspect,
+	SimdLevel simd = BestSimdLevel());
+
+// Copies the rectangle out of tightly packed RGBA pixels
+void CopyRect(const uint8_t* rgba, int width, const ImageRect& rect, uint8_t* dst);
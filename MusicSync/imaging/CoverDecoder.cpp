@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "CoverDecoder.h"
+
+#include <wincodec.h>
+#include <winrt/base.h>
+
+#include <algorithm>
+
+namespace {
+	// Sniffing first means WIC does not have to probe every installed codec
+	const GUID* ContainerFormat(ImageFormat format)
+	{
+		switch (format) {
+		case ImageFormat::Png: return &GUID_ContainerFormatPng;
+		case ImageFormat::Jpeg: return &GUID_ContainerFormatJpeg;
+		case ImageFormat::Bmp: return &GUID_ContainerFormatBmp;
+		case ImageFormat::Gif: return &GUID_ContainerFormatGif;
+		case ImageFormat::Webp: return &GUID_ContainerFormatWebp;
+		default: return nullptr;
+		}
+	}
+
+	constexpr UINT maxReduction = 8;
+
+	// Largest power of two the image can shrink by with its shorter side still
+	// at least minSize
+	UINT Reduction(UINT width, UINT height, int minSize)
+	{
+		if (minSize <= 0) {
+			return 1;
+		}
+		UINT shorter = (std::min)(width, height);
+		UINT reduction = 1;
+		while (reduction < maxReduction && (shorter + reduction * 2 - 1) / (reduction * 2) >= static_cast<UINT>(minSize)) {
+			reduction *= 2;
+		}
+		return reduction;
+	}
+
+	// JPEG scales while it decodes, in the IDCT, so the full size image is never
+	// produced. Copies the closest size the codec offers if that is the reduced
+	// size, up to a pixel of rounding, in the codec's own pixel format, then wraps it in a
+	// bitmap for the format converter. bytes is the size of that copy.
+	HRESULT DecodeNative(IWICImagingFactory* factory, IWICBitmapFrameDecode* frame, UINT& width, UINT& height,
+		winrt::com_ptr<IWICBitmapSource>& scaled, size_t& bytes)
+	{
+		winrt::com_ptr<IWICBitmapSourceTransform> transform;
+		HRESULT hr = frame->QueryInterface(IID_PPV_ARGS(transform.put()));
+		UINT closestWidth = width;
+		UINT closestHeight = height;
+		if (SUCCEEDED(hr)) hr = transform->GetClosestSize(&closestWidth, &closestHeight);
+		if (FAILED(hr) || closestWidth > width || closestHeight > height || closestWidth + 1 < width || closestHeight + 1 < height) {
+			return E_NOTIMPL;
+		}
+
+		WICPixelFormatGUID pixelFormat = GUID_WICPixelFormat32bppRGBA;
+		hr = transform->GetClosestPixelFormat(&pixelFormat);
+		winrt::com_ptr<IWICComponentInfo> info;
+		winrt::com_ptr<IWICPixelFormatInfo> formatInfo;
+		UINT bitsPerPixel = 0;
+		if (SUCCEEDED(hr)) hr = factory->CreateComponentInfo(pixelFormat, info.put());
+		if (SUCCEEDED(hr)) hr = info->QueryInterface(IID_PPV_ARGS(formatInfo.put()));
+		if (SUCCEEDED(hr)) hr = formatInfo->GetBitsPerPixel(&bitsPerPixel);
+		if (FAILED(hr)) {
+			return hr;
+		}
+
+		UINT stride = (closestWidth * bitsPerPixel + 31) / 32 * 4;
+		std::vector<uint8_t> pixels(static_cast<size_t>(stride) * closestHeight);
+		hr = transform->CopyPixels(nullptr, closestWidth, closestHeight, &pixelFormat, WICBitmapTransformRotate0, stride,
+			static_cast<UINT>(pixels.size()), pixels.data());
+
+		// Copied into the bitmap, the vector only lives as long as this call
+		winrt::com_ptr<IWICBitmap> bitmap;
+		if (SUCCEEDED(hr)) hr = factory->CreateBitmapFromMemory(closestWidth, closestHeight, pixelFormat, stride,
+			static_cast<UINT>(pixels.size()), pixels.data(), bitmap.put());
+		if (FAILED(hr)) {
+			return hr;
+		}
+		width = closestWidth;
+		height = closestHeight;
+		scaled.copy_from(bitmap.get());
+		bytes = pixels.size();
+		return S_OK;
+	}
+}
+
+long DecodeCover(const std::vector<uint8_t>& bytes, ImageFormat format, int minSize, CoverImage& out, CoverDecodeStats* stats)
+{
+	const GUID* container = ContainerFormat(format);
+	if (container == nullptr || bytes.empty()) {
+		return WINCODEC_ERR_UNKNOWNIMAGEFORMAT;
+	}
+
+	// Created per cover, this runs once per track and a cached factory would
+	// outlive COM on the media thread
+	winrt::com_ptr<IWICImagingFactory> factory;
+	HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.put()));
+
+	winrt::com_ptr<IWICStream> stream;
+	if (SUCCEEDED(hr)) hr = factory->CreateStream(stream.put());
+	if (SUCCEEDED(hr)) hr = stream->InitializeFromMemory(const_cast<BYTE*>(bytes.data()), static_cast<DWORD>(bytes.size()));
+
+	winrt::com_ptr<IWICBitmapDecoder> decoder;
+	if (SUCCEEDED(hr)) hr = factory->CreateDecoder(*container, nullptr, decoder.put());
+	if (SUCCEEDED(hr)) hr = decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand);
+
+	winrt::com_ptr<IWICBitmapFrameDecode> frame;
+	if (SUCCEEDED(hr)) hr = decoder->GetFrame(0, frame.put());
+
+	UINT sourceWidth = 0;
+	UINT sourceHeight = 0;
+	if (SUCCEEDED(hr)) hr = frame->GetSize(&sourceWidth, &sourceHeight);
+	if (FAILED(hr)) {
+		return hr;
+	}
+
+	// Formats without native scaling, PNG among them, go through the WIC Fant
+	// scaler, which pulls full size rows from the decoder as it needs them
+	UINT reduction = Reduction(sourceWidth, sourceHeight, minSize);
+	UINT width = (sourceWidth + reduction - 1) / reduction;
+	UINT height = (sourceHeight + reduction - 1) / reduction;
+	winrt::com_ptr<IWICBitmapSource> source;
+	source.copy_from(frame.get());
+	size_t nativeBytes = 0;
+	bool native = false;
+	if (reduction > 1) {
+		winrt::com_ptr<IWICBitmapSource> scaled;
+		native = format == ImageFormat::Jpeg && SUCCEEDED(DecodeNative(factory.get(), frame.get(), width, height, scaled, nativeBytes));
+		if (!native) {
+			winrt::com_ptr<IWICBitmapScaler> scaler;
+			hr = factory->CreateBitmapScaler(scaler.put());
+			if (SUCCEEDED(hr)) hr = scaler->Initialize(frame.get(), width, height, WICBitmapInterpolationModeFant);
+			if (SUCCEEDED(hr)) scaled.copy_from(scaler.get());
+		}
+		if (FAILED(hr)) {
+			return hr;
+		}
+		source = scaled;
+	}
+
+	winrt::com_ptr<IWICFormatConverter> converter;
+	hr = factory->CreateFormatConverter(converter.put());
+	if (SUCCEEDED(hr)) hr = converter->Initialize(source.get(), GUID_WICPixelFormat32bppRGBA,
+		WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+	if (SUCCEEDED(hr)) hr = converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(pixels.size()), pixels.data());
+	if (FAILED(hr)) {
+		return hr;
+	}
+
+	if (stats) {
+		stats->reduction = static_cast<int>(reduction);
+		stats->native = native;
+		// The codec's copy and the bitmap made from it, then the bitmap and the RGBA
+		stats->peakBytes = (std::max)(nativeBytes * 2, nativeBytes + pixels.size());
+	}
+	out.width = static_cast<int>(width);
+	out.height = static_cast<int>(height);
+	out.rgba = std::move(pixels);
+	out.sourceFormat = format;
+	out.sourceBytes = bytes.size();
+	out.sourceWidth = static_cast<int>(sourceWidth);
+	out.sourceHeight = static_cast<int>(sourceHeight);
+	return S_OK;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "CoverImage.h"
+
+#include <cstdint>
+#include <vector>
+
+struct CoverDecodeStats {
+	int reduction = 1;    // Power of two the image was decoded smaller by
+	bool native = false;  // Scaled by the codec itself, JPEG's IDCT scaling
+	size_t peakBytes = 0; // Pixel buffers held at once, WIC's own state not counted
+};
+
+// Decodes encoded cover bytes into RGBA with WIC. Large images are decoded
+// smaller by the biggest power of two, up to 8, that keeps their shorter side
+// at least minSize, so they never exist as full size RGBA; 0 decodes at full
+// size. The rest of the scaling is left to the resampler. Returns the failing
+// HRESULT.
+long DecodeCover(const std::vector<uint8_t>& bytes, ImageFormat format, int minSize, CoverImage& out,
+	CoverDecodeStats* stats = nullptr);
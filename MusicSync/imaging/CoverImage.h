@@ -0,0 +1,51 @@
+#pragma once
+#include "ImageFormat.h"
+#include "CoverCrop.h"
+#include "Palette.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+struct CoverMip {
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> rgba;
+};
+
+// A decoded album cover, ready to be put on screen. Produced once per cover by
+// the media thread and shared read-only with the overlay.
+struct CoverImage {
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> rgba; // Straight alpha, tightly packed rows
+	int targetSize = 0;        // The longer side was resampled to this for the current overlay scale
+
+	// Half size each, down to a few pixels. For effects that want a small copy, not for drawing.
+	std::vector<CoverMip> mips;
+
+	ImageFormat sourceFormat = ImageFormat::Unknown;
+	size_t sourceBytes = 0;
+	int sourceWidth = 0;
+	int sourceHeight = 0;
+	// Part of the decoded image that was kept, borders and sides of video
+	// thumbnails are cut so they fill the cover slot
+	ImageRect crop;
+
+	// Uncompressed copy the canvas can load without decoding, see CoverPipeline
+	std::filesystem::path texturePath;
+
+	// Blurred and darkened small copy for the overlay background, stretched when
+	// drawn. Its pixels are only kept until the cache has written them.
+	CoverMip backdrop;
+	std::filesystem::path backdropPath;
+
+	// Colors for the automatic theme, from a palette of a small mip
+	CoverTheme theme;
+};
+
+// Cover edge length in pixels at overlay scale 1. The overlay was laid out
+// around 544px covers drawn at 0.2x.
+constexpr float coverDisplaySize = 0.2f * 544.0f;
+// Width / height of the cover slot
+constexpr float coverAspect = 1.0f;
@@ -0,0 +1,303 @@
+#include "pch.h"
+#include "CoverPipeline.h"
+#include "CoverDecoder.h"
+#include "BmpWriter.h"
+#include "Resampler.h"
+#include "Blur.h"
+#include "CoverCrop.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+namespace {
+	constexpr int smallestMip = 8;
+	constexpr size_t maxMips = 4;
+
+	// The backdrop is blurred from the smallest mip at least this long. The blur
+	// hides how few pixels it has once stretched over the background.
+	constexpr int backdropMinSize = 32;
+	constexpr float backdropSigma = 0.1f;  // Of the backdrop's longer side
+	constexpr int backdropBrightness = 112; // Of 256, keeps white text readable
+
+	// The palette is taken from the largest mip no longer than this, a few
+	// thousand pixels hold all the colors that matter
+	constexpr int paletteMaxSize = 64;
+	constexpr int paletteColors = 8;
+	// Hard limit on the extraction, past it the cover gets no theme rather
+	// than holding up the next track
+	constexpr auto paletteBudget = std::chrono::milliseconds(2);
+}
+
+CoverPipeline::CoverPipeline(std::filesystem::path cacheDirectory, uint64_t cacheBytes)
+	: cache(std::move(cacheDirectory), cacheBytes)
+{
+	stats.cache = cache.GetStats();
+}
+
+void CoverPipeline::SetCacheCapacity(uint64_t bytes)
+{
+	cache.SetCapacity(bytes);
+}
+
+std::shared_ptr<const CoverImage> CoverPipeline::FindAlbum(const std::string& albumKey, int maxSize)
+{
+	std::optional<uint64_t> contentHash = cache.FindAlbum(albumKey);
+	if (!contentHash) {
+		return nullptr;
+	}
+
+	std::shared_ptr<const CoverImage> cover = LoadCached(*contentHash, maxSize);
+	if (cover) {
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.albumHits++;
+	}
+	return cover;
+}
+
+std::shared_ptr<const CoverImage> CoverPipeline::Process(const std::vector<uint8_t>& bytes, int maxSize, const std::string& albumKey)
+{
+	if (bytes.empty()) {
+		return nullptr;
+	}
+
+	uint64_t contentHash = CoverCache::Hash(bytes.data(), bytes.size());
+	if (!albumKey.empty()) {
+		cache.SetAlbum(albumKey, contentHash);
+	}
+	if (auto cover = LoadCached(contentHash, maxSize)) {
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.cacheHits++;
+		return cover;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto cover = std::make_shared<CoverImage>();
+	ImageFormat format = SniffImageFormat(bytes.data(), bytes.size());
+	CoverDecodeStats decodeStats;
+	long hr = DecodeCover(bytes, format, maxSize, *cover, &decodeStats);
+	uint64_t decodedPixels = hr >= 0 ? static_cast<uint64_t>(cover->width) * cover->height : 0;
+	auto cropStart = std::chrono::steady_clock::now();
+	bool cropped = hr >= 0 && Crop(*cover);
+
+	// Exact size for the overlay, up or down, so the canvas draws it 1:1
+	auto resampleStart = std::chrono::steady_clock::now();
+	uint64_t resampledPixels = 0;
+	if (hr >= 0) {
+		double fit = static_cast<double>(maxSize) / (std::max)(cover->width, cover->height);
+		int width = (std::max)(1, static_cast<int>(std::lround(cover->width * fit)));
+		int height = (std::max)(1, static_cast<int>(std::lround(cover->height * fit)));
+		if (width != cover->width || height != cover->height) {
+			std::vector<uint8_t> resampled(static_cast<size_t>(width) * height * 4);
+			ResampleLanczos(cover->rgba.data(), cover->width, cover->height, resampled.data(), width, height);
+			resampledPixels = static_cast<uint64_t>(cover->width) * cover->height;
+			cover->rgba = std::move(resampled);
+			cover->width = width;
+			cover->height = height;
+		}
+		cover->targetSize = maxSize;
+		BuildMips(*cover);
+	}
+	auto resampleEnd = std::chrono::steady_clock::now();
+	if (hr >= 0) {
+		BuildBackdrop(*cover);
+	}
+	auto backdropEnd = std::chrono::steady_clock::now();
+	auto backdropMicros = std::chrono::duration_cast<std::chrono::microseconds>(backdropEnd - resampleEnd).count();
+	bool themed = hr >= 0 && BuildTheme(*cover);
+	auto themeMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - backdropEnd).count();
+	auto resampleMicros = std::chrono::duration_cast<std::chrono::microseconds>(resampleEnd - resampleStart).count();
+	auto cropMicros = std::chrono::duration_cast<std::chrono::microseconds>(resampleStart - cropStart).count();
+
+	bool written = hr >= 0 && cache.Insert(contentHash, maxSize, cover);
+	// The backdrop's pixels were only needed for the file
+	cover->backdrop = CoverMip{};
+	auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.cacheMisses++;
+	stats.cache = cache.GetStats();
+	if (!written) {
+		LOG("Failed to process album cover ({} bytes, {}): 0x{:08X}", bytes.size(), ImageFormatExtension(format), static_cast<uint32_t>(hr));
+		stats.failures++;
+		return nullptr;
+	}
+
+	stats.decoded++;
+	stats.decodeMicros += micros;
+	stats.decodedPixels += decodedPixels;
+	if (decodeStats.reduction > 1) {
+		stats.reducedDecodes++;
+	}
+	stats.resampleMicros += resampleMicros;
+	stats.resampledPixels += resampledPixels;
+	stats.cropMicros += cropMicros;
+	if (cropped) {
+		stats.cropped++;
+	}
+	if (themed) {
+		stats.themes++;
+		stats.themeMicros += themeMicros;
+	}
+	else {
+		stats.themesOverBudget++;
+	}
+	if (!cover->backdropPath.empty()) {
+		stats.backdrops++;
+		stats.backdropMicros += backdropMicros;
+	}
+	stats.textureBytesWritten += BmpFileSize(cover->width, cover->height);
+	RecordCover(*cover);
+	return cover;
+}
+
+std::shared_ptr<const CoverImage> CoverPipeline::LoadCached(uint64_t contentHash, int maxSize)
+{
+	auto start = std::chrono::steady_clock::now();
+	auto cover = std::make_shared<CoverImage>();
+	if (!cache.Find(contentHash, maxSize, cover)) {
+		return nullptr;
+	}
+	BuildMips(*cover);
+	auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.cacheMicros += micros;
+	stats.cache = cache.GetStats();
+	RecordCover(*cover);
+	return cover;
+}
+
+// Video thumbnails come letterboxed or wider than the slot, cut them before
+// resampling so the slot is filled and no pixels are scaled only to be dropped.
+// False if the whole image was kept.
+bool CoverPipeline::Crop(CoverImage& cover)
+{
+	cover.crop = FindCoverCrop(cover.rgba.data(), cover.width, cover.height, coverAspect);
+	if (cover.crop.width == cover.width && cover.crop.height == cover.height) {
+		return false;
+	}
+	std::vector<uint8_t> cropped(static_cast<size_t>(cover.crop.width) * cover.crop.height * 4);
+	CopyRect(cover.rgba.data(), cover.width, cover.crop, cropped.data());
+	cover.rgba = std::move(cropped);
+	cover.width = cover.crop.width;
+	cover.height = cover.crop.height;
+	return true;
+}
+
+void CoverPipeline::BuildMips(CoverImage& cover)
+{
+	cover.mips.clear();
+	cover.mips.reserve(maxMips);
+	const uint8_t* pixels = cover.rgba.data();
+	int width = cover.width;
+	int height = cover.height;
+	while (cover.mips.size() < maxMips && (std::min)(width, height) >= smallestMip * 2) {
+		CoverMip mip;
+		mip.width = (width + 1) / 2;
+		mip.height = (height + 1) / 2;
+		mip.rgba.resize(static_cast<size_t>(mip.width) * mip.height * 4);
+		DownsampleBox(pixels, width, height, mip.rgba.data());
+		cover.mips.push_back(std::move(mip));
+
+		pixels = cover.mips.back().rgba.data();
+		width = cover.mips.back().width;
+		height = cover.mips.back().height;
+	}
+}
+
+// Downsampling first makes the blur cheap, a wide blur of the full cover would
+// cost tens of times more and look the same once darkened and stretched
+void CoverPipeline::BuildBackdrop(CoverImage& cover)
+{
+	const CoverMip* source = nullptr;
+	for (const CoverMip& mip : cover.mips) {
+		if ((std::max)(mip.width, mip.height) >= backdropMinSize) {
+			source = &mip;
+		}
+	}
+
+	CoverMip& backdrop = cover.backdrop;
+	if (source) {
+		backdrop = *source;
+	}
+	else {
+		backdrop.width = cover.width;
+		backdrop.height = cover.height;
+		backdrop.rgba = cover.rgba;
+	}
+	if (backdrop.rgba.empty()) {
+		return;
+	}
+
+	float sigma = (std::max)(backdrop.width, backdrop.height) * backdropSigma;
+	BlurGaussian(backdrop.rgba.data(), backdrop.width, backdrop.height, sigma);
+	Darken(backdrop.rgba.data(), static_cast<size_t>(backdrop.width) * backdrop.height, backdropBrightness);
+}
+
+// False if the palette took longer than its budget
+bool CoverPipeline::BuildTheme(CoverImage& cover)
+{
+	const uint8_t* pixels = cover.rgba.data();
+	int width = cover.width;
+	int height = cover.height;
+	for (const CoverMip& mip : cover.mips) {
+		if ((std::max)(width, height) <= paletteMaxSize) {
+			break;
+		}
+		pixels = mip.rgba.data();
+		width = mip.width;
+		height = mip.height;
+	}
+
+	std::vector<PaletteColor> palette;
+	if (!ExtractPalette(pixels, width, height, paletteColors, std::chrono::steady_clock::now() + paletteBudget, palette)) {
+		return false;
+	}
+	cover.theme = PickTheme(palette);
+	return true;
+}
+
+// Callers hold statsMutex
+void CoverPipeline::RecordCover(const CoverImage& cover)
+{
+	stats.covers++;
+	stats.sourceBytes += cover.sourceBytes;
+	stats.sourcePixels += static_cast<uint64_t>(cover.sourceWidth) * cover.sourceHeight;
+	stats.texturePixels += static_cast<uint64_t>(cover.width) * cover.height;
+}
+
+std::filesystem::path CoverPipeline::Export(const std::vector<uint8_t>& bytes, const std::filesystem::path& basePath)
+{
+	if (bytes.empty()) {
+		return {};
+	}
+
+	std::filesystem::path path = basePath;
+	path += ImageFormatExtension(SniffImageFormat(bytes.data(), bytes.size()));
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		LOG("Failed to open file for writing: {}", path.string());
+		return {};
+	}
+	file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.exportBytesWritten += bytes.size();
+	return path;
+}
+
+void CoverPipeline::RecordTextureLoad(uint64_t micros)
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.textureLoads++;
+	stats.textureLoadMicros += micros;
+}
+
+CoverPipelineStats CoverPipeline::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
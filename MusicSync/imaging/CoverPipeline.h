@@ -0,0 +1,85 @@
+#pragma once
+#include "CoverImage.h"
+#include "CoverCache.h"
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct CoverPipelineStats {
+	uint64_t covers = 0;              // Shown, decoded or from the cache
+	uint64_t decoded = 0;
+	uint64_t failures = 0;
+	uint64_t sourceBytes = 0;         // Encoded bytes received from media apps
+	uint64_t sourcePixels = 0;        // What the render thread used to decode
+	uint64_t decodedPixels = 0;       // What the media thread decodes, large sources are decoded smaller
+	uint64_t reducedDecodes = 0;
+	uint64_t decodeMicros = 0;        // Spent on the media thread
+	uint64_t resampleMicros = 0;      // Part of decodeMicros
+	uint64_t resampledPixels = 0;     // Source pixels fed to the resampler
+	uint64_t cropped = 0;             // Thumbnails cut to fill the cover slot
+	uint64_t cropMicros = 0;          // Part of decodeMicros
+	uint64_t themes = 0;
+	uint64_t themeMicros = 0;         // Part of decodeMicros
+	uint64_t themesOverBudget = 0;    // Given up on, the overlay keeps the set colors
+	uint64_t backdrops = 0;
+	uint64_t backdropMicros = 0;      // Part of decodeMicros
+	uint64_t textureBytesWritten = 0; // Uncompressed textures added to the cache
+	uint64_t texturePixels = 0;
+	uint64_t exportBytesWritten = 0;
+	uint64_t textureLoads = 0;
+	uint64_t textureLoadMicros = 0;   // Spent on the render thread
+
+	uint64_t cacheHits = 0;           // Same bytes seen before, decode and scaling skipped
+	uint64_t albumHits = 0;           // Known album, the thumbnail was not even read
+	uint64_t cacheMisses = 0;
+	uint64_t cacheMicros = 0;         // Spent loading hits
+	CoverCacheStats cache;
+};
+
+// Turns thumbnail bytes into a CoverImage off the game thread, once per cover
+// and scale: sniff the format, decode no larger than needed, crop video
+// thumbnails to the cover slot and resample to the exact size the overlay
+// draws at. The backdrop blur and theme colors come from the small mips. The
+// canvas can only load textures from files, so the result is kept as an
+// uncompressed BMP in the CoverCache under a name unique per cover and size;
+// no file is rewritten while the overlay may still have it loaded.
+class CoverPipeline
+{
+public:
+	CoverPipeline(std::filesystem::path cacheDirectory, uint64_t cacheBytes);
+
+	// Media thread. The cover last seen for the album at this size, without
+	// reading or decoding anything. Returns nullptr if there is none.
+	std::shared_ptr<const CoverImage> FindAlbum(const std::string& albumKey, int maxSize);
+
+	// Media thread. Returns nullptr if the bytes could not be decoded. Bytes seen
+	// before are served from the cache. A non-empty albumKey is remembered for FindAlbum.
+	std::shared_ptr<const CoverImage> Process(const std::vector<uint8_t>& bytes, int maxSize, const std::string& albumKey);
+
+	void SetCacheCapacity(uint64_t bytes);
+
+	// Media thread. Writes the original bytes as basePath plus the real extension
+	// and returns the path written, empty on failure.
+	std::filesystem::path Export(const std::vector<uint8_t>& bytes, const std::filesystem::path& basePath);
+
+	// Render thread
+	void RecordTextureLoad(uint64_t micros);
+
+	CoverPipelineStats GetStats() const;
+
+private:
+	std::shared_ptr<const CoverImage> LoadCached(uint64_t contentHash, int maxSize);
+	static bool Crop(CoverImage& cover);
+	static void BuildMips(CoverImage& cover);
+	static void BuildBackdrop(CoverImage& cover);
+	static bool BuildTheme(CoverImage& cover);
+	void RecordCover(const CoverImage& cover);
+
+	CoverCache cache; // Media thread only
+
+	mutable std::mutex statsMutex;
+	CoverPipelineStats stats;
+};
@@ -0,0 +1,30 @@
+#include "pch.h"
+#include "ImageFormat.h"
+
+#include <cstring>
+
+ImageFormat SniffImageFormat(const uint8_t* data, size_t size)
+{
+	auto startsWith = [&](const char* magic, size_t length, size_t offset = 0) {
+		return size >= offset + length && std::memcmp(data + offset, magic, length) == 0;
+	};
+
+	if (startsWith("\x89PNG\r\n\x1a\n", 8)) return ImageFormat::Png;
+	if (startsWith("\xff\xd8\xff", 3)) return ImageFormat::Jpeg;
+	if (startsWith("GIF87a", 6) || startsWith("GIF89a", 6)) return ImageFormat::Gif;
+	if (startsWith("RIFF", 4) && startsWith("WEBP", 4, 8)) return ImageFormat::Webp;
+	if (startsWith("BM", 2)) return ImageFormat::Bmp;
+	return ImageFormat::Unknown;
+}
+
+const char* ImageFormatExtension(ImageFormat format)
+{
+	switch (format) {
+	case ImageFormat::Png: return ".png";
+	case ImageFormat::Jpeg: return ".jpg";
+	case ImageFormat::Bmp: return ".bmp";
+	case ImageFormat::Gif: return ".gif";
+	case ImageFormat::Webp: return ".webp";
+	default: return ".bin";
+	}
+}
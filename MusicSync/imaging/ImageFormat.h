@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum class ImageFormat {
+	Unknown,
+	Png,
+	Jpeg,
+	Bmp,
+	Gif,
+	Webp
+};
+
+// Identifies an encoded image from its magic bytes. Media apps hand out JPEG
+// and PNG thumbnails under the same API, so the extension cannot be trusted.
+ImageFormat SniffImageFormat(const uint8_t* data, size_t size);
+
+// File extension including the dot, ".bin" for unknown data
+const char* ImageFormatExtension(ImageFormat format);
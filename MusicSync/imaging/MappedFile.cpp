@@ -0,0 +1,30 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#include <winrt/base.h>
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	winrt::file_handle file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+	LARGE_INTEGER fileSize{};
+	if (!file || !GetFileSizeEx(file.get(), &fileSize) || fileSize.QuadPart == 0) {
+		return;
+	}
+
+	winrt::handle mapping{ CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr) };
+	if (!mapping) {
+		return;
+	}
+	view = static_cast<const uint8_t*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+	if (view != nullptr) {
+		size = static_cast<size_t>(fileSize.QuadPart);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (view != nullptr) {
+		UnmapViewOfFile(view);
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+// Read-only view of a whole file, unmapped on destruction. Empty if the file
+// is missing or empty.
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* view = nullptr;
+	size_t size = 0;
+};
@@ -0,0 +1,296 @@
+#include "pch.h"
+#include "Palette.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Rows of the image counted between looks at the clock
+	constexpr int deadlineRows = 16;
+
+	// Palette colors closer than this are one color to PickTheme
+	constexpr int mergeDistance = 32;
+
+	// Counter index of a pixel that is not counted, one past the last
+	constexpr uint32_t skippedIndex = paletteBins * paletteLanes;
+
+	uint32_t Key(const uint8_t* pixel)
+	{
+		return static_cast<uint32_t>(pixel[0] >> 4) << 8 | static_cast<uint32_t>(pixel[1] >> 4) << 4 | (pixel[2] >> 4);
+	}
+
+	void Count(const uint32_t* indices, int n, uint32_t* counts)
+	{
+		for (int i = 0; i < n; ++i) {
+			if (indices[i] != skippedIndex) {
+				counts[indices[i]]++;
+			}
+		}
+	}
+
+	// Counter indices of four pixels at once, the increments stay scalar since
+	// there is no scatter. Pixels are read as little-endian RGBA words.
+	size_t HistogramSse2(const uint8_t* rgba, size_t pixels, uint32_t* counts)
+	{
+		const __m128i four = _mm_set1_epi32(0xF);
+		const __m128i opaque = _mm_set1_epi32(127);
+		const __m128i skipped = _mm_set1_epi32(static_cast<int>(skippedIndex));
+		const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+		alignas(16) uint32_t indices[4];
+		size_t i = 0;
+		for (; i + 4 <= pixels; i += 4) {
+			__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + i * 4));
+			__m128i r = _mm_and_si128(_mm_srli_epi32(in, 4), four);
+			__m128i g = _mm_and_si128(_mm_srli_epi32(in, 12), four);
+			__m128i b = _mm_and_si128(_mm_srli_epi32(in, 20), four);
+			__m128i key = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 8), _mm_slli_epi32(g, 4)), b);
+			__m128i index = _mm_or_si128(_mm_slli_epi32(key, 2), lanes);
+			__m128i counted = _mm_cmpgt_epi32(_mm_srli_epi32(in, 24), opaque);
+			index = _mm_or_si128(_mm_and_si128(counted, index), _mm_andnot_si128(counted, skipped));
+			_mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+			Count(indices, 4, counts);
+		}
+		return i;
+	}
+
+	SIMD_TARGET_AVX2 size_t HistogramAvx2(const uint8_t* rgba, size_t pixels, uint32_t* counts)
+	{
+		const __m256i four = _mm256_set1_epi32(0xF);
+		const __m256i opaque = _mm256_set1_epi32(127);
+		const __m256i skipped = _mm256_set1_epi32(static_cast<int>(skippedIndex));
+		const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 0, 1, 2, 3);
+		alignas(32) uint32_t indices[8];
+		size_t i = 0;
+		for (; i + 8 <= pixels; i += 8) {
+			__m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + i * 4));
+			__m256i r = _mm256_and_si256(_mm256_srli_epi32(in, 4), four);
+			__m256i g = _mm256_and_si256(_mm256_srli_epi32(in, 12), four);
+			__m256i b = _mm256_and_si256(_mm256_srli_epi32(in, 20), four);
+			__m256i key = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 8), _mm256_slli_epi32(g, 4)), b);
+			__m256i index = _mm256_or_si256(_mm256_slli_epi32(key, 2), lanes);
+			__m256i counted = _mm256_cmpgt_epi32(_mm256_srli_epi32(in, 24), opaque);
+			index = _mm256_blendv_epi8(skipped, index, counted);
+			_mm256_store_si256(reinterpret_cast<__m256i*>(indices), index);
+			Count(indices, 8, counts);
+		}
+		return i;
+	}
+
+	struct Bin {
+		uint32_t count = 0;
+		uint8_t channel[3] = {}; // 4-bit values
+		uint16_t key = 0;
+	};
+
+	struct Box {
+		size_t begin = 0;
+		size_t end = 0;
+		uint64_t population = 0;
+		uint8_t low[3] = { 15, 15, 15 };
+		uint8_t high[3] = { 0, 0, 0 };
+	};
+
+	Box MakeBox(const std::vector<Bin>& bins, size_t begin, size_t end)
+	{
+		Box box;
+		box.begin = begin;
+		box.end = end;
+		for (size_t i = begin; i < end; ++i) {
+			box.population += bins[i].count;
+			for (int c = 0; c < 3; ++c) {
+				box.low[c] = (std::min)(box.low[c], bins[i].channel[c]);
+				box.high[c] = (std::max)(box.high[c], bins[i].channel[c]);
+			}
+		}
+		return box;
+	}
+
+	// Splits the box at the median of its widest channel. The order of the bins
+	// is fully determined, so the palette does not depend on the sort.
+	std::pair<Box, Box> Split(std::vector<Bin>& bins, const Box& box)
+	{
+		int axis = 0;
+		for (int c = 1; c < 3; ++c) {
+			if (box.high[c] - box.low[c] > box.high[axis] - box.low[axis]) {
+				axis = c;
+			}
+		}
+		std::sort(bins.begin() + box.begin, bins.begin() + box.end, [axis](const Bin& a, const Bin& b) {
+			return a.channel[axis] != b.channel[axis] ? a.channel[axis] < b.channel[axis] : a.key < b.key;
+		});
+
+		uint64_t half = box.population / 2;
+		uint64_t seen = 0;
+		size_t split = box.begin;
+		while (split < box.end && seen + bins[split].count <= half) {
+			seen += bins[split].count;
+			split++;
+		}
+		split = std::clamp(split, box.begin + 1, box.end - 1);
+		return { MakeBox(bins, box.begin, split), MakeBox(bins, split, box.end) };
+	}
+
+	float Luminance(const uint8_t rgb[3])
+	{
+		float linear[3];
+		for (int c = 0; c < 3; ++c) {
+			float value = rgb[c] / 255.0f;
+			linear[c] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+		return 0.2126f * linear[0] + 0.7152f * linear[1] + 0.0722f * linear[2];
+	}
+}
+
+void PaletteHistogram(const uint8_t* rgba, size_t pixels, uint32_t* counts, SimdLevel simd)
+{
+	size_t done = 0;
+	switch (simd) {
+	case SimdLevel::Avx2: done = HistogramAvx2(rgba, pixels, counts); break;
+	case SimdLevel::Sse2: done = HistogramSse2(rgba, pixels, counts); break;
+	default: break;
+	}
+	for (size_t i = done; i < pixels; ++i) {
+		const uint8_t* pixel = rgba + i * 4;
+		if (pixel[3] >= 128) {
+			counts[Key(pixel) * paletteLanes + (i % paletteLanes)]++;
+		}
+	}
+}
+
+bool ExtractPalette(const uint8_t* rgba, int width, int height, int maxColors, std::chrono::steady_clock::time_point deadline,
+	std::vector<PaletteColor>& palette, SimdLevel simd)
+{
+	palette.clear();
+	std::vector<uint32_t> counts(static_cast<size_t>(paletteBins) * paletteLanes, 0);
+	for (int y = 0; y < height; y += deadlineRows) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+		int rows = (std::min)(deadlineRows, height - y);
+		PaletteHistogram(rgba + static_cast<size_t>(y) * width * 4, static_cast<size_t>(width) * rows, counts.data(), simd);
+	}
+
+	std::vector<Bin> bins;
+	for (uint32_t key = 0; key < paletteBins; ++key) {
+		const uint32_t* lanes = &counts[key * paletteLanes];
+		uint32_t count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		if (count > 0) {
+			Bin bin;
+			bin.count = count;
+			bin.channel[0] = static_cast<uint8_t>(key >> 8);
+			bin.channel[1] = static_cast<uint8_t>((key >> 4) & 0xF);
+			bin.channel[2] = static_cast<uint8_t>(key & 0xF);
+			bin.key = static_cast<uint16_t>(key);
+			bins.push_back(bin);
+		}
+	}
+	if (bins.empty()) {
+		return true;
+	}
+
+	// The most populous box that still holds more than one color is cut next
+	std::vector<Box> boxes = { MakeBox(bins, 0, bins.size()) };
+	while (boxes.size() < static_cast<size_t>(maxColors)) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+		auto next = boxes.end();
+		for (auto it = boxes.begin(); it != boxes.end(); ++it) {
+			if (it->end - it->begin >= 2 && (next == boxes.end() || it->population > next->population)) {
+				next = it;
+			}
+		}
+		if (next == boxes.end()) {
+			break;
+		}
+		auto [first, second] = Split(bins, *next);
+		*next = first;
+		boxes.push_back(second);
+	}
+
+	// Bins only place the cuts, the colors are the means of the actual pixels
+	std::vector<uint8_t> boxOfBin(paletteBins, 0);
+	for (size_t i = 0; i < boxes.size(); ++i) {
+		for (size_t bin = boxes[i].begin; bin < boxes[i].end; ++bin) {
+			boxOfBin[bins[bin].key] = static_cast<uint8_t>(i);
+		}
+	}
+	std::vector<uint64_t> sums(boxes.size() * 3, 0);
+	size_t pixels = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < pixels; ++i) {
+		const uint8_t* pixel = rgba + i * 4;
+		if (pixel[3] >= 128) {
+			uint64_t* sum = &sums[boxOfBin[Key(pixel)] * 3];
+			sum[0] += pixel[0];
+			sum[1] += pixel[1];
+			sum[2] += pixel[2];
+		}
+	}
+	for (size_t i = 0; i < boxes.size(); ++i) {
+		PaletteColor color;
+		uint64_t population = boxes[i].population;
+		for (int c = 0; c < 3; ++c) {
+			color.rgb[c] = static_cast<uint8_t>((sums[i * 3 + c] + population / 2) / population);
+		}
+		color.count = static_cast<uint32_t>(population);
+		palette.push_back(color);
+	}
+	std::sort(palette.begin(), palette.end(), [](const PaletteColor& a, const PaletteColor& b) {
+		if (a.count != b.count) {
+			return a.count > b.count;
+		}
+		return std::lexicographical_compare(a.rgb, a.rgb + 3, b.rgb, b.rgb + 3);
+	});
+	return true;
+}
+
+CoverTheme PickTheme(const std::vector<PaletteColor>& palette)
+{
+	CoverTheme theme;
+	if (palette.empty()) {
+		return theme;
+	}
+	theme.valid = true;
+
+	// Each color joins the first more common one close to it
+	std::vector<PaletteColor> merged;
+	for (const PaletteColor& color : palette) {
+		auto near = std::find_if(merged.begin(), merged.end(), [&](const PaletteColor& other) {
+			int distance = 0;
+			for (int c = 0; c < 3; ++c) {
+				distance = (std::max)(distance, std::abs(color.rgb[c] - other.rgb[c]));
+			}
+			return distance < mergeDistance;
+		});
+		if (near != merged.end()) {
+			near->count += color.count;
+		}
+		else {
+			merged.push_back(color);
+		}
+	}
+	std::stable_sort(merged.begin(), merged.end(), [](const PaletteColor& a, const PaletteColor& b) { return a.count > b.count; });
+	std::copy_n(merged[0].rgb, 3, theme.background);
+
+	for (size_t i = 1; i < merged.size(); ++i) {
+		if (ContrastRatio(merged[i].rgb, theme.background) >= themeMinContrast) {
+			std::copy_n(merged[i].rgb, 3, theme.text);
+			return theme;
+		}
+	}
+
+	// One of the two always reaches 4.5 against any background
+	const uint8_t white[3] = { 255, 255, 255 };
+	const uint8_t black[3] = { 0, 0, 0 };
+	const uint8_t* text = ContrastRatio(white, theme.background) >= ContrastRatio(black, theme.background) ? white : black;
+	std::copy_n(text, 3, theme.text);
+	return theme;
+}
+
+float ContrastRatio(const uint8_t a[3], const uint8_t b[3])
+{
+	float first = Luminance(a) + 0.05f;
+	float second = Luminance(b) + 0.05f;
+	return (std::max)(first, second) / (std::min)(first, second);
+}
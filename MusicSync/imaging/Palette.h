@@ -0,0 +1,45 @@
+#pragma once
+#include "Simd.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+struct PaletteColor {
+	uint8_t rgb[3] = { 0, 0, 0 };
+	uint32_t count = 0; // Pixels it stands for
+};
+
+// Overlay colors picked from a cover, straight sRGB
+struct CoverTheme {
+	bool valid = false;
+	uint8_t background[3] = { 0, 0, 0 };
+	uint8_t text[3] = { 255, 255, 255 };
+};
+
+// WCAG minimum for normal text
+constexpr float themeMinContrast = 4.5f;
+
+// Colors with 4 bits per channel counted into 4096 bins, pixels under half
+// alpha are skipped. Every bin has paletteLanes counters that neighbouring
+// pixels take turns on, so a run of one color does not wait on its own
+// increments; a bin's count is the sum of counts[bin * paletteLanes + lane].
+// Adds to counts, which holds paletteBins * paletteLanes entries.
+constexpr int paletteBins = 1 << 12;
+constexpr int paletteLanes = 4;
+void PaletteHistogram(const uint8_t* rgba, size_t pixels, uint32_t* counts, SimdLevel simd = BestSimdLevel());
+
+// Median cut of the histogram of rgba into at most maxColors colors, most
+// common first, each the mean of the pixels in its box. Small images are meant,
+// a mip of the cover. False if the deadline passed first, palette is then
+// incomplete and not to be used.
+bool ExtractPalette(const uint8_t* rgba, int width, int height, int maxColors, std::chrono::steady_clock::time_point deadline,
+	std::vector<PaletteColor>& palette, SimdLevel simd = BestSimdLevel());
+
+// The most common color as background, text in the most common color that
+// reaches themeMinContrast against it, or white or black if none does. Close
+// palette colors are counted as one, median cut splits large flat areas.
+CoverTheme PickTheme(const std::vector<PaletteColor>& palette);
+
+// WCAG contrast ratio of two sRGB colors, 1 to 21
+float ContrastRatio(const uint8_t a[3], const uint8_t b[3]);
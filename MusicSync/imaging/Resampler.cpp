@@ -0,0 +1,307 @@
+#include "pch.h"
+#include "Resampler.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+	constexpr int weightBits = 14;
+	constexpr int32_t rounding = 1 << (weightBits - 1);
+	constexpr double lanczosRadius = 3.0;
+	constexpr double pi = 3.14159265358979323846;
+
+	double Sinc(double x)
+	{
+		if (x == 0.0) {
+			return 1.0;
+		}
+		x *= pi;
+		return std::sin(x) / x;
+	}
+
+	double Lanczos(double x)
+	{
+		return std::abs(x) < lanczosRadius ? Sinc(x) * Sinc(x / lanczosRadius) : 0.0;
+	}
+
+	// Filter taps for every output pixel along one axis. Each output reads `taps`
+	// consecutive input pixels from first[i], the count is padded with zero
+	// weights to a multiple of four so the SIMD kernels never need a tail.
+	struct Contributions {
+		int taps = 0;
+		std::vector<int> first;
+		std::vector<int16_t> weights; // taps per output pixel
+	};
+
+	Contributions ComputeContributions(int inSize, int outSize)
+	{
+		double scale = static_cast<double>(inSize) / outSize;
+		double filterScale = (std::max)(scale, 1.0); // Widen the filter when shrinking
+		double support = lanczosRadius * filterScale;
+
+		Contributions result;
+		result.taps = (static_cast<int>(std::ceil(support)) * 2 + 1 + 3) & ~3;
+		result.first.resize(outSize);
+		result.weights.assign(static_cast<size_t>(outSize) * result.taps, 0);
+
+		std::vector<double> weights(result.taps);
+		for (int i = 0; i < outSize; ++i) {
+			double center = (i + 0.5) * scale;
+			int first = (std::max)(0, static_cast<int>(center - support + 0.5));
+			int last = (std::min)(inSize, static_cast<int>(center + support + 0.5));
+			int count = (std::min)(last - first, result.taps);
+
+			double total = 0.0;
+			for (int k = 0; k < count; ++k) {
+				weights[k] = Lanczos((first + k - center + 0.5) / filterScale);
+				total += weights[k];
+			}
+
+			// Normalize in fixed point and put the rounding error on the largest tap
+			int16_t* fixed = &result.weights[static_cast<size_t>(i) * result.taps];
+			int sum = 0;
+			int largest = 0;
+			for (int k = 0; k < count; ++k) {
+				fixed[k] = static_cast<int16_t>(std::lround(weights[k] / total * (1 << weightBits)));
+				sum += fixed[k];
+				if (fixed[k] > fixed[largest]) {
+					largest = k;
+				}
+			}
+			fixed[largest] = static_cast<int16_t>(fixed[largest] + (1 << weightBits) - sum);
+			result.first[i] = first;
+		}
+		return result;
+	}
+
+	uint8_t Clamp(int32_t value)
+	{
+		value >>= weightBits;
+		return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+	int32_t PairWeights(const int16_t* weights)
+	{
+		return static_cast<uint16_t>(weights[0]) | (static_cast<int32_t>(weights[1]) << 16);
+	}
+
+	// Horizontal pass over one row. The row is padded so first + taps never reads past it.
+	void HorizontalScalar(const uint8_t* row, uint8_t* out, int outWidth, const Contributions& c)
+	{
+		for (int x = 0; x < outWidth; ++x) {
+			const uint8_t* in = row + c.first[x] * 4;
+			const int16_t* w = &c.weights[static_cast<size_t>(x) * c.taps];
+			int32_t acc[4] = { rounding, rounding, rounding, rounding };
+			for (int k = 0; k < c.taps; ++k) {
+				for (int channel = 0; channel < 4; ++channel) {
+					acc[channel] += in[k * 4 + channel] * w[k];
+				}
+			}
+			for (int channel = 0; channel < 4; ++channel) {
+				out[x * 4 + channel] = Clamp(acc[channel]);
+			}
+		}
+	}
+
+	void HorizontalSse2(const uint8_t* row, uint8_t* out, int outWidth, const Contributions& c)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		for (int x = 0; x < outWidth; ++x) {
+			const uint8_t* in = row + c.first[x] * 4;
+			const int16_t* w = &c.weights[static_cast<size_t>(x) * c.taps];
+			__m128i acc = _mm_set1_epi32(rounding);
+			for (int k = 0; k < c.taps; k += 2) {
+				// Two pixels to r0 r1 g0 g1 b0 b1 a0 a1, so madd sums each channel over both taps
+				__m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + k * 4)), zero);
+				pixels = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+				acc = _mm_add_epi32(acc, _mm_madd_epi16(pixels, _mm_set1_epi32(PairWeights(w + k))));
+			}
+			acc = _mm_srai_epi32(acc, weightBits);
+			acc = _mm_packus_epi16(_mm_packs_epi32(acc, acc), zero);
+			*reinterpret_cast<int32_t*>(out + x * 4) = _mm_cvtsi128_si32(acc);
+		}
+	}
+
+	SIMD_TARGET_AVX2 void HorizontalAvx2(const uint8_t* row, uint8_t* out, int outWidth, const Contributions& c)
+	{
+		const __m128i interleave = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+		const __m128i zero = _mm_setzero_si128();
+		for (int x = 0; x < outWidth; ++x) {
+			const uint8_t* in = row + c.first[x] * 4;
+			const int16_t* w = &c.weights[static_cast<size_t>(x) * c.taps];
+			__m256i acc = _mm256_setzero_si256();
+			for (int k = 0; k < c.taps; k += 4) {
+				// Four pixels, one pair per lane
+				__m128i pixels = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + k * 4)), interleave);
+				__m256i weights = _mm256_set_m128i(_mm_set1_epi32(PairWeights(w + k + 2)), _mm_set1_epi32(PairWeights(w + k)));
+				acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_cvtepu8_epi16(pixels), weights));
+			}
+			__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+			sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(rounding)), weightBits);
+			sum = _mm_packus_epi16(_mm_packs_epi32(sum, sum), zero);
+			*reinterpret_cast<int32_t*>(out + x * 4) = _mm_cvtsi128_si32(sum);
+		}
+	}
+
+	// Vertical pass over one output row, rows[k] are the taps of this row
+	void VerticalScalar(const uint8_t* const* rows, const int16_t* w, int taps, uint8_t* out, int start, int bytes)
+	{
+		for (int i = start; i < bytes; ++i) {
+			int32_t acc = rounding;
+			for (int k = 0; k < taps; ++k) {
+				acc += rows[k][i] * w[k];
+			}
+			out[i] = Clamp(acc);
+		}
+	}
+
+	int VerticalSse2(const uint8_t* const* rows, const int16_t* w, int taps, uint8_t* out, int start, int bytes)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		int i = start;
+		for (; i + 16 <= bytes; i += 16) {
+			__m128i acc0 = _mm_set1_epi32(rounding);
+			__m128i acc1 = acc0;
+			__m128i acc2 = acc0;
+			__m128i acc3 = acc0;
+			for (int k = 0; k < taps; k += 2) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k + 1] + i));
+				__m128i weights = _mm_set1_epi32(PairWeights(w + k));
+				__m128i lo = _mm_unpacklo_epi8(a, b);
+				__m128i hi = _mm_unpackhi_epi8(a, b);
+				acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), weights));
+				acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), weights));
+				acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), weights));
+				acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), weights));
+			}
+			__m128i first = _mm_packs_epi32(_mm_srai_epi32(acc0, weightBits), _mm_srai_epi32(acc1, weightBits));
+			__m128i second = _mm_packs_epi32(_mm_srai_epi32(acc2, weightBits), _mm_srai_epi32(acc3, weightBits));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(first, second));
+		}
+		return i;
+	}
+
+	// Same as SSE2 on 32 bytes. Unpacks and packs both stay within 128-bit lanes,
+	// so the byte order comes back out as it went in.
+	SIMD_TARGET_AVX2 int VerticalAvx2(const uint8_t* const* rows, const int16_t* w, int taps, uint8_t* out, int start, int bytes)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		int i = start;
+		for (; i + 32 <= bytes; i += 32) {
+			__m256i acc0 = _mm256_set1_epi32(rounding);
+			__m256i acc1 = acc0;
+			__m256i acc2 = acc0;
+			__m256i acc3 = acc0;
+			for (int k = 0; k < taps; k += 2) {
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k] + i));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k + 1] + i));
+				__m256i weights = _mm256_set1_epi32(PairWeights(w + k));
+				__m256i lo = _mm256_unpacklo_epi8(a, b);
+				__m256i hi = _mm256_unpackhi_epi8(a, b);
+				acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), weights));
+				acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), weights));
+				acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), weights));
+				acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), weights));
+			}
+			__m256i first = _mm256_packs_epi32(_mm256_srai_epi32(acc0, weightBits), _mm256_srai_epi32(acc1, weightBits));
+			__m256i second = _mm256_packs_epi32(_mm256_srai_epi32(acc2, weightBits), _mm256_srai_epi32(acc3, weightBits));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_packus_epi16(first, second));
+		}
+		return i;
+	}
+
+	void BoxScalar(const uint8_t* row0, const uint8_t* row1, int width, uint8_t* out, int start, int outWidth)
+	{
+		for (int x = start; x < outWidth; ++x) {
+			int left = x * 2 * 4;
+			int right = (std::min)(x * 2 + 1, width - 1) * 4;
+			for (int channel = 0; channel < 4; ++channel) {
+				int sum = row0[left + channel] + row0[right + channel] + row1[left + channel] + row1[right + channel];
+				out[x * 4 + channel] = static_cast<uint8_t>((sum + 2) >> 2);
+			}
+		}
+	}
+
+	// Two output pixels from four input pixels of both rows. Stops before an odd last column.
+	int BoxSse2(const uint8_t* row0, const uint8_t* row1, int width, uint8_t* out)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+		int x = 0;
+		for (; (x + 2) * 2 <= width; x += 2) {
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+			__m128i first = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));  // Pixels 0 and 1
+			__m128i second = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)); // Pixels 2 and 3
+			first = _mm_add_epi16(first, _mm_srli_si128(first, 8));
+			second = _mm_add_epi16(second, _mm_srli_si128(second, 8));
+			__m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(first, second), two), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sum, zero));
+		}
+		return x;
+	}
+}
+
+void ResampleLanczos(const uint8_t* src, int srcWidth, int srcHeight, uint8_t* dst, int dstWidth, int dstHeight,
+	SimdLevel simd)
+{
+	if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+		return;
+	}
+
+	// Horizontal first into an intermediate of dstWidth x srcHeight
+	Contributions horizontal = ComputeContributions(srcWidth, dstWidth);
+	std::vector<uint8_t> padded(static_cast<size_t>(srcWidth + horizontal.taps) * 4, 0);
+	std::vector<uint8_t> intermediate(static_cast<size_t>(dstWidth) * srcHeight * 4);
+	for (int y = 0; y < srcHeight; ++y) {
+		std::memcpy(padded.data(), src + static_cast<size_t>(y) * srcWidth * 4, static_cast<size_t>(srcWidth) * 4);
+		uint8_t* out = &intermediate[static_cast<size_t>(y) * dstWidth * 4];
+		switch (simd) {
+		case SimdLevel::Avx2: HorizontalAvx2(padded.data(), out, dstWidth, horizontal); break;
+		case SimdLevel::Sse2: HorizontalSse2(padded.data(), out, dstWidth, horizontal); break;
+		default: HorizontalScalar(padded.data(), out, dstWidth, horizontal); break;
+		}
+	}
+
+	// Taps past the last row have zero weight, they only need to point at valid memory
+	Contributions vertical = ComputeContributions(srcHeight, dstHeight);
+	std::vector<const uint8_t*> rows(vertical.taps);
+	int rowBytes = dstWidth * 4;
+	for (int y = 0; y < dstHeight; ++y) {
+		for (int k = 0; k < vertical.taps; ++k) {
+			int row = (std::min)(vertical.first[y] + k, srcHeight - 1);
+			rows[k] = &intermediate[static_cast<size_t>(row) * rowBytes];
+		}
+		const int16_t* w = &vertical.weights[static_cast<size_t>(y) * vertical.taps];
+		uint8_t* out = dst + static_cast<size_t>(y) * rowBytes;
+
+		// Wider kernels hand their tail to the narrower ones
+		int done = 0;
+		if (simd == SimdLevel::Avx2) {
+			done = VerticalAvx2(rows.data(), w, vertical.taps, out, done, rowBytes);
+		}
+		if (simd != SimdLevel::Scalar) {
+			done = VerticalSse2(rows.data(), w, vertical.taps, out, done, rowBytes);
+		}
+		VerticalScalar(rows.data(), w, vertical.taps, out, done, rowBytes);
+	}
+}
+
+void DownsampleBox(const uint8_t* src, int width, int height, uint8_t* dst, SimdLevel simd)
+{
+	int outWidth = (width + 1) / 2;
+	int outHeight = (height + 1) / 2;
+	for (int y = 0; y < outHeight; ++y) {
+		const uint8_t* row0 = src + static_cast<size_t>(y) * 2 * width * 4;
+		const uint8_t* row1 = src + static_cast<size_t>((std::min)(y * 2 + 1, height - 1)) * width * 4;
+		uint8_t* out = dst + static_cast<size_t>(y) * outWidth * 4;
+
+		// Four pixels per step is already memory bound, AVX2 has nothing to add here
+		int done = simd == SimdLevel::Scalar ? 0 : BoxSse2(row0, row1, width, out);
+		BoxScalar(row0, row1, width, out, done, outWidth);
+	}
+}
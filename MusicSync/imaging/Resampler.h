@@ -0,0 +1,14 @@
+#pragma once
+#include "Simd.h"
+
+#include <cstdint>
+
+// Lanczos-3 resample of tightly packed RGBA pixels, up or down. Fixed point
+// throughout, so every kernel produces exactly the same pixels.
+void ResampleLanczos(const uint8_t* src, int srcWidth, int srcHeight, uint8_t* dst, int dstWidth, int dstHeight,
+	SimdLevel simd = BestSimdLevel());
+
+// Halves both sides with a 2x2 box filter, odd sizes round up and repeat the
+// last row or column. dst holds ((width + 1) / 2) * ((height + 1) / 2) pixels.
+void DownsampleBox(const uint8_t* src, int width, int height, uint8_t* dst,
+	SimdLevel simd = BestSimdLevel());
@@ -0,0 +1,44 @@
+#include "pch.h"
+#include "Simd.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+SimdLevel BestSimdLevel()
+{
+	static const SimdLevel best = [] {
+#if defined(_MSC_VER)
+		int info[4] = {};
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+
+		// AVX2 needs the CPU flag and the OS saving the YMM registers
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+		if (maxLeaf >= 7 && osSavesYmm) {
+			__cpuidex(info, 7, 0);
+			if (info[1] & (1 << 5)) {
+				return SimdLevel::Avx2;
+			}
+		}
+#else
+		// Also checks that the OS saves the YMM registers
+		if (__builtin_cpu_supports("avx2")) {
+			return SimdLevel::Avx2;
+		}
+#endif
+		return SimdLevel::Sse2; // Baseline on x64
+	}();
+	return best;
+}
+
+const char* SimdLevelName(SimdLevel level)
+{
+	switch (level) {
+	case SimdLevel::Sse2: return "SSE2";
+	case SimdLevel::Avx2: return "AVX2";
+	default: return "scalar";
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Instruction sets the image kernels have code paths for. Every path of a
+// kernel produces the same pixels, a level only changes its speed.
+enum class SimdLevel {
+	Scalar,
+	Sse2,
+	Avx2
+};
+
+// Highest level the CPU and OS support, detected once
+SimdLevel BestSimdLevel();
+const char* SimdLevelName(SimdLevel level);
+
+// Marks functions that use AVX2 intrinsics. MSVC compiles them anywhere, GCC
+// and Clang only in functions built for that target. They are only called
+// after BestSimdLevel() allowed it.
+#if defined(_MSC_VER)
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
@@ -0,0 +1,336 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Coroutine stages for media acquisition, kept free of WinRT so the same stage
+// logic runs against SMTC and against the fake executor of the tests. A Stage<T>
+// is a lazy coroutine that co_awaits StageCalls, one platform call each, and
+// other stages. A started stage and everything it awaits share one stop token:
+// a stop cancels whichever call is in flight and the stage ends as Cancelled.
+// Coroutines resume on the thread that completed the call they waited on.
+
+enum class StageStatus {
+	Ok,
+	Failed,
+	Cancelled,
+	TimedOut
+};
+
+template <typename T>
+struct StageResult {
+	StageStatus status = StageStatus::Failed;
+	int32_t code = 0;       // Platform error code of a failed call, HRESULT on Windows
+	std::optional<T> value; // Set when status is Ok
+};
+
+// Thrown out of a co_await on a call that did not succeed, ends the stage with its status
+struct StageError {
+	StageStatus status = StageStatus::Failed;
+	int32_t code = 0;
+};
+
+namespace stage_detail {
+	struct PromiseBase {
+		std::stop_token stopToken;
+		std::coroutine_handle<> continuation;
+		std::exception_ptr error;
+	};
+
+	template <typename Promise>
+	std::stop_token StopTokenOf(std::coroutine_handle<Promise> handle)
+	{
+		if constexpr (std::is_base_of_v<PromiseBase, Promise>) {
+			return handle.promise().stopToken;
+		}
+		else {
+			return {};
+		}
+	}
+}
+
+template <typename T>
+class [[nodiscard]] Stage
+{
+public:
+	struct promise_type : stage_detail::PromiseBase {
+		std::optional<T> value;
+
+		Stage get_return_object() { return Stage(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+
+		// Hands control back to whoever awaited the stage
+		auto final_suspend() noexcept
+		{
+			struct Resume {
+				bool await_ready() noexcept { return false; }
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+				{
+					std::coroutine_handle<> continuation = handle.promise().continuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+				void await_resume() noexcept {}
+			};
+			return Resume{};
+		}
+
+		template <typename U>
+		void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+		void unhandled_exception() { error = std::current_exception(); }
+	};
+
+	Stage(Stage&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+	Stage& operator=(Stage&& other) noexcept
+	{
+		if (this != &other) {
+			if (handle) {
+				handle.destroy();
+			}
+			handle = std::exchange(other.handle, {});
+		}
+		return *this;
+	}
+	~Stage()
+	{
+		if (handle) {
+			handle.destroy();
+		}
+	}
+
+	// Awaiting a stage runs it with the awaiting coroutine's stop token
+	bool await_ready() const noexcept { return false; }
+
+	template <typename Promise>
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> awaiting) noexcept
+	{
+		handle.promise().continuation = awaiting;
+		handle.promise().stopToken = stage_detail::StopTokenOf(awaiting);
+		return handle;
+	}
+
+	T await_resume()
+	{
+		promise_type& promise = handle.promise();
+		if (promise.error) {
+			std::rethrow_exception(promise.error);
+		}
+		return std::move(*promise.value);
+	}
+
+private:
+	explicit Stage(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+// One call into the platform, completed later from any thread. start is given
+// the function that completes the call and returns the one that cancels it.
+// A cancelled call still has to complete, with StageStatus::Cancelled.
+template <typename T>
+class StageCall
+{
+public:
+	using Complete = std::function<void(StageResult<T>)>;
+	using Start = std::function<std::function<void()>(Complete)>;
+
+	explicit StageCall(Start start) : start(std::move(start)) {}
+
+	bool await_ready() const noexcept { return false; }
+
+	template <typename Promise>
+	bool await_suspend(std::coroutine_handle<Promise> awaiting)
+	{
+		std::stop_token stopToken = stage_detail::StopTokenOf(awaiting);
+		if (stopToken.stop_requested()) {
+			// Nothing new is started once a stop was requested
+			state->result.status = StageStatus::Cancelled;
+			return false;
+		}
+
+		state->awaiting = awaiting;
+		std::function<void()> cancel = start([state = state](StageResult<T> result) {
+			state->result = std::move(result);
+			if (state->completed.exchange(true)) {
+				state->awaiting.resume();
+			}
+		});
+		onStop.emplace(stopToken, [cancel = std::move(cancel)] {
+			if (cancel) {
+				cancel();
+			}
+		});
+
+		// Whichever of this and the completion comes second resumes the coroutine
+		return !state->completed.exchange(true);
+	}
+
+	T await_resume()
+	{
+		onStop.reset();
+		StageResult<T>& result = state->result;
+		if (result.status != StageStatus::Ok || !result.value) {
+			throw StageError{ result.status == StageStatus::Ok ? StageStatus::Failed : result.status, result.code };
+		}
+		return std::move(*result.value);
+	}
+
+private:
+	struct State {
+		std::atomic<bool> completed{ false };
+		std::coroutine_handle<> awaiting;
+		StageResult<T> result;
+	};
+
+	Start start;
+	std::shared_ptr<State> state = std::make_shared<State>();
+	std::optional<std::stop_callback<std::function<void()>>> onStop;
+};
+
+namespace stage_detail {
+	// Runs a stage to the end on its own, for StartStage and WhenAll
+	struct Detached {
+		struct promise_type : PromiseBase {
+			template <typename... Args>
+			promise_type(std::stop_token& token, Args&...) { stopToken = token; }
+
+			Detached get_return_object() noexcept { return {}; }
+			std::suspend_never initial_suspend() noexcept { return {}; }
+			std::suspend_never final_suspend() noexcept { return {}; }
+			void return_void() noexcept {}
+			void unhandled_exception() noexcept { std::terminate(); }
+		};
+	};
+
+	template <typename T, typename Done>
+	Detached Drive(std::stop_token /*token*/, Stage<T> stage, Done done)
+	{
+		StageResult<T> result;
+		try {
+			result.value.emplace(co_await stage);
+			result.status = StageStatus::Ok;
+		}
+		catch (const StageError& e) {
+			result.status = e.status;
+			result.code = e.code;
+		}
+		catch (...) {
+			result.status = StageStatus::Failed;
+		}
+		done(std::move(result));
+	}
+
+	template <typename T>
+	struct AllAwaiter {
+		explicit AllAwaiter(std::vector<Stage<T>>& stages) : stages(stages) {}
+
+		std::vector<Stage<T>>& stages;
+		std::vector<StageResult<T>> results;
+		std::atomic<size_t> remaining{ 0 };
+
+		bool await_ready() const noexcept { return stages.empty(); }
+
+		template <typename Promise>
+		bool await_suspend(std::coroutine_handle<Promise> awaiting)
+		{
+			// One extra count while starting, so a stage finishing early cannot resume before all are started
+			results.resize(stages.size());
+			remaining = stages.size() + 1;
+			std::stop_token stopToken = StopTokenOf(awaiting);
+			for (size_t i = 0; i < stages.size(); ++i) {
+				Drive(stopToken, std::move(stages[i]), [this, i, awaiting](StageResult<T> result) {
+					results[i] = std::move(result);
+					if (--remaining == 0) {
+						awaiting.resume();
+					}
+				});
+			}
+			return --remaining != 0;
+		}
+
+		std::vector<StageResult<T>> await_resume() { return std::move(results); }
+	};
+}
+
+// Runs the stages concurrently, sharing the awaiting stage's stop token, and
+// returns one result each in order. A stage that fails does not stop the others.
+template <typename T>
+Stage<std::vector<StageResult<T>>> WhenAll(std::vector<Stage<T>> stages)
+{
+	co_return co_await stage_detail::AllAwaiter<T>(stages);
+}
+
+// A started stage. Its result is picked up by Wait, from any thread.
+template <typename T>
+class StageOperation
+{
+public:
+	// Time a cancelled stage gets to unwind before Wait gives up on it
+	static constexpr std::chrono::milliseconds unwindGrace{ 250 };
+
+	void Cancel() { stopSource.request_stop(); }
+
+	bool Done() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return result.has_value();
+	}
+
+	// Blocks until the stage has finished or the deadline passed. A late stage is
+	// cancelled: what it finished with is returned if it unwinds within the grace
+	// time, TimedOut if not.
+	StageResult<T> Wait(std::chrono::steady_clock::time_point deadline)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!finished.wait_until(lock, deadline, [this] { return result.has_value(); })) {
+			lock.unlock();
+			Cancel();
+			lock.lock();
+			if (!finished.wait_for(lock, unwindGrace, [this] { return result.has_value(); })) {
+				StageResult<T> late;
+				late.status = StageStatus::TimedOut;
+				return late;
+			}
+		}
+		return *result;
+	}
+
+private:
+	template <typename U>
+	friend std::shared_ptr<StageOperation<U>> StartStage(Stage<U> stage);
+
+	void Finish(StageResult<T> finalResult)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			result = std::move(finalResult);
+		}
+		finished.notify_all();
+	}
+
+	std::stop_source stopSource;
+	mutable std::mutex mutex;
+	std::condition_variable finished;
+	std::optional<StageResult<T>> result;
+};
+
+// Runs the stage until its first call suspends and returns the handle to it
+template <typename T>
+std::shared_ptr<StageOperation<T>> StartStage(Stage<T> stage)
+{
+	auto operation = std::make_shared<StageOperation<T>>();
+	stage_detail::Drive(operation->stopSource.get_token(), std::move(stage), [operation](StageResult<T> result) {
+		operation->Finish(std::move(result));
+	});
+	return operation;
+}
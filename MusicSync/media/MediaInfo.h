@@ -0,0 +1,28 @@
+#pragma once
+#include "PlaybackClock.h"
+
+#include <cstdint>
+#include <string>
+
+struct MediaInfo {
+	std::string title;
+	std::string artist;
+	std::string album;
+	std::string albumCoverPath;
+	bool isValid = false;
+	bool hasThumbnail = false;
+	uint32_t thumbnailRevision = 0; // Bumped when the app announces new properties, the cover may differ under the same title
+	TimelineSample timeline; // Not part of the comparison, position changes are not media changes
+
+	// Comparison operator for detecting changes
+	bool operator==(const MediaInfo& other) const {
+		return title == other.title &&
+			artist == other.artist &&
+			album == other.album &&
+			isValid == other.isValid;
+	}
+
+	bool operator!=(const MediaInfo& other) const {
+		return !(*this == other);
+	}
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include "MediaInfo.h"
+#include "../imaging/CoverImage.h"
+
+#include <cstdint>
+#include <memory>
+
+// What the overlay renders from. Every publish bumps the generation, so the
+// renderer can tell a new snapshot apart from the one it already laid out.
+struct MediaSnapshot {
+	MediaInfo info;
+	std::shared_ptr<const CoverImage> cover; // Null when there is no usable cover
+	uint64_t generation = 0;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include "MediaInfo.h"
+#include "SessionTracker.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Counters a source keeps about its own fetches. Cold fetches had to acquire
+// the session manager or session first, warm ones reused the cached handles.
+struct MediaSourceStats {
+	uint64_t fetches = 0;
+	uint64_t noSession = 0;
+	uint64_t failures = 0;
+	uint64_t managerAcquisitions = 0;
+	uint64_t sessionAcquisitions = 0;
+	uint64_t coldFetches = 0;
+	uint64_t coldMicros = 0;
+	uint64_t coldCycles = 0;
+	uint64_t warmFetches = 0;
+	uint64_t warmMicros = 0;
+	uint64_t warmCycles = 0;
+};
+
+// Where "now playing" data comes from. Kept free of WinRT so the plugin logic
+// can be driven by ScriptedMediaSource as well as the real SMTC backend.
+class MediaSource
+{
+public:
+	using ChangedCallback = std::function<void()>;
+
+	virtual ~MediaSource() = default;
+
+	// Start delivering change notifications. The callback may run on any thread
+	// and should only schedule a refresh. Returns false if the source can only be polled.
+	virtual bool Subscribe(ChangedCallback onChanged) = 0;
+	virtual void Unsubscribe() = 0;
+
+	// Whether change notifications arrive right now. A subscribed source can lose
+	// them, e.g. when the platform connection is re-established, and polls until
+	// they are back.
+	virtual bool EventsActive() const = 0;
+
+	// Read the current media state
+	virtual MediaInfo FetchCurrent() = 0;
+
+	// Read the thumbnail of the media returned by the last FetchCurrent, empty if there is none.
+	// Can be called again for the same media, e.g. to rescale the cover.
+	virtual std::vector<uint8_t> ReadThumbnail() = 0;
+
+	// The caller already has the cover of the last FetchCurrent, drop any read in flight
+	virtual void SkipThumbnail() {}
+
+	virtual MediaSourceStats GetStats() const { return {}; }
+
+	// Sources that see several media apps at once pick the shown one with this policy
+	virtual void SetSessionPolicy(SessionPolicy /*policy*/) {}
+
+	// One line per known session, for the musicsync_list_sessions notifier
+	virtual std::vector<std::string> DescribeSessions() const { return {}; }
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include "AsyncStage.h"
+
+#include <cstdint>
+#include <vector>
+
+// The acquisition stages, written against a backend so the same logic runs on
+// SMTC and on the fake executor the tests and benchmarks use. Backends are
+// small copyable handles, since a cancelled stage may outlive its caller:
+//   Session, Properties, Thumbnail, Stream and Buffer types
+//   StageCall<Properties> RequestProperties(const Session&)
+//   StageCall<Stream> OpenThumbnail(const Thumbnail&)
+//   uint64_t StreamSize(const Stream&)
+//   StageCall<Buffer> ReadStream(const Stream&, uint32_t size)
+//   std::vector<uint8_t> BufferBytes(const Buffer&)
+
+template <typename Backend>
+Stage<typename Backend::Properties> RequestProperties(Backend backend, typename Backend::Session session)
+{
+	co_return co_await backend.RequestProperties(session);
+}
+
+// Properties of every session, all requested at once so the slowest app bounds
+// the fetch instead of the sum of all of them. One app failing or being
+// cancelled leaves the others' results alone.
+template <typename Backend>
+Stage<std::vector<StageResult<typename Backend::Properties>>> FetchProperties(Backend backend, std::vector<typename Backend::Session> sessions)
+{
+	std::vector<Stage<typename Backend::Properties>> requests;
+	requests.reserve(sessions.size());
+	for (const auto& session : sessions) {
+		requests.push_back(RequestProperties(backend, session));
+	}
+	co_return co_await WhenAll(std::move(requests));
+}
+
+// Opens the thumbnail and reads it whole, empty for an empty or oversized stream.
+// A stop cancels the open or the read, whichever is in flight.
+template <typename Backend>
+Stage<std::vector<uint8_t>> ReadCover(Backend backend, typename Backend::Thumbnail thumbnail, uint64_t maxBytes)
+{
+	typename Backend::Stream stream = co_await backend.OpenThumbnail(thumbnail);
+	uint64_t size = backend.StreamSize(stream);
+	if (size == 0 || size >= maxBytes) {
+		co_return std::vector<uint8_t>{};
+	}
+	typename Backend::Buffer buffer = co_await backend.ReadStream(stream, static_cast<uint32_t>(size));
+	co_return backend.BufferBytes(buffer);
+}
@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "PlaybackClock.h"
+
+#include <algorithm>
+#include <chrono>
+
+double TimelineSample::PositionAt(int64_t nowNanos) const
+{
+	double position = positionSeconds;
+	if (playing && nowNanos > capturedAtNanos) {
+		position += (nowNanos - capturedAtNanos) * 1e-9 * playbackRate;
+	}
+
+	// Never run past the reported bounds, however late the next real update is
+	return std::clamp(position, startSeconds, std::max(startSeconds, endSeconds));
+}
+
+float TimelineSample::ProgressAt(int64_t nowNanos) const
+{
+	double duration = DurationSeconds();
+	if (!valid || duration <= 0.0) {
+		return 0.0f;
+	}
+	return static_cast<float>((PositionAt(nowNanos) - startSeconds) / duration);
+}
+
+int64_t PlaybackClock::NowNanos()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PlaybackClock::Publish(const TimelineSample& sample)
+{
+	sequence.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	startSeconds.store(sample.startSeconds, std::memory_order_relaxed);
+	endSeconds.store(sample.endSeconds, std::memory_order_relaxed);
+	positionSeconds.store(sample.positionSeconds, std::memory_order_relaxed);
+	playbackRate.store(sample.playbackRate, std::memory_order_relaxed);
+	capturedAtNanos.store(sample.capturedAtNanos, std::memory_order_relaxed);
+	playing.store(sample.playing, std::memory_order_relaxed);
+	valid.store(sample.valid, std::memory_order_relaxed);
+
+	sequence.fetch_add(1, std::memory_order_release);
+}
+
+TimelineSample PlaybackClock::Read() const
+{
+	TimelineSample sample;
+	uint32_t before = 0;
+	uint32_t after = 0;
+	do {
+		before = sequence.load(std::memory_order_acquire);
+		sample.startSeconds = startSeconds.load(std::memory_order_relaxed);
+		sample.endSeconds = endSeconds.load(std::memory_order_relaxed);
+		sample.positionSeconds = positionSeconds.load(std::memory_order_relaxed);
+		sample.playbackRate = playbackRate.load(std::memory_order_relaxed);
+		sample.capturedAtNanos = capturedAtNanos.load(std::memory_order_relaxed);
+		sample.playing = playing.load(std::memory_order_relaxed);
+		sample.valid = valid.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		after = sequence.load(std::memory_order_relaxed);
+	} while (before != after || (before & 1) != 0);
+	return sample;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Playback position as reported by the media app at one point in time.
+// Positions in between are extrapolated from capturedAt and the playback rate.
+struct TimelineSample {
+	double startSeconds = 0.0;
+	double endSeconds = 0.0;
+	double positionSeconds = 0.0;
+	double playbackRate = 1.0;
+	int64_t capturedAtNanos = 0; // PlaybackClock::NowNanos() time positionSeconds was valid at
+	bool playing = false;
+	bool valid = false; // Position fields are usable, playing is reported either way
+
+	double PositionAt(int64_t nowNanos) const;
+	float ProgressAt(int64_t nowNanos) const; // 0-1 through the track
+	double DurationSeconds() const { return endSeconds - startSeconds; }
+};
+
+// Single writer, many reader hand-off of the latest TimelineSample. Readers never
+// block or allocate, which makes it safe to read from the render thread every frame.
+class PlaybackClock
+{
+public:
+	void Publish(const TimelineSample& sample);
+	TimelineSample Read() const;
+
+	// Monotonic clock all samples are stamped with
+	static int64_t NowNanos();
+
+private:
+	std::atomic<uint32_t> sequence{ 0 }; // Odd while a write is in progress
+	std::atomic<double> startSeconds{ 0.0 };
+	std::atomic<double> endSeconds{ 0.0 };
+	std::atomic<double> positionSeconds{ 0.0 };
+	std::atomic<double> playbackRate{ 1.0 };
+	std::atomic<int64_t> capturedAtNanos{ 0 };
+	std::atomic<bool> playing{ false };
+	std::atomic<bool> valid{ false };
+};
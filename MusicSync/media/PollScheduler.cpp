@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "PollScheduler.h"
+
+#include <algorithm>
+
+using namespace std::chrono_literals;
+
+namespace {
+	constexpr auto fastPeriod = 500ms;        // Right after a track change or seek
+	constexpr int fastPolls = 3;
+	constexpr auto eventDebounce = 50ms;      // SMTC sends properties, playback and timeline events back to back
+	constexpr auto playingMaxPeriod = 4s;     // Playing, polling is the only way to see track changes
+	constexpr auto idleMaxPeriod = 10s;       // Nothing playing
+	constexpr auto eventsMaxPeriod = 30s;     // Events report changes, polling is only a fallback
+}
+
+PollScheduler::PollScheduler()
+	: lastPoll(Clock::now()), started(Clock::now()), period(fastPeriod)
+{
+}
+
+PollReason PollScheduler::WaitForNextPoll()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		Clock::time_point due;
+		if (std::optional<PollReason> reason = TakeDuePoll(Clock::now(), due)) {
+			return *reason;
+		}
+		wake.wait_until(lock, due);
+		stats.threadWakeups++;
+	}
+}
+
+std::optional<PollReason> PollScheduler::PollIfDue(Clock::time_point now, Clock::time_point& nextDue)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return TakeDuePoll(now, nextDue);
+}
+
+// Mutex held
+std::optional<PollReason> PollScheduler::TakeDuePoll(Clock::time_point now, Clock::time_point& nextDue)
+{
+	if (stopping) {
+		return PollReason::Shutdown;
+	}
+
+	if (refreshRequested) {
+		refreshRequested = false;
+		changePending = false;
+		stats.refreshPolls++;
+		lastPoll = now;
+		return PollReason::Refresh;
+	}
+
+	nextDue = lastPoll + period;
+	if (changePending) {
+		nextDue = (std::min)(nextDue, changeAt + eventDebounce);
+	}
+	if (now < nextDue) {
+		return std::nullopt;
+	}
+
+	PollReason reason = changePending ? PollReason::Changed : PollReason::Timer;
+	if (changePending) {
+		stats.changedPolls++;
+	}
+	else {
+		stats.timerPolls++;
+	}
+	changePending = false;
+	lastPoll = now;
+	return reason;
+}
+
+void PollScheduler::NotifyChanged(Clock::time_point at)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (changePending) {
+			return;
+		}
+		changePending = true;
+		changeAt = at;
+	}
+	wake.notify_one();
+}
+
+void PollScheduler::RequestRefresh()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		refreshRequested = true;
+	}
+	wake.notify_one();
+}
+
+void PollScheduler::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+}
+
+void PollScheduler::ReportPoll(bool changed, bool playing, bool eventsActive)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	stableCount = changed ? 0 : stableCount + 1;
+	period = NextPeriod(period, stableCount, playing, eventsActive);
+}
+
+std::chrono::milliseconds PollScheduler::NextPeriod(std::chrono::milliseconds current, int stableCount, bool playing, bool eventsActive)
+{
+	if (stableCount < fastPolls) {
+		return fastPeriod;
+	}
+
+	std::chrono::milliseconds maxPeriod = eventsActive ? eventsMaxPeriod : (playing ? playingMaxPeriod : idleMaxPeriod);
+	return std::clamp(current * 3 / 2, std::chrono::milliseconds(fastPeriod), maxPeriod);
+}
+
+std::chrono::milliseconds PollScheduler::CurrentPeriod() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return period;
+}
+
+PollSchedulerStats PollScheduler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	PollSchedulerStats result = stats;
+	result.periodMillis = period.count();
+	result.uptimeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started).count();
+	return result;
+}
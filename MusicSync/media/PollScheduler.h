@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+enum class PollReason {
+	Timer,   // The current period ran out
+	Changed, // The media source reported a change
+	Refresh, // Someone asked for fresh data right now
+	Shutdown
+};
+
+struct PollSchedulerStats {
+	uint64_t timerPolls = 0;
+	uint64_t changedPolls = 0;
+	uint64_t refreshPolls = 0;
+	uint64_t threadWakeups = 0; // Every return from the wait, including ones that went back to sleep
+	int64_t periodMillis = 0;
+	int64_t uptimeMillis = 0;
+};
+
+// Decides when the media thread polls next. The period shrinks right after a
+// change and backs off while playback is stable or nothing plays. Change events,
+// explicit refreshes and shutdown wake the waiting thread immediately.
+class PollScheduler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	PollScheduler();
+
+	// Blocks until the next poll is due
+	PollReason WaitForNextPoll();
+
+	// Non-blocking WaitForNextPoll for a given time, used to simulate the
+	// scheduler. Returns the poll due at now, or nothing and when to ask again.
+	std::optional<PollReason> PollIfDue(Clock::time_point now, Clock::time_point& nextDue);
+
+	// Called by the media source, bursts of events are coalesced into one poll
+	void NotifyChanged(Clock::time_point at = Clock::now());
+	void RequestRefresh();
+	void Stop();
+
+	// Feeds the outcome of a poll back so the next period can adapt
+	void ReportPoll(bool changed, bool playing, bool eventsActive);
+
+	std::chrono::milliseconds CurrentPeriod() const;
+	PollSchedulerStats GetStats() const;
+
+	// Period used after a poll with the given outcome, stableCount polls after the last change
+	static std::chrono::milliseconds NextPeriod(std::chrono::milliseconds current, int stableCount, bool playing, bool eventsActive);
+
+private:
+	std::optional<PollReason> TakeDuePoll(Clock::time_point now, Clock::time_point& nextDue);
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+	bool refreshRequested = false;
+	bool changePending = false;
+	Clock::time_point changeAt;
+	Clock::time_point lastPoll;
+	Clock::time_point started;
+	std::chrono::milliseconds period;
+	int stableCount = 0;
+	PollSchedulerStats stats;
+};
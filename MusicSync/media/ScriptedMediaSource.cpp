@@ -0,0 +1,150 @@
+// Built without the plugin's precompiled header, so the tests can use it as is
+#include "ScriptedMediaSource.h"
+
+ScriptedMediaSource::ScriptedMediaSource(std::vector<ScriptStep> script, bool loop)
+	: script(std::move(script)), loop(loop)
+{
+	player = std::thread(&ScriptedMediaSource::Run, this);
+}
+
+ScriptedMediaSource::~ScriptedMediaSource()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (player.joinable()) {
+		player.join();
+	}
+}
+
+bool ScriptedMediaSource::Subscribe(ChangedCallback callback)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	onChanged = std::move(callback);
+	return true;
+}
+
+void ScriptedMediaSource::Unsubscribe()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	onChanged = nullptr;
+}
+
+bool ScriptedMediaSource::EventsActive() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return onChanged != nullptr;
+}
+
+MediaInfo ScriptedMediaSource::FetchCurrent()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return current;
+}
+
+std::vector<uint8_t> ScriptedMediaSource::ReadThumbnail()
+{
+	return {};
+}
+
+void ScriptedMediaSource::SetSessionPolicy(SessionPolicy policy)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	tracker.SetPolicy(std::move(policy));
+	const TrackedSession* selected = tracker.Selected();
+	current = selected ? selected->info : MediaInfo{};
+}
+
+std::vector<std::string> ScriptedMediaSource::DescribeSessions() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::string> lines;
+	const TrackedSession* selected = tracker.Selected();
+	for (const auto& session : tracker.Sessions()) {
+		lines.push_back((&session == selected ? "* " : "  ") + session.appId +
+			" [" + (session.playing ? "playing" : "paused") + (session.allowed ? "" : ", denied") +
+			", priority " + std::to_string(session.priority) + "] " + session.info.artist + " - " + session.info.title);
+	}
+	return lines;
+}
+
+uint64_t ScriptedMediaSource::StepsApplied() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stepsApplied;
+}
+
+// Mutex held. The step's app opens a session the first time it has a track and
+// closes it when it has none, like an app that stopped.
+void ScriptedMediaSource::Apply(const ScriptStep& step)
+{
+	std::vector<std::string> appIds;
+	for (const auto& session : tracker.Sessions()) {
+		if (session.appId != step.appId) {
+			appIds.push_back(session.appId);
+		}
+	}
+	if (step.info.isValid) {
+		appIds.push_back(step.appId);
+	}
+	tracker.SyncSessions(appIds);
+
+	if (step.info.isValid) {
+		MediaInfo info = step.info;
+		if (info.timeline.valid) {
+			info.timeline.capturedAtNanos = PlaybackClock::NowNanos();
+		}
+		tracker.UpdateSession(step.appId, info, info.timeline.playing);
+		tracker.SetSystemCurrent(step.appId);
+	}
+
+	const TrackedSession* selected = tracker.Selected();
+	current = selected ? selected->info : MediaInfo{};
+	stepsApplied++;
+}
+
+void ScriptedMediaSource::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	do {
+		for (const auto& step : script) {
+			if (wake.wait_for(lock, step.delay, [this] { return stopping; })) {
+				return;
+			}
+			Apply(step);
+
+			// Fire outside the lock, the callback is allowed to call FetchCurrent
+			auto callback = onChanged;
+			lock.unlock();
+			if (callback) {
+				callback();
+			}
+			lock.lock();
+		}
+	} while (loop && !script.empty() && !stopping);
+}
+
+std::vector<ScriptStep> ScriptedMediaSource::PreviewScript()
+{
+	auto track = [](std::string title, std::string artist, std::string album) {
+		MediaInfo info;
+		info.title = std::move(title);
+		info.artist = std::move(artist);
+		info.album = std::move(album);
+		info.isValid = true;
+		info.timeline.endSeconds = 30.0;
+		info.timeline.playing = true;
+		info.timeline.valid = true;
+		return info;
+	};
+
+	using namespace std::chrono_literals;
+	return {
+		{ 0ms, track("Preview Track", "MusicSync", "Overlay Preview") },
+		{ 8s, track("A Much Longer Preview Track Title", "Another Artist", "Second Album") },
+		{ 8s, MediaInfo{} }, // Nothing playing
+		{ 4s, track("Short", "Artist", "") },
+	};
+}
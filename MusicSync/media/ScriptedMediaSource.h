@@ -0,0 +1,55 @@
+#pragma once
+#include "MediaSource.h"
+#include "SessionTracker.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct ScriptStep {
+	std::chrono::milliseconds delay; // Time to wait before this step is applied
+	MediaInfo info;                  // Invalid info closes the app's session
+	std::string appId = "MusicSync.Preview";
+};
+
+// MediaSource that replays a fixed list of tracks on its own thread, firing change
+// events the same way SMTC does. Every step updates the session of its app in a
+// SessionTracker, so the shown track is picked by the same policy as live media.
+// Used for the overlay preview and the tests, and needs no media apps.
+class ScriptedMediaSource : public MediaSource
+{
+public:
+	explicit ScriptedMediaSource(std::vector<ScriptStep> script, bool loop = true);
+	~ScriptedMediaSource() override;
+
+	bool Subscribe(ChangedCallback onChanged) override;
+	void Unsubscribe() override;
+	bool EventsActive() const override;
+	MediaInfo FetchCurrent() override;
+	std::vector<uint8_t> ReadThumbnail() override;
+	void SetSessionPolicy(SessionPolicy policy) override;
+	std::vector<std::string> DescribeSessions() const override;
+
+	// Steps applied so far, counting every pass of a looping script
+	uint64_t StepsApplied() const;
+
+	static std::vector<ScriptStep> PreviewScript();
+
+private:
+	void Run();
+	void Apply(const ScriptStep& step);
+
+	std::vector<ScriptStep> script;
+	bool loop;
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+	SessionTracker tracker;
+	MediaInfo current; // Of the selected session
+	uint64_t stepsApplied = 0;
+	ChangedCallback onChanged;
+	std::thread player;
+};
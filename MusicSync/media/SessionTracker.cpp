@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "SessionTracker.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+	std::vector<std::string> SplitList(const std::string& list)
+	{
+		std::vector<std::string> items;
+		size_t start = 0;
+		while (start <= list.size()) {
+			size_t end = list.find(',', start);
+			if (end == std::string::npos) {
+				end = list.size();
+			}
+
+			size_t first = list.find_first_not_of(" \t", start);
+			size_t last = list.find_last_not_of(" \t", end - 1);
+			if (first != std::string::npos && first < end && last >= first) {
+				items.push_back(SessionPolicy::NormalizeAppId(list.substr(first, last - first + 1)));
+			}
+			start = end + 1;
+		}
+		return items;
+	}
+}
+
+std::string SessionPolicy::NormalizeAppId(std::string appId)
+{
+	std::transform(appId.begin(), appId.end(), appId.begin(),
+		[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return appId;
+}
+
+SessionPolicy SessionPolicy::Parse(const std::string& allowList, const std::string& denyList, const std::string& priorityList)
+{
+	SessionPolicy policy;
+	for (auto& appId : SplitList(allowList)) {
+		policy.allow.insert(std::move(appId));
+	}
+	for (auto& appId : SplitList(denyList)) {
+		policy.deny.insert(std::move(appId));
+	}
+
+	auto ordered = SplitList(priorityList);
+	for (size_t i = 0; i < ordered.size(); ++i) {
+		policy.priority.emplace(ordered[i], static_cast<int>(ordered.size() - i));
+	}
+	return policy;
+}
+
+void SessionTracker::SetPolicy(SessionPolicy newPolicy)
+{
+	policy = std::move(newPolicy);
+	for (auto& session : sessions) {
+		ApplyPolicy(session);
+	}
+	Reselect();
+}
+
+void SessionTracker::ApplyPolicy(TrackedSession& session) const
+{
+	std::string key = SessionPolicy::NormalizeAppId(session.appId);
+	session.allowed = !policy.deny.contains(key) && (policy.allow.empty() || policy.allow.contains(key));
+
+	auto it = policy.priority.find(key);
+	session.priority = it != policy.priority.end() ? it->second : 0;
+}
+
+std::vector<std::string> SessionTracker::SyncSessions(const std::vector<std::string>& appIds)
+{
+	std::unordered_set<std::string> live(appIds.begin(), appIds.end());
+
+	// Swap-remove sessions that went away and patch the moved entry's index
+	for (size_t i = 0; i < sessions.size();) {
+		if (live.contains(sessions[i].appId)) {
+			++i;
+			continue;
+		}
+		index.erase(sessions[i].appId);
+		if (i != sessions.size() - 1) {
+			sessions[i] = std::move(sessions.back());
+			index[sessions[i].appId] = i;
+		}
+		sessions.pop_back();
+	}
+
+	std::vector<std::string> added;
+	for (const auto& appId : appIds) {
+		if (index.contains(appId)) {
+			continue;
+		}
+		TrackedSession session;
+		session.appId = appId;
+		session.lastActivity = ++activityCounter;
+		ApplyPolicy(session);
+		index.emplace(appId, sessions.size());
+		sessions.push_back(std::move(session));
+		added.push_back(appId);
+	}
+
+	Reselect();
+	return added;
+}
+
+void SessionTracker::UpdateSession(const std::string& appId, const MediaInfo& info, bool playing)
+{
+	auto it = index.find(appId);
+	if (it == index.end()) {
+		return;
+	}
+
+	auto& session = sessions[it->second];
+	if (session.info != info || (playing && !session.playing)) {
+		session.lastActivity = ++activityCounter;
+	}
+	session.info = info;
+	session.playing = playing;
+	Reselect();
+}
+
+void SessionTracker::SetSystemCurrent(const std::string& appId)
+{
+	systemCurrent = appId;
+	Reselect();
+}
+
+const TrackedSession* SessionTracker::Selected() const
+{
+	return selected >= 0 ? &sessions[selected] : nullptr;
+}
+
+// Playing beats paused, then configured priority, then the session Windows
+// considers current, then whichever changed most recently
+bool SessionTracker::Prefer(const TrackedSession& a, const TrackedSession& b) const
+{
+	if (a.playing != b.playing) return a.playing;
+	if (a.priority != b.priority) return a.priority > b.priority;
+	bool aCurrent = a.appId == systemCurrent;
+	bool bCurrent = b.appId == systemCurrent;
+	if (aCurrent != bCurrent) return aCurrent;
+	return a.lastActivity > b.lastActivity;
+}
+
+void SessionTracker::Reselect()
+{
+	selected = -1;
+	for (size_t i = 0; i < sessions.size(); ++i) {
+		if (!sessions[i].allowed) {
+			continue;
+		}
+		if (selected < 0 || Prefer(sessions[i], sessions[selected])) {
+			selected = static_cast<int>(i);
+		}
+	}
+}
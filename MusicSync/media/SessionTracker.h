@@ -0,0 +1,62 @@
+#pragma once
+#include "MediaInfo.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Which media apps may be shown and which win when several are active.
+// App ids are SourceAppUserModelIds, matched case-insensitively.
+struct SessionPolicy {
+	std::unordered_set<std::string> allow;      // Empty allows every app
+	std::unordered_set<std::string> deny;
+	std::unordered_map<std::string, int> priority; // Higher wins, unlisted apps are 0
+
+	// Builds a policy from comma separated app id lists. The priority list is
+	// ordered, the first entry gets the highest priority.
+	static SessionPolicy Parse(const std::string& allowList, const std::string& denyList, const std::string& priorityList);
+	static std::string NormalizeAppId(std::string appId);
+};
+
+struct TrackedSession {
+	std::string appId;
+	MediaInfo info;
+	bool playing = false;
+	uint64_t lastActivity = 0;
+
+	// Policy results, evaluated when the session is added or the policy changes
+	bool allowed = true;
+	int priority = 0;
+};
+
+// Small table of the active media sessions keyed by app id. It is updated
+// incrementally as sessions come and go and re-picks the displayed session on
+// every change, so reading the selection is O(1).
+class SessionTracker
+{
+public:
+	void SetPolicy(SessionPolicy newPolicy);
+
+	// Replaces the set of live sessions. Returns the app ids that were added.
+	std::vector<std::string> SyncSessions(const std::vector<std::string>& appIds);
+	void UpdateSession(const std::string& appId, const MediaInfo& info, bool playing);
+	void SetSystemCurrent(const std::string& appId);
+
+	const TrackedSession* Selected() const;
+	const std::vector<TrackedSession>& Sessions() const { return sessions; }
+	bool Contains(const std::string& appId) const { return index.contains(appId); }
+
+private:
+	void ApplyPolicy(TrackedSession& session) const;
+	bool Prefer(const TrackedSession& a, const TrackedSession& b) const;
+	void Reselect();
+
+	std::vector<TrackedSession> sessions;
+	std::unordered_map<std::string, size_t> index;
+	SessionPolicy policy;
+	std::string systemCurrent;
+	int selected = -1;
+	uint64_t activityCounter = 0;
+};
@@ -0,0 +1,569 @@
+#include "pch.h"
+#include "SmtcMediaSource.h"
+#include "MediaStages.h"
+
+#include <chrono>
+#include <format>
+
+namespace winrt_foundation = winrt::Windows::Foundation;
+namespace winrt_media = winrt::Windows::Media::Control;
+namespace winrt_streams = winrt::Windows::Storage::Streams;
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+	constexpr auto callTimeout = std::chrono::seconds(5);
+	constexpr uint64_t maxThumbnailBytes = 10 * 1024 * 1024;
+
+	// A WinRT async operation as a StageCall. makeOperation starts it; if that
+	// throws, the call fails the same way a failed operation does. Stopping the
+	// stage cancels the operation.
+	template <typename MakeOperation>
+	auto Call(MakeOperation makeOperation)
+	{
+		using Operation = decltype(makeOperation());
+		using TResult = decltype(std::declval<Operation>().GetResults());
+		return StageCall<TResult>([makeOperation](typename StageCall<TResult>::Complete complete) -> std::function<void()> {
+			Operation operation{ nullptr };
+			try {
+				operation = makeOperation();
+				operation.Completed([complete](const Operation& finished, winrt_foundation::AsyncStatus status) {
+					StageResult<TResult> result;
+					if (status == winrt_foundation::AsyncStatus::Completed) {
+						try {
+							result.value.emplace(finished.GetResults());
+							result.status = StageStatus::Ok;
+						}
+						catch (const winrt::hresult_error& e) {
+							result.code = e.code();
+						}
+					}
+					else if (status == winrt_foundation::AsyncStatus::Canceled) {
+						result.status = StageStatus::Cancelled;
+					}
+					else {
+						result.code = finished.ErrorCode();
+					}
+					complete(std::move(result));
+				});
+			}
+			catch (const winrt::hresult_error& e) {
+				StageResult<TResult> result;
+				result.code = e.code();
+				complete(std::move(result));
+				return {};
+			}
+			return [operation] { operation.Cancel(); };
+		});
+	}
+
+	// MediaStages backend over SMTC, it holds no state so stages may outlive the source
+	struct SmtcBackend {
+		using Session = winrt_media::GlobalSystemMediaTransportControlsSession;
+		using Properties = winrt_media::GlobalSystemMediaTransportControlsSessionMediaProperties;
+		using Thumbnail = winrt_streams::IRandomAccessStreamReference;
+		using Stream = winrt_streams::IRandomAccessStreamWithContentType;
+		using Buffer = winrt_streams::IBuffer;
+
+		StageCall<Properties> RequestProperties(const Session& session) const
+		{
+			return Call([session] { return session.TryGetMediaPropertiesAsync(); });
+		}
+
+		StageCall<Stream> OpenThumbnail(const Thumbnail& thumbnail) const
+		{
+			return Call([thumbnail] { return thumbnail.OpenReadAsync(); });
+		}
+
+		uint64_t StreamSize(const Stream& stream) const { return stream.Size(); }
+
+		StageCall<Buffer> ReadStream(const Stream& stream, uint32_t size) const
+		{
+			return Call([stream, size] { return stream.ReadAsync(winrt_streams::Buffer(size), size, winrt_streams::InputStreamOptions::None); });
+		}
+
+		std::vector<uint8_t> BufferBytes(const Buffer& buffer) const
+		{
+			std::vector<uint8_t> bytes;
+			if (buffer != nullptr && buffer.Length() > 0) {
+				bytes.resize(buffer.Length());
+				winrt_streams::DataReader::FromBuffer(buffer).ReadBytes(bytes);
+			}
+			return bytes;
+		}
+	};
+
+	Stage<winrt_media::GlobalSystemMediaTransportControlsSessionManager> RequestManager()
+	{
+		co_return co_await Call([] { return winrt_media::GlobalSystemMediaTransportControlsSessionManager::RequestAsync(); });
+	}
+
+	// Stages here are only cancelled at their deadline, or once nobody waits for them
+	template <typename T>
+	winrt::hresult ErrorOf(const StageResult<T>& result)
+	{
+		switch (result.status) {
+		case StageStatus::Ok:
+			return S_OK;
+		case StageStatus::Cancelled:
+		case StageStatus::TimedOut:
+			return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+		default:
+			return result.code != 0 ? winrt::hresult(result.code) : winrt::hresult(E_FAIL);
+		}
+	}
+
+	double ToSeconds(winrt_foundation::TimeSpan span)
+	{
+		return std::chrono::duration<double>(span).count();
+	}
+
+	TimelineSample ReadTimeline(
+		const winrt_media::GlobalSystemMediaTransportControlsSessionTimelineProperties& timeline,
+		const winrt_media::GlobalSystemMediaTransportControlsSessionPlaybackInfo& playbackInfo,
+		bool playing)
+	{
+		TimelineSample sample;
+		sample.playing = playing;
+		if (timeline == nullptr) {
+			return sample;
+		}
+
+		sample.startSeconds = ToSeconds(timeline.StartTime());
+		sample.endSeconds = ToSeconds(timeline.EndTime());
+		sample.positionSeconds = ToSeconds(timeline.Position());
+		sample.valid = sample.endSeconds > sample.startSeconds;
+
+		if (playbackInfo != nullptr) {
+			if (auto rate = playbackInfo.PlaybackRate()) {
+				sample.playbackRate = rate.Value();
+			}
+		}
+
+		// The position was valid at LastUpdatedTime, move that onto the monotonic clock.
+		// Apps that never set it report the epoch, treat those positions as current.
+		int64_t now = PlaybackClock::NowNanos();
+		auto age = winrt::clock::now() - timeline.LastUpdatedTime();
+		auto ageNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(age).count();
+		bool plausible = ageNanos >= 0 && ageNanos * 1e-9 <= sample.DurationSeconds();
+		sample.capturedAtNanos = plausible ? now - ageNanos : now;
+		return sample;
+	}
+}
+
+SmtcMediaSource::~SmtcMediaSource()
+{
+	Unsubscribe();
+	CancelThumbnail();
+}
+
+winrt::hresult SmtcMediaSource::AcquireManager()
+{
+	if (manager != nullptr) {
+		return S_OK;
+	}
+
+	StageResult<SessionManager> result = StartStage(RequestManager())->Wait(Clock::now() + callTimeout);
+	winrt::hresult hr = ErrorOf(result);
+	if (hr == S_OK) {
+		manager = *result.value;
+		{
+			std::lock_guard<std::mutex> lock(statsMutex);
+			stats.managerAcquisitions++;
+		}
+		AttachManagerEvents();
+	}
+	sessionsStale = true;
+	return hr;
+}
+
+// The session list events belong to one manager, so they are attached again
+// whenever the manager is re-acquired after a failure
+void SmtcMediaSource::AttachManagerEvents()
+{
+	std::lock_guard<std::mutex> lock(eventMutex);
+	if (!onChanged || manager == nullptr) {
+		return;
+	}
+
+	try {
+		// Both only invalidate the session table, the media thread re-reads it
+		sessionsChangedRevoker = manager.SessionsChanged(winrt::auto_revoke,
+			[this](const auto&, const auto&) {
+				sessionsStale = true;
+				NotifyChanged();
+			});
+		currentChangedRevoker = manager.CurrentSessionChanged(winrt::auto_revoke,
+			[this](const auto&, const auto&) {
+				sessionsStale = true;
+				NotifyChanged();
+			});
+		subscribed = true;
+	}
+	catch (const winrt::hresult_error& e) {
+		LOG("Media change events unavailable: 0x{:08X}", static_cast<uint32_t>(e.code().value));
+		sessionsChangedRevoker.revoke();
+		currentChangedRevoker.revoke();
+		subscribed = false;
+	}
+}
+
+// Events of a dropped manager never arrive, the source polls the whole session
+// list until the next manager has its events attached
+void SmtcMediaSource::DetachManagerEvents()
+{
+	std::lock_guard<std::mutex> lock(eventMutex);
+	sessionsChangedRevoker.revoke();
+	currentChangedRevoker.revoke();
+	subscribed = false;
+}
+
+bool SmtcMediaSource::Subscribe(ChangedCallback callback)
+{
+	{
+		std::lock_guard<std::mutex> lock(eventMutex);
+		onChanged = std::move(callback);
+	}
+
+	// Without a manager yet the events are attached once one is acquired
+	winrt::hresult hr = AcquireManager();
+	if (hr != S_OK) {
+		LOG("Media change events unavailable: 0x{:08X}", static_cast<uint32_t>(hr.value));
+		return false;
+	}
+	if (!EventsActive()) {
+		AttachManagerEvents();
+	}
+	sessionsStale = true;
+	return EventsActive();
+}
+
+bool SmtcMediaSource::EventsActive() const
+{
+	std::lock_guard<std::mutex> lock(eventMutex);
+	return subscribed;
+}
+
+void SmtcMediaSource::Unsubscribe()
+{
+	std::lock_guard<std::mutex> lock(eventMutex);
+	sessionsChangedRevoker.revoke();
+	currentChangedRevoker.revoke();
+	for (auto& [appId, handle] : handles) {
+		handle.propertiesChangedRevoker.revoke();
+		handle.playbackChangedRevoker.revoke();
+		handle.timelineChangedRevoker.revoke();
+	}
+	onChanged = nullptr;
+	subscribed = false;
+}
+
+void SmtcMediaSource::SetSessionPolicy(SessionPolicy policy)
+{
+	tracker.SetPolicy(std::move(policy));
+}
+
+void SmtcMediaSource::MarkDirty(const std::string& appId, bool newProperties)
+{
+	{
+		std::lock_guard<std::mutex> lock(eventMutex);
+		dirtySessions.insert(appId);
+		if (newProperties) {
+			propertiesChanged.insert(appId);
+		}
+	}
+	NotifyChanged();
+}
+
+void SmtcMediaSource::NotifyChanged()
+{
+	ChangedCallback callback;
+	{
+		std::lock_guard<std::mutex> lock(eventMutex);
+		callback = onChanged;
+	}
+	if (callback) {
+		callback();
+	}
+}
+
+// Diffs the live session list against the table. Only sessions that appeared
+// get new handles and event hooks, existing ones are kept as they are.
+void SmtcMediaSource::ResyncSessions()
+{
+	auto sessions = manager.GetSessions();
+	std::vector<std::string> appIds;
+	std::unordered_map<std::string, Session> live;
+	for (const auto& session : sessions) {
+		std::string appId = winrt::to_string(session.SourceAppUserModelId());
+		appIds.push_back(appId);
+		live.emplace(std::move(appId), session);
+	}
+
+	for (auto it = handles.begin(); it != handles.end();) {
+		it = live.contains(it->first) ? std::next(it) : handles.erase(it);
+	}
+
+	std::lock_guard<std::mutex> lock(eventMutex);
+	for (const auto& appId : tracker.SyncSessions(appIds)) {
+		SessionHandle& handle = handles[appId];
+		handle.session = live.at(appId);
+		if (subscribed) {
+			handle.propertiesChangedRevoker = handle.session.MediaPropertiesChanged(winrt::auto_revoke,
+				[this, appId](const auto&, const auto&) { MarkDirty(appId, true); });
+			handle.playbackChangedRevoker = handle.session.PlaybackInfoChanged(winrt::auto_revoke,
+				[this, appId](const auto&, const auto&) { MarkDirty(appId); });
+			handle.timelineChangedRevoker = handle.session.TimelinePropertiesChanged(winrt::auto_revoke,
+				[this, appId](const auto&, const auto&) { MarkDirty(appId); });
+		}
+		dirtySessions.insert(appId);
+	}
+
+	auto current = manager.GetCurrentSession();
+	tracker.SetSystemCurrent(current != nullptr ? winrt::to_string(current.SourceAppUserModelId()) : std::string());
+
+	std::lock_guard<std::mutex> statsLock(statsMutex);
+	stats.sessionAcquisitions++;
+}
+
+winrt::hresult SmtcMediaSource::ApplyProperties(const std::string& appId, SessionHandle& handle,
+	const winrt_media::GlobalSystemMediaTransportControlsSessionMediaProperties& mediaProperties)
+{
+	MediaInfo info;
+	bool playing = false;
+
+	// Property getters are plain calls into the source app and only fail if it went away
+	try {
+		if (mediaProperties != nullptr) {
+			info.title = winrt::to_string(mediaProperties.Title());
+			info.artist = winrt::to_string(mediaProperties.Artist());
+			info.album = winrt::to_string(mediaProperties.AlbumTitle());
+			info.isValid = true;
+
+			handle.thumbnail = mediaProperties.Thumbnail();
+			info.hasThumbnail = handle.thumbnail != nullptr;
+			info.thumbnailRevision = handle.thumbnailRevision;
+		}
+
+		auto playbackInfo = handle.session.GetPlaybackInfo();
+		playing = playbackInfo != nullptr &&
+			playbackInfo.PlaybackStatus() == winrt_media::GlobalSystemMediaTransportControlsSessionPlaybackStatus::Playing;
+
+		info.timeline = ReadTimeline(handle.session.GetTimelineProperties(), playbackInfo, playing);
+	}
+	catch (const winrt::hresult_error& e) {
+		return e.code();
+	}
+
+	tracker.UpdateSession(appId, info, playing);
+	return S_OK;
+}
+
+SmtcMediaSource::FetchStatus SmtcMediaSource::FetchSelected(MediaInfo& info, winrt::hresult& error)
+{
+	error = AcquireManager();
+	if (error != S_OK) {
+		return FetchStatus::Failed;
+	}
+
+	// Without events nothing tells us about new sessions, so re-read the list every poll
+	if (sessionsStale.exchange(false) || !subscribed) {
+		ResyncSessions();
+	}
+
+	std::unordered_set<std::string> dirty;
+	std::unordered_set<std::string> announced;
+	{
+		std::lock_guard<std::mutex> lock(eventMutex);
+		dirty.swap(dirtySessions);
+		announced.swap(propertiesChanged);
+	}
+	// The thumbnail reference cannot be compared, so an announced change is
+	// what tells a new cover under the same title apart from a plain re-read
+	for (const auto& appId : announced) {
+		if (auto it = handles.find(appId); it != handles.end()) {
+			it->second.thumbnailRevision++;
+		}
+	}
+	if (!subscribed) {
+		for (const auto& session : tracker.Sessions()) {
+			dirty.insert(session.appId);
+		}
+	}
+	// The shown session is always refreshed in case an event was missed
+	if (const TrackedSession* selected = tracker.Selected()) {
+		dirty.insert(selected->appId);
+	}
+
+	// Every property request is started before any is waited on, so the slowest
+	// app bounds the fetch instead of the sum of all of them
+	std::vector<std::string> fetched;
+	std::vector<Session> sessions;
+	for (const auto& appId : dirty) {
+		if (auto it = handles.find(appId); it != handles.end()) {
+			fetched.push_back(appId);
+			sessions.push_back(it->second.session);
+		}
+	}
+
+	// Requests still running at the deadline are cancelled, the rest are applied
+	auto results = StartStage(FetchProperties(SmtcBackend{}, std::move(sessions)))->Wait(Clock::now() + callTimeout);
+	for (size_t i = 0; i < fetched.size(); ++i) {
+		winrt::hresult hr = HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+		if (results.value) {
+			const auto& result = (*results.value)[i];
+			hr = ErrorOf(result);
+			if (hr == S_OK) {
+				hr = ApplyProperties(fetched[i], handles.at(fetched[i]), *result.value);
+			}
+		}
+		if (hr != S_OK) {
+			// Keep the last known state of this session and re-read the session list next time
+			LogSessionFailure(fetched[i], hr);
+		}
+	}
+
+	const TrackedSession* selected = tracker.Selected();
+	if (selected == nullptr) {
+		return FetchStatus::NoSession;
+	}
+
+	info = selected->info;
+	PrefetchThumbnail(*selected, handles.at(selected->appId).thumbnail);
+	return FetchStatus::Ok;
+}
+
+void SmtcMediaSource::LogSessionFailure(const std::string& appId, winrt::hresult error)
+{
+	LOG("Error getting media info from {}: 0x{:08X}", appId, static_cast<uint32_t>(error.value));
+	sessionsStale = true;
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.failures++;
+}
+
+// Starts reading the cover as soon as the shown media changes, so it streams in
+// while the caller is still comparing metadata
+void SmtcMediaSource::PrefetchThumbnail(const TrackedSession& selected, const winrt_streams::IRandomAccessStreamReference& thumbnail)
+{
+	std::string key = selected.appId + '\n' + selected.info.artist + '\n' + selected.info.album + '\n' + selected.info.title +
+		'\n' + std::to_string(selected.info.thumbnailRevision) + (thumbnail != nullptr ? "+" : "-");
+	if (key == thumbnailKey) {
+		return; // Already read, in flight or skipped
+	}
+
+	CancelThumbnail();
+	thumbnailKey = std::move(key);
+	thumbnailSource = thumbnail;
+	if (thumbnail == nullptr) {
+		return;
+	}
+
+	thumbnailRead = StartStage(ReadCover(SmtcBackend{}, thumbnail, maxThumbnailBytes));
+}
+
+void SmtcMediaSource::CancelThumbnail()
+{
+	if (thumbnailRead != nullptr) {
+		thumbnailRead->Cancel();
+	}
+	thumbnailRead = nullptr;
+	thumbnailSource = nullptr;
+	thumbnailKey.clear();
+}
+
+// The key is kept so the same cover is not read again by the next fetch, and
+// the source so ReadThumbnail can still read it if it turns out to be needed
+void SmtcMediaSource::SkipThumbnail()
+{
+	if (thumbnailRead != nullptr) {
+		thumbnailRead->Cancel();
+	}
+	thumbnailRead = nullptr;
+}
+
+MediaInfo SmtcMediaSource::FetchCurrent()
+{
+	auto start = std::chrono::steady_clock::now();
+	ULONG64 startCycles = 0;
+	QueryThreadCycleTime(GetCurrentThread(), &startCycles);
+	uint64_t acquisitionsBefore = 0;
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		acquisitionsBefore = stats.managerAcquisitions + stats.sessionAcquisitions;
+	}
+
+	MediaInfo info;
+	winrt::hresult error;
+	FetchStatus status = FetchSelected(info, error);
+
+	if (status == FetchStatus::Failed) {
+		// Drop the cached handles, the next fetch re-acquires them
+		LOG("Error getting media info: 0x{:08X}", static_cast<uint32_t>(error.value));
+		info = MediaInfo{};
+		handles.clear();
+		tracker.SyncSessions({});
+		DetachManagerEvents();
+		manager = nullptr;
+		sessionsStale = true;
+	}
+	if (status != FetchStatus::Ok) {
+		CancelThumbnail();
+	}
+
+	ULONG64 endCycles = 0;
+	QueryThreadCycleTime(GetCurrentThread(), &endCycles);
+	auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.fetches++;
+	if (status == FetchStatus::NoSession) stats.noSession++;
+	if (status == FetchStatus::Failed) stats.failures++;
+	if (stats.managerAcquisitions + stats.sessionAcquisitions != acquisitionsBefore) {
+		stats.coldFetches++;
+		stats.coldMicros += micros;
+		stats.coldCycles += endCycles - startCycles;
+	}
+	else {
+		stats.warmFetches++;
+		stats.warmMicros += micros;
+		stats.warmCycles += endCycles - startCycles;
+	}
+
+	sessionSummary.clear();
+	const TrackedSession* selected = tracker.Selected();
+	for (const auto& session : tracker.Sessions()) {
+		sessionSummary.push_back(std::format("{}{} [{}{}, priority {}] {} - {}",
+			&session == selected ? "* " : "  ", session.appId,
+			session.playing ? "playing" : "paused", session.allowed ? "" : ", denied",
+			session.priority, session.info.artist, session.info.title));
+	}
+	return info;
+}
+
+MediaSourceStats SmtcMediaSource::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
+
+std::vector<std::string> SmtcMediaSource::DescribeSessions() const
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return sessionSummary;
+}
+
+std::vector<uint8_t> SmtcMediaSource::ReadThumbnail()
+{
+	if (thumbnailRead == nullptr && thumbnailSource != nullptr) {
+		thumbnailRead = StartStage(ReadCover(SmtcBackend{}, thumbnailSource, maxThumbnailBytes));
+	}
+	if (thumbnailRead == nullptr) {
+		return {};
+	}
+
+	StageResult<std::vector<uint8_t>> result = thumbnailRead->Wait(Clock::now() + callTimeout);
+	if (result.status != StageStatus::Ok) {
+		LOG("Failed to read album cover: 0x{:08X}", static_cast<uint32_t>(ErrorOf(result).value));
+		return {};
+	}
+	return *result.value;
+}
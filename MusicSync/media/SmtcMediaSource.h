@@ -0,0 +1,92 @@
+#pragma once
+#include "AsyncStage.h"
+#include "MediaSource.h"
+#include "SessionTracker.h"
+
+#include <winrt/Windows.Foundation.h>
+#include <winrt/Windows.Foundation.Collections.h>
+#include <winrt/Windows.Media.Control.h>
+#include <winrt/Windows.Storage.Streams.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+// MediaSource backed by the Windows GlobalSystemMediaTransportControls (SMTC) API.
+// Every active session is tracked, and the one shown is picked by SessionTracker
+// rather than by whatever Windows considers current. The session manager and the
+// session handles are cached and only re-acquired after a session list change or
+// a failed call. The calls themselves run as MediaStages: property requests for
+// all changed sessions run concurrently, and the cover of the shown media is read
+// by a cancellable stage that starts as soon as the media is known.
+class SmtcMediaSource : public MediaSource
+{
+public:
+	~SmtcMediaSource() override;
+
+	bool Subscribe(ChangedCallback onChanged) override;
+	void Unsubscribe() override;
+	bool EventsActive() const override;
+	MediaInfo FetchCurrent() override;
+	std::vector<uint8_t> ReadThumbnail() override;
+	void SkipThumbnail() override;
+	MediaSourceStats GetStats() const override;
+	void SetSessionPolicy(SessionPolicy policy) override;
+	std::vector<std::string> DescribeSessions() const override;
+
+private:
+	using SessionManager = winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSessionManager;
+	using Session = winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSession;
+
+	enum class FetchStatus {
+		Ok,
+		NoSession,
+		Failed
+	};
+
+	struct SessionHandle {
+		Session session{ nullptr };
+		Session::MediaPropertiesChanged_revoker propertiesChangedRevoker;
+		Session::PlaybackInfoChanged_revoker playbackChangedRevoker;
+		Session::TimelinePropertiesChanged_revoker timelineChangedRevoker;
+		winrt::Windows::Storage::Streams::IRandomAccessStreamReference thumbnail{ nullptr };
+		uint32_t thumbnailRevision = 0;
+	};
+
+	winrt::hresult AcquireManager();
+	void AttachManagerEvents();
+	void DetachManagerEvents();
+	void ResyncSessions();
+	winrt::hresult ApplyProperties(const std::string& appId, SessionHandle& handle,
+		const winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSessionMediaProperties& mediaProperties);
+	FetchStatus FetchSelected(MediaInfo& info, winrt::hresult& error);
+	void LogSessionFailure(const std::string& appId, winrt::hresult error);
+	void PrefetchThumbnail(const TrackedSession& selected, const winrt::Windows::Storage::Streams::IRandomAccessStreamReference& thumbnail);
+	void CancelThumbnail();
+	void MarkDirty(const std::string& appId, bool newProperties = false);
+	void NotifyChanged();
+
+	// Cached handles and the session table, only touched by the thread calling FetchCurrent/Subscribe
+	SessionManager manager{ nullptr };
+	std::unordered_map<std::string, SessionHandle> handles;
+	SessionTracker tracker;
+	std::atomic<bool> sessionsStale{ true };
+	bool subscribed = false; // Written by the media thread under eventMutex
+
+	mutable std::mutex eventMutex;
+	ChangedCallback onChanged;
+	std::unordered_set<std::string> dirtySessions;
+	std::unordered_set<std::string> propertiesChanged; // Subset of dirtySessions that announced new media properties
+	SessionManager::SessionsChanged_revoker sessionsChangedRevoker;
+	SessionManager::CurrentSessionChanged_revoker currentChangedRevoker;
+
+	// In-flight or finished read of the shown cover, media thread only
+	std::shared_ptr<StageOperation<std::vector<uint8_t>>> thumbnailRead;
+	winrt::Windows::Storage::Streams::IRandomAccessStreamReference thumbnailSource{ nullptr }; // Kept to read a skipped cover on demand
+	std::string thumbnailKey;
+
+	mutable std::mutex statsMutex;
+	MediaSourceStats stats;
+	std::vector<std::string> sessionSummary;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Single writer, single reader hand-off of a value too big to update atomically.
+// The writer fills Back() and publishes it; the reader picks up the newest value
+// with Acquire() and keeps reading Front() until the next one. Neither side
+// blocks or allocates, and a slot is never written while the reader holds it.
+template <typename T>
+class TripleBuffer
+{
+public:
+	// Writer side
+	T& Back() { return slots[backIndex]; }
+
+	void Publish()
+	{
+		uint8_t previous = middle.exchange(static_cast<uint8_t>(backIndex | freshBit), std::memory_order_acq_rel);
+		backIndex = previous & indexMask;
+	}
+
+	// Reader side. Returns true if a newer value was picked up.
+	bool Acquire()
+	{
+		if ((middle.load(std::memory_order_relaxed) & freshBit) == 0) {
+			return false;
+		}
+		uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+		frontIndex = previous & indexMask;
+		return true;
+	}
+
+	const T& Front() const { return slots[frontIndex]; }
+
+private:
+	static constexpr uint8_t indexMask = 0x3;
+	static constexpr uint8_t freshBit = 0x4;
+
+	std::array<T, 3> slots{};
+	uint8_t backIndex = 0;  // Writer only
+	uint8_t frontIndex = 1; // Reader only
+	std::atomic<uint8_t> middle{ 2 };
+};
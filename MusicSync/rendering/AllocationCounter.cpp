@@ -0,0 +1,83 @@
+#include "pch.h"
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef MUSICSYNC_COUNT_ALLOCATIONS
+
+namespace {
+    thread_local bool counting = false;
+    thread_local bool paused = false;
+    thread_local uint64_t allocations = 0;
+
+    void* Allocate(std::size_t size) noexcept
+    {
+        if (counting && !paused) {
+            ++allocations;
+        }
+        return std::malloc(size != 0 ? size : 1);
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* memory = Allocate(size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+void AllocationCounter::Start()
+{
+    allocations = 0;
+    paused = false;
+    counting = true;
+}
+
+uint64_t AllocationCounter::Stop()
+{
+    counting = false;
+    return allocations;
+}
+
+void AllocationCounter::Pause()
+{
+    paused = true;
+}
+
+void AllocationCounter::Resume()
+{
+    paused = false;
+}
+
+#else
+
+void AllocationCounter::Start() {}
+uint64_t AllocationCounter::Stop() { return 0; }
+void AllocationCounter::Pause() {}
+void AllocationCounter::Resume() {}
+
+#endif
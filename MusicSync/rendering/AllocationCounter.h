@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+// Counts heap allocations made through operator new on the calling thread
+// between Start and Stop. Only built with MUSICSYNC_COUNT_ALLOCATIONS, which
+// the test build sets and which replaces the global operator new. Otherwise
+// every call is a no-op and Stop returns zero.
+class AllocationCounter
+{
+public:
+    static constexpr bool enabled =
+#ifdef MUSICSYNC_COUNT_ALLOCATIONS
+        true;
+#else
+        false;
+#endif
+
+    static void Start();
+    static uint64_t Stop();
+
+    // Excludes calls into code we do not control from the count
+    static void Pause();
+    static void Resume();
+};
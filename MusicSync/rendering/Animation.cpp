@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "Animation.h"
+
+namespace {
+    constexpr size_t easingSteps = 256;
+    using EasingTable = std::array<float, easingSteps + 1>;
+
+    constexpr float EaseExact(Easing easing, float t)
+    {
+        switch (easing) {
+        case Easing::InOutCubic: {
+            if (t < 0.5f) {
+                return 4.0f * t * t * t;
+            }
+            float f = -2.0f * t + 2.0f;
+            return 1.0f - f * f * f / 2.0f;
+        }
+        case Easing::OutCubic: {
+            float f = 1.0f - t;
+            return 1.0f - f * f * f;
+        }
+        case Easing::OutBack: {
+            constexpr float c1 = 1.70158f;
+            constexpr float c3 = c1 + 1.0f;
+            float f = t - 1.0f;
+            return 1.0f + c3 * f * f * f + c1 * f * f;
+        }
+        default:
+            return t;
+        }
+    }
+
+    constexpr EasingTable MakeEasingTable(Easing easing)
+    {
+        EasingTable table{};
+        for (size_t i = 0; i <= easingSteps; ++i) {
+            table[i] = EaseExact(easing, static_cast<float>(i) / easingSteps);
+        }
+        return table;
+    }
+
+    constexpr std::array<EasingTable, static_cast<size_t>(Easing::Count)> easingTables = {
+        MakeEasingTable(Easing::Linear),
+        MakeEasingTable(Easing::InOutCubic),
+        MakeEasingTable(Easing::OutCubic),
+        MakeEasingTable(Easing::OutBack),
+    };
+
+    static_assert(easingTables[static_cast<size_t>(Easing::InOutCubic)][easingSteps / 2] == 0.5f);
+    static_assert(easingTables[static_cast<size_t>(Easing::OutBack)][easingSteps] == 1.0f);
+}
+
+float Ease(Easing easing, float t)
+{
+    if (t <= 0.0f) {
+        return 0.0f;
+    }
+    if (t >= 1.0f) {
+        return 1.0f;
+    }
+    const EasingTable& table = easingTables[static_cast<size_t>(easing) % easingTables.size()];
+    float position = t * easingSteps;
+    size_t index = static_cast<size_t>(position);
+    float fraction = position - static_cast<float>(index);
+    return table[index] + (table[index + 1] - table[index]) * fraction;
+}
+
+bool AnimationTrack::Add(float time, float value, Easing easing)
+{
+    if (count == keyframes.size() || (count > 0 && time < keyframes[count - 1].time)) {
+        return false;
+    }
+    keyframes[count++] = Keyframe{ time, value, easing };
+    return true;
+}
+
+float AnimationTrack::Evaluate(float time) const
+{
+    if (count == 0) {
+        return 0.0f;
+    }
+    if (time <= keyframes[0].time) {
+        return keyframes[0].value;
+    }
+    for (size_t i = 1; i < count; ++i) {
+        const Keyframe& to = keyframes[i];
+        if (time < to.time) {
+            const Keyframe& from = keyframes[i - 1];
+            float t = (time - from.time) / (to.time - from.time);
+            return from.value + (to.value - from.value) * Ease(to.easing, t);
+        }
+    }
+    return keyframes[count - 1].value;
+}
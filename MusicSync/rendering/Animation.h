@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum class Easing : uint8_t {
+    Linear,
+    InOutCubic,
+    OutCubic,
+    OutBack, // Overshoots slightly before settling
+    Count
+};
+
+// Eased progress for t in [0, 1]. Looks up a table generated at compile time
+// and interpolates between its entries, so no easing math runs per frame.
+float Ease(Easing easing, float t);
+
+struct Keyframe {
+    float time = 0.0f;  // Seconds from the start of the animation
+    float value = 0.0f;
+    Easing easing = Easing::Linear; // Curve of the segment that ends at this keyframe
+};
+
+// Keyframes of one animated value, stored inline. Clearing and adding never
+// allocate, so tracks can be rebuilt on the render thread.
+class AnimationTrack
+{
+public:
+    static constexpr size_t maxKeyframes = 4;
+
+    void Clear() { count = 0; }
+
+    // Keyframes must be added in time order. Returns false when the track is
+    // full or the time goes backwards, the keyframe is then dropped.
+    bool Add(float time, float value, Easing easing = Easing::Linear);
+
+    // Holds the first value before the first keyframe and the last value after
+    // the last one. An empty track evaluates to 0.
+    float Evaluate(float time) const;
+    float Duration() const { return count > 0 ? keyframes[count - 1].time : 0.0f; }
+
+private:
+    std::array<Keyframe, maxKeyframes> keyframes;
+    size_t count = 0;
+};
@@ -0,0 +1,321 @@
+#include "pch.h"
+#include "Compositor.h"
+#include "TextFitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MUSICSYNC_BLEND_SSE2 1
+#endif
+
+namespace {
+    // x / 255 rounded to nearest for x in [0, 255 * 255], the same formula in every kernel
+    inline uint32_t Div255(uint32_t x)
+    {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    void BlendOverScalar(uint8_t* dst, const uint8_t* src, size_t pixels)
+    {
+        for (size_t i = 0; i < pixels; ++i, dst += 4, src += 4) {
+            uint32_t inverse = 255 - src[3];
+            for (int c = 0; c < 4; ++c) {
+                dst[c] = static_cast<uint8_t>((std::min)(255u, src[c] + Div255(dst[c] * inverse)));
+            }
+        }
+    }
+
+    void BlendCoverageScalar(uint8_t* dst, const uint8_t* coverage, const uint8_t color[4], size_t pixels)
+    {
+        for (size_t i = 0; i < pixels; ++i, dst += 4) {
+            uint8_t src[4];
+            for (int c = 0; c < 4; ++c) {
+                src[c] = static_cast<uint8_t>(Div255(color[c] * coverage[i]));
+            }
+            BlendOverScalar(dst, src, 1);
+        }
+    }
+
+#ifdef MUSICSYNC_BLEND_SSE2
+    // Eight 16-bit lanes of x / 255, same rounding as Div255
+    inline __m128i Div255Sse2(__m128i x)
+    {
+        x = _mm_add_epi16(x, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+    // Two premultiplied pixels in 16-bit lanes over two destination pixels
+    inline __m128i OverSse2(__m128i src, __m128i dst)
+    {
+        __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, 0xFF), 0xFF);
+        __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+        return _mm_add_epi16(src, Div255Sse2(_mm_mullo_epi16(dst, inverse)));
+    }
+
+    void BlendOverSse2(uint8_t* dst, const uint8_t* src, size_t pixels)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 4 <= pixels; i += 4) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+            __m128i low = OverSse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+            __m128i high = OverSse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(low, high));
+        }
+        BlendOverScalar(dst + i * 4, src + i * 4, pixels - i);
+    }
+
+    void BlendCoverageSse2(uint8_t* dst, const uint8_t* coverage, const uint8_t color[4], size_t pixels)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        uint32_t packedColor;
+        std::memcpy(&packedColor, color, 4);
+        const __m128i colorWide = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(packedColor)), zero);
+
+        size_t i = 0;
+        for (; i + 4 <= pixels; i += 4) {
+            uint32_t packedCoverage;
+            std::memcpy(&packedCoverage, coverage + i, 4);
+            if (packedCoverage == 0) {
+                continue;
+            }
+            // Spread each coverage byte over the four channels of its pixel
+            __m128i c = _mm_cvtsi32_si128(static_cast<int>(packedCoverage));
+            c = _mm_unpacklo_epi8(c, c);
+            c = _mm_unpacklo_epi16(c, c);
+            __m128i srcLow = Div255Sse2(_mm_mullo_epi16(colorWide, _mm_unpacklo_epi8(c, zero)));
+            __m128i srcHigh = Div255Sse2(_mm_mullo_epi16(colorWide, _mm_unpackhi_epi8(c, zero)));
+
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i * 4));
+            __m128i low = OverSse2(srcLow, _mm_unpacklo_epi8(d, zero));
+            __m128i high = OverSse2(srcHigh, _mm_unpackhi_epi8(d, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_packus_epi16(low, high));
+        }
+        BlendCoverageScalar(dst + i * 4, coverage + i, color, pixels - i);
+    }
+#endif
+
+    void Premultiply(const uint8_t straight[4], uint8_t premultiplied[4])
+    {
+        for (int c = 0; c < 3; ++c) {
+            premultiplied[c] = static_cast<uint8_t>(Div255(straight[c] * straight[3]));
+        }
+        premultiplied[3] = straight[3];
+    }
+
+    uint64_t Mix(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    uint64_t MixValue(uint64_t hash, const T& value)
+    {
+        return Mix(hash, &value, sizeof(value));
+    }
+
+    // Coverage of one row of a rounded rectangle, anti-aliased along the corner arcs
+    void RoundedRowCoverage(int y, int width, int height, int radius, uint8_t* coverage)
+    {
+        std::memset(coverage, 255, width);
+        int cornerY = -1;
+        if (y < radius) {
+            cornerY = radius;
+        }
+        else if (y >= height - radius) {
+            cornerY = height - radius;
+        }
+        if (cornerY < 0) {
+            return;
+        }
+
+        // Distance of each pixel center to the corner circle center, one pixel of falloff
+        float dy = (y + 0.5f) - cornerY;
+        for (int x = 0; x < radius && x < width; ++x) {
+            float dx = radius - (x + 0.5f);
+            float distance = std::sqrt(dx * dx + dy * dy);
+            float alpha = std::clamp(radius - distance + 0.5f, 0.0f, 1.0f);
+            uint8_t value = static_cast<uint8_t>(alpha * 255.0f + 0.5f);
+            coverage[x] = value;
+            coverage[width - 1 - x] = value;
+        }
+    }
+}
+
+void Bitmap::Reset(int newWidth, int newHeight)
+{
+    width = (std::max)(0, newWidth);
+    height = (std::max)(0, newHeight);
+    pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+}
+
+BlendKernel BestBlendKernel()
+{
+#ifdef MUSICSYNC_BLEND_SSE2
+    return BlendKernel::Sse2;
+#else
+    return BlendKernel::Scalar;
+#endif
+}
+
+void BlendOver(uint8_t* dst, const uint8_t* src, size_t pixels, BlendKernel kernel)
+{
+#ifdef MUSICSYNC_BLEND_SSE2
+    if (kernel == BlendKernel::Sse2) {
+        BlendOverSse2(dst, src, pixels);
+        return;
+    }
+#endif
+    BlendOverScalar(dst, src, pixels);
+}
+
+void BlendCoverage(uint8_t* dst, const uint8_t* coverage, const uint8_t color[4], size_t pixels, BlendKernel kernel)
+{
+#ifdef MUSICSYNC_BLEND_SSE2
+    if (kernel == BlendKernel::Sse2) {
+        BlendCoverageSse2(dst, coverage, color, pixels);
+        return;
+    }
+#endif
+    BlendCoverageScalar(dst, coverage, color, pixels);
+}
+
+void Unpremultiply(const Bitmap& bitmap, std::vector<uint8_t>& rgba)
+{
+    rgba.resize(bitmap.pixels.size());
+    for (size_t i = 0; i < bitmap.pixels.size(); i += 4) {
+        uint32_t alpha = bitmap.pixels[i + 3];
+        for (int c = 0; c < 3; ++c) {
+            rgba[i + c] = alpha == 0 ? 0 : static_cast<uint8_t>((std::min)(255u, (bitmap.pixels[i + c] * 255 + alpha / 2) / alpha));
+        }
+        rgba[i + 3] = static_cast<uint8_t>(alpha);
+    }
+}
+
+uint64_t CompositorScene::Hash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = MixValue(hash, width);
+    hash = MixValue(hash, height);
+    hash = Mix(hash, background, sizeof(background));
+    hash = MixValue(hash, cornerRadius);
+    hash = MixValue(hash, cover.get());
+    hash = MixValue(hash, coverX);
+    hash = MixValue(hash, coverY);
+    hash = MixValue(hash, coverWidth);
+    hash = MixValue(hash, coverHeight);
+    for (const CompositorLine& line : lines) {
+        hash = Mix(hash, line.text.data(), line.text.size());
+        hash = MixValue(hash, line.pixelHeight);
+        hash = MixValue(hash, line.x);
+        hash = MixValue(hash, line.y);
+        hash = MixValue(hash, line.maxWidth);
+        hash = Mix(hash, line.color, sizeof(line.color));
+    }
+    return hash;
+}
+
+void Compose(const CompositorScene& scene, const GlyphFont& font, Bitmap& out, BlendKernel kernel)
+{
+    out.Reset(scene.width, scene.height);
+    if (out.width == 0 || out.height == 0) {
+        return;
+    }
+
+    // Background, every row goes through the coverage blend so corners need no special case
+    uint8_t background[4];
+    Premultiply(scene.background, background);
+    int radius = std::clamp(scene.cornerRadius, 0, (std::min)(out.width, out.height) / 2);
+    std::vector<uint8_t> coverage(out.width);
+    for (int y = 0; y < out.height; ++y) {
+        RoundedRowCoverage(y, out.width, out.height, radius, coverage.data());
+        BlendCoverage(out.Row(y), coverage.data(), background, out.width, kernel);
+    }
+
+    // Cover, nearest sampled if it was not resampled to exactly this size yet
+    const CoverImage* cover = scene.cover.get();
+    if (cover && cover->width > 0 && cover->height > 0 && scene.coverWidth > 0 && scene.coverHeight > 0) {
+        std::vector<uint8_t> row(static_cast<size_t>(scene.coverWidth) * 4);
+        int x0 = (std::max)(0, -scene.coverX);
+        int x1 = (std::min)(scene.coverWidth, out.width - scene.coverX);
+        for (int y = (std::max)(0, -scene.coverY); y < scene.coverHeight && scene.coverY + y < out.height; ++y) {
+            int sourceY = y * cover->height / scene.coverHeight;
+            const uint8_t* source = cover->rgba.data() + static_cast<size_t>(sourceY) * cover->width * 4;
+            for (int x = x0; x < x1; ++x) {
+                int sourceX = x * cover->width / scene.coverWidth;
+                Premultiply(source + sourceX * 4, row.data() + x * 4);
+            }
+            if (x1 > x0) {
+                BlendOver(out.Row(scene.coverY + y) + (scene.coverX + x0) * 4, row.data() + x0 * 4, x1 - x0, kernel);
+            }
+        }
+    }
+
+    // Text, cut with the compositor font's own widths
+    TextFitter fitter([&font](const std::string& text, float pixelHeight) { return font.Measure(text, pixelHeight); });
+    CoverageMask mask;
+    for (const CompositorLine& line : scene.lines) {
+        std::string text = fitter.Fit(line.text, line.pixelHeight, static_cast<float>(line.maxWidth));
+        font.Rasterize(text, line.pixelHeight, mask);
+        uint8_t color[4];
+        Premultiply(line.color, color);
+
+        // The mask has a pixel of margin on the left
+        int left = line.x - 1;
+        int x0 = (std::max)(0, -left);
+        int x1 = (std::min)(mask.width, out.width - left);
+        for (int y = (std::max)(0, -line.y); y < mask.height && line.y + y < out.height; ++y) {
+            if (x1 > x0) {
+                BlendCoverage(out.Row(line.y + y) + (left + x0) * 4, mask.coverage.data() + static_cast<size_t>(y) * mask.width + x0,
+                    color, x1 - x0, kernel);
+            }
+        }
+    }
+}
+
+uint64_t HashPixels(const Bitmap& bitmap)
+{
+    return Mix(14695981039346656037ull, bitmap.pixels.data(), bitmap.pixels.size());
+}
+
+CompositorScene GoldenScene()
+{
+    auto cover = std::make_shared<CoverImage>();
+    cover->width = 64;
+    cover->height = 64;
+    cover->rgba.resize(64 * 64 * 4);
+    for (int y = 0; y < 64; ++y) {
+        for (int x = 0; x < 64; ++x) {
+            uint8_t* pixel = cover->rgba.data() + (y * 64 + x) * 4;
+            pixel[0] = static_cast<uint8_t>(x * 4);
+            pixel[1] = static_cast<uint8_t>(y * 4);
+            pixel[2] = static_cast<uint8_t>((x ^ y) * 4);
+            pixel[3] = static_cast<uint8_t>(128 + x * 2);
+        }
+    }
+
+    CompositorScene scene;
+    scene.width = 330;
+    scene.height = 70;
+    scene.background[0] = 30;
+    scene.background[1] = 60;
+    scene.background[2] = 90;
+    scene.background[3] = 200;
+    scene.cornerRadius = 12;
+    scene.cover = std::move(cover);
+    scene.coverX = 10;
+    scene.coverY = 5;
+    scene.coverWidth = 60;
+    scene.coverHeight = 60;
+    return scene;
+}
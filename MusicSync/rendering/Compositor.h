@@ -0,0 +1,78 @@
+#pragma once
+#include "GlyphFont.h"
+#include "../imaging/CoverImage.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Premultiplied RGBA, tightly packed rows
+struct Bitmap {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    void Reset(int newWidth, int newHeight);
+    uint8_t* Row(int y) { return pixels.data() + static_cast<size_t>(y) * width * 4; }
+};
+
+enum class BlendKernel {
+    Scalar,
+    Sse2
+};
+
+// SSE2 on every x64 CPU, scalar elsewhere
+BlendKernel BestBlendKernel();
+
+// Premultiplied src over dst. Integer math with exact rounding, so every
+// kernel gives the same pixels.
+void BlendOver(uint8_t* dst, const uint8_t* src, size_t pixels, BlendKernel kernel = BestBlendKernel());
+
+// A premultiplied color scaled by each coverage value, over dst
+void BlendCoverage(uint8_t* dst, const uint8_t* coverage, const uint8_t color[4], size_t pixels,
+    BlendKernel kernel = BestBlendKernel());
+
+// Straight alpha copy for file formats and textures that expect it
+void Unpremultiply(const Bitmap& bitmap, std::vector<uint8_t>& rgba);
+
+struct CompositorLine {
+    std::string text;
+    float pixelHeight = 16.0f;
+    int x = 0;
+    int y = 0;        // Top of the line
+    int maxWidth = 0; // Longer text is cut with an ellipsis
+    uint8_t color[4] = { 255, 255, 255, 255 }; // Straight alpha
+};
+
+// Everything in one overlay texture. Positions are relative to its top left.
+struct CompositorScene {
+    int width = 0;
+    int height = 0;
+    uint8_t background[4] = { 0, 0, 0, 255 }; // Straight alpha
+    int cornerRadius = 0;
+
+    std::shared_ptr<const CoverImage> cover;
+    int coverX = 0;
+    int coverY = 0;
+    int coverWidth = 0;
+    int coverHeight = 0;
+
+    std::vector<CompositorLine> lines;
+
+    // Identifies the result, equal scenes compose to equal pixels
+    uint64_t Hash() const;
+};
+
+// Rasterizes the background with anti-aliased rounded corners, the cover and
+// the text into out. Pure CPU work, meant for a worker thread.
+void Compose(const CompositorScene& scene, const GlyphFont& font, Bitmap& out, BlendKernel kernel = BestBlendKernel());
+
+// FNV-1a of the pixels, for comparing results
+uint64_t HashPixels(const Bitmap& bitmap);
+
+// Fixed scene without text, so its pixels do not depend on the installed
+// fonts: translucent rounded background and a generated cover that is drawn
+// scaled. Every kernel must compose it to goldenSceneHash.
+CompositorScene GoldenScene();
+constexpr uint64_t goldenSceneHash = 0xb2ef63ac18de9b86ull;
@@ -0,0 +1,330 @@
+#include "pch.h"
+#include "CoverAtlas.h"
+#include "../IMGUI/imstb_rectpack.h"
+#include "../imaging/BmpWriter.h"
+#include "../imaging/Resampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // Empty column and row after every thumbnail, so filtered samples never pick up a neighbour
+    constexpr int gap = 1;
+
+    // Scales the cover so its longer side is thumbSize, from the smallest mip
+    // that is still at least that large. Leaves width at 0 for a cover without pixels.
+    void MakeThumbnail(const CoverImage& cover, int thumbSize, std::vector<uint8_t>& rgba, int& width, int& height)
+    {
+        width = 0;
+        height = 0;
+        const uint8_t* source = cover.rgba.data();
+        int sourceWidth = cover.width;
+        int sourceHeight = cover.height;
+        if (sourceWidth <= 0 || sourceHeight <= 0 || cover.rgba.size() < static_cast<size_t>(sourceWidth) * sourceHeight * 4) {
+            return;
+        }
+        for (const CoverMip& mip : cover.mips) {
+            if ((std::max)(mip.width, mip.height) < thumbSize) {
+                break;
+            }
+            source = mip.rgba.data();
+            sourceWidth = mip.width;
+            sourceHeight = mip.height;
+        }
+
+        float fit = static_cast<float>(thumbSize) / (std::max)(sourceWidth, sourceHeight);
+        width = (std::clamp)(static_cast<int>(std::lround(sourceWidth * fit)), 1, thumbSize);
+        height = (std::clamp)(static_cast<int>(std::lround(sourceHeight * fit)), 1, thumbSize);
+        rgba.resize(static_cast<size_t>(width) * height * 4);
+        if (width == sourceWidth && height == sourceHeight) {
+            std::memcpy(rgba.data(), source, rgba.size());
+        }
+        else {
+            ResampleLanczos(source, sourceWidth, sourceHeight, rgba.data(), width, height);
+        }
+    }
+}
+
+struct CoverAtlas::Packer {
+    stbrp_context context{};
+    std::vector<stbrp_node> nodes;
+
+    void Reset(int width, int height)
+    {
+        nodes.resize(width);
+        stbrp_init_target(&context, width, height, nodes.data(), static_cast<int>(nodes.size()));
+    }
+};
+
+CoverAtlas::CoverAtlas()
+    : packer(std::make_unique<Packer>())
+{
+}
+
+CoverAtlas::~CoverAtlas() = default;
+
+void CoverAtlas::Update(const std::vector<std::shared_ptr<const CoverImage>>& covers, int newThumbSize, int newCapacity)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats.updates++;
+    newThumbSize = (std::max)(newThumbSize, 1);
+    newCapacity = (std::max)({ newCapacity, static_cast<int>(covers.size()), 1 });
+    if (newThumbSize != thumbSize || newCapacity != capacity) {
+        Reset(newThumbSize, newCapacity);
+    }
+
+    auto slotOf = [this](const std::filesystem::path& cover) {
+        auto it = std::find_if(slots.begin(), slots.end(), [&](const Slot& slot) { return slot.cover == cover; });
+        return it != slots.end() ? static_cast<int>(it - slots.begin()) : -1;
+    };
+
+    // Evicted covers leave holes where they were
+    for (Slot& slot : slots) {
+        if (slot.cover.empty()) {
+            continue;
+        }
+        bool wanted = std::any_of(covers.begin(), covers.end(),
+            [&](const std::shared_ptr<const CoverImage>& cover) { return cover && cover->texturePath == slot.cover; });
+        if (!wanted) {
+            ClearCell(slot);
+            slot.cover.clear();
+            slot.rgba.clear();
+            stats.evicted++;
+        }
+    }
+
+    // New covers go into the smallest hole they fit, then into free space
+    std::vector<Slot> unplaced;
+    for (const std::shared_ptr<const CoverImage>& cover : covers) {
+        if (!cover || cover->texturePath.empty()) {
+            continue;
+        }
+        if (slotOf(cover->texturePath) >= 0) {
+            stats.kept++;
+            continue;
+        }
+        Slot slot;
+        MakeThumbnail(*cover, thumbSize, slot.rgba, slot.width, slot.height);
+        if (slot.width == 0) {
+            continue;
+        }
+        stats.thumbnails++;
+        slot.cover = cover->texturePath;
+        slot.cellWidth = slot.width + gap;
+        slot.cellHeight = slot.height + gap;
+
+        Slot* hole = nullptr;
+        for (Slot& candidate : slots) {
+            if (candidate.cover.empty() && candidate.cellWidth >= slot.cellWidth && candidate.cellHeight >= slot.cellHeight &&
+                (!hole || candidate.cellWidth * candidate.cellHeight < hole->cellWidth * hole->cellHeight)) {
+                hole = &candidate;
+            }
+        }
+        if (hole) {
+            slot.x = hole->x;
+            slot.y = hole->y;
+            slot.cellWidth = hole->cellWidth;
+            slot.cellHeight = hole->cellHeight;
+            *hole = std::move(slot);
+            Blit(*hole);
+            stats.holesReused++;
+        }
+        else if (Pack(slot.cellWidth, slot.cellHeight, slot.x, slot.y)) {
+            slots.push_back(std::move(slot));
+            Blit(slots.back());
+        }
+        else {
+            unplaced.push_back(std::move(slot));
+        }
+    }
+    if (!unplaced.empty()) {
+        // The holes are too small or scattered, everything still wanted is placed again
+        for (Slot& slot : slots) {
+            if (!slot.cover.empty()) {
+                slot.cellWidth = slot.width + gap;
+                slot.cellHeight = slot.height + gap;
+                unplaced.push_back(std::move(slot));
+            }
+        }
+        Repack(std::move(unplaced));
+        stats.repacks++;
+    }
+
+    tiles.assign(covers.size(), CoverAtlasTile{});
+    for (size_t i = 0; i < covers.size(); ++i) {
+        int index = covers[i] && !covers[i]->texturePath.empty() ? slotOf(covers[i]->texturePath) : -1;
+        if (index < 0) {
+            continue;
+        }
+        const Slot& slot = slots[index];
+        CoverAtlasTile& tile = tiles[i];
+        tile.uv0 = Vector2F{ static_cast<float>(slot.x) / width, static_cast<float>(slot.y) / height };
+        tile.uv1 = Vector2F{ static_cast<float>(slot.x + slot.width) / width, static_cast<float>(slot.y + slot.height) / height };
+        tile.width = slot.width;
+        tile.height = slot.height;
+    }
+    stats.uploadBytes += pixels.size();
+    stats.updateMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Room for capacity thumbnails in a grid as close to square as it gets
+void CoverAtlas::Reset(int newThumbSize, int newCapacity)
+{
+    thumbSize = newThumbSize;
+    capacity = newCapacity;
+    int cell = thumbSize + gap;
+    int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(capacity))));
+    int rows = (capacity + columns - 1) / columns;
+    width = columns * cell;
+    height = rows * cell;
+    pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+    slots.clear();
+    packer->Reset(width, height);
+}
+
+bool CoverAtlas::Pack(int cellWidth, int cellHeight, int& x, int& y)
+{
+    stbrp_rect rect{};
+    rect.w = static_cast<stbrp_coord>(cellWidth);
+    rect.h = static_cast<stbrp_coord>(cellHeight);
+    if (!stbrp_pack_rects(&packer->context, &rect, 1)) {
+        return false;
+    }
+    x = rect.x;
+    y = rect.y;
+    return true;
+}
+
+// Packs the slots tallest first like a fresh build, a row taller each time
+// they do not fit
+void CoverAtlas::Repack(std::vector<Slot> placed)
+{
+    std::sort(placed.begin(), placed.end(), [](const Slot& a, const Slot& b) { return a.cellHeight > b.cellHeight; });
+    bool fits = false;
+    for (int candidate = height; !fits; candidate += thumbSize + gap) {
+        height = candidate;
+        packer->Reset(width, height);
+        fits = true;
+        for (size_t i = 0; i < placed.size() && fits; ++i) {
+            fits = Pack(placed[i].cellWidth, placed[i].cellHeight, placed[i].x, placed[i].y);
+        }
+    }
+    pixels.assign(static_cast<size_t>(width) * height * 4, 0);
+    slots = std::move(placed);
+    for (const Slot& slot : slots) {
+        Blit(slot);
+    }
+}
+
+void CoverAtlas::Blit(const Slot& slot)
+{
+    size_t rowBytes = static_cast<size_t>(slot.width) * 4;
+    for (int y = 0; y < slot.height; ++y) {
+        std::memcpy(&pixels[(static_cast<size_t>(slot.y + y) * width + slot.x) * 4], &slot.rgba[y * rowBytes], rowBytes);
+    }
+}
+
+void CoverAtlas::ClearCell(const Slot& slot)
+{
+    size_t rowBytes = static_cast<size_t>(slot.cellWidth) * 4;
+    for (int y = 0; y < slot.cellHeight; ++y) {
+        std::memset(&pixels[(static_cast<size_t>(slot.y + y) * width + slot.x) * 4], 0, rowBytes);
+    }
+}
+
+CoverAtlasBuilder::CoverAtlasBuilder(std::filesystem::path stagingDirectory)
+    : stagingDirectory(std::move(stagingDirectory))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(this->stagingDirectory, ec);
+    worker = std::thread(&CoverAtlasBuilder::Run, this);
+}
+
+CoverAtlasBuilder::~CoverAtlasBuilder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void CoverAtlasBuilder::Submit(std::vector<std::shared_ptr<const CoverImage>> covers, int thumbSize, int capacity, uint64_t key)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = Job{ std::move(covers), thumbSize, capacity, key };
+    }
+    wake.notify_one();
+}
+
+bool CoverAtlasBuilder::TakeResult(Result& result)
+{
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock() || !ready) {
+        return false;
+    }
+    result = std::move(*ready);
+    ready.reset();
+    taken[1] = taken[0];
+    taken[0] = result.texturePath;
+    return true;
+}
+
+CoverAtlasStats CoverAtlasBuilder::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void CoverAtlasBuilder::Run()
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending.has_value(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(*pending);
+            pending.reset();
+        }
+
+        // The covers are released before the result is handed over, the atlas has their pixels
+        atlas.Update(job.covers, job.thumbSize, job.capacity);
+        job.covers.clear();
+
+        Result result;
+        result.key = job.key;
+        result.thumbSize = job.thumbSize;
+        result.tiles = atlas.Tiles();
+        result.texturePath = stagingDirectory / ("recent_" + std::to_string(written++) + ".bmp");
+        bool staged = WriteBmp(result.texturePath, atlas.Pixels().data(), atlas.Width(), atlas.Height());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats = atlas.GetStats();
+        if (staged && !pending) {
+            RemoveStale(result.texturePath);
+            ready = std::move(result);
+        }
+    }
+}
+
+// Worker, with the mutex held so taken does not change underneath
+void CoverAtlasBuilder::RemoveStale(const std::filesystem::path& keep)
+{
+    std::error_code ec;
+    for (const auto& file : std::filesystem::directory_iterator(stagingDirectory, ec)) {
+        const std::filesystem::path& path = file.path();
+        std::string name = path.filename().string();
+        if (name.rfind("recent_", 0) == 0 && path != keep && path != taken[0] && path != taken[1]) {
+            std::filesystem::remove(path, ec);
+        }
+    }
+}
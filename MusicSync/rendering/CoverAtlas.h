@@ -0,0 +1,142 @@
+#pragma once
+#include "pch.h"
+#include "../imaging/CoverImage.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Most covers the recent tracks strip shows
+constexpr int maxRecentCovers = 8;
+
+// Where one cover's thumbnail is in the atlas texture
+struct CoverAtlasTile {
+    Vector2F uv0{ 0.0f, 0.0f };
+    Vector2F uv1{ 0.0f, 0.0f };
+    int width = 0;  // Pixels, 0 for a cover without pixels
+    int height = 0;
+};
+
+struct CoverAtlasStats {
+    uint64_t updates = 0;
+    uint64_t thumbnails = 0;  // Covers scaled down, one already in the atlas is not scaled again
+    uint64_t kept = 0;        // Covers that stayed where they were
+    uint64_t evicted = 0;
+    uint64_t holesReused = 0; // New covers placed where an evicted one was
+    uint64_t repacks = 0;
+    uint64_t uploadBytes = 0; // Texture bytes staged, the whole atlas every update
+    uint64_t updateMicros = 0;
+};
+
+// Thumbnails of a few covers packed into one RGBA texture with stb_rect_pack,
+// so a strip of them is drawn from a single texture. Updates are incremental:
+// covers still wanted keep their place and pixels, a cover no longer wanted
+// leaves a hole that a new thumbnail of the same or smaller size takes, and
+// only when neither a hole nor free space fits is everything packed again.
+class CoverAtlas
+{
+public:
+    CoverAtlas();
+    ~CoverAtlas();
+    CoverAtlas(const CoverAtlas&) = delete;
+    CoverAtlas& operator=(const CoverAtlas&) = delete;
+
+    // Makes the atlas hold exactly these covers, Tiles() follows their order.
+    // Thumbnails fit in thumbSize squares and the texture is sized for capacity
+    // of them, another thumbSize or capacity starts over.
+    void Update(const std::vector<std::shared_ptr<const CoverImage>>& covers, int thumbSize, int capacity);
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    const std::vector<uint8_t>& Pixels() const { return pixels; } // Straight alpha
+    const std::vector<CoverAtlasTile>& Tiles() const { return tiles; }
+    const CoverAtlasStats& GetStats() const { return stats; }
+
+private:
+    struct Packer;
+
+    struct Slot {
+        std::filesystem::path cover; // Staged texture of the cover, empty for a hole
+        int x = 0;
+        int y = 0;
+        int width = 0;      // Of the thumbnail
+        int height = 0;
+        int cellWidth = 0;  // Packed room, a hole is reused by anything that fits
+        int cellHeight = 0;
+        std::vector<uint8_t> rgba; // Kept for repacking
+    };
+
+    void Reset(int newThumbSize, int newCapacity);
+    bool Pack(int cellWidth, int cellHeight, int& x, int& y);
+    void Repack(std::vector<Slot> placed);
+    void Blit(const Slot& slot);
+    void ClearCell(const Slot& slot);
+
+    int thumbSize = 0;
+    int capacity = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+    std::vector<Slot> slots;
+    std::vector<CoverAtlasTile> tiles;
+    std::unique_ptr<Packer> packer;
+    CoverAtlasStats stats;
+};
+
+// Keeps a CoverAtlas up to date on its own thread and stages it as a BMP for
+// the canvas. Only the newest cover list is built. Staged atlases other than
+// the two last taken are deleted when a new one is written.
+class CoverAtlasBuilder
+{
+public:
+    struct Result {
+        uint64_t key = 0;
+        std::filesystem::path texturePath;
+        int thumbSize = 0;
+        std::vector<CoverAtlasTile> tiles;
+    };
+
+    explicit CoverAtlasBuilder(std::filesystem::path stagingDirectory);
+    ~CoverAtlasBuilder();
+    CoverAtlasBuilder(const CoverAtlasBuilder&) = delete;
+    CoverAtlasBuilder& operator=(const CoverAtlasBuilder&) = delete;
+
+    // Render thread. Replaces a list that has not been started yet.
+    void Submit(std::vector<std::shared_ptr<const CoverImage>> covers, int thumbSize, int capacity, uint64_t key);
+
+    // Render thread, never blocks. True if a new result was taken.
+    bool TakeResult(Result& result);
+
+    CoverAtlasStats GetStats() const;
+
+private:
+    struct Job {
+        std::vector<std::shared_ptr<const CoverImage>> covers;
+        int thumbSize = 0;
+        int capacity = 0;
+        uint64_t key = 0;
+    };
+
+    void Run();
+    void RemoveStale(const std::filesystem::path& keep);
+
+    std::filesystem::path stagingDirectory;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::optional<Job> pending;
+    std::optional<Result> ready;
+    std::array<std::filesystem::path, 2> taken; // Newest first
+    CoverAtlasStats stats;
+
+    CoverAtlas atlas; // Worker only
+    uint64_t written = 0;
+    std::thread worker;
+};
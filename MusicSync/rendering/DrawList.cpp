@@ -0,0 +1,204 @@
+#include "pch.h"
+#include "DrawList.h"
+
+void DrawList::Clear()
+{
+    // Strings keep their buffers, the next recording assigns into them
+    commandCount = 0;
+    contentStart = 0;
+    stringCount = 0;
+    overflowed = false;
+}
+
+DrawCommand* DrawList::Add(DrawOp op)
+{
+    if (commandCount == commands.size()) {
+        overflowed = true;
+        return nullptr;
+    }
+    DrawCommand& command = commands[commandCount++];
+    command = DrawCommand{};
+    command.op = op;
+    return &command;
+}
+
+uint8_t DrawList::Intern(std::string_view text)
+{
+    for (size_t i = 0; i < stringCount; ++i) {
+        if (strings[i] == text) {
+            return static_cast<uint8_t>(i);
+        }
+    }
+    if (stringCount == strings.size()) {
+        overflowed = true;
+        return static_cast<uint8_t>(strings.size() - 1);
+    }
+    strings[stringCount].assign(text);
+    return static_cast<uint8_t>(stringCount++);
+}
+
+void DrawList::SetColor(const LinearColor& color)
+{
+    if (DrawCommand* command = Add(DrawOp::SetColor)) {
+        command->color = color;
+    }
+}
+
+void DrawList::SetPosition(Vector2 position)
+{
+    if (DrawCommand* command = Add(DrawOp::SetPosition)) {
+        command->min = position;
+    }
+}
+
+void DrawList::DrawRect(Vector2 min, Vector2 max, float rounding)
+{
+    if (DrawCommand* command = Add(DrawOp::DrawRect)) {
+        command->min = min;
+        command->max = max;
+        command->rounding = rounding;
+    }
+}
+
+void DrawList::DrawTexture(ImageWrapper* texture, float scale, float rounding)
+{
+    if (DrawCommand* command = Add(DrawOp::DrawTexture)) {
+        command->texture = texture;
+        command->xScale = scale;
+        command->rounding = rounding;
+    }
+}
+
+void DrawList::DrawTile(ImageWrapper* texture, Vector2 min, Vector2 max, Vector2F uv0, Vector2F uv1, float rounding)
+{
+    if (DrawCommand* command = Add(DrawOp::DrawTile)) {
+        command->texture = texture;
+        command->min = min;
+        command->max = max;
+        command->uv0 = uv0;
+        command->uv1 = uv1;
+        command->rounding = rounding;
+    }
+}
+
+void DrawList::DrawString(std::string_view text, float xScale, float yScale)
+{
+    uint8_t index = Intern(text);
+    if (DrawCommand* command = Add(DrawOp::DrawString)) {
+        command->stringIndex = index;
+        command->xScale = xScale;
+        command->yScale = yScale;
+    }
+}
+
+void DrawList::DrawProgress(Vector2 min, Vector2 max, const LinearColor& trackColor, const LinearColor& fillColor)
+{
+    if (DrawCommand* command = Add(DrawOp::DrawProgress)) {
+        command->min = min;
+        command->max = max;
+        command->color = trackColor;
+        command->fillColor = fillColor;
+    }
+}
+
+void DrawList::DrawMarquee(Vector2 position, const Marquee* marquee, float xScale, float yScale)
+{
+    if (DrawCommand* command = Add(DrawOp::DrawMarquee)) {
+        command->min = position;
+        command->marquee = marquee;
+        command->xScale = xScale;
+        command->yScale = yScale;
+    }
+}
+
+void DrawList::Freeze(uint64_t nowNanos)
+{
+    for (size_t i = 0; i < commandCount; ++i) {
+        DrawCommand& command = commands[i];
+        if (command.op != DrawOp::DrawMarquee || !command.marquee) {
+            continue;
+        }
+        Marquee::Window window = command.marquee->At(nowNanos);
+        command.min.X += static_cast<int>(window.x);
+        command.stringIndex = Intern(window.text);
+        command.marquee = nullptr;
+    }
+}
+
+namespace {
+    Vector2 Apply(const DrawTransform& transform, Vector2 point)
+    {
+        float x = transform.origin.X + (point.X - transform.origin.X) * transform.scale + transform.offsetX;
+        float y = transform.origin.Y + (point.Y - transform.origin.Y) * transform.scale;
+        return Vector2{ static_cast<int>(x), static_cast<int>(y) };
+    }
+
+    void SetTargetColor(DrawTarget& target, const LinearColor& color, float alpha)
+    {
+        target.SetColor(LinearColor{ color.R, color.G, color.B, color.A * alpha });
+    }
+}
+
+void DrawList::Replay(DrawTarget& target, float progress, uint64_t nowNanos, const DrawTransform& transform, DrawPart part) const
+{
+    size_t first = part == DrawPart::Content ? contentStart : 0;
+    size_t last = part == DrawPart::Background ? contentStart : commandCount;
+    float scale = transform.scale;
+
+    for (size_t i = first; i < last; ++i) {
+        const DrawCommand& command = commands[i];
+        switch (command.op) {
+        case DrawOp::SetColor:
+            SetTargetColor(target, command.color, transform.alpha);
+            break;
+        case DrawOp::SetPosition:
+            target.SetPosition(Apply(transform, command.min));
+            break;
+        case DrawOp::DrawRect:
+            target.DrawRect(Apply(transform, command.min), Apply(transform, command.max), command.rounding * scale);
+            break;
+        case DrawOp::DrawTexture:
+            target.DrawTexture(command.texture, command.xScale * scale, command.rounding * scale);
+            break;
+        case DrawOp::DrawTile:
+            target.DrawTile(command.texture, Apply(transform, command.min), Apply(transform, command.max), command.uv0,
+                command.uv1, command.rounding * scale);
+            break;
+        case DrawOp::DrawString:
+            target.DrawString(strings[command.stringIndex], command.xScale * scale, command.yScale * scale);
+            break;
+        case DrawOp::DrawProgress: {
+            if (progress < 0.0f) {
+                break;
+            }
+            Vector2 min = Apply(transform, command.min);
+            Vector2 max = Apply(transform, command.max);
+            int fillWidth = static_cast<int>((max.X - min.X) * progress);
+            SetTargetColor(target, command.color, transform.alpha);
+            target.DrawRect(min, max, 0.0f);
+            SetTargetColor(target, command.fillColor, transform.alpha);
+            target.DrawRect(min, Vector2{ min.X + fillWidth, max.Y }, 0.0f);
+            break;
+        }
+        case DrawOp::DrawMarquee: {
+            // Frozen marquees keep the text they showed in the string table
+            std::string_view text;
+            Vector2 position = command.min;
+            if (command.marquee) {
+                Marquee::Window window = command.marquee->At(nowNanos);
+                text = window.text;
+                position.X += static_cast<int>(window.x);
+            }
+            else {
+                text = strings[command.stringIndex];
+            }
+            if (text.empty()) {
+                break;
+            }
+            target.SetPosition(Apply(transform, position));
+            target.DrawString(text, command.xScale * scale, command.yScale * scale);
+            break;
+        }
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "pch.h"
+#include "Marquee.h"
+#include "DrawTarget.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+
+enum class DrawOp : uint8_t {
+    SetColor,
+    SetPosition,
+    DrawRect,
+    DrawTexture,
+    DrawTile,
+    DrawString,
+    DrawProgress,
+    DrawMarquee
+};
+
+struct DrawCommand {
+    DrawOp op = DrawOp::SetColor;
+    LinearColor color{ 0, 0, 0, 0 };
+    LinearColor fillColor{ 0, 0, 0, 0 }; // DrawProgress only
+    Vector2 min{ 0, 0 };                 // Position or rect start
+    Vector2 max{ 0, 0 };
+    float xScale = 1.0f;
+    float yScale = 1.0f;
+    float rounding = 0.0f;               // DrawRect and the textures, where the target can round
+    Vector2F uv0{ 0.0f, 0.0f };          // DrawTile only
+    Vector2F uv1{ 1.0f, 1.0f };
+    ImageWrapper* texture = nullptr;
+    const Marquee* marquee = nullptr;
+    uint8_t stringIndex = 0;
+};
+
+// Applied to a replay: positions scale around origin and move by offsetX,
+// colors are multiplied by alpha. The default leaves everything as recorded.
+struct DrawTransform {
+    Vector2 origin{ 0, 0 };
+    float offsetX = 0.0f;
+    float scale = 1.0f;
+    float alpha = 1.0f;
+};
+
+// Commands recorded before MarkContent are the background, the rest the content
+enum class DrawPart : uint8_t {
+    All,
+    Background,
+    Content
+};
+
+// Retained draw commands for the overlay. Recorded when the media or the
+// layout changes and replayed every frame. Commands live in a fixed array and
+// strings in a fixed table whose buffers are reused between recordings, so a
+// replay never touches the heap. Textures are not owned, the recorder keeps
+// them alive until the next recording.
+class DrawList
+{
+public:
+    static constexpr size_t maxCommands = 48;
+    static constexpr size_t maxStrings = 8;
+
+    void Clear();
+
+    void SetColor(const LinearColor& color);
+    void SetPosition(Vector2 position);
+    void DrawRect(Vector2 min, Vector2 max, float rounding = 0.0f);
+    void DrawTexture(ImageWrapper* texture, float scale, float rounding = 0.0f);
+    void DrawTile(ImageWrapper* texture, Vector2 min, Vector2 max, Vector2F uv0, Vector2F uv1, float rounding = 0.0f);
+    void DrawString(std::string_view text, float xScale, float yScale);
+
+    // Track in trackColor with the first `progress` of it in fillColor, the
+    // progress is passed to Replay. Skipped when that is negative.
+    void DrawProgress(Vector2 min, Vector2 max, const LinearColor& trackColor, const LinearColor& fillColor);
+
+    // Scrolling line with its clip region starting at position. The window is
+    // picked from the clock reading passed to Replay, the marquee is not owned.
+    void DrawMarquee(Vector2 position, const Marquee* marquee, float xScale, float yScale);
+
+    void MarkContent() { contentStart = commandCount; }
+
+    // Turns every marquee into the text it shows at nowNanos, so the list no
+    // longer depends on marquees that are about to be reused for another track
+    void Freeze(uint64_t nowNanos);
+
+    void Replay(DrawTarget& target, float progress, uint64_t nowNanos,
+        const DrawTransform& transform = DrawTransform{}, DrawPart part = DrawPart::All) const;
+
+    size_t Size() const { return commandCount; }
+    bool Overflowed() const { return overflowed; }
+
+private:
+    DrawCommand* Add(DrawOp op);
+    uint8_t Intern(std::string_view text);
+
+    std::array<DrawCommand, maxCommands> commands;
+    size_t commandCount = 0;
+    size_t contentStart = 0;
+    std::array<std::string, maxStrings> strings;
+    size_t stringCount = 0;
+    bool overflowed = false;
+};
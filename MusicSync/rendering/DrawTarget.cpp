@@ -0,0 +1,58 @@
+#include "pch.h"
+#include "DrawTarget.h"
+#include "AllocationCounter.h"
+
+namespace {
+    constexpr unsigned char translucentBlend = 2; // EBlendMode BLEND_Translucent
+}
+
+void CanvasDrawTarget::SetColor(const LinearColor& color)
+{
+    canvas.SetColor(color.R, color.G, color.B, color.A);
+    this->color = color;
+}
+
+void CanvasDrawTarget::SetPosition(Vector2 position)
+{
+    canvas.SetPosition(position);
+}
+
+void CanvasDrawTarget::DrawRect(Vector2 min, Vector2 max, float /*rounding*/)
+{
+    canvas.DrawRect(min, max);
+    drawCalls++;
+}
+
+void CanvasDrawTarget::DrawTexture(ImageWrapper* texture, float scale, float /*rounding*/)
+{
+    canvas.DrawTexture(texture, scale);
+    drawCalls++;
+}
+
+void CanvasDrawTarget::DrawTile(ImageWrapper* texture, Vector2 min, Vector2 max, Vector2F uv0, Vector2F uv1, float /*rounding*/)
+{
+    if (!texture) {
+        return;
+    }
+    // The tile takes texel coordinates and a 0-1 color
+    Vector2 size = texture->GetSize();
+    canvas.SetPosition(min);
+    canvas.DrawTile(texture, static_cast<float>(max.X - min.X), static_cast<float>(max.Y - min.Y),
+        uv0.X * size.X, uv0.Y * size.Y, (uv1.X - uv0.X) * size.X, (uv1.Y - uv0.Y) * size.Y,
+        LinearColor{ color.R / 255.0f, color.G / 255.0f, color.B / 255.0f, color.A / 255.0f }, 1, translucentBlend);
+    drawCalls++;
+}
+
+void CanvasDrawTarget::DrawString(std::string_view text, float xScale, float yScale)
+{
+    // The SDK takes the text as a std::string by value, that allocation is not ours to avoid
+    AllocationCounter::Pause();
+    canvas.DrawString(std::string(text), xScale, yScale);
+    AllocationCounter::Resume();
+    drawCalls++;
+}
+
+float CanvasDrawTarget::MeasureString(const std::string& text, float scale)
+{
+    return canvas.GetStringSize(text, scale, scale).X;
+}
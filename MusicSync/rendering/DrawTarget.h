@@ -0,0 +1,66 @@
+#pragma once
+#include "pch.h"
+
+#include <string>
+#include <string_view>
+
+// Pixel height of the canvas font at scale 1, for targets that draw text in other fonts
+constexpr float canvasFontPixels = 14.0f;
+
+enum class OverlayBackend : uint8_t {
+    Canvas,
+    ImGui
+};
+
+// Where a DrawList is replayed. Colors are 0-255 like the canvas, text scales
+// are canvas font scales. Every draw call is counted for the settings panel.
+class DrawTarget
+{
+public:
+    virtual ~DrawTarget() = default;
+
+    virtual OverlayBackend Backend() const = 0;
+    virtual Vector2 GetSize() = 0;
+    // Changes whenever text would measure differently, e.g. another font
+    virtual uintptr_t MetricsId() const = 0;
+
+    virtual void SetColor(const LinearColor& color) = 0;
+    virtual void SetPosition(Vector2 position) = 0;
+    // Rounding is a corner radius in pixels, targets that cannot round ignore it
+    virtual void DrawRect(Vector2 min, Vector2 max, float rounding) = 0;
+    virtual void DrawTexture(ImageWrapper* texture, float scale, float rounding) = 0;
+    // Stretches the part of the texture between uv0 and uv1 (0 to 1) over min to max
+    virtual void DrawTile(ImageWrapper* texture, Vector2 min, Vector2 max, Vector2F uv0, Vector2F uv1, float rounding) = 0;
+    virtual void DrawString(std::string_view text, float xScale, float yScale) = 0;
+    virtual float MeasureString(const std::string& text, float scale) = 0;
+
+    // Draws that reach the GPU, where the target can tell. The canvas cannot,
+    // its count is the number of calls.
+    virtual uint64_t Batches() const { return drawCalls; }
+    uint64_t DrawCalls() const { return drawCalls; }
+
+protected:
+    uint64_t drawCalls = 0;
+};
+
+class CanvasDrawTarget : public DrawTarget
+{
+public:
+    explicit CanvasDrawTarget(CanvasWrapper& canvas) : canvas(canvas) {}
+
+    OverlayBackend Backend() const override { return OverlayBackend::Canvas; }
+    Vector2 GetSize() override { return canvas.GetSize(); }
+    uintptr_t MetricsId() const override { return 1; }
+
+    void SetColor(const LinearColor& color) override;
+    void SetPosition(Vector2 position) override;
+    void DrawRect(Vector2 min, Vector2 max, float rounding) override;
+    void DrawTexture(ImageWrapper* texture, float scale, float rounding) override;
+    void DrawTile(ImageWrapper* texture, Vector2 min, Vector2 max, Vector2F uv0, Vector2F uv1, float rounding) override;
+    void DrawString(std::string_view text, float xScale, float yScale) override;
+    float MeasureString(const std::string& text, float scale) override;
+
+private:
+    CanvasWrapper& canvas;
+    LinearColor color{ 255, 255, 255, 255 }; // DrawTile takes the color as an argument
+};
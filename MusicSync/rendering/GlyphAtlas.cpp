@@ -0,0 +1,235 @@
+#include "pch.h"
+#include "GlyphAtlas.h"
+#include "../IMGUI/imstb_rectpack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+    // Empty column and row after every glyph, so filtered samples never pick up a neighbour
+    constexpr int gap = 1;
+
+    // Tallest atlas, doubling stops here. stb_rect_pack's coordinates are 16 bit.
+    constexpr int maxHeight = 32768;
+}
+
+struct GlyphAtlas::Packer {
+    stbrp_context context{};
+    std::vector<stbrp_node> nodes;
+
+    void Reset(int width, int height)
+    {
+        nodes.resize(width);
+        stbrp_init_target(&context, width, height, nodes.data(), static_cast<int>(nodes.size()));
+    }
+};
+
+GlyphAtlas::GlyphAtlas(int width, int initialHeight)
+    : width(width), height(initialHeight), pixels(static_cast<size_t>(width) * initialHeight, 0),
+    packer(std::make_unique<Packer>())
+{
+    packer->Reset(width, height);
+}
+
+GlyphAtlas::~GlyphAtlas() = default;
+
+const AtlasGlyph* GlyphAtlas::Find(uint64_t key) const
+{
+    auto it = glyphs.find(key);
+    return it != glyphs.end() ? &it->second : nullptr;
+}
+
+bool GlyphAtlas::Pack(Packer& into, int glyphWidth, int glyphHeight, int& x, int& y)
+{
+    stbrp_rect rect{};
+    rect.w = static_cast<stbrp_coord>(glyphWidth + gap);
+    rect.h = static_cast<stbrp_coord>(glyphHeight + gap);
+    if (!stbrp_pack_rects(&into.context, &rect, 1)) {
+        return false;
+    }
+    x = rect.x;
+    y = rect.y;
+    return true;
+}
+
+bool GlyphAtlas::Grow()
+{
+    if (height >= maxHeight || !Repack(height * 2)) {
+        return false;
+    }
+    grows++;
+    return true;
+}
+
+// Packs every glyph again, tallest first like a fresh build, into an atlas of
+// at least newHeight. Keeps doubling if the skyline wastes too much room, up to
+// maxHeight; false, and nothing moved, if they do not fit even then.
+bool GlyphAtlas::Repack(int newHeight)
+{
+    std::vector<AtlasGlyph*> order;
+    for (auto& [key, glyph] : glyphs) {
+        if (glyph.width > 0) {
+            order.push_back(&glyph);
+        }
+    }
+    std::sort(order.begin(), order.end(), [](const AtlasGlyph* a, const AtlasGlyph* b) { return a->height > b->height; });
+
+    // Placed before anything moves
+    std::vector<std::pair<int, int>> placement(order.size());
+    auto trial = std::make_unique<Packer>();
+    int candidate = (std::min)(newHeight, maxHeight);
+    for (;;) {
+        trial->Reset(width, candidate);
+        bool placed = true;
+        for (size_t i = 0; i < order.size() && placed; ++i) {
+            placed = Pack(*trial, order[i]->width, order[i]->height, placement[i].first, placement[i].second);
+        }
+        if (placed) {
+            break;
+        }
+        if (candidate >= maxHeight) {
+            return false;
+        }
+        candidate = (std::min)(candidate * 2, maxHeight);
+    }
+
+    height = candidate;
+    packer = std::move(trial);
+    std::vector<uint8_t> oldPixels = std::move(pixels);
+    pixels.assign(static_cast<size_t>(width) * height, 0);
+    for (size_t i = 0; i < order.size(); ++i) {
+        AtlasGlyph* glyph = order[i];
+        auto [x, y] = placement[i];
+        for (int row = 0; row < glyph->height; ++row) {
+            std::memcpy(pixels.data() + static_cast<size_t>(y + row) * width + x,
+                oldPixels.data() + static_cast<size_t>(glyph->y + row) * width + glyph->x, glyph->width);
+        }
+        glyph->x = x;
+        glyph->y = y;
+    }
+    return true;
+}
+
+const AtlasGlyph& GlyphAtlas::Add(uint64_t key, const uint8_t* source, int glyphWidth, int glyphHeight, int xOffset, int yOffset)
+{
+    AtlasGlyph glyph;
+    glyph.xOffset = xOffset;
+    glyph.yOffset = yOffset;
+    if (source && glyphWidth > 0 && glyphHeight > 0 && glyphWidth + gap <= width && glyphHeight + gap <= maxHeight) {
+        bool packed = Pack(*packer, glyphWidth, glyphHeight, glyph.x, glyph.y);
+        while (!packed && Grow()) {
+            packed = Pack(*packer, glyphWidth, glyphHeight, glyph.x, glyph.y);
+        }
+        if (!packed) {
+            // A full atlas draws the glyph as a blank rather than growing without end
+            return glyphs[key] = glyph;
+        }
+        glyph.width = glyphWidth;
+        glyph.height = glyphHeight;
+        for (int row = 0; row < glyphHeight; ++row) {
+            std::memcpy(pixels.data() + static_cast<size_t>(glyph.y + row) * width + glyph.x,
+                source + static_cast<size_t>(row) * glyphWidth, glyphWidth);
+        }
+    }
+    return glyphs[key] = glyph;
+}
+
+namespace {
+    template <typename T>
+    void Put(std::vector<uint8_t>& out, T value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    bool Take(const uint8_t*& data, const uint8_t* end, T& value)
+    {
+        if (static_cast<size_t>(end - data) < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+        return true;
+    }
+}
+
+void GlyphAtlas::Write(std::vector<uint8_t>& out) const
+{
+    Put<int32_t>(out, width);
+    Put<int32_t>(out, height);
+    Put<uint32_t>(out, static_cast<uint32_t>(glyphs.size()));
+    for (const auto& [key, glyph] : glyphs) {
+        Put<uint64_t>(out, key);
+        for (int value : { glyph.x, glyph.y, glyph.width, glyph.height, glyph.xOffset, glyph.yOffset }) {
+            Put<int32_t>(out, value);
+        }
+    }
+    out.insert(out.end(), pixels.begin(), pixels.end());
+}
+
+bool GlyphAtlas::Read(const uint8_t* data, size_t size)
+{
+    const uint8_t* end = data + size;
+    int32_t fileWidth;
+    int32_t fileHeight;
+    uint32_t count;
+    if (!Take(data, end, fileWidth) || !Take(data, end, fileHeight) || !Take(data, end, count) ||
+        fileWidth <= 0 || fileHeight <= 0 || fileWidth > 4096 || fileHeight > maxHeight) {
+        return false;
+    }
+
+    std::unordered_map<uint64_t, AtlasGlyph> fileGlyphs;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t key;
+        int32_t values[6];
+        if (!Take(data, end, key)) {
+            return false;
+        }
+        for (int32_t& value : values) {
+            if (!Take(data, end, value)) {
+                return false;
+            }
+        }
+        AtlasGlyph glyph{ values[0], values[1], values[2], values[3], values[4], values[5] };
+        // In 64 bit so tampered values cannot wrap around, and with the gap Add leaves
+        // so every glyph can be packed again
+        if (glyph.width < 0 || glyph.height < 0 || glyph.x < 0 || glyph.y < 0 ||
+            int64_t{ glyph.x } + glyph.width > fileWidth || int64_t{ glyph.y } + glyph.height > fileHeight ||
+            (glyph.width > 0 && (int64_t{ glyph.width } + gap > fileWidth || int64_t{ glyph.height } + gap > maxHeight))) {
+            return false;
+        }
+        fileGlyphs[key] = glyph;
+    }
+    size_t pixelBytes = static_cast<size_t>(fileWidth) * fileHeight;
+    if (static_cast<size_t>(end - data) != pixelBytes) {
+        return false;
+    }
+
+    // The packer's state is not stored, repacking rebuilds it along with the pixels.
+    // The current contents come back if the file's glyphs cannot be packed.
+    int oldWidth = width;
+    std::unordered_map<uint64_t, AtlasGlyph> oldGlyphs = std::exchange(glyphs, std::move(fileGlyphs));
+    std::vector<uint8_t> oldPixels = std::exchange(pixels, std::vector<uint8_t>(data, data + pixelBytes));
+    width = fileWidth;
+    if (!Repack(fileHeight)) {
+        width = oldWidth;
+        glyphs = std::move(oldGlyphs);
+        pixels = std::move(oldPixels);
+        return false;
+    }
+    return true;
+}
+
+GlyphAtlasStats GlyphAtlas::GetStats() const
+{
+    GlyphAtlasStats stats;
+    stats.glyphs = glyphs.size();
+    stats.width = width;
+    stats.height = height;
+    stats.bytes = pixels.size() + packer->nodes.size() * sizeof(stbrp_node);
+    stats.grows = grows;
+    stats.buildMicros = buildMicros;
+    return stats;
+}
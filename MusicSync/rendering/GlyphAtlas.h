@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct GlyphAtlasStats {
+    size_t glyphs = 0;
+    int width = 0;
+    int height = 0;
+    size_t bytes = 0;      // Pixels plus packer nodes
+    uint64_t grows = 0;    // Times everything was repacked into a taller atlas
+    uint64_t buildMicros = 0;
+};
+
+// Where a glyph sits in the atlas and how it is placed relative to the pen
+// position and baseline at the size it was rendered at
+struct AtlasGlyph {
+    int x = 0;
+    int y = 0;
+    int width = 0;  // 0 for glyphs without pixels, e.g. spaces
+    int height = 0;
+    int xOffset = 0;
+    int yOffset = 0;
+};
+
+// Single channel glyph images packed with stb_rect_pack into one texture of
+// fixed width. It starts small and doubles its height when a glyph does not
+// fit, repacking what it has, so it only ever holds glyphs that were asked for.
+// A glyph that does not fit the tallest atlas is kept without pixels.
+class GlyphAtlas
+{
+public:
+    explicit GlyphAtlas(int width = 512, int initialHeight = 128);
+    ~GlyphAtlas();
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    const AtlasGlyph* Find(uint64_t key) const;
+    // Copies the image in, pixels may be null when width or height is 0
+    const AtlasGlyph& Add(uint64_t key, const uint8_t* pixels, int width, int height, int xOffset, int yOffset);
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    const uint8_t* Row(int y) const { return pixels.data() + static_cast<size_t>(y) * width; }
+
+    // Glyph table and pixels, in the byte order of this machine
+    void Write(std::vector<uint8_t>& out) const;
+    // Replaces the contents with what Write produced. False, and unchanged, if
+    // the data is cut short or does not fit together.
+    bool Read(const uint8_t* data, size_t size);
+
+    // Time spent adding glyphs is counted by the caller, the atlas cannot see rasterization
+    void AddBuildTime(uint64_t micros) { buildMicros += micros; }
+    GlyphAtlasStats GetStats() const;
+
+private:
+    struct Packer;
+
+    static bool Pack(Packer& into, int glyphWidth, int glyphHeight, int& x, int& y);
+    bool Grow();
+    bool Repack(int newHeight);
+
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+    std::unordered_map<uint64_t, AtlasGlyph> glyphs;
+
+    // The skyline packer's state, kept between adds
+    std::unique_ptr<Packer> packer;
+    uint64_t grows = 0;
+    uint64_t buildMicros = 0;
+};
@@ -0,0 +1,398 @@
+#include "pch.h"
+#include "GlyphFont.h"
+#include "TextFitter.h"
+#include "../IMGUI/imstb_truetype.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+struct GlyphFont::Face {
+    std::vector<uint8_t> data;
+    int id = 0; // Order of adding, part of the atlas key
+    uint64_t contentHash = 0;
+    stbtt_fontinfo info{};
+    int ascent = 0;
+    int descent = 0;
+
+    float Scale(float pixelHeight) const { return stbtt_ScaleForPixelHeight(&info, pixelHeight); }
+};
+
+namespace {
+    // Calls visit for every code point, bytes that are not valid UTF-8 come out as '?'
+    template <typename Visit>
+    void ForEachCodePoint(std::string_view text, Visit&& visit)
+    {
+        size_t offset = 0;
+        while (offset < text.size()) {
+            char32_t codePoint;
+            size_t length = DecodeUtf8(text, offset, codePoint);
+            if (length == 0) {
+                codePoint = '?';
+                length = 1;
+            }
+            visit(codePoint < 0x20 ? U' ' : codePoint);
+            offset += length;
+        }
+    }
+
+    // Printable ASCII, what nearly every title needs, added on first use
+    constexpr std::string_view sdfSeed =
+        " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+
+    constexpr uint32_t sdfFileMagic = 0x4644534d; // "MSDF"
+    constexpr uint32_t sdfFileVersion = 1;
+
+    // FNV-1a
+    uint64_t Hash(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t MicrosSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+uint64_t GlyphFont::Glyph::Key() const
+{
+    return (static_cast<uint64_t>(face->id) << 32) | static_cast<uint32_t>(index);
+}
+
+GlyphFont::GlyphFont() = default;
+GlyphFont::~GlyphFont() = default;
+
+bool GlyphFont::AddFont(std::vector<uint8_t> data)
+{
+    auto face = std::make_unique<Face>();
+    face->data = std::move(data);
+    int offset = stbtt_GetFontOffsetForIndex(face->data.data(), 0);
+    if (face->data.empty() || offset < 0 || !stbtt_InitFont(&face->info, face->data.data(), offset)) {
+        return false;
+    }
+    int lineGap;
+    stbtt_GetFontVMetrics(&face->info, &face->ascent, &face->descent, &lineGap);
+    face->id = static_cast<int>(faces.size());
+    face->contentHash = Hash(14695981039346656037ull, face->data.data(), face->data.size());
+    faces.push_back(std::move(face));
+    return true;
+}
+
+GlyphFont::Glyph GlyphFont::FindGlyph(char32_t codePoint) const
+{
+    for (const auto& face : faces) {
+        int index = stbtt_FindGlyphIndex(&face->info, static_cast<int>(codePoint));
+        if (index != 0) {
+            return Glyph{ face.get(), index };
+        }
+    }
+    // Missing everywhere, the primary font's placeholder box
+    return Glyph{ faces.front().get(), 0 };
+}
+
+float GlyphFont::Measure(std::string_view text, float pixelHeight) const
+{
+    if (faces.empty()) {
+        return 0.0f;
+    }
+
+    float pen = 0.0f;
+    Glyph previous;
+    ForEachCodePoint(text, [&](char32_t codePoint) {
+        Glyph glyph = FindGlyph(codePoint);
+        float scale = glyph.face->Scale(pixelHeight);
+        if (previous.face == glyph.face) {
+            pen += scale * stbtt_GetGlyphKernAdvance(&glyph.face->info, previous.index, glyph.index);
+        }
+        int advance;
+        int leftBearing;
+        stbtt_GetGlyphHMetrics(&glyph.face->info, glyph.index, &advance, &leftBearing);
+        pen += scale * advance;
+        previous = glyph;
+    });
+    return pen;
+}
+
+int GlyphFont::LineHeight(float pixelHeight) const
+{
+    if (faces.empty()) {
+        return 0;
+    }
+    const Face& primary = *faces.front();
+    float scale = primary.Scale(pixelHeight);
+    return static_cast<int>(std::ceil(primary.ascent * scale)) + static_cast<int>(std::ceil(-primary.descent * scale));
+}
+
+void GlyphFont::Rasterize(std::string_view text, float pixelHeight, CoverageMask& mask) const
+{
+    mask = CoverageMask{};
+    if (faces.empty() || text.empty()) {
+        return;
+    }
+    if (rendering == GlyphRendering::Sdf) {
+        RasterizeSdf(text, pixelHeight, mask);
+    }
+    else {
+        RasterizeOutline(text, pixelHeight, mask);
+    }
+}
+
+// One pixel of margin on both sides for glyphs that reach past their advance
+void GlyphFont::BeginMask(std::string_view text, float pixelHeight, CoverageMask& mask) const
+{
+    const Face& primary = *faces.front();
+    mask.baseline = static_cast<int>(std::ceil(primary.ascent * primary.Scale(pixelHeight)));
+    mask.width = static_cast<int>(std::ceil(Measure(text, pixelHeight))) + 2;
+    mask.height = LineHeight(pixelHeight);
+    mask.coverage.assign(static_cast<size_t>(mask.width) * mask.height, 0);
+}
+
+void GlyphFont::RasterizeOutline(std::string_view text, float pixelHeight, CoverageMask& mask) const
+{
+    BeginMask(text, pixelHeight, mask);
+    std::vector<uint8_t> glyphPixels;
+    float pen = 1.0f;
+    Glyph previous;
+    ForEachCodePoint(text, [&](char32_t codePoint) {
+        Glyph glyph = FindGlyph(codePoint);
+        const stbtt_fontinfo* info = &glyph.face->info;
+        float scale = glyph.face->Scale(pixelHeight);
+        if (previous.face == glyph.face) {
+            pen += scale * stbtt_GetGlyphKernAdvance(info, previous.index, glyph.index);
+        }
+        previous = glyph;
+
+        // Subpixel pen positions keep the spacing even at small sizes
+        float left = std::floor(pen);
+        float shift = pen - left;
+        int x0, y0, x1, y1;
+        stbtt_GetGlyphBitmapBoxSubpixel(info, glyph.index, scale, scale, shift, 0.0f, &x0, &y0, &x1, &y1);
+        int width = x1 - x0;
+        int height = y1 - y0;
+        if (width > 0 && height > 0) {
+            glyphPixels.assign(static_cast<size_t>(width) * height, 0);
+            stbtt_MakeGlyphBitmapSubpixel(info, glyphPixels.data(), width, height, width, scale, scale, shift, 0.0f, glyph.index);
+
+            // Glyphs can overlap (kerning, combining marks), the stronger coverage wins
+            int originX = static_cast<int>(left) + x0;
+            int originY = mask.baseline + y0;
+            for (int y = (std::max)(0, -originY); y < height && originY + y < mask.height; ++y) {
+                const uint8_t* src = glyphPixels.data() + static_cast<size_t>(y) * width;
+                uint8_t* dst = mask.coverage.data() + static_cast<size_t>(originY + y) * mask.width;
+                for (int x = (std::max)(0, -originX); x < width && originX + x < mask.width; ++x) {
+                    dst[originX + x] = (std::max)(dst[originX + x], src[x]);
+                }
+            }
+        }
+
+        int advance;
+        int leftBearing;
+        stbtt_GetGlyphHMetrics(info, glyph.index, &advance, &leftBearing);
+        pen += scale * advance;
+    });
+}
+
+const AtlasGlyph& GlyphFont::SdfGlyph(Glyph glyph) const
+{
+    uint64_t key = glyph.Key();
+    if (const AtlasGlyph* found = sdfAtlas.Find(key)) {
+        return *found;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int width = 0;
+    int height = 0;
+    int xOffset = 0;
+    int yOffset = 0;
+    constexpr float distanceScale = static_cast<float>(sdfOnEdge) / sdfPadding;
+    uint8_t* sdf = stbtt_GetGlyphSDF(&glyph.face->info, glyph.face->Scale(sdfPixelHeight), glyph.index,
+        sdfPadding, sdfOnEdge, distanceScale, &width, &height, &xOffset, &yOffset);
+    const AtlasGlyph& added = sdfAtlas.Add(key, sdf, width, height, xOffset, yOffset);
+    if (sdf) {
+        stbtt_FreeSDF(sdf, nullptr);
+    }
+    sdfAtlas.AddBuildTime(MicrosSince(start));
+    return added;
+}
+
+void GlyphFont::PrepareSdfLocked(std::string_view text) const
+{
+    if (!sdfSeeded) {
+        sdfSeeded = true;
+        PrepareSdfLocked(sdfSeed);
+    }
+    ForEachCodePoint(text, [&](char32_t codePoint) {
+        SdfGlyph(FindGlyph(codePoint));
+    });
+}
+
+void GlyphFont::PrepareSdf(std::string_view text) const
+{
+    if (faces.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sdfMutex);
+    PrepareSdfLocked(text);
+}
+
+GlyphAtlasStats GlyphFont::SdfStats() const
+{
+    std::lock_guard<std::mutex> lock(sdfMutex);
+    return sdfAtlas.GetStats();
+}
+
+void GlyphFont::RasterizeSdf(std::string_view text, float pixelHeight, CoverageMask& mask) const
+{
+    BeginMask(text, pixelHeight, mask);
+    std::lock_guard<std::mutex> lock(sdfMutex);
+    PrepareSdfLocked(text);
+
+    // Atlas pixels per output pixel and the distance one atlas value step stands for
+    const float ratio = pixelHeight / sdfPixelHeight;
+    const float coveragePerStep = ratio * sdfPadding / sdfOnEdge;
+
+    float pen = 1.0f;
+    Glyph previous;
+    ForEachCodePoint(text, [&](char32_t codePoint) {
+        Glyph glyph = FindGlyph(codePoint);
+        const stbtt_fontinfo* info = &glyph.face->info;
+        float scale = glyph.face->Scale(pixelHeight);
+        if (previous.face == glyph.face) {
+            pen += scale * stbtt_GetGlyphKernAdvance(info, previous.index, glyph.index);
+        }
+        previous = glyph;
+
+        const AtlasGlyph& atlasGlyph = SdfGlyph(glyph);
+        if (atlasGlyph.width > 0) {
+            // The glyph's box at this size, sampled at output pixel centers with a bilinear lookup
+            float left = pen + atlasGlyph.xOffset * ratio;
+            float top = mask.baseline + atlasGlyph.yOffset * ratio;
+            int x0 = (std::max)(0, static_cast<int>(std::floor(left)));
+            int x1 = (std::min)(mask.width, static_cast<int>(std::ceil(left + atlasGlyph.width * ratio)));
+            int y0 = (std::max)(0, static_cast<int>(std::floor(top)));
+            int y1 = (std::min)(mask.height, static_cast<int>(std::ceil(top + atlasGlyph.height * ratio)));
+            float maxU = static_cast<float>(atlasGlyph.width - 1);
+            float maxV = static_cast<float>(atlasGlyph.height - 1);
+
+            for (int y = y0; y < y1; ++y) {
+                float v = std::clamp((y + 0.5f - top) / ratio - 0.5f, 0.0f, maxV);
+                int row = static_cast<int>(v);
+                int nextRow = (std::min)(row + 1, atlasGlyph.height - 1);
+                float fy = v - row;
+                const uint8_t* upper = sdfAtlas.Row(atlasGlyph.y + row) + atlasGlyph.x;
+                const uint8_t* lower = sdfAtlas.Row(atlasGlyph.y + nextRow) + atlasGlyph.x;
+                uint8_t* dst = mask.coverage.data() + static_cast<size_t>(y) * mask.width;
+
+                for (int x = x0; x < x1; ++x) {
+                    float u = std::clamp((x + 0.5f - left) / ratio - 0.5f, 0.0f, maxU);
+                    int column = static_cast<int>(u);
+                    int nextColumn = (std::min)(column + 1, atlasGlyph.width - 1);
+                    float fx = u - column;
+                    float above = upper[column] + (upper[nextColumn] - upper[column]) * fx;
+                    float below = lower[column] + (lower[nextColumn] - lower[column]) * fx;
+                    float distance = above + (below - above) * fy - sdfOnEdge;
+
+                    // Half a pixel of smoothing either side of the edge, at any size
+                    float coverage = std::clamp(distance * coveragePerStep + 0.5f, 0.0f, 1.0f);
+                    dst[x] = (std::max)(dst[x], static_cast<uint8_t>(coverage * 255.0f + 0.5f));
+                }
+            }
+        }
+
+        int advance;
+        int leftBearing;
+        stbtt_GetGlyphHMetrics(info, glyph.index, &advance, &leftBearing);
+        pen += scale * advance;
+    });
+}
+
+uint64_t GlyphFont::SdfCacheKey() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto& face : faces) {
+        hash = Hash(hash, &face->contentHash, sizeof(face->contentHash));
+    }
+    float pixelHeight = sdfPixelHeight;
+    int padding = sdfPadding;
+    uint8_t onEdge = sdfOnEdge;
+    hash = Hash(hash, &pixelHeight, sizeof(pixelHeight));
+    hash = Hash(hash, &padding, sizeof(padding));
+    hash = Hash(hash, &onEdge, sizeof(onEdge));
+    hash = Hash(hash, &sdfFileVersion, sizeof(sdfFileVersion));
+    return Hash(hash, sdfSeed.data(), sdfSeed.size());
+}
+
+std::vector<uint8_t> GlyphFont::SaveSdf() const
+{
+    uint64_t key = SdfCacheKey();
+    std::vector<uint8_t> out(sizeof(sdfFileMagic) + sizeof(key));
+    std::memcpy(out.data(), &sdfFileMagic, sizeof(sdfFileMagic));
+    std::memcpy(out.data() + sizeof(sdfFileMagic), &key, sizeof(key));
+
+    std::lock_guard<std::mutex> lock(sdfMutex);
+    if (!faces.empty()) {
+        PrepareSdfLocked({});
+    }
+    sdfAtlas.Write(out);
+    return out;
+}
+
+bool GlyphFont::LoadSdf(const uint8_t* data, size_t size)
+{
+    uint32_t magic;
+    uint64_t key;
+    if (faces.empty() || size < sizeof(magic) + sizeof(key)) {
+        return false;
+    }
+    std::memcpy(&magic, data, sizeof(magic));
+    std::memcpy(&key, data + sizeof(magic), sizeof(key));
+    if (magic != sdfFileMagic || key != SdfCacheKey()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(sdfMutex);
+    size_t header = sizeof(magic) + sizeof(key);
+    if (!sdfAtlas.Read(data + header, size - header)) {
+        return false;
+    }
+    // The seed glyphs were added before it was saved
+    sdfSeeded = true;
+    return true;
+}
+
+GlyphAtlasStats GlyphFont::BuildBitmapAtlas(std::string_view text, float pixelHeight) const
+{
+    GlyphAtlas atlas;
+    if (faces.empty()) {
+        return atlas.GetStats();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto add = [&](char32_t codePoint) {
+        Glyph glyph = FindGlyph(codePoint);
+        if (atlas.Find(glyph.Key())) {
+            return;
+        }
+        float scale = glyph.face->Scale(pixelHeight);
+        int width = 0;
+        int height = 0;
+        int xOffset = 0;
+        int yOffset = 0;
+        uint8_t* bitmap = stbtt_GetGlyphBitmap(&glyph.face->info, scale, scale, glyph.index, &width, &height, &xOffset, &yOffset);
+        atlas.Add(glyph.Key(), bitmap, width, height, xOffset, yOffset);
+        if (bitmap) {
+            stbtt_FreeBitmap(bitmap, nullptr);
+        }
+    };
+    ForEachCodePoint(sdfSeed, add);
+    ForEachCodePoint(text, add);
+    atlas.AddBuildTime(MicrosSince(start));
+    return atlas.GetStats();
+}
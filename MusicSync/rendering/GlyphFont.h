@@ -0,0 +1,96 @@
+#pragma once
+#include "GlyphAtlas.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Anti-aliased coverage of one line of text, 0 to 255 per pixel
+struct CoverageMask {
+    int width = 0;
+    int height = 0;
+    int baseline = 0; // Rows from the top of the mask to the baseline
+    std::vector<uint8_t> coverage;
+};
+
+enum class GlyphRendering {
+    Sdf,     // Every size sampled from one signed distance field atlas
+    Outline  // Outlines rasterized at the requested size
+};
+
+// TrueType fonts rendered with stb_truetype. Several fonts can be added, a
+// code point missing from one is taken from the next, so CJK titles still
+// render with a Latin primary font. Once the fonts are added one instance can
+// measure and rasterize from any thread, the SDF atlas has its own lock.
+//
+// The SDF atlas holds each glyph once, rendered at sdfPixelHeight with a few
+// pixels of distance around it. Any size is a filtered lookup, so the overlay
+// scale never needs another atlas. Glyphs are added as titles use them.
+class GlyphFont
+{
+public:
+    GlyphFont();
+    ~GlyphFont();
+    GlyphFont(const GlyphFont&) = delete;
+    GlyphFont& operator=(const GlyphFont&) = delete;
+
+    // TrueType or the first face of a TrueType collection. False if the data is not a font.
+    bool AddFont(std::vector<uint8_t> data);
+    size_t FontCount() const { return faces.size(); }
+
+    // Advance width of the text in pixels, kerning included
+    float Measure(std::string_view text, float pixelHeight) const;
+    // Ascent plus descent of the primary font
+    int LineHeight(float pixelHeight) const;
+
+    static constexpr float sdfPixelHeight = 40.0f;
+    static constexpr int sdfPadding = 5;      // Pixels of distance around each glyph
+    static constexpr uint8_t sdfOnEdge = 128; // Values above are inside
+
+    // Set before the font is shared between threads
+    void SetRendering(GlyphRendering mode) { rendering = mode; }
+    GlyphRendering Rendering() const { return rendering; }
+
+    void Rasterize(std::string_view text, float pixelHeight, CoverageMask& mask) const;
+
+    // Adds the glyphs of text to the SDF atlas ahead of use
+    void PrepareSdf(std::string_view text) const;
+    GlyphAtlasStats SdfStats() const;
+
+    // Identifies the SDF atlas these fonts and settings start from, for
+    // caching it on disk: the font data, the SDF settings and the seed glyphs
+    uint64_t SdfCacheKey() const;
+    // The atlas with its glyph table, for LoadSdf on a later run
+    std::vector<uint8_t> SaveSdf() const;
+    // False, and nothing loaded, if the data is not from SaveSdf with the same key
+    bool LoadSdf(const uint8_t* data, size_t size);
+
+    // The coverage atlas of text's glyphs at one size, what a per-size bitmap
+    // atlas would have to hold. For comparing against the SDF atlas.
+    GlyphAtlasStats BuildBitmapAtlas(std::string_view text, float pixelHeight) const;
+
+private:
+    struct Face;
+    struct Glyph {
+        const Face* face = nullptr;
+        int index = 0;
+
+        uint64_t Key() const;
+    };
+
+    Glyph FindGlyph(char32_t codePoint) const;
+    void RasterizeOutline(std::string_view text, float pixelHeight, CoverageMask& mask) const;
+    void RasterizeSdf(std::string_view text, float pixelHeight, CoverageMask& mask) const;
+    const AtlasGlyph& SdfGlyph(Glyph glyph) const; // Under sdfMutex
+    void PrepareSdfLocked(std::string_view text) const;
+    void BeginMask(std::string_view text, float pixelHeight, CoverageMask& mask) const;
+
+    std::vector<std::unique_ptr<Face>> faces;
+    GlyphRendering rendering = GlyphRendering::Sdf;
+
+    mutable std::mutex sdfMutex;
+    mutable GlyphAtlas sdfAtlas;
+    mutable bool sdfSeeded = false;
+};
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "ImGuiDrawTarget.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace {
+    int ToChannel(float value)
+    {
+        return static_cast<int>(std::clamp(value, 0.0f, 255.0f) + 0.5f);
+    }
+}
+
+ImGuiDrawTarget::ImGuiDrawTarget(ImDrawList* list, ImFont* font, ImVec2 displaySize)
+    : list(list), font(font), size{ static_cast<int>(displaySize.x), static_cast<int>(displaySize.y) },
+    firstCommand(list->CmdBuffer.Size)
+{
+}
+
+void ImGuiDrawTarget::SetColor(const LinearColor& color)
+{
+    this->color = IM_COL32(ToChannel(color.R), ToChannel(color.G), ToChannel(color.B), ToChannel(color.A));
+}
+
+void ImGuiDrawTarget::SetPosition(Vector2 position)
+{
+    this->position = ImVec2(static_cast<float>(position.X), static_cast<float>(position.Y));
+}
+
+void ImGuiDrawTarget::DrawRect(Vector2 min, Vector2 max, float rounding)
+{
+    list->AddRectFilled(ImVec2(static_cast<float>(min.X), static_cast<float>(min.Y)),
+        ImVec2(static_cast<float>(max.X), static_cast<float>(max.Y)), color, rounding);
+    drawCalls++;
+}
+
+void ImGuiDrawTarget::DrawTexture(ImageWrapper* texture, float scale, float rounding)
+{
+    ImTextureID id = texture ? texture->GetImGuiTex() : nullptr;
+    if (!id) {
+        return;
+    }
+    Vector2 textureSize = texture->GetSize();
+    ImVec2 max(position.x + textureSize.X * scale, position.y + textureSize.Y * scale);
+    list->AddImageRounded(id, position, max, ImVec2(0.0f, 0.0f), ImVec2(1.0f, 1.0f), color, rounding);
+    drawCalls++;
+}
+
+void ImGuiDrawTarget::DrawTile(ImageWrapper* texture, Vector2 min, Vector2 max, Vector2F uv0, Vector2F uv1, float rounding)
+{
+    ImTextureID id = texture ? texture->GetImGuiTex() : nullptr;
+    if (!id) {
+        return;
+    }
+    list->AddImageRounded(id, ImVec2(static_cast<float>(min.X), static_cast<float>(min.Y)),
+        ImVec2(static_cast<float>(max.X), static_cast<float>(max.Y)), ImVec2(uv0.X, uv0.Y), ImVec2(uv1.X, uv1.Y), color, rounding);
+    drawCalls++;
+}
+
+void ImGuiDrawTarget::DrawString(std::string_view text, float xScale, float yScale)
+{
+    list->AddText(font, canvasFontPixels * yScale, position, color, text.data(), text.data() + text.size());
+    drawCalls++;
+}
+
+float ImGuiDrawTarget::MeasureString(const std::string& text, float scale)
+{
+    return font->CalcTextSizeA(canvasFontPixels * scale, FLT_MAX, 0.0f, text.data(), text.data() + text.size()).x;
+}
+
+uint64_t ImGuiDrawTarget::Batches() const
+{
+    return static_cast<uint64_t>((std::max)(0, list->CmdBuffer.Size - firstCommand));
+}
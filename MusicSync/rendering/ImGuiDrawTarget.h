@@ -0,0 +1,34 @@
+#pragma once
+#include "DrawTarget.h"
+
+// Replays into an ImDrawList, e.g. the background list of the plugin's ImGui
+// context. Text uses the given font, rects and textures can be rounded.
+class ImGuiDrawTarget : public DrawTarget
+{
+public:
+    ImGuiDrawTarget(ImDrawList* list, ImFont* font, ImVec2 displaySize);
+
+    OverlayBackend Backend() const override { return OverlayBackend::ImGui; }
+    Vector2 GetSize() override { return size; }
+    uintptr_t MetricsId() const override { return reinterpret_cast<uintptr_t>(font); }
+
+    void SetColor(const LinearColor& color) override;
+    void SetPosition(Vector2 position) override;
+    void DrawRect(Vector2 min, Vector2 max, float rounding) override;
+    void DrawTexture(ImageWrapper* texture, float scale, float rounding) override;
+    void DrawTile(ImageWrapper* texture, Vector2 min, Vector2 max, Vector2F uv0, Vector2F uv1, float rounding) override;
+    void DrawString(std::string_view text, float xScale, float yScale) override;
+    float MeasureString(const std::string& text, float scale) override;
+
+    // Draw commands this target added to the list. ImGui merges primitives
+    // that share a texture, so this is usually lower than the call count.
+    uint64_t Batches() const override;
+
+private:
+    ImDrawList* list;
+    ImFont* font;
+    Vector2 size;
+    int firstCommand;
+    ImU32 color = IM_COL32_WHITE;
+    ImVec2 position{ 0.0f, 0.0f };
+};
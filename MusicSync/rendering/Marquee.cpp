@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "Marquee.h"
+
+#include <algorithm>
+
+namespace {
+    // Space between the end of the text and the start of its next copy
+    constexpr std::string_view loopGap = "     ";
+}
+
+void Marquee::Prepare(std::string_view newText, float newScale, float newClipWidth, const TextWidthOracle& oracle, uint64_t newStartNanos)
+{
+    if (newText == text && newScale == scale && newClipWidth == clipWidth) {
+        return;
+    }
+    Reset();
+    text.assign(newText);
+    scale = newScale;
+    clipWidth = newClipWidth;
+    startNanos = newStartNanos;
+
+    std::string clean = SanitizeUtf8(text);
+    if (clean.empty() || !oracle || oracle(clean, scale) <= clipWidth) {
+        return;
+    }
+
+    // Prefix widths instead of summed glyph widths, so kerning and the font's
+    // own spacing are exactly what the canvas draws
+    looped = clean;
+    looped.append(loopGap);
+    size_t firstLength = looped.size();
+    looped.append(clean);
+
+    std::string_view firstCopy(looped.data(), firstLength);
+    float left = 0.0f;
+    for (size_t offset = 0; offset < firstLength;) {
+        size_t end = NextGrapheme(firstCopy, offset);
+        float right = oracle(looped.substr(0, end), scale);
+        graphemes.push_back(Grapheme{ static_cast<uint32_t>(offset), static_cast<uint32_t>(end), left, (std::max)(left, right) });
+        left = graphemes.back().right;
+        offset = end;
+    }
+    loopWidth = left;
+    if (loopWidth <= 0.0f) {
+        Reset();
+        return;
+    }
+
+    // The second copy is only ever partly visible, its positions are the first copy's moved by a loop
+    size_t firstCount = graphemes.size();
+    for (size_t i = 0; i < firstCount && graphemes[i].begin < clean.size(); ++i) {
+        Grapheme shifted = graphemes[i];
+        shifted.begin += static_cast<uint32_t>(firstLength);
+        shifted.end += static_cast<uint32_t>(firstLength);
+        shifted.left += loopWidth;
+        shifted.right += loopWidth;
+        graphemes.push_back(shifted);
+    }
+
+    speed = baseSpeed * scale;
+    periodNanos = pauseNanos + static_cast<uint64_t>(static_cast<double>(loopWidth) / speed * 1e9);
+    scrolls = true;
+}
+
+void Marquee::Reset()
+{
+    text.clear();
+    scale = 0.0f;
+    clipWidth = 0.0f;
+    scrolls = false;
+    looped.clear();
+    graphemes.clear();
+    loopWidth = 0.0f;
+    periodNanos = 0;
+}
+
+float Marquee::OffsetAt(uint64_t nowNanos) const
+{
+    if (!scrolls) {
+        return 0.0f;
+    }
+    uint64_t elapsed = nowNanos > startNanos ? nowNanos - startNanos : 0;
+    uint64_t cycle = elapsed % periodNanos;
+    if (cycle < pauseNanos) {
+        return 0.0f;
+    }
+    return static_cast<float>(static_cast<double>(cycle - pauseNanos) * speed / 1e9);
+}
+
+Marquee::Window Marquee::At(uint64_t nowNanos) const
+{
+    Window window;
+    if (!scrolls) {
+        return window;
+    }
+
+    float offset = OffsetAt(nowNanos);
+    float clipRight = offset + clipWidth;
+    auto first = std::lower_bound(graphemes.begin(), graphemes.end(), offset,
+        [](const Grapheme& grapheme, float x) { return grapheme.left < x; });
+    auto last = std::upper_bound(first, graphemes.end(), clipRight,
+        [](float x, const Grapheme& grapheme) { return x < grapheme.right; });
+    if (first >= last) {
+        return window;
+    }
+
+    window.text = std::string_view(looped).substr(first->begin, (last - 1)->end - first->begin);
+    window.x = first->left - offset;
+    return window;
+}
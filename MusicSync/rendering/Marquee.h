@@ -0,0 +1,61 @@
+#pragma once
+#include "TextFitter.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Scrolls a line that is wider than its clip region. Everything that needs a
+// measurement is done once in Prepare, a frame only turns a clock reading into
+// an offset and looks up which graphemes are inside the clip region. The
+// offset is a function of the elapsed time alone, so the speed does not depend
+// on the frame rate and the same clock reading always gives the same window.
+//
+// The canvas has no clip rectangle, so clipping is done at grapheme
+// granularity: graphemes that cross an edge of the region are left out.
+class Marquee
+{
+public:
+    struct Window {
+        std::string_view text; // Graphemes fully inside the clip region
+        float x = 0.0f;        // Where text starts, relative to the left edge of the region
+    };
+
+    // Pixels per second at scale 1, and the pause at the start of every loop
+    static constexpr float baseSpeed = 40.0f;
+    static constexpr uint64_t pauseNanos = 2'000'000'000;
+
+    // Measures text followed by a gap and a second copy for a seamless loop.
+    // Does nothing if text, scale and width are the same as last time, so the
+    // scroll position survives unrelated layout changes. startNanos is the
+    // clock reading the loop starts from.
+    void Prepare(std::string_view text, float scale, float clipWidth, const TextWidthOracle& oracle, uint64_t startNanos);
+    void Reset();
+
+    // False when the text fits, it is then drawn as is
+    bool Scrolls() const { return scrolls; }
+
+    float OffsetAt(uint64_t nowNanos) const;
+    Window At(uint64_t nowNanos) const;
+
+private:
+    struct Grapheme {
+        uint32_t begin = 0; // Bytes in looped
+        uint32_t end = 0;
+        float left = 0.0f;  // Pixels from the start of looped
+        float right = 0.0f;
+    };
+
+    std::string text;
+    float scale = 0.0f;
+    float clipWidth = 0.0f;
+
+    bool scrolls = false;
+    std::string looped;
+    std::vector<Grapheme> graphemes;
+    float loopWidth = 0.0f; // Text and gap, the second copy starts here
+    float speed = 0.0f;     // Pixels per second
+    uint64_t startNanos = 0;
+    uint64_t periodNanos = 0;
+};
@@ -5,9 +5,55 @@
 #include <filesystem>
 #include "../MusicSync.h"
 #include <algorithm>
+#include <chrono>
+
+namespace {
+    // Frames per window of the backend stats shown in the settings
+    constexpr uint64_t backendStatsFrames = 120;
+
+    uint8_t ToByte(float value)
+    {
+        return static_cast<uint8_t>(std::clamp(value, 0.0f, 255.0f) + 0.5f);
+    }
+
+    // Texture coordinates of the centered part of a texture that covers the
+    // area at its own aspect ratio, the rest is cut off
+    void CropToFill(Vector2 textureSize, Vector2 area, Vector2F& uv0, Vector2F& uv1)
+    {
+        uv0 = Vector2F{ 0.0f, 0.0f };
+        uv1 = Vector2F{ 1.0f, 1.0f };
+        if (textureSize.X <= 0 || textureSize.Y <= 0 || area.X <= 0 || area.Y <= 0) {
+            return;
+        }
+        float textureAspect = static_cast<float>(textureSize.X) / textureSize.Y;
+        float areaAspect = static_cast<float>(area.X) / area.Y;
+        if (areaAspect > textureAspect) {
+            float visible = textureAspect / areaAspect;
+            uv0.Y = (1.0f - visible) / 2.0f;
+            uv1.Y = uv0.Y + visible;
+        }
+        else {
+            float visible = areaAspect / textureAspect;
+            uv0.X = (1.0f - visible) / 2.0f;
+            uv1.X = uv0.X + visible;
+        }
+    }
+}
+
+std::vector<std::filesystem::path> MusicOverlay::SystemFontPaths()
+{
+    wchar_t windowsDirectory[MAX_PATH];
+    UINT length = GetWindowsDirectoryW(windowsDirectory, MAX_PATH);
+    std::filesystem::path fonts = (length > 0 && length < MAX_PATH ? std::filesystem::path(windowsDirectory) : std::filesystem::path(L"C:\\Windows")) / L"Fonts";
+    return { fonts / L"segoeui.ttf", fonts / L"arial.ttf", fonts / L"malgun.ttf", fonts / L"YuGothM.ttc", fonts / L"msyh.ttc" };
+}
 
 MusicOverlay::MusicOverlay(std::shared_ptr<GameWrapper> gw, std::shared_ptr<CVarManagerWrapper> cv, MusicSync* ms)
-    : gameWrapper(gw), cvarManager(cv), musicSync(ms)
+    : gameWrapper(gw), cvarManager(cv), musicSync(ms),
+    targetOracle([this](const std::string& text, float scale) {
+        return measureTarget ? measureTarget->MeasureString(text, scale) : 0.0f;
+    }),
+    textFitter(targetOracle)
 {
     InitializeSettings();
 }
@@ -25,6 +71,22 @@ void MusicOverlay::InitializeSettings()
     CVarWrapper xCvar = cvarManager->getCvar("music_overlay_x");
     CVarWrapper yCvar = cvarManager->getCvar("music_overlay_y");
     CVarWrapper showCoverCvar = cvarManager->getCvar("music_overlay_show_cover");
+    CVarWrapper backdropCvar = cvarManager->getCvar("music_overlay_cover_backdrop");
+    CVarWrapper showProgressCvar = cvarManager->getCvar("music_overlay_show_progress");
+    CVarWrapper autoWidthCvar = cvarManager->getCvar("music_overlay_auto_width");
+    CVarWrapper marqueeCvar = cvarManager->getCvar("music_overlay_marquee");
+    CVarWrapper transitionCvar = cvarManager->getCvar("music_overlay_transition");
+    CVarWrapper compositedCvar = cvarManager->getCvar("music_overlay_composited");
+    CVarWrapper panelRadiusCvar = cvarManager->getCvar("music_overlay_corner_radius");
+    CVarWrapper panelShadowCvar = cvarManager->getCvar("music_overlay_shadow");
+    CVarWrapper panelOutlineCvar = cvarManager->getCvar("music_overlay_outline");
+    CVarWrapper recentCountCvar = cvarManager->getCvar("music_overlay_recent_covers");
+    CVarWrapper backendCvar = cvarManager->getCvar("music_overlay_backend");
+    CVarWrapper textColorCvar = cvarManager->getCvar("music_overlay_text_color");
+    CVarWrapper bkgColorCvar = cvarManager->getCvar("music_overlay_background_color");
+    CVarWrapper bkgOpacityCvar = cvarManager->getCvar("music_overlay_background_opacity");
+    CVarWrapper outlineColorCvar = cvarManager->getCvar("music_overlay_outline_color");
+    CVarWrapper autoThemeCvar = cvarManager->getCvar("music_overlay_auto_theme");
 
     // Bind to shared_ptr variables - X/Y are now float for percentages
     enabled = std::make_shared<bool>(enabledCvar ? enabledCvar.getBoolValue() : true);
@@ -32,6 +94,17 @@ void MusicOverlay::InitializeSettings()
     overlayX = std::make_shared<float>(xCvar ? xCvar.getFloatValue() : 60.0f);
     overlayY = std::make_shared<float>(yCvar ? yCvar.getFloatValue() : 83.0f);
     showAlbumCover = std::make_shared<bool>(showCoverCvar ? showCoverCvar.getBoolValue() : true);
+    coverBackdrop = std::make_shared<bool>(backdropCvar ? backdropCvar.getBoolValue() : false);
+    showProgress = std::make_shared<bool>(showProgressCvar ? showProgressCvar.getBoolValue() : true);
+    autoWidth = std::make_shared<bool>(autoWidthCvar ? autoWidthCvar.getBoolValue() : false);
+    marqueeEnabled = std::make_shared<bool>(marqueeCvar ? marqueeCvar.getBoolValue() : false);
+    transitionStyle = std::make_shared<int>(transitionCvar ? transitionCvar.getIntValue() : 1);
+    composited = std::make_shared<bool>(compositedCvar ? compositedCvar.getBoolValue() : false);
+    panelRadius = std::make_shared<int>(panelRadiusCvar ? panelRadiusCvar.getIntValue() : 0);
+    panelShadow = std::make_shared<int>(panelShadowCvar ? panelShadowCvar.getIntValue() : 0);
+    panelOutline = std::make_shared<int>(panelOutlineCvar ? panelOutlineCvar.getIntValue() : 0);
+    recentCount = std::make_shared<int>(recentCountCvar ? recentCountCvar.getIntValue() : 0);
+    backend = std::make_shared<int>(backendCvar ? backendCvar.getIntValue() : 0);
 
     // Bind them to the CVars for automatic updates
     if (enabledCvar) enabledCvar.bindTo(enabled);
@@ -39,211 +112,727 @@ void MusicOverlay::InitializeSettings()
     if (xCvar) xCvar.bindTo(overlayX);
     if (yCvar) yCvar.bindTo(overlayY);
     if (showCoverCvar) showCoverCvar.bindTo(showAlbumCover);
+    if (backdropCvar) backdropCvar.bindTo(coverBackdrop);
+    if (showProgressCvar) showProgressCvar.bindTo(showProgress);
+    if (autoWidthCvar) autoWidthCvar.bindTo(autoWidth);
+    if (marqueeCvar) marqueeCvar.bindTo(marqueeEnabled);
+    if (transitionCvar) transitionCvar.bindTo(transitionStyle);
+    if (compositedCvar) compositedCvar.bindTo(composited);
+    if (panelRadiusCvar) panelRadiusCvar.bindTo(panelRadius);
+    if (panelShadowCvar) panelShadowCvar.bindTo(panelShadow);
+    if (panelOutlineCvar) panelOutlineCvar.bindTo(panelOutline);
+    if (recentCountCvar) recentCountCvar.bindTo(recentCount);
+    if (backendCvar) backendCvar.bindTo(backend);
+
+    // Everything else the layout needs is compared per frame, only colors need a parse
+    auto onColorChanged = [this](std::string oldValue, CVarWrapper cvar) { ReadColors(); };
+    if (textColorCvar) textColorCvar.addOnValueChanged(onColorChanged);
+    if (bkgColorCvar) bkgColorCvar.addOnValueChanged(onColorChanged);
+    if (bkgOpacityCvar) bkgOpacityCvar.addOnValueChanged(onColorChanged);
+    if (outlineColorCvar) outlineColorCvar.addOnValueChanged(onColorChanged);
+    if (autoThemeCvar) autoThemeCvar.addOnValueChanged(onColorChanged);
+    ReadColors();
 }
 
-void MusicOverlay::UpdateRenderData()
+void MusicOverlay::ReadColors()
 {
-    toRender.clear();
-    
-    MediaInfo info = musicSync->GetCurrentMedia();
-    if (!info.isValid) {
-        needsUpdate = false;
+    CVarWrapper textColorCvar = cvarManager->getCvar("music_overlay_text_color");
+    CVarWrapper bkgColorCvar = cvarManager->getCvar("music_overlay_background_color");
+    CVarWrapper bkgOpacityCvar = cvarManager->getCvar("music_overlay_background_opacity");
+    if (textColorCvar) setTextColor = textColorCvar.getColorValue();
+    if (bkgColorCvar) setBackgroundColor = bkgColorCvar.getColorValue();
+    if (bkgOpacityCvar) backgroundOpacity = bkgOpacityCvar.getIntValue();
+    CVarWrapper outlineColorCvar = cvarManager->getCvar("music_overlay_outline_color");
+    if (outlineColorCvar) outlineColor = outlineColorCvar.getColorValue();
+    CVarWrapper autoThemeCvar = cvarManager->getCvar("music_overlay_auto_theme");
+    if (autoThemeCvar) autoTheme = autoThemeCvar.getBoolValue();
+    ApplyTheme();
+}
+
+// The cover's theme replaces the set colors but keeps their alpha. Covers
+// without one, and no cover at all, use the set colors.
+void MusicOverlay::ApplyTheme()
+{
+    textColor = setTextColor;
+    backgroundColor = setBackgroundColor;
+    if (!autoTheme || !loadedCover || !loadedCover->theme.valid) {
         return;
     }
-    
-    // Get current screen resolution
-    SettingsWrapper settingsWrapper = gameWrapper->GetSettings();
-    std::string resolution = settingsWrapper.GetVideoSettings().Resolution;
-    auto [screenWidth, screenHeight] = musicSync->ParseResolution(resolution);
-    
-    // Convert percentages to actual pixel positions
-    float scale = *overlayScale;
-    int baseX = static_cast<int>(((*overlayX) / 100.0f) * screenWidth);
-    int baseY = static_cast<int>(((*overlayY) / 100.0f) * screenHeight);
-    
-    // Load album cover if needed
+    const CoverTheme& theme = loadedCover->theme;
+    textColor = LinearColor{ static_cast<float>(theme.text[0]), static_cast<float>(theme.text[1]),
+        static_cast<float>(theme.text[2]), setTextColor.A };
+    backgroundColor = LinearColor{ static_cast<float>(theme.background[0]), static_cast<float>(theme.background[1]),
+        static_cast<float>(theme.background[2]), setBackgroundColor.A };
+}
+
+OverlayLayoutInput MusicOverlay::CurrentLayoutInput(int screenWidth, int screenHeight) const
+{
+    OverlayLayoutInput input;
+    input.screenWidth = screenWidth;
+    input.screenHeight = screenHeight;
+    input.scale = *overlayScale;
+    input.xPercent = *overlayX;
+    input.yPercent = *overlayY;
+    input.showCover = *showAlbumCover;
+    input.showProgress = *showProgress;
+    input.coverBackdrop = *coverBackdrop;
+    if (albumCoverImage && albumCoverImage->IsLoadedForCanvas()) {
+        Vector2 imgSize = albumCoverImage->GetSize();
+        input.coverWidth = imgSize.X;
+        input.coverHeight = imgSize.Y;
+    }
+    input.lineCount = (titleLine.empty() ? 0 : 1) + (artistLine.empty() ? 0 : 1) + (albumLine.empty() ? 0 : 1);
+    input.autoWidth = *autoWidth;
+    input.marquee = *marqueeEnabled;
+    input.composited = *composited;
+    input.panelRadius = *panelRadius;
+    input.panelShadow = *panelShadow;
+    input.panelOutline = *panelOutline;
+    input.recentCount = std::clamp(*recentCount, 0, maxRecentCovers);
+    input.backend = activeBackend;
+    input.textColor = textColor;
+    input.backgroundColor = backgroundColor;
+    input.backgroundOpacity = backgroundOpacity;
+    input.outlineColor = outlineColor;
+    return input;
+}
+
+// Returns true if what the overlay shows changed, as opposed to e.g. only the playback state
+bool MusicOverlay::UpdateRenderData(const MediaSnapshot& snapshot)
+{
+    const MediaInfo& info = snapshot.info;
+    drawListDirty = true;
+
+    // Display strings only change with the media, not per frame. They are cut
+    // to the available width in FitLines once the layout is known.
+    std::string title = info.isValid && !info.title.empty() ? "Title: " + info.title : std::string();
+    std::string artist = info.isValid && !info.artist.empty() ? "By: " + info.artist : std::string();
+    std::string album = info.isValid && !info.album.empty() ? "From " + info.album : std::string();
+    bool changed = title != titleLine || artist != artistLine || album != albumLine;
+    titleLine = std::move(title);
+    artistLine = std::move(artist);
+    albumLine = std::move(album);
+
+    if (!info.isValid) {
+        return changed;
+    }
+
+    // Load album cover if needed. The texture was decoded and scaled by the media
+    // thread, so this is a plain upload. The previous cover is only replaced once
+    // the new one exists.
     if (*showAlbumCover) {
-        dataDir = gameWrapper->GetDataFolder() / "MusicSync";
-        coverPath = dataDir / coverFile;
-        std::string staticAlbumCoverPath = coverPath.string();
-        
-        if (lastAlbumCoverPath != staticAlbumCoverPath || !albumCoverImage) {
-            try {
-                albumCoverImage = std::make_shared<ImageWrapper>(staticAlbumCoverPath, true, false);
-                lastAlbumCoverPath = staticAlbumCoverPath;
+        if (snapshot.cover != loadedCover) {
+            if (!snapshot.cover && !info.hasThumbnail && albumCoverImage) {
+                // Apps often send the new title before its thumbnail. The old cover stays
+                // up for a moment instead of blinking out, RenderOverlay drops it if none comes.
+                if (coverGraceUntil == 0) {
+                    coverGraceUntil = PlaybackClock::NowNanos() + coverGraceNanos;
+                }
+                return changed;
             }
-            catch (const std::exception& e) {
-                albumCoverImage.reset();
+
+            std::shared_ptr<ImageWrapper> coverImage;
+            if (snapshot.cover && !snapshot.cover->texturePath.empty()) {
+                auto loadStart = std::chrono::steady_clock::now();
+                coverImage = LoadTexture(snapshot.cover->texturePath);
+                auto loadMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStart).count();
+                if (CoverPipeline* pipeline = musicSync->GetCoverPipeline()) {
+                    pipeline->RecordTextureLoad(static_cast<uint64_t>(loadMicros));
+                }
             }
+            changed = changed || coverImage != albumCoverImage;
+            albumCoverImage = coverImage;
+            RememberCover(loadedCover);
+            loadedCover = snapshot.cover;
+            backdropImage.reset();
+            coverGraceUntil = 0;
+            ApplyTheme();
         }
-        
-        if (albumCoverImage) {
-            float coverScale = scale;
-            Vector2 imgSize = albumCoverImage->GetSize();
+    }
+    return changed;
+}
 
-            image albumImg;
-            albumImg.img = albumCoverImage;
-            albumImg.position = Vector2{baseX, baseY};
-            albumImg.scale = coverScale;
-            albumImg.color = LinearColor{1.0f, 1.0f, 1.0f, 1.0f};
-            toRender.push_back(albumImg);
-        }
+// The canvas texture is always loaded, the layout reads the cover size from it
+std::shared_ptr<ImageWrapper> MusicOverlay::LoadTexture(const std::filesystem::path& path) const
+{
+    try {
+        return std::make_shared<ImageWrapper>(path, true, activeBackend == OverlayBackend::ImGui);
+    }
+    catch (const std::exception& e) {
+        return nullptr;
     }
-    
-    needsUpdate = false;
 }
 
-void MusicOverlay::RenderOverlay(CanvasWrapper canvas)
+// Called before the first frame of another backend. Textures are uploaded
+// again for it, so anything still drawing the old ones is dropped.
+void MusicOverlay::SwitchBackend(OverlayBackend newBackend)
 {
-    CVarWrapper overlayTextColorCvar = cvarManager->getCvar("music_overlay_text_color");
-    if (!overlayTextColorCvar) { return; }
-    CVarWrapper overlayBkgColorCvar = cvarManager->getCvar("music_overlay_background_color");
-    if (!overlayBkgColorCvar) { return; }
-    CVarWrapper overlayBkgOpacityCvar = cvarManager->getCvar("music_overlay_background_opacity");
-    if (!overlayBkgOpacityCvar) { return; }
+    activeBackend = newBackend;
+    outgoingList.Clear();
+    outgoingCover.reset();
+    outgoingComposite.reset();
+    backdropImage.reset();
+    transition.Stop();
+    if (loadedCover && albumCoverImage && !loadedCover->texturePath.empty()) {
+        albumCoverImage = LoadTexture(loadedCover->texturePath);
+    }
+    if (compositedImage && !compositedPath.empty()) {
+        compositedImage = LoadTexture(compositedPath);
+    }
+    if (panelImage) {
+        panelImage = LoadTexture(panelSkin.texturePath);
+    }
+    if (recentImage) {
+        recentImage = LoadTexture(recentTiles.texturePath);
+    }
+    drawListDirty = true;
+}
 
-    LinearColor textColor = overlayTextColorCvar.getColorValue();
-    LinearColor bkgColor = overlayBkgColorCvar.getColorValue();
-    int bkgOpacity = overlayBkgOpacityCvar.getIntValue();
-    
+void MusicOverlay::RecordBackendFrame(const DrawTarget& target, uint64_t nanos)
+{
+    size_t index = static_cast<size_t>(target.Backend());
+    OverlayBackendStats& window = backendWindow[index];
+    window.frames++;
+    window.frameNanos += nanos;
+    window.drawCalls += target.DrawCalls();
+    window.batches += target.Batches();
+    if (window.frames == backendStatsFrames) {
+        backendStats[index] = window;
+        window = OverlayBackendStats{};
+    }
+}
+
+// Moves what is on screen to the outgoing list and animates to the list that
+// is recorded next. A transition that is still running is cut short, its
+// incoming content becomes the new outgoing one.
+void MusicOverlay::StartTransition(std::shared_ptr<ImageWrapper> previousCover, uint64_t nowNanos)
+{
+    TransitionStyle style = static_cast<TransitionStyle>(std::clamp(*transitionStyle, 0, 3));
+    if (style == TransitionStyle::None || drawList.Size() == 0) {
+        transition.Stop();
+        return;
+    }
+    std::swap(outgoingList, drawList);
+    outgoingList.Freeze(nowNanos);
+    outgoingCover = std::move(previousCover);
+    outgoingComposite = compositedImage;
+    transition.Start(style, nowNanos, 60.0f * layout.input.scale);
+}
+
+void MusicOverlay::RenderOverlay(DrawTarget& target)
+{
     if (!*enabled) return;
-    
-    MediaInfo info = musicSync->GetCurrentMedia();
-    if (!info.isValid) return;
-    
-    // Update render data if needed
-    if (needsUpdate) {
-        UpdateRenderData();
-    }
-    
-    // Get current screeen resolution for percentage calculation
-    SettingsWrapper settingsWrapper = gameWrapper->GetSettings();
-    std::string resolution = settingsWrapper.GetVideoSettings().Resolution;
-    auto [screenWidth, screenHeight] = musicSync->ParseResolution(resolution);
-    
-    // Convert percentages to actual pixel positions
-    float scale = *overlayScale;
-    int baseX = static_cast<int>(((*overlayX) / 100.0f) * screenWidth);
-    int baseY = static_cast<int>(((*overlayY) / 100.0f) * screenHeight);
-    
-    int lineHeight = static_cast<int>(50 * scale);
-    int padding = static_cast<int>(20 * scale);
-    
-    // Calculate background dimensions using the scale
-    int albumCoverWidth = 0;
-    int albumCoverHeight = 0;
-    float actualAlbumCoverScale = 0.2f * scale;
-    
-    if (!toRender.empty()) {
-        auto& img = toRender[0];
-        if (img.img && img.img->IsLoadedForCanvas()) {
-            Vector2 imgSize = img.img->GetSize();
-            float xScale = 1.0;
-            float yScale = 1.0;
-            if (imgSize.X <= 544.0) {
-                xScale = 544.0 / imgSize.X;
-            }
-            if (imgSize.Y <= 544.0) {
-                yScale = 544.0 / imgSize.Y;
-            }
-            if (yScale < xScale) {
-                actualAlbumCoverScale = yScale * actualAlbumCoverScale;
-            }
-            else {
-                actualAlbumCoverScale = xScale * actualAlbumCoverScale;
-            }
-            albumCoverWidth = static_cast<int>(imgSize.X * actualAlbumCoverScale);
-            albumCoverHeight = static_cast<int>(imgSize.Y * actualAlbumCoverScale);
-        }
-    }
-      
-    // Calculate total backgground dimensions
-    int totalWidth = 650*scale;
-    int totalHeight = (108 * scale) + padding;
-
-    // Draw background, album cover, and text
-    
-    // Draw background rectangle
-    canvas.SetColor(bkgColor.R, bkgColor.G, bkgColor.B, bkgOpacity);
-    canvas.DrawRect(
-        Vector2{baseX - padding, baseY - padding}, 
-        Vector2{baseX - padding + totalWidth, baseY - padding + totalHeight}
-    );
-
-    // Calculate the content area
-    int contentAreaY = baseY;
-    int contentAreaHeight = totalHeight - (2 * padding);
-
-    // Calculate album cover vertical centering
-    int albumCoverY = contentAreaY + (contentAreaHeight / 2) - (albumCoverHeight / 2);
-
-    // Calculate total text block height
-    int textBlockHeight = 0;
-    int lineCount = 0;
-    if (!info.title.empty()) lineCount++;
-    if (!info.artist.empty()) lineCount++;
-    if (!info.album.empty()) lineCount++;
-    textBlockHeight = lineCount * lineHeight;
-
-    // Calculate text starting position
-    int textStartY = contentAreaY + (contentAreaHeight / 2) - (textBlockHeight / 2) + (padding / 2);
-    int textX = baseX + albumCoverWidth + padding;
 
-    // Render album cover
-    if (*showAlbumCover) {
-        if (!toRender.empty()) {
-            auto& img = toRender[0];
-            if (img.img && img.img->IsLoadedForCanvas()) {
-                canvas.SetPosition(Vector2{ baseX, albumCoverY });
-                canvas.SetColor(255, 255, 255, 255);
-                canvas.DrawTexture(img.img.get(), actualAlbumCoverScale);
+    if (target.Backend() != activeBackend) {
+        SwitchBackend(target.Backend());
+    }
+    if (target.MetricsId() != textMetricsId) {
+        // Another font, every cached width and marquee is stale
+        textMetricsId = target.MetricsId();
+        textFitter.Clear();
+        for (Marquee& marquee : marquees) {
+            marquee.Reset();
+        }
+        drawListDirty = true;
+    }
+
+    auto frameStart = std::chrono::steady_clock::now();
+
+    // The bar position is extrapolated from the last timeline update, no media calls happen here.
+    // Marquees and transitions run on the same monotonic clock.
+    uint64_t now = PlaybackClock::NowNanos();
+
+    // Lock-free, the snapshot stays valid until the next acquire
+    const MediaSnapshot& snapshot = musicSync->AcquireMediaSnapshot();
+    bool steady = snapshot.generation == renderedGeneration;
+    std::shared_ptr<ImageWrapper> previousCover;
+    bool contentChanged = false;
+    if (!steady) {
+        previousCover = albumCoverImage;
+        contentChanged = UpdateRenderData(snapshot);
+        renderedGeneration = snapshot.generation;
+    }
+    if (coverGraceUntil != 0 && now >= coverGraceUntil) {
+        // No thumbnail came for the new track
+        if (!previousCover) {
+            previousCover = albumCoverImage;
+        }
+        albumCoverImage.reset();
+        RememberCover(loadedCover);
+        loadedCover.reset();
+        backdropImage.reset();
+        coverGraceUntil = 0;
+        ApplyTheme();
+        drawListDirty = true;
+        contentChanged = true;
+    }
+    if (!snapshot.info.isValid) {
+        transition.Stop();
+        return;
+    }
+    if (contentChanged) {
+        StartTransition(std::move(previousCover), now);
+    }
+
+    // The target size follows resolution and viewport changes without a settings lookup.
+    // Comparing the inputs is all a steady frame does before replaying the draw list.
+    Vector2 targetSize = target.GetSize();
+    OverlayLayoutInput input = CurrentLayoutInput(targetSize.X, targetSize.Y);
+    if (!layoutValid || input != layout.input) {
+        layout = OverlayLayout::Compute(input);
+        layoutValid = true;
+        layoutBuilds++;
+        drawListDirty = true;
+    }
+    if (layout.input.composited) {
+        TakeComposite();
+    }
+    if (panelSkins) {
+        TakePanelSkin();
+    }
+    if (recentAtlas) {
+        TakeRecentAtlas();
+    }
+    if (drawListDirty) {
+        FitLines(target);
+        RecordDrawList();
+        drawListDirty = false;
+    }
+
+    float progress = -1.0f;
+    if (layout.drawProgress) {
+        TimelineSample timeline = musicSync->GetPlaybackClock().Read();
+        if (timeline.valid) {
+            progress = timeline.ProgressAt(now);
+        }
+    }
+    if (transition.Active(now)) {
+        // The background stays put, only the content animates
+        Vector2 origin{ (layout.backgroundMin.X + layout.backgroundMax.X) / 2, (layout.backgroundMin.Y + layout.backgroundMax.Y) / 2 };
+        TransitionFrame frame = transition.Evaluate(now, origin);
+        drawList.Replay(target, progress, now, DrawTransform{}, DrawPart::Background);
+        outgoingList.Replay(target, progress, now, frame.outgoing, DrawPart::Content);
+        drawList.Replay(target, progress, now, frame.incoming, DrawPart::Content);
+    }
+    else {
+        if (outgoingCover || outgoingComposite || outgoingList.Size() > 0) {
+            outgoingList.Clear();
+            outgoingCover.reset();
+            outgoingComposite.reset();
+            transition.Stop();
+        }
+        drawList.Replay(target, progress, now);
+    }
+
+    uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frameStart).count();
+    frames++;
+    frameNanos += nanos;
+    RecordBackendFrame(target, nanos);
+}
+
+void MusicOverlay::FitLines(DrawTarget& target)
+{
+    measureTarget = &target;
+    fittedWidth = 0;
+    uint64_t now = PlaybackClock::NowNanos();
+    const std::string* lines[] = { &titleLine, &artistLine, &albumLine };
+    for (size_t i = 0; i < fittedLines.size(); ++i) {
+        // A marquee keeps its measurements and scroll position while its line and scale stay the same
+        if (layout.input.marquee && !layout.input.composited) {
+            marquees[i].Prepare(*lines[i], layout.fontSize, static_cast<float>(layout.textMaxWidth), targetOracle, now);
+        }
+        else {
+            marquees[i].Reset();
+        }
+        if (marquees[i].Scrolls()) {
+            fittedLines[i] = *lines[i];
+            fittedWidth = layout.textMaxWidth;
+            continue;
+        }
+
+        fittedLines[i] = textFitter.Fit(*lines[i], layout.fontSize, static_cast<float>(layout.textMaxWidth));
+        float width = textFitter.Measure(fittedLines[i], layout.fontSize);
+        fittedWidth = (std::max)(fittedWidth, static_cast<int>(width + 0.5f));
+    }
+    measureTarget = nullptr;
+}
+
+// Picks up a finished composite. Only the one for the scene the draw list
+// waits on is loaded, older ones were already replaced.
+void MusicOverlay::TakeComposite()
+{
+    OverlayCompositor::Result result;
+    if (!compositor || !compositor->TakeResult(result) || result.key != submittedSceneKey) {
+        return;
+    }
+    auto loadStart = std::chrono::steady_clock::now();
+    std::shared_ptr<ImageWrapper> image = LoadTexture(result.texturePath);
+    auto loadMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - loadStart).count();
+    if (CoverPipeline* pipeline = musicSync->GetCoverPipeline()) {
+        pipeline->RecordTextureLoad(static_cast<uint64_t>(loadMicros));
+    }
+    if (image) {
+        compositedImage = std::move(image);
+        compositedPath = result.texturePath;
+        compositedKey = result.key;
+        drawListDirty = true;
+    }
+}
+
+// Everything but the progress bar, relative to the top left of the background
+CompositorScene MusicOverlay::CurrentScene(int backgroundRight) const
+{
+    CompositorScene scene;
+    scene.width = backgroundRight - layout.backgroundMin.X;
+    scene.height = layout.backgroundMax.Y - layout.backgroundMin.Y;
+    scene.background[0] = ToByte(backgroundColor.R);
+    scene.background[1] = ToByte(backgroundColor.G);
+    scene.background[2] = ToByte(backgroundColor.B);
+    scene.background[3] = ToByte(static_cast<float>(backgroundOpacity));
+    scene.cornerRadius = layout.cornerRadius;
+
+    if (layout.drawCover && loadedCover) {
+        scene.cover = loadedCover;
+        scene.coverX = layout.coverPosition.X - layout.backgroundMin.X;
+        scene.coverY = layout.coverPosition.Y - layout.backgroundMin.Y;
+        scene.coverWidth = static_cast<int>(layout.input.coverWidth * layout.coverScale);
+        scene.coverHeight = static_cast<int>(layout.input.coverHeight * layout.coverScale);
+    }
+
+    // The compositor fits the lines with its own font, the target's font is
+    // only used for the background width
+    int maxWidth = (std::min)(layout.textMaxWidth, backgroundRight - layout.padding - layout.textX);
+    int currentY = layout.firstLineY;
+    for (const std::string* line : { &titleLine, &artistLine, &albumLine }) {
+        if (line->empty()) {
+            continue;
+        }
+        CompositorLine& compositorLine = scene.lines.emplace_back();
+        compositorLine.text = *line;
+        compositorLine.pixelHeight = canvasFontPixels * layout.fontSize;
+        compositorLine.x = layout.textX - layout.backgroundMin.X;
+        compositorLine.y = currentY - layout.backgroundMin.Y;
+        compositorLine.maxWidth = maxWidth;
+        compositorLine.color[0] = ToByte(textColor.R);
+        compositorLine.color[1] = ToByte(textColor.G);
+        compositorLine.color[2] = ToByte(textColor.B);
+        compositorLine.color[3] = ToByte(textColor.A);
+        currentY += layout.lineHeight;
+    }
+    return scene;
+}
+
+// Records the composited texture, submitting the scene first if it changed.
+// False if the target should draw instead because the fonts are missing.
+bool MusicOverlay::RecordComposite(int backgroundRight)
+{
+    if (!compositor) {
+        Preload();
+    }
+    if (!compositor || compositor->Failed()) {
+        return false;
+    }
+
+    CompositorScene scene = CurrentScene(backgroundRight);
+    uint64_t key = scene.Hash();
+    if (key != submittedSceneKey) {
+        submittedSceneKey = key;
+        compositor->Submit(std::move(scene), key);
+    }
+
+    // The whole panel is content. On a track change the new one fades in once
+    // the worker has it, otherwise the previous texture stays up until then.
+    if (layout.drawProgress) {
+        drawList.DrawProgress(layout.progressMin, Vector2{ backgroundRight - layout.cornerRadius, layout.progressMax.Y },
+            LinearColor{ textColor.R, textColor.G, textColor.B, textColor.A / 4 }, textColor);
+    }
+    drawList.MarkContent();
+    bool ready = compositedKey == submittedSceneKey;
+    if (compositedImage && (ready || !transition.Active(PlaybackClock::NowNanos()))) {
+        drawList.SetPosition(layout.backgroundMin);
+        drawList.SetColor(LinearColor{ 255, 255, 255, 255 });
+        drawList.DrawTexture(compositedImage.get(), 1.0f);
+    }
+    return true;
+}
+
+void MusicOverlay::RecordDrawList()
+{
+    drawList.Clear();
+
+    int backgroundRight = layout.BackgroundRight(fittedWidth);
+    if (layout.input.composited && RecordComposite(backgroundRight)) {
+        return;
+    }
+
+    // Draw background, the blurred cover or a flat rectangle, either is one draw
+    // call. A panel skin replaces the rectangle and goes over the cover.
+    Vector2 backgroundMax{ backgroundRight, layout.backgroundMax.Y };
+    ImageWrapper* backdrop = CurrentBackdrop();
+    std::optional<PanelStyle> panelStyle = CurrentPanelStyle(backdrop != nullptr);
+    bool skinned = panelStyle && PanelSkinReady(*panelStyle);
+    if (backdrop) {
+        Vector2F uv0;
+        Vector2F uv1;
+        CropToFill(backdrop->GetSize(), Vector2{ backgroundMax.X - layout.backgroundMin.X, backgroundMax.Y - layout.backgroundMin.Y }, uv0, uv1);
+        drawList.SetColor(LinearColor{ 255, 255, 255, static_cast<float>(backgroundOpacity) });
+        drawList.DrawTile(backdrop, layout.backgroundMin, backgroundMax, uv0, uv1, static_cast<float>(layout.cornerRadius));
+    }
+    else if (!skinned) {
+        drawList.SetColor(LinearColor{ backgroundColor.R, backgroundColor.G, backgroundColor.B, static_cast<float>(backgroundOpacity) });
+        drawList.DrawRect(layout.backgroundMin, backgroundMax, static_cast<float>(layout.cornerRadius));
+    }
+    if (skinned) {
+        std::array<PanelSlice, 9> slices;
+        size_t count = SlicePanel(panelSkin.skin, layout.backgroundMin, backgroundMax, slices);
+        drawList.SetColor(LinearColor{ 255, 255, 255, 255 });
+        for (size_t i = 0; i < count; ++i) {
+            drawList.DrawTile(panelImage.get(), slices[i].min, slices[i].max, slices[i].uv0, slices[i].uv1);
+        }
+    }
+
+    // Progress bar along the bottom edge of the background, filled per frame
+    if (layout.drawProgress) {
+        drawList.DrawProgress(layout.progressMin, Vector2{ backgroundRight - layout.cornerRadius, layout.progressMax.Y },
+            LinearColor{ textColor.R, textColor.G, textColor.B, textColor.A / 4 }, textColor);
+    }
+
+    // Recent covers under the background, all from one atlas texture so ImGui
+    // draws the strip as one batch. It is not animated, the atlas of the new
+    // strip replaces the old one once the worker has it.
+    if (layout.drawRecent && RecentAtlasReady()) {
+        float fit = static_cast<float>(layout.recentSize) / (std::max)(recentTiles.thumbSize, 1);
+        drawList.SetColor(LinearColor{ 255, 255, 255, 255 });
+        int x = layout.recentMin.X;
+        for (const CoverAtlasTile& tile : recentTiles.tiles) {
+            if (tile.width > 0) {
+                int width = static_cast<int>(tile.width * fit);
+                int height = static_cast<int>(tile.height * fit);
+                Vector2 min{ x + (layout.recentSize - width) / 2, layout.recentMin.Y + (layout.recentSize - height) / 2 };
+                drawList.DrawTile(recentImage.get(), min, Vector2{ min.X + width, min.Y + height }, tile.uv0, tile.uv1,
+                    layout.cornerRadius / 4.0f);
             }
+            x += layout.recentSize + layout.recentGap;
         }
     }
 
-    // Render text
-    canvas.SetColor(textColor.R, textColor.G, textColor.B, textColor.A);
-    int currentY = textStartY;
-    float fontSize = 2.0f * scale;
+    // Everything after this animates on track changes
+    drawList.MarkContent();
+
+    // Render album cover
+    if (layout.drawCover) {
+        drawList.SetPosition(layout.coverPosition);
+        drawList.SetColor(LinearColor{ 255, 255, 255, 255 });
+        drawList.DrawTexture(albumCoverImage.get(), layout.coverScale, layout.cornerRadius / 2.0f);
+    }
 
-    if (!info.title.empty()) {
-        std::string displayTitle = info.title;
-        if (displayTitle.length() > 20) {
-            displayTitle = displayTitle.substr(0, 20) + "...";
+    // Render text
+    drawList.SetColor(textColor);
+    int currentY = layout.firstLineY;
+    for (size_t i = 0; i < fittedLines.size(); ++i) {
+        if (fittedLines[i].empty()) {
+            continue;
         }
-        canvas.SetPosition(Vector2{textX, currentY});
-        canvas.DrawString("Title: " + displayTitle, fontSize, fontSize);
-        currentY += lineHeight;
+        if (marquees[i].Scrolls()) {
+            drawList.DrawMarquee(Vector2{ layout.textX, currentY }, &marquees[i], layout.fontSize, layout.fontSize);
+        }
+        else {
+            drawList.SetPosition(Vector2{ layout.textX, currentY });
+            drawList.DrawString(fittedLines[i], layout.fontSize, layout.fontSize);
+        }
+        currentY += layout.lineHeight;
+    }
+
+    if (drawList.Overflowed()) {
+        LOG("Overlay draw list overflowed, some elements are not drawn");
+    }
+}
+
+// The backdrop of the cover on screen, loaded on first use. Null when it is
+// off, there is no cover or its backdrop could not be loaded.
+ImageWrapper* MusicOverlay::CurrentBackdrop()
+{
+    if (!layout.input.coverBackdrop || !layout.drawCover || !loadedCover || loadedCover->backdropPath.empty()) {
+        return nullptr;
+    }
+    if (!backdropImage) {
+        backdropImage = LoadTexture(loadedCover->backdropPath);
+    }
+    return backdropImage && backdropImage->IsLoadedForCanvas() ? backdropImage.get() : nullptr;
+}
+
+// Null when no panel CVar is set and the background is the plain rectangle
+std::optional<PanelStyle> MusicOverlay::CurrentPanelStyle(bool overBackdrop) const
+{
+    if (!layout.input.HasPanelSkin()) {
+        return std::nullopt;
+    }
+    float scale = layout.input.scale;
+    PanelStyle style;
+    style.radius = layout.cornerRadius;
+    style.shadow = static_cast<int>(layout.input.panelShadow * scale);
+    style.outline = layout.input.panelOutline > 0 ? (std::max)(1, static_cast<int>(layout.input.panelOutline * scale)) : 0;
+    style.fill[0] = ToByte(backgroundColor.R);
+    style.fill[1] = ToByte(backgroundColor.G);
+    style.fill[2] = ToByte(backgroundColor.B);
+    style.fill[3] = overBackdrop ? 0 : ToByte(static_cast<float>(backgroundOpacity));
+    style.outlineColor[0] = ToByte(outlineColor.R);
+    style.outlineColor[1] = ToByte(outlineColor.G);
+    style.outlineColor[2] = ToByte(outlineColor.B);
+    style.outlineColor[3] = ToByte(outlineColor.A);
+    return style;
+}
+
+// Asks the worker for the style if it was not asked for yet. True once its skin is loaded.
+bool MusicOverlay::PanelSkinReady(const PanelStyle& style)
+{
+    if (!panelSkins) {
+        panelSkins = std::make_unique<PanelSkinBuilder>(MusicSync::GetDataDir() / "staging");
+    }
+    if (submittedPanel != style) {
+        submittedPanel = style;
+        panelSkins->Submit(style);
+    }
+    return panelImage && panelSkin.style == style;
+}
+
+void MusicOverlay::TakePanelSkin()
+{
+    PanelSkinBuilder::Result result;
+    if (!panelSkins->TakeResult(result) || submittedPanel != result.style) {
+        return;
+    }
+    std::shared_ptr<ImageWrapper> image = LoadTexture(result.texturePath);
+    if (image) {
+        panelImage = std::move(image);
+        panelSkin = std::move(result);
+        drawListDirty = true;
+    }
+}
+
+// Puts the cover that was on screen at the front of the recent covers. One
+// more than the strip can show is kept, the cover on screen may be among them.
+void MusicOverlay::RememberCover(const std::shared_ptr<const CoverImage>& previous)
+{
+    if (!previous || previous->texturePath.empty()) {
+        return;
+    }
+    recentCovers.erase(std::remove_if(recentCovers.begin(), recentCovers.end(),
+        [&](const std::shared_ptr<const CoverImage>& cover) { return cover->texturePath == previous->texturePath; }), recentCovers.end());
+    recentCovers.insert(recentCovers.begin(), previous);
+    if (recentCovers.size() > static_cast<size_t>(maxRecentCovers) + 1) {
+        recentCovers.pop_back();
     }
+}
 
-    if (!info.artist.empty()) {
-        std::string displayArtist = info.artist;
-        if (displayArtist.length() > 20) {
-            displayArtist = displayArtist.substr(0, 20) + "...";
+// The covers the strip shows, newest first, without the one on screen
+std::vector<std::shared_ptr<const CoverImage>> MusicOverlay::RecentStrip() const
+{
+    std::vector<std::shared_ptr<const CoverImage>> strip;
+    for (const std::shared_ptr<const CoverImage>& cover : recentCovers) {
+        if (static_cast<int>(strip.size()) == layout.input.recentCount) {
+            break;
+        }
+        if (!loadedCover || cover->texturePath != loadedCover->texturePath) {
+            strip.push_back(cover);
         }
-        canvas.SetPosition(Vector2{textX, currentY});
-        canvas.DrawString("By: " + displayArtist, fontSize, fontSize);
-        currentY += lineHeight;
     }
+    return strip;
+}
 
-    if (!info.album.empty()) {
-        canvas.SetPosition(Vector2{textX, currentY});
-        canvas.DrawString("From " + info.album, fontSize, fontSize);
+// Asks the worker for the current strip if it was not asked for yet. True
+// while an atlas is loaded and there is a strip to draw.
+bool MusicOverlay::RecentAtlasReady()
+{
+    std::vector<std::shared_ptr<const CoverImage>> strip = RecentStrip();
+    if (strip.empty()) {
+        return false;
+    }
+    uint64_t key = static_cast<uint64_t>(layout.recentSize) << 8 | static_cast<uint64_t>(layout.input.recentCount);
+    for (const std::shared_ptr<const CoverImage>& cover : strip) {
+        key = (key ^ std::filesystem::hash_value(cover->texturePath)) * 1099511628211ull;
+    }
+    if (!recentAtlas) {
+        recentAtlas = std::make_unique<CoverAtlasBuilder>(MusicSync::GetDataDir() / "staging");
     }
+    if (key != submittedRecentKey) {
+        submittedRecentKey = key;
+        recentAtlas->Submit(std::move(strip), layout.recentSize, layout.input.recentCount, key);
+    }
+    return recentImage != nullptr;
 }
 
-void MusicOverlay::ClearAlbumCover()
+void MusicOverlay::TakeRecentAtlas()
 {
-    if (albumCoverImage) {
-        albumCoverImage.reset();
+    CoverAtlasBuilder::Result result;
+    if (!recentAtlas->TakeResult(result) || result.key != submittedRecentKey) {
+        return;
+    }
+    std::shared_ptr<ImageWrapper> image = LoadTexture(result.texturePath);
+    if (image) {
+        recentImage = std::move(image);
+        recentTiles = std::move(result);
+        drawListDirty = true;
+    }
+}
+
+void MusicOverlay::Preload()
+{
+    if (!compositor && *composited) {
+        compositor = std::make_unique<OverlayCompositor>(MusicSync::GetDataDir() / "staging",
+            MusicSync::GetDataDir() / "fontcache", SystemFontPaths());
+    }
+}
+
+void MusicOverlay::LogFrameStats()
+{
+    LOG("Overlay frames: {}, avg {} ns including draw calls, {} layout builds", frames,
+        frames > 0 ? frameNanos / frames : 0, layoutBuilds);
+    TextFitterStats text = textFitter.GetStats();
+    LOG("Overlay text: {} width measurements, {} cache hits, {} cached widths", text.measurements, text.cacheHits, text.entries);
+    if (compositor) {
+        OverlayCompositorStats stats = compositor->GetStats();
+        LOG("Overlay compositor: {} fonts loaded in {} us, {} scenes composed in avg {} us plus {} us staging, {} superseded",
+            stats.fonts, stats.fontLoadMicros, stats.composed, stats.composed > 0 ? stats.composeMicros / stats.composed : 0,
+            stats.composed > 0 ? stats.writeMicros / stats.composed : 0, stats.superseded);
+        LOG("Overlay SDF atlas: {} in {} us", stats.atlasFromCache ? "loaded from cache" : "built", stats.atlasMicros);
+        LOG("Overlay SDF atlas: {} glyphs in {}x{} ({} KB), built in {} us, grown {} times", stats.sdfAtlas.glyphs,
+            stats.sdfAtlas.width, stats.sdfAtlas.height, stats.sdfAtlas.bytes / 1024, stats.sdfAtlas.buildMicros, stats.sdfAtlas.grows);
+    }
+    if (recentAtlas) {
+        CoverAtlasStats stats = recentAtlas->GetStats();
+        LOG("Overlay recent covers: {} updates in avg {} us, {} scaled, {} holes reused, {} repacks, {} KB staged",
+            stats.updates, stats.updates > 0 ? stats.updateMicros / stats.updates : 0, stats.thumbnails, stats.holesReused,
+            stats.repacks, stats.uploadBytes / 1024);
     }
-    toRender.clear();
-    lastAlbumCoverPath.clear();
-    needsUpdate = true; // Force reload on next render
 }
 
 void MusicOverlay::OnUnload()
 {
-    toRender.clear();
+    drawList.Clear();
+    drawListDirty = true;
+    outgoingList.Clear();
+    outgoingCover.reset();
+    transition.Stop();
+    coverGraceUntil = 0;
+    layoutValid = false;
+    textFitter.Clear();
+    for (Marquee& marquee : marquees) {
+        marquee.Reset();
+    }
     albumCoverImage.reset();
+    loadedCover.reset();
+    compositor.reset();
+    compositedImage.reset();
+    outgoingComposite.reset();
+    compositedKey = 0;
+    submittedSceneKey = 0;
+    panelSkins.reset();
+    panelImage.reset();
+    submittedPanel.reset();
+    recentCovers.clear();
+    recentAtlas.reset();
+    recentImage.reset();
+    recentTiles = CoverAtlasBuilder::Result{};
+    submittedRecentKey = 0;
 }
\ No newline at end of file
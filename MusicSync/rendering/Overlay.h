@@ -1,13 +1,30 @@
 #pragma once
 #include "pch.h"
 
+#include "../media/MediaSnapshot.h"
+#include "OverlayLayout.h"
+#include "DrawList.h"
+#include "TextFitter.h"
+#include "Marquee.h"
+#include "Transition.h"
+#include "OverlayCompositor.h"
+#include "PanelSkin.h"
+#include "CoverAtlas.h"
+#include "DrawTarget.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <optional>
+
 class MusicSync;
 
-struct image {
-    std::shared_ptr<ImageWrapper> img;
-    Vector2 position;
-    float scale;
-    LinearColor color;
+// Totals over a window of frames drawn by one backend, for comparing them in the settings
+struct OverlayBackendStats {
+    uint64_t frames = 0;
+    uint64_t frameNanos = 0; // CPU time of the overlay, not of the GPU work it queues
+    uint64_t drawCalls = 0;
+    uint64_t batches = 0;
 };
 
 class MusicOverlay {
@@ -15,34 +32,150 @@ private:
     std::shared_ptr<GameWrapper> gameWrapper;
     std::shared_ptr<CVarManagerWrapper> cvarManager;
     MusicSync* musicSync;
-    inline static std::filesystem::path dataDir;
-    inline static std::filesystem::path coverPath;
-    inline static auto coverFile = "cover.png";
     // Overlay settings
     std::shared_ptr<bool> enabled;
     std::shared_ptr<float> overlayScale;
     std::shared_ptr<float> overlayX;
     std::shared_ptr<float> overlayY;
     std::shared_ptr<bool> showAlbumCover;
+    std::shared_ptr<bool> coverBackdrop;
+    std::shared_ptr<bool> showProgress;
+    std::shared_ptr<bool> autoWidth;
+    std::shared_ptr<bool> marqueeEnabled;
+    std::shared_ptr<int> transitionStyle;
+    std::shared_ptr<int> backend;
+    std::shared_ptr<bool> composited;
+    std::shared_ptr<int> panelRadius;
+    std::shared_ptr<int> panelShadow;
+    std::shared_ptr<int> panelOutline;
+    std::shared_ptr<int> recentCount;
 
-    // Album cover image (using ImageWrapper)
+    // Album cover image (using ImageWrapper), loaded from the staged texture of loadedCover
     std::shared_ptr<ImageWrapper> albumCoverImage;
-    std::string lastAlbumCoverPath;
+    std::shared_ptr<const CoverImage> loadedCover;
+    // Blurred background of loadedCover, loaded by the first recording that draws it
+    std::shared_ptr<ImageWrapper> backdropImage;
+    // Set while the old cover stands in for a new track whose thumbnail has not arrived yet
+    uint64_t coverGraceUntil = 0;
+    static constexpr uint64_t coverGraceNanos = 1'500'000'000;
+
+    // Cached render data, rebuilt when the media snapshot generation changes
+    uint64_t renderedGeneration = 0;
+    std::string titleLine;
+    std::string artistLine;
+    std::string albumLine;
+
+    // Lines cut to the layout's text width at grapheme boundaries. Refitted with
+    // the draw list, the fitter caches widths so only a new track or scale measures.
+    DrawTarget* measureTarget = nullptr; // Set while fitting, the oracle measures through it
+    TextWidthOracle targetOracle;
+    TextFitter textFitter;
+    std::array<std::string, 3> fittedLines;
+    int fittedWidth = 0;
+
+    // Lines that overflow scroll instead of being cut when marquee mode is on
+    std::array<Marquee, 3> marquees;
+
+    // Composited mode: background, cover and text in one texture, composed by
+    // the worker whenever the scene changes. The last texture stays up until then.
+    std::unique_ptr<OverlayCompositor> compositor;
+    std::shared_ptr<ImageWrapper> compositedImage;
+    std::filesystem::path compositedPath;
+    uint64_t compositedKey = 0;      // Scene of compositedImage
+    uint64_t submittedSceneKey = 0;  // Scene the draw list wants
+
+    // Panel skin: rounded corners, shadow and outline in one 9-slice texture,
+    // built by a worker whenever the style changes. The flat background stands in until then.
+    std::unique_ptr<PanelSkinBuilder> panelSkins;
+    std::shared_ptr<ImageWrapper> panelImage;
+    PanelSkinBuilder::Result panelSkin; // Of panelImage
+    std::optional<PanelStyle> submittedPanel;
+
+    // Recent tracks strip: covers shown before loadedCover, newest first and
+    // without repeats. Their thumbnails are packed into one texture by a worker
+    // whenever the strip changes, the last atlas stays up until then.
+    std::vector<std::shared_ptr<const CoverImage>> recentCovers;
+    std::unique_ptr<CoverAtlasBuilder> recentAtlas;
+    std::shared_ptr<ImageWrapper> recentImage;
+    CoverAtlasBuilder::Result recentTiles; // Of recentImage
+    uint64_t submittedRecentKey = 0;
 
-    // Cached render data
-    std::vector<image> toRender;
+    // Colors are parsed once per CVar change instead of looked up every frame.
+    // textColor and backgroundColor are what is drawn, the set ones or the
+    // cover's theme.
+    LinearColor textColor{ 255, 255, 255, 255 };
+    LinearColor backgroundColor{ 0, 0, 0, 255 };
+    LinearColor setTextColor{ 255, 255, 255, 255 };
+    LinearColor setBackgroundColor{ 0, 0, 0, 255 };
+    bool autoTheme = false;
+    int backgroundOpacity = 100;
+    LinearColor outlineColor{ 255, 255, 255, 96 };
+
+    // Rebuilt only when its input changes, see OverlayLayoutInput
+    OverlayLayout layout;
+    bool layoutValid = false;
+
+    // Re-recorded with the layout or the media, replayed every frame
+    DrawList drawList;
+    bool drawListDirty = true;
+
+    // What was on screen before the last track change, faded out by the transition.
+    // outgoingCover keeps the texture the outgoing list draws alive until then.
+    DrawList outgoingList;
+    std::shared_ptr<ImageWrapper> outgoingCover;
+    std::shared_ptr<ImageWrapper> outgoingComposite;
+    Transition transition;
+
+    // Textures are uploaded for the backend that draws them, switching reloads them
+    OverlayBackend activeBackend = OverlayBackend::Canvas;
+    uintptr_t textMetricsId = 0;
+
+    // Frame cost, render thread of the active backend only
+    uint64_t frames = 0;
+    uint64_t frameNanos = 0;
+    uint64_t layoutBuilds = 0;
+    std::array<OverlayBackendStats, 2> backendWindow{};
+    std::array<OverlayBackendStats, 2> backendStats{};
+
+    bool UpdateRenderData(const MediaSnapshot& snapshot);
+    void StartTransition(std::shared_ptr<ImageWrapper> previousCover, uint64_t nowNanos);
+    void ReadColors();
+    void ApplyTheme();
+    void FitLines(DrawTarget& target);
+    std::shared_ptr<ImageWrapper> LoadTexture(const std::filesystem::path& path) const;
+    void SwitchBackend(OverlayBackend newBackend);
+    void RecordBackendFrame(const DrawTarget& target, uint64_t nanos);
+    void RecordDrawList();
+    ImageWrapper* CurrentBackdrop();
+    std::optional<PanelStyle> CurrentPanelStyle(bool overBackdrop) const;
+    bool PanelSkinReady(const PanelStyle& style);
+    void TakePanelSkin();
+    void RememberCover(const std::shared_ptr<const CoverImage>& previous);
+    std::vector<std::shared_ptr<const CoverImage>> RecentStrip() const;
+    bool RecentAtlasReady();
+    void TakeRecentAtlas();
+    void TakeComposite();
+    bool RecordComposite(int backgroundRight);
+    CompositorScene CurrentScene(int backgroundRight) const;
+    OverlayLayoutInput CurrentLayoutInput(int screenWidth, int screenHeight) const;
 
 public:
-    bool needsUpdate = true;
 
     MusicOverlay(std::shared_ptr<GameWrapper> gw, std::shared_ptr<CVarManagerWrapper> cv, MusicSync* ms);
     ~MusicOverlay();
 
     void InitializeSettings();
-    void UpdateRenderData();
-    void RenderOverlay(CanvasWrapper canvas);
+    void RenderOverlay(DrawTarget& target);
+    OverlayBackend SelectedBackend() const { return static_cast<OverlayBackend>(std::clamp(*backend, 0, 1)); }
+    // Totals over the last complete window of frames drawn by that backend
+    OverlayBackendStats GetBackendStats(OverlayBackend which) const { return backendStats[static_cast<size_t>(which)]; }
     void OnUnload();
-    void ClearAlbumCover();
+    // Starts the compositor's font and atlas loading early when it will be needed
+    void Preload();
+    void LogFrameStats();
 
     std::pair<int, int> ParseResolution(const std::string& resolution);
+
+    // Segoe UI first, then fonts that cover Korean, Japanese and Chinese titles
+    static std::vector<std::filesystem::path> SystemFontPaths();
 };
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "pch.h"
+#include "OverlayCompositor.h"
+#include "../imaging/BmpWriter.h"
+#include "../imaging/MappedFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+    constexpr int slotCount = 3;
+
+    std::vector<uint8_t> ReadFile(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return {};
+        }
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::filesystem::path AtlasPath(const std::filesystem::path& directory, uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "sdf_%016llx.bin", static_cast<unsigned long long>(key));
+        return directory / name;
+    }
+
+    uint64_t MicrosSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+OverlayCompositor::OverlayCompositor(std::filesystem::path stagingDirectory, std::filesystem::path cacheDirectory,
+    std::vector<std::filesystem::path> fontPaths)
+    : stagingDirectory(std::move(stagingDirectory)), cacheDirectory(std::move(cacheDirectory)), fontPaths(std::move(fontPaths))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(this->stagingDirectory, ec);
+    std::filesystem::create_directories(this->cacheDirectory, ec);
+    worker = std::thread(&OverlayCompositor::Run, this);
+}
+
+OverlayCompositor::~OverlayCompositor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    // Titles seen this session need no rasterizing next time
+    if (font.FontCount() > 0 && font.SdfStats().glyphs > savedGlyphs) {
+        SaveAtlas();
+    }
+}
+
+void OverlayCompositor::Submit(CompositorScene scene, uint64_t key)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending) {
+            stats.superseded++;
+        }
+        pending = Job{ std::move(scene), key };
+    }
+    wake.notify_one();
+}
+
+bool OverlayCompositor::TakeResult(Result& result)
+{
+    // A frame skips the check rather than wait for the worker to finish its bookkeeping
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock() || !ready) {
+        return false;
+    }
+    result = std::move(*ready);
+    ready.reset();
+    takenSlots[1] = takenSlots[0];
+    takenSlots[0] = readySlot;
+    readySlot = -1;
+    return true;
+}
+
+OverlayCompositorStats OverlayCompositor::GetStats() const
+{
+    OverlayCompositorStats copy;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        copy = stats;
+    }
+    copy.sdfAtlas = font.SdfStats();
+    return copy;
+}
+
+// Maps the cached atlas for these fonts, or builds the seed glyphs and caches them
+void OverlayCompositor::LoadAtlas()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::filesystem::path path = AtlasPath(cacheDirectory, font.SdfCacheKey());
+
+    bool fromCache;
+    {
+        MappedFile file(path);
+        fromCache = file.view != nullptr && font.LoadSdf(file.view, file.size);
+    }
+    if (fromCache) {
+        savedGlyphs = font.SdfStats().glyphs;
+    }
+    else {
+        font.PrepareSdf({});
+        SaveAtlas();
+    }
+    uint64_t micros = MicrosSince(start);
+    LOG("Overlay font atlas: {} in {:.1f} ms", fromCache ? "loaded from cache" : "built and cached", micros / 1000.0);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.atlasMicros = micros;
+    stats.atlasFromCache = fromCache;
+}
+
+void OverlayCompositor::SaveAtlas()
+{
+    std::filesystem::path path = AtlasPath(cacheDirectory, font.SdfCacheKey());
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+
+    std::vector<uint8_t> data = font.SaveSdf();
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+            return;
+        }
+    }
+    // A plugin that is unloaded mid-write leaves the old cache or none, never half of one
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (!ec) {
+        savedGlyphs = font.SdfStats().glyphs;
+    }
+}
+
+int OverlayCompositor::FreeSlot() const
+{
+    for (int slot = 0; slot < slotCount; ++slot) {
+        if (slot != takenSlots[0] && slot != takenSlots[1]) {
+            return slot;
+        }
+    }
+    return 0;
+}
+
+void OverlayCompositor::Run()
+{
+    auto loadStart = std::chrono::steady_clock::now();
+    for (const auto& path : fontPaths) {
+        font.AddFont(ReadFile(path));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.fontLoadMicros = MicrosSince(loadStart);
+        stats.fonts = font.FontCount();
+    }
+    if (font.FontCount() == 0) {
+        failed.store(true, std::memory_order_release);
+        return;
+    }
+    LoadAtlas();
+
+    Bitmap bitmap;
+    std::vector<uint8_t> straight;
+    BlendKernel kernel = BestBlendKernel();
+    while (true) {
+        Job job;
+        int slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending.has_value(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(*pending);
+            pending.reset();
+            // An untaken result is outdated by this job, its slot may be the free one
+            ready.reset();
+            readySlot = -1;
+            slot = FreeSlot();
+        }
+
+        auto composeStart = std::chrono::steady_clock::now();
+        Compose(job.scene, font, bitmap, kernel);
+        uint64_t composeMicros = MicrosSince(composeStart);
+
+        auto writeStart = std::chrono::steady_clock::now();
+        Unpremultiply(bitmap, straight);
+        std::filesystem::path path = stagingDirectory / ("overlay_" + std::to_string(slot) + ".bmp");
+        bool written = bitmap.width > 0 && bitmap.height > 0 && WriteBmp(path, straight.data(), bitmap.width, bitmap.height);
+        uint64_t writeMicros = MicrosSince(writeStart);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.composed++;
+        stats.composeMicros += composeMicros;
+        stats.writeMicros += writeMicros;
+        if (written && !pending) {
+            ready = Result{ job.key, path, bitmap.width, bitmap.height };
+            readySlot = slot;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "Compositor.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+struct OverlayCompositorStats {
+    uint64_t composed = 0;
+    uint64_t superseded = 0;   // Replaced by a newer scene before the worker got to it
+    uint64_t composeMicros = 0;
+    uint64_t writeMicros = 0;  // Unpremultiply and staging file
+    uint64_t fontLoadMicros = 0;
+    uint64_t atlasMicros = 0;     // Loading the cached SDF atlas, or building it on a miss
+    bool atlasFromCache = false;
+    size_t fonts = 0;
+    GlyphAtlasStats sdfAtlas;
+};
+
+// Composes overlay scenes into one texture on its own thread. The canvas can
+// only load textures from files, so every result is staged as a BMP in the
+// staging directory. Three files are rotated and the two last taken are never
+// rewritten, so the texture on screen and the one a transition fades out stay
+// valid while the next is written.
+//
+// The SDF atlas is cached in the cache directory, keyed by the fonts and SDF
+// settings, and mapped on the next load instead of rasterized again. Glyphs
+// added while running are saved on destruction.
+class OverlayCompositor
+{
+public:
+    struct Result {
+        uint64_t key = 0;
+        std::filesystem::path texturePath;
+        int width = 0;
+        int height = 0;
+    };
+
+    // The fonts are loaded by the worker, the first one that loads is the primary font
+    OverlayCompositor(std::filesystem::path stagingDirectory, std::filesystem::path cacheDirectory,
+        std::vector<std::filesystem::path> fontPaths);
+    ~OverlayCompositor();
+    OverlayCompositor(const OverlayCompositor&) = delete;
+    OverlayCompositor& operator=(const OverlayCompositor&) = delete;
+
+    // Render thread. Replaces a scene that has not been started yet.
+    void Submit(CompositorScene scene, uint64_t key);
+
+    // Render thread, never blocks. True if a new result was taken.
+    bool TakeResult(Result& result);
+
+    // True once the worker gave up because none of the fonts could be loaded
+    bool Failed() const { return failed.load(std::memory_order_acquire); }
+
+    OverlayCompositorStats GetStats() const;
+
+private:
+    struct Job {
+        CompositorScene scene;
+        uint64_t key = 0;
+    };
+
+    void Run();
+    void LoadAtlas();
+    void SaveAtlas();
+    int FreeSlot() const;
+
+    std::filesystem::path stagingDirectory;
+    std::filesystem::path cacheDirectory;
+    std::vector<std::filesystem::path> fontPaths;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::optional<Job> pending;
+    std::optional<Result> ready;
+    int readySlot = -1;
+    std::array<int, 2> takenSlots{ -1, -1 }; // Newest first
+    OverlayCompositorStats stats;
+
+    GlyphFont font; // Loaded and used by the worker, the SDF atlas grows with the titles it sees
+    size_t savedGlyphs = 0; // Worker only, until it is joined
+    std::atomic<bool> failed{ false };
+    std::thread worker;
+};
@@ -0,0 +1,111 @@
+#include "pch.h"
+#include "OverlayLayout.h"
+#include "../imaging/CoverImage.h"
+
+#include <algorithm>
+
+namespace {
+    bool SameColor(const LinearColor& a, const LinearColor& b)
+    {
+        return a.R == b.R && a.G == b.G && a.B == b.B && a.A == b.A;
+    }
+}
+
+bool OverlayLayoutInput::operator==(const OverlayLayoutInput& other) const
+{
+    return screenWidth == other.screenWidth &&
+        screenHeight == other.screenHeight &&
+        scale == other.scale &&
+        xPercent == other.xPercent &&
+        yPercent == other.yPercent &&
+        showCover == other.showCover &&
+        showProgress == other.showProgress &&
+        coverBackdrop == other.coverBackdrop &&
+        coverWidth == other.coverWidth &&
+        coverHeight == other.coverHeight &&
+        lineCount == other.lineCount &&
+        autoWidth == other.autoWidth &&
+        marquee == other.marquee &&
+        composited == other.composited &&
+        panelRadius == other.panelRadius &&
+        panelShadow == other.panelShadow &&
+        panelOutline == other.panelOutline &&
+        recentCount == other.recentCount &&
+        backend == other.backend &&
+        SameColor(textColor, other.textColor) &&
+        SameColor(backgroundColor, other.backgroundColor) &&
+        backgroundOpacity == other.backgroundOpacity &&
+        SameColor(outlineColor, other.outlineColor);
+}
+
+OverlayLayout OverlayLayout::Compute(const OverlayLayoutInput& input)
+{
+    OverlayLayout layout;
+    layout.input = input;
+
+    // Convert percentages to actual pixel positions
+    float scale = input.scale;
+    int baseX = static_cast<int>((input.xPercent / 100.0f) * input.screenWidth);
+    int baseY = static_cast<int>((input.yPercent / 100.0f) * input.screenHeight);
+
+    int padding = static_cast<int>(20 * scale);
+    layout.padding = padding;
+    // The canvas can only draw square rects, ImGui and the compositor round them.
+    // A panel skin is a texture, so it rounds on every backend.
+    if (input.panelRadius > 0) {
+        layout.cornerRadius = static_cast<int>(input.panelRadius * scale);
+    }
+    else if (input.backend == OverlayBackend::ImGui || input.composited) {
+        layout.cornerRadius = padding / 2;
+    }
+    layout.lineHeight = static_cast<int>(50 * scale);
+    layout.fontSize = 2.0f * scale;
+
+    // Covers are resampled to the exact display size, this only matters until a rescale lands
+    int coverWidth = 0;
+    int coverHeight = 0;
+    int longestSide = (std::max)(input.coverWidth, input.coverHeight);
+    if (input.showCover && longestSide > 0) {
+        layout.drawCover = true;
+        layout.coverScale = coverDisplaySize * scale / longestSide;
+        coverWidth = static_cast<int>(input.coverWidth * layout.coverScale);
+        coverHeight = static_cast<int>(input.coverHeight * layout.coverScale);
+    }
+
+    // Background around the content
+    int totalWidth = static_cast<int>(650 * scale);
+    int totalHeight = static_cast<int>(108 * scale) + padding;
+    layout.backgroundMin = Vector2{ baseX - padding, baseY - padding };
+    layout.backgroundMax = Vector2{ baseX - padding + totalWidth, baseY - padding + totalHeight };
+
+    // Cover and text block are centered vertically in the content area
+    int contentAreaHeight = totalHeight - (2 * padding);
+    layout.coverPosition = Vector2{ baseX, baseY + (contentAreaHeight / 2) - (coverHeight / 2) };
+
+    int textBlockHeight = input.lineCount * layout.lineHeight;
+    layout.firstLineY = baseY + (contentAreaHeight / 2) - (textBlockHeight / 2) + (padding / 2);
+    layout.textX = baseX + coverWidth + padding;
+    layout.textMaxWidth = (std::max)(0, layout.backgroundMax.X - padding - layout.textX);
+
+    // Progress bar along the bottom edge of the background
+    layout.drawProgress = input.showProgress;
+    int barHeight = (std::max)(2, static_cast<int>(4 * scale));
+    // and clear of its rounded corners
+    layout.progressMin = Vector2{ layout.backgroundMin.X + layout.cornerRadius, layout.backgroundMax.Y - barHeight };
+    layout.progressMax = Vector2{ layout.backgroundMax.X - layout.cornerRadius, layout.backgroundMax.Y };
+
+    // Recent covers in a row under the background, at 40% of the cover size
+    layout.drawRecent = input.recentCount > 0 && !input.composited;
+    layout.recentSize = (std::max)(1, static_cast<int>(coverDisplaySize * scale * 0.4f));
+    layout.recentGap = (std::max)(1, padding / 4);
+    layout.recentMin = Vector2{ layout.backgroundMin.X, layout.backgroundMax.Y + layout.recentGap };
+    return layout;
+}
+
+int OverlayLayout::BackgroundRight(int textWidth) const
+{
+    if (!input.autoWidth) {
+        return backgroundMax.X;
+    }
+    return (std::min)(backgroundMax.X, textX + textWidth + padding);
+}
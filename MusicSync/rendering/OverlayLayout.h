@@ -0,0 +1,71 @@
+#pragma once
+#include "pch.h"
+#include "DrawTarget.h"
+
+// Everything the overlay layout depends on. A frame only recomputes the layout
+// when one of these differs from what the current layout was built from.
+struct OverlayLayoutInput {
+    int screenWidth = 0;
+    int screenHeight = 0;
+    float scale = 1.0f;
+    float xPercent = 0.0f;
+    float yPercent = 0.0f;
+    bool showCover = true;
+    bool showProgress = true;
+    bool coverBackdrop = false; // Background is the blurred cover where there is one
+    int coverWidth = 0;  // Texture size, 0 when there is no loaded cover
+    int coverHeight = 0;
+    int lineCount = 0;
+    bool autoWidth = false; // Shrink the background to the measured text
+    bool marquee = false;   // Overflowing lines scroll instead of being cut
+    bool composited = false; // Drawn as one texture composed on a worker thread
+    int panelRadius = 0;     // Panel skin at scale 1, all 0 for the plain background
+    int panelShadow = 0;
+    int panelOutline = 0;
+    int recentCount = 0;     // Covers in the recent tracks strip, 0 for none
+    OverlayBackend backend = OverlayBackend::Canvas;
+    LinearColor textColor{ 255, 255, 255, 255 };
+    LinearColor backgroundColor{ 0, 0, 0, 255 };
+    int backgroundOpacity = 100;
+    LinearColor outlineColor{ 255, 255, 255, 96 };
+
+    bool HasPanelSkin() const { return panelRadius > 0 || panelShadow > 0 || panelOutline > 0; }
+    bool operator==(const OverlayLayoutInput& other) const;
+    bool operator!=(const OverlayLayoutInput& other) const { return !(*this == other); }
+};
+
+// Resolved positions and sizes of every overlay element, in screen pixels.
+// Immutable once computed, the render path only reads it.
+struct OverlayLayout {
+    OverlayLayoutInput input;
+
+    Vector2 backgroundMin{ 0, 0 };
+    Vector2 backgroundMax{ 0, 0 };
+
+    bool drawCover = false;
+    Vector2 coverPosition{ 0, 0 };
+    float coverScale = 1.0f;
+
+    int padding = 0;
+    int cornerRadius = 0; // Of the background, 0 where it is drawn square
+    int textX = 0;
+    int textMaxWidth = 0; // Lines are fitted to this, the background is sized for it
+    int firstLineY = 0;
+    int lineHeight = 0;
+    float fontSize = 1.0f;
+
+    bool drawProgress = false;
+    Vector2 progressMin{ 0, 0 }; // Track, the filled part grows from progressMin.X
+    Vector2 progressMax{ 0, 0 };
+
+    bool drawRecent = false;
+    Vector2 recentMin{ 0, 0 }; // Top left of the strip, under the background
+    int recentSize = 0;        // Edge of a thumbnail
+    int recentGap = 0;
+
+    static OverlayLayout Compute(const OverlayLayoutInput& input);
+
+    // Right edge of the background and progress bar for lines measured at
+    // textWidth. The full width unless the input asks for autoWidth.
+    int BackgroundRight(int textWidth) const;
+};
@@ -0,0 +1,280 @@
+#include "pch.h"
+#include "PanelSkin.h"
+#include "Compositor.h"
+#include "../imaging/Blur.h"
+#include "../imaging/BmpWriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    constexpr float shadowOpacity = 0.45f;
+
+    uint64_t Mix(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    struct Rect {
+        float x0, y0, x1, y1;
+        float radius;
+    };
+
+    // Anti-aliased coverage of a pixel by a rounded rectangle, from the signed
+    // distance of its center to the edge
+    float Coverage(const Rect& rect, int x, int y)
+    {
+        float halfWidth = (rect.x1 - rect.x0) / 2.0f;
+        float halfHeight = (rect.y1 - rect.y0) / 2.0f;
+        float radius = (std::min)({ rect.radius, halfWidth, halfHeight });
+        float qx = std::abs(x + 0.5f - (rect.x0 + halfWidth)) - (halfWidth - radius);
+        float qy = std::abs(y + 0.5f - (rect.y0 + halfHeight)) - (halfHeight - radius);
+        float outside = std::hypot((std::max)(qx, 0.0f), (std::max)(qy, 0.0f));
+        float distance = outside + (std::min)((std::max)(qx, qy), 0.0f) - radius;
+        return std::clamp(0.5f - distance, 0.0f, 1.0f);
+    }
+
+    uint8_t ToCoverage(float value)
+    {
+        return static_cast<uint8_t>(value * 255.0f + 0.5f);
+    }
+
+    void Premultiply(const uint8_t straight[4], uint8_t premultiplied[4])
+    {
+        for (int c = 0; c < 3; ++c) {
+            premultiplied[c] = static_cast<uint8_t>((straight[c] * straight[3] + 127) / 255);
+        }
+        premultiplied[3] = straight[3];
+    }
+
+    std::filesystem::path SkinPath(const std::filesystem::path& directory, const PanelStyle& style)
+    {
+        char name[40];
+        snprintf(name, sizeof(name), "panel_%016llx.bmp", static_cast<unsigned long long>(style.Hash()));
+        return directory / name;
+    }
+}
+
+uint64_t PanelStyle::Hash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = Mix(hash, &radius, sizeof(radius));
+    hash = Mix(hash, &shadow, sizeof(shadow));
+    hash = Mix(hash, &outline, sizeof(outline));
+    hash = Mix(hash, fill, sizeof(fill));
+    return Mix(hash, outlineColor, sizeof(outlineColor));
+}
+
+// The shadow is the panel moved down by a third of its size and blurred. A
+// corner has to hold everything that changes along the edges: the margin, the
+// blur spreading inwards from the shadow's edge and the corner arc.
+PanelSkin PanelSkinGeometry(const PanelStyle& style)
+{
+    int offset = style.shadow / 3;
+    PanelSkin skin;
+    skin.margin = style.shadow + offset;
+    skin.corner = skin.margin + style.shadow + offset + (std::max)(style.radius, style.outline);
+    skin.size = skin.corner * 2 + panelSkinCenter;
+    return skin;
+}
+
+PanelSkin BuildPanelSkin(const PanelStyle& style)
+{
+    PanelSkin skin = PanelSkinGeometry(style);
+    int size = skin.size;
+    size_t pixels = static_cast<size_t>(size) * size;
+    float near = static_cast<float>(skin.margin);
+    float far = static_cast<float>(size - skin.margin);
+    Rect panel{ near, near, far, far, static_cast<float>(style.radius) };
+
+    std::vector<uint8_t> panelCoverage(pixels);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            panelCoverage[static_cast<size_t>(y) * size + x] = ToCoverage(Coverage(panel, x, y));
+        }
+    }
+
+    // Black shadow under the panel, cut out where the panel is so a translucent
+    // fill does not darken
+    Bitmap bitmap;
+    bitmap.Reset(size, size);
+    if (style.shadow > 0) {
+        float offset = static_cast<float>(style.shadow / 3);
+        Rect shadow{ near, near + offset, far, far + offset, static_cast<float>(style.radius) };
+        std::vector<uint8_t> shadowPixels(pixels * 4, 0);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                shadowPixels[(static_cast<size_t>(y) * size + x) * 4 + 3] = ToCoverage(Coverage(shadow, x, y) * shadowOpacity);
+            }
+        }
+        BlurGaussian(shadowPixels.data(), size, size, style.shadow / 3.0f);
+        for (size_t i = 0; i < pixels; ++i) {
+            bitmap.pixels[i * 4 + 3] = static_cast<uint8_t>((shadowPixels[i * 4 + 3] * (255 - panelCoverage[i]) + 127) / 255);
+        }
+    }
+
+    uint8_t fill[4];
+    Premultiply(style.fill, fill);
+    for (int y = 0; y < size; ++y) {
+        BlendCoverage(bitmap.Row(y), panelCoverage.data() + static_cast<size_t>(y) * size, fill, size);
+    }
+
+    // Ring between the panel edge and the panel inset by the width
+    if (style.outline > 0) {
+        float inset = static_cast<float>(style.outline);
+        Rect inner{ near + inset, near + inset, far - inset, far - inset, static_cast<float>((std::max)(style.radius - style.outline, 0)) };
+        uint8_t color[4];
+        Premultiply(style.outlineColor, color);
+        std::vector<uint8_t> ring(size);
+        for (int y = 0; y < size; ++y) {
+            const uint8_t* outer = panelCoverage.data() + static_cast<size_t>(y) * size;
+            for (int x = 0; x < size; ++x) {
+                ring[x] = static_cast<uint8_t>((std::max)(0, outer[x] - ToCoverage(Coverage(inner, x, y))));
+            }
+            BlendCoverage(bitmap.Row(y), ring.data(), color, size);
+        }
+    }
+
+    Unpremultiply(bitmap, skin.rgba);
+    return skin;
+}
+
+size_t SlicePanel(const PanelSkin& skin, Vector2 min, Vector2 max, std::array<PanelSlice, 9>& slices)
+{
+    if (skin.size <= 0) {
+        return 0;
+    }
+
+    // Panels smaller than two corners show less of each corner
+    Vector2 outerMin{ min.X - skin.margin, min.Y - skin.margin };
+    Vector2 outerMax{ max.X + skin.margin, max.Y + skin.margin };
+    int cornerX = (std::min)(skin.corner, (outerMax.X - outerMin.X) / 2);
+    int cornerY = (std::min)(skin.corner, (outerMax.Y - outerMin.Y) / 2);
+    int xs[4] = { outerMin.X, outerMin.X + cornerX, outerMax.X - cornerX, outerMax.X };
+    int ys[4] = { outerMin.Y, outerMin.Y + cornerY, outerMax.Y - cornerY, outerMax.Y };
+
+    // The stretched middle samples only its own texel centers, so filtering
+    // never pulls in a neighbouring slice
+    float size = static_cast<float>(skin.size);
+    float middle0 = (skin.corner + 0.5f) / size;
+    float middle1 = (skin.corner + panelSkinCenter - 0.5f) / size;
+    float us[4] = { 0.0f, cornerX / size, (skin.size - cornerX) / size, 1.0f };
+    float vs[4] = { 0.0f, cornerY / size, (skin.size - cornerY) / size, 1.0f };
+    float u0[3] = { us[0], middle0, us[2] };
+    float u1[3] = { us[1], middle1, us[3] };
+    float v0[3] = { vs[0], middle0, vs[2] };
+    float v1[3] = { vs[1], middle1, vs[3] };
+
+    size_t count = 0;
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            if (xs[column + 1] <= xs[column] || ys[row + 1] <= ys[row]) {
+                continue;
+            }
+            PanelSlice& slice = slices[count++];
+            slice.min = Vector2{ xs[column], ys[row] };
+            slice.max = Vector2{ xs[column + 1], ys[row + 1] };
+            slice.uv0 = Vector2F{ u0[column], v0[row] };
+            slice.uv1 = Vector2F{ u1[column], v1[row] };
+        }
+    }
+    return count;
+}
+
+PanelSkinBuilder::PanelSkinBuilder(std::filesystem::path stagingDirectory)
+    : stagingDirectory(std::move(stagingDirectory))
+{
+    std::error_code ec;
+    std::filesystem::create_directories(this->stagingDirectory, ec);
+    worker = std::thread(&PanelSkinBuilder::Run, this);
+}
+
+PanelSkinBuilder::~PanelSkinBuilder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void PanelSkinBuilder::Submit(const PanelStyle& style)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = style;
+    }
+    wake.notify_one();
+}
+
+bool PanelSkinBuilder::TakeResult(Result& result)
+{
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock() || !ready) {
+        return false;
+    }
+    result = std::move(*ready);
+    ready.reset();
+    taken[1] = taken[0];
+    taken[0] = result.texturePath;
+    return true;
+}
+
+void PanelSkinBuilder::Run()
+{
+    while (true) {
+        PanelStyle style;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending.has_value(); });
+            if (stopping) {
+                return;
+            }
+            style = *pending;
+            pending.reset();
+        }
+
+        Result result;
+        result.style = style;
+        result.skin = PanelSkinGeometry(style);
+        result.texturePath = SkinPath(stagingDirectory, style);
+
+        std::error_code ec;
+        bool staged = std::filesystem::file_size(result.texturePath, ec) == BmpFileSize(result.skin.size, result.skin.size);
+        if (!staged) {
+            auto start = std::chrono::steady_clock::now();
+            PanelSkin skin = BuildPanelSkin(style);
+            staged = WriteBmp(result.texturePath, skin.rgba.data(), skin.size, skin.size);
+            result.buildMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (staged && !pending) {
+            RemoveStale(result.texturePath);
+            ready = std::move(result);
+        }
+    }
+}
+
+// Worker, with the mutex held so taken does not change underneath
+void PanelSkinBuilder::RemoveStale(const std::filesystem::path& keep)
+{
+    std::error_code ec;
+    for (const auto& file : std::filesystem::directory_iterator(stagingDirectory, ec)) {
+        const std::filesystem::path& path = file.path();
+        std::string name = path.filename().string();
+        if (name.rfind("panel_", 0) == 0 && path != keep && path != taken[0] && path != taken[1]) {
+            std::filesystem::remove(path, ec);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "pch.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// How the overlay background is drawn, in screen pixels at the current scale
+struct PanelStyle {
+    int radius = 0;
+    int shadow = 0;  // Blur extent of the drop shadow, 0 for none
+    int outline = 0; // Width, drawn inside the edge
+    uint8_t fill[4] = { 0, 0, 0, 255 };         // Straight alpha, 0 alpha leaves the panel to a backdrop
+    uint8_t outlineColor[4] = { 255, 255, 255, 255 };
+
+    bool operator==(const PanelStyle& other) const = default;
+    uint64_t Hash() const;
+};
+
+// A square 9-slice texture of the panel: four corners of `corner` pixels and
+// edges and a center of panelSkinCenter pixels that are stretched. It reaches
+// `margin` pixels past the panel on every side for the shadow.
+struct PanelSkin {
+    int corner = 0;
+    int margin = 0;
+    int size = 0;
+    std::vector<uint8_t> rgba; // Straight alpha, empty for PanelSkinGeometry
+};
+
+constexpr int panelSkinCenter = 2;
+
+PanelSkin PanelSkinGeometry(const PanelStyle& style);
+// Pure CPU work, meant for a worker thread
+PanelSkin BuildPanelSkin(const PanelStyle& style);
+
+struct PanelSlice {
+    Vector2 min{ 0, 0 };
+    Vector2 max{ 0, 0 };
+    Vector2F uv0{ 0.0f, 0.0f };
+    Vector2F uv1{ 1.0f, 1.0f };
+};
+
+// The quads that draw the skin around a panel from min to max, at most nine.
+// Returns how many were filled in, slices of zero size are left out.
+size_t SlicePanel(const PanelSkin& skin, Vector2 min, Vector2 max, std::array<PanelSlice, 9>& slices);
+
+// Builds panel skins on its own thread and stages them as BMPs for the canvas,
+// named by their style so a style seen in an earlier session loads without a
+// rebuild. Only the newest request is built. Staged skins other than the two
+// last taken are deleted when a new one is written.
+class PanelSkinBuilder
+{
+public:
+    struct Result {
+        PanelStyle style;
+        PanelSkin skin; // Without pixels
+        std::filesystem::path texturePath;
+        uint64_t buildMicros = 0; // 0 when it was staged already
+    };
+
+    explicit PanelSkinBuilder(std::filesystem::path stagingDirectory);
+    ~PanelSkinBuilder();
+    PanelSkinBuilder(const PanelSkinBuilder&) = delete;
+    PanelSkinBuilder& operator=(const PanelSkinBuilder&) = delete;
+
+    // Render thread. Replaces a style that has not been started yet.
+    void Submit(const PanelStyle& style);
+
+    // Render thread, never blocks. True if a new result was taken.
+    bool TakeResult(Result& result);
+
+private:
+    void Run();
+    void RemoveStale(const std::filesystem::path& keep);
+
+    std::filesystem::path stagingDirectory;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::optional<PanelStyle> pending;
+    std::optional<Result> ready;
+    std::array<std::filesystem::path, 2> taken; // Newest first
+    std::thread worker;
+};
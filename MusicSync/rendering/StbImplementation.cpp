@@ -0,0 +1,9 @@
+#include "pch.h"
+
+// The stb libraries vendored with ImGui are compiled static into imgui_draw.cpp,
+// so the overlay compiles its own copy here for the rest of the plugin. Rect
+// pack comes first so stb_truetype uses it instead of its fallback packer.
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "../IMGUI/imstb_rectpack.h"
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "../IMGUI/imstb_truetype.h"
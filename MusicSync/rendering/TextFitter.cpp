@@ -0,0 +1,261 @@
+#include "pch.h"
+#include "TextFitter.h"
+
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+size_t DecodeUtf8(std::string_view text, size_t offset, char32_t& codePoint)
+{
+    unsigned char lead = static_cast<unsigned char>(text[offset]);
+    size_t length;
+    char32_t minimum;
+    if (lead < 0x80) {
+        codePoint = lead;
+        return 1;
+    }
+    else if ((lead & 0xE0) == 0xC0) {
+        length = 2;
+        minimum = 0x80;
+        codePoint = lead & 0x1F;
+    }
+    else if ((lead & 0xF0) == 0xE0) {
+        length = 3;
+        minimum = 0x800;
+        codePoint = lead & 0x0F;
+    }
+    else if ((lead & 0xF8) == 0xF0) {
+        length = 4;
+        minimum = 0x10000;
+        codePoint = lead & 0x07;
+    }
+    else {
+        return 0;
+    }
+
+    if (offset + length > text.size()) {
+        return 0;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        unsigned char next = static_cast<unsigned char>(text[offset + i]);
+        if ((next & 0xC0) != 0x80) {
+            return 0;
+        }
+        codePoint = (codePoint << 6) | (next & 0x3F);
+    }
+
+    // Overlong forms, surrogates and values past the last plane are not valid
+    if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        return 0;
+    }
+    return length;
+}
+
+namespace {
+    // Code points that attach to the one before them. Combining marks of the
+    // scripts song metadata commonly uses, Hangul vowel and final jamo, ZWNJ,
+    // variation selectors, skin tone modifiers and emoji tags. Sorted.
+    constexpr std::pair<char32_t, char32_t> extendRanges[] = {
+        { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+        { 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+        { 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+        { 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0900, 0x0903 }, { 0x093A, 0x093C },
+        { 0x093E, 0x094F }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 }, { 0x0981, 0x0983 },
+        { 0x09BC, 0x09BC }, { 0x09BE, 0x09CD }, { 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A },
+        { 0x0E47, 0x0E4E }, { 0x1160, 0x11FF }, { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF },
+        { 0x200C, 0x200C }, { 0x20D0, 0x20FF }, { 0x302A, 0x302F }, { 0x3099, 0x309A },
+        { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0x1F3FB, 0x1F3FF }, { 0xE0020, 0xE007F },
+        { 0xE0100, 0xE01EF },
+    };
+
+    bool IsExtend(char32_t codePoint)
+    {
+        size_t low = 0;
+        size_t high = std::size(extendRanges);
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (codePoint < extendRanges[mid].first) {
+                high = mid;
+            }
+            else if (codePoint > extendRanges[mid].second) {
+                low = mid + 1;
+            }
+            else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsRegionalIndicator(char32_t codePoint)
+    {
+        return codePoint >= 0x1F1E6 && codePoint <= 0x1F1FF;
+    }
+
+    constexpr char32_t zeroWidthJoiner = 0x200D;
+}
+
+size_t NextGrapheme(std::string_view text, size_t offset)
+{
+    if (offset >= text.size()) {
+        return text.size();
+    }
+
+    char32_t codePoint;
+    size_t length = DecodeUtf8(text, offset, codePoint);
+    if (length == 0) {
+        return offset + 1;
+    }
+    size_t end = offset + length;
+
+    if (codePoint == '\r' && end < text.size() && text[end] == '\n') {
+        return end + 1;
+    }
+
+    // Flags are pairs of regional indicators
+    char32_t next;
+    if (IsRegionalIndicator(codePoint) && end < text.size()) {
+        size_t nextLength = DecodeUtf8(text, end, next);
+        if (nextLength != 0 && IsRegionalIndicator(next)) {
+            end += nextLength;
+        }
+    }
+
+    while (end < text.size()) {
+        size_t nextLength = DecodeUtf8(text, end, next);
+        if (nextLength == 0) {
+            break;
+        }
+        if (IsExtend(next)) {
+            end += nextLength;
+        }
+        else if (next == zeroWidthJoiner) {
+            // A joiner pulls in the code point after it, e.g. the parts of a family emoji
+            end += nextLength;
+            if (end < text.size()) {
+                size_t joinedLength = DecodeUtf8(text, end, next);
+                if (joinedLength != 0 && next >= 0x20) {
+                    end += joinedLength;
+                }
+            }
+        }
+        else {
+            break;
+        }
+    }
+    return end;
+}
+
+std::string SanitizeUtf8(std::string_view text)
+{
+    std::string result;
+    result.reserve(text.size());
+    size_t offset = 0;
+    while (offset < text.size()) {
+        char32_t codePoint;
+        size_t length = DecodeUtf8(text, offset, codePoint);
+        if (length == 0) {
+            result.push_back('?');
+            offset++;
+        }
+        else {
+            result.append(text.substr(offset, length));
+            offset += length;
+        }
+    }
+    return result;
+}
+
+size_t TextFitter::KeyHash::operator()(const Key& key) const
+{
+    uint32_t scaleBits;
+    std::memcpy(&scaleBits, &key.scale, sizeof(scaleBits));
+    return std::hash<std::string>{}(key.text) ^ (static_cast<size_t>(scaleBits) * 0x9E3779B97F4A7C15ull);
+}
+
+TextFitter::TextFitter(TextWidthOracle oracle)
+    : oracle(std::move(oracle))
+{
+}
+
+float TextFitter::Measure(const std::string& text, float scale)
+{
+    if (text.empty()) {
+        return 0.0f;
+    }
+
+    Key key{ text, scale };
+    auto it = widths.find(key);
+    if (it != widths.end()) {
+        cacheHits++;
+        return it->second;
+    }
+
+    // Entries are a few dozen bytes and only a handful are used per track,
+    // starting over is cheaper than tracking recency
+    if (widths.size() >= maxEntries) {
+        widths.clear();
+    }
+    float width = oracle ? oracle(text, scale) : 0.0f;
+    measurements++;
+    widths.emplace(std::move(key), width);
+    return width;
+}
+
+std::string TextFitter::Fit(std::string_view text, float scale, float maxWidth, std::string_view ellipsis)
+{
+    std::string clean = SanitizeUtf8(text);
+    if (Measure(clean, scale) <= maxWidth) {
+        return clean;
+    }
+
+    std::vector<size_t> graphemeEnds;
+    for (size_t offset = 0; offset < clean.size();) {
+        offset = NextGrapheme(clean, offset);
+        graphemeEnds.push_back(offset);
+    }
+
+    auto candidate = [&](size_t graphemes) {
+        size_t end = graphemes > 0 ? graphemeEnds[graphemes - 1] : 0;
+        while (end > 0 && clean[end - 1] == ' ') {
+            end--;
+        }
+        std::string cut = clean.substr(0, end);
+        cut.append(ellipsis);
+        return cut;
+    };
+
+    std::string shortest = candidate(0);
+    if (Measure(shortest, scale) > maxWidth) {
+        return {};
+    }
+
+    // Widths grow with the prefix, so the longest prefix that fits is found in
+    // O(log n) measurements. The whole text is already known not to fit.
+    size_t low = 0;
+    size_t high = graphemeEnds.size() - 1;
+    while (low < high) {
+        size_t mid = (low + high + 1) / 2;
+        if (Measure(candidate(mid), scale) <= maxWidth) {
+            low = mid;
+        }
+        else {
+            high = mid - 1;
+        }
+    }
+    return low > 0 ? candidate(low) : shortest;
+}
+
+void TextFitter::Clear()
+{
+    widths.clear();
+}
+
+TextFitterStats TextFitter::GetStats() const
+{
+    TextFitterStats stats;
+    stats.measurements = measurements;
+    stats.cacheHits = cacheHits;
+    stats.entries = widths.size();
+    return stats;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Width in pixels of a string drawn at the given font scale. The overlay
+// measures through the canvas, anything else can plug in its own metrics.
+using TextWidthOracle = std::function<float(const std::string& text, float scale)>;
+
+// Length of the UTF-8 sequence at offset and its code point, 0 if the bytes
+// there are not valid UTF-8
+size_t DecodeUtf8(std::string_view text, size_t offset, char32_t& codePoint);
+
+// Splits valid UTF-8 into user-perceived characters, so a cut never lands
+// inside a multi-byte sequence, between a letter and its combining marks or
+// inside an emoji sequence. This is a subset of UAX #29: combining marks,
+// variation selectors, ZWJ sequences, skin tone modifiers, tag sequences and
+// flag pairs are kept together. Returns the byte offset after the grapheme at
+// `offset`.
+size_t NextGrapheme(std::string_view text, size_t offset);
+
+// Replaces bytes that are not part of valid UTF-8 with '?'
+std::string SanitizeUtf8(std::string_view text);
+
+struct TextFitterStats {
+    uint64_t measurements = 0; // Oracle calls
+    uint64_t cacheHits = 0;
+    size_t entries = 0;
+};
+
+// Cuts text to a pixel width at grapheme boundaries and appends an ellipsis.
+// Widths are cached per (string, scale), so fitting the same track again or
+// refitting after a layout change with an unchanged scale costs no
+// measurements. Not thread safe, the overlay only uses it on the game thread.
+class TextFitter
+{
+public:
+    static constexpr size_t maxEntries = 1024;
+
+    explicit TextFitter(TextWidthOracle oracle);
+
+    float Measure(const std::string& text, float scale);
+
+    // Whole text if it fits, otherwise the longest grapheme prefix that fits
+    // together with the ellipsis. Trailing spaces before the ellipsis are
+    // dropped. Can return just the ellipsis, or nothing if even that is too wide.
+    std::string Fit(std::string_view text, float scale, float maxWidth, std::string_view ellipsis = "...");
+
+    void Clear();
+    TextFitterStats GetStats() const;
+
+private:
+    struct Key {
+        std::string text;
+        float scale;
+        bool operator==(const Key& other) const { return scale == other.scale && text == other.text; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    TextWidthOracle oracle;
+    std::unordered_map<Key, float, KeyHash> widths;
+    uint64_t measurements = 0;
+    uint64_t cacheHits = 0;
+};
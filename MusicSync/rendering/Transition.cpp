@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "Transition.h"
+
+void Transition::Start(TransitionStyle style, uint64_t nowNanos, float slideDistance)
+{
+    for (AnimationTrack& track : tracks) {
+        track.Clear();
+    }
+
+    constexpr float end = durationSeconds;
+    constexpr float half = durationSeconds / 2.0f;
+
+    // Every style fades, the outgoing content is gone by half time so the two never read on top of each other
+    tracks[OutAlpha].Add(0.0f, 1.0f);
+    tracks[OutAlpha].Add(half, 0.0f, Easing::InOutCubic);
+    tracks[InAlpha].Add(0.0f, 0.0f);
+    tracks[InAlpha].Add(end, 1.0f, Easing::InOutCubic);
+    tracks[OutOffset].Add(0.0f, 0.0f);
+    tracks[InOffset].Add(0.0f, 0.0f);
+    tracks[OutScale].Add(0.0f, 1.0f);
+    tracks[InScale].Add(0.0f, 1.0f);
+
+    switch (style) {
+    case TransitionStyle::Slide:
+        tracks[OutOffset].Add(half, -slideDistance, Easing::OutCubic);
+        tracks[InOffset].Clear();
+        tracks[InOffset].Add(0.0f, slideDistance);
+        tracks[InOffset].Add(end, 0.0f, Easing::OutCubic);
+        break;
+    case TransitionStyle::Scale:
+        tracks[OutScale].Add(half, 0.85f, Easing::OutCubic);
+        tracks[InScale].Clear();
+        tracks[InScale].Add(0.0f, 0.85f);
+        tracks[InScale].Add(end, 1.0f, Easing::OutBack);
+        break;
+    default:
+        break;
+    }
+
+    startNanos = nowNanos;
+    running = style != TransitionStyle::None;
+}
+
+bool Transition::Active(uint64_t nowNanos) const
+{
+    return running && nowNanos < startNanos + static_cast<uint64_t>(durationSeconds * 1e9f);
+}
+
+TransitionFrame Transition::Evaluate(uint64_t nowNanos, Vector2 origin) const
+{
+    float time = nowNanos > startNanos ? static_cast<float>(static_cast<double>(nowNanos - startNanos) / 1e9) : 0.0f;
+
+    TransitionFrame frame;
+    frame.outgoing.origin = origin;
+    frame.outgoing.alpha = tracks[OutAlpha].Evaluate(time);
+    frame.outgoing.offsetX = tracks[OutOffset].Evaluate(time);
+    frame.outgoing.scale = tracks[OutScale].Evaluate(time);
+    frame.incoming.origin = origin;
+    frame.incoming.alpha = tracks[InAlpha].Evaluate(time);
+    frame.incoming.offsetX = tracks[InOffset].Evaluate(time);
+    frame.incoming.scale = tracks[InScale].Evaluate(time);
+    return frame;
+}
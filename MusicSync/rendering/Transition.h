@@ -0,0 +1,47 @@
+#pragma once
+#include "Animation.h"
+#include "DrawList.h"
+
+enum class TransitionStyle : uint8_t {
+    None,
+    CrossFade,
+    Slide,
+    Scale
+};
+
+struct TransitionFrame {
+    DrawTransform outgoing;
+    DrawTransform incoming;
+};
+
+// Animates the overlay content from the outgoing to the incoming track. All
+// channels are fixed-capacity AnimationTracks, so starting a transition on
+// the render thread does not allocate.
+class Transition
+{
+public:
+    static constexpr float durationSeconds = 0.45f;
+
+    // slideDistance is in pixels, the overlay passes it already scaled
+    void Start(TransitionStyle style, uint64_t nowNanos, float slideDistance);
+    void Stop() { running = false; }
+    bool Active(uint64_t nowNanos) const;
+
+    // Transforms around origin, the center of the overlay
+    TransitionFrame Evaluate(uint64_t nowNanos, Vector2 origin) const;
+
+private:
+    enum Channel : size_t {
+        OutAlpha,
+        OutOffset,
+        OutScale,
+        InAlpha,
+        InOffset,
+        InScale,
+        ChannelCount
+    };
+
+    std::array<AnimationTrack, ChannelCount> tracks;
+    uint64_t startNanos = 0;
+    bool running = false;
+};
@@ -0,0 +1,84 @@
+#include "Bench.h"
+#include "CountingDrawTarget.h"
+#include "SimdLevels.h"
+#include "imaging/Blur.h"
+#include "imaging/Resampler.h"
+#include "rendering/DrawList.h"
+
+#include <cstdio>
+#include <vector>
+
+// Blurs a cover-sized image and the small mip the pipeline actually blurs with
+// every kernel, which must agree, then replays an overlay's draw list with the
+// backdrop and with the flat background and compares what a frame costs
+BENCH(Backdrop)
+{
+	constexpr int size = 544;
+	std::vector<uint8_t> source(static_cast<size_t>(size) * size * 4);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			uint8_t* pixel = &source[(static_cast<size_t>(y) * size + x) * 4];
+			pixel[0] = static_cast<uint8_t>(x * 255 / size);
+			pixel[1] = static_cast<uint8_t>(y * 255 / size);
+			pixel[2] = static_cast<uint8_t>(((x / 32 + y / 32) % 2) * 255);
+			pixel[3] = 255;
+		}
+	}
+	std::vector<uint8_t> mip(static_cast<size_t>(size / 2) * (size / 2) * 4);
+	std::vector<uint8_t> small(static_cast<size_t>(size / 4) * (size / 4) * 4);
+	DownsampleBox(source.data(), size, size, mip.data());
+	DownsampleBox(mip.data(), size / 2, size / 2, small.data());
+
+	std::vector<uint8_t> reference[2];
+	std::vector<uint8_t> pixels;
+	for (SimdLevel kernel : SupportedSimdLevels()) {
+		double micros[2] = {};
+		bool same = true;
+		for (int i = 0; i < 2; ++i) {
+			const std::vector<uint8_t>& input = i == 0 ? source : small;
+			int side = i == 0 ? size : size / 4;
+			micros[i] = bench::MedianMicros(10, [&] {
+				pixels = input;
+				BlurGaussian(pixels.data(), side, side, side * 0.1f, kernel);
+			});
+			if (reference[i].empty()) {
+				reference[i] = pixels;
+			}
+			same = same && pixels == reference[i];
+		}
+		std::printf("  blur %-6s %dx%d in %.0f us, downsampled %dx%d in %.0f us, %s\n", SimdLevelName(kernel), size, size,
+			micros[0], size / 4, size / 4, micros[1], same ? "same pixels as scalar" : "DIFFERS from scalar");
+	}
+
+	// The backdrop replaces the background rect with one tile of the blurred cover
+	ImageWrapper backdrop("backdrop.bmp", true);
+	ImageWrapper cover("cover.bmp", true);
+	const char* names[] = { "flat", "backdrop" };
+	for (int i = 0; i < 2; ++i) {
+		DrawList list;
+		list.SetColor(LinearColor{ 0, 0, 0, 150 });
+		if (i == 0) {
+			list.DrawRect(Vector2{ 100, 700 }, Vector2{ 750, 828 }, 10.0f);
+		}
+		else {
+			list.DrawTile(&backdrop, Vector2{ 100, 700 }, Vector2{ 750, 828 }, Vector2F{ 0.0f, 0.2f }, Vector2F{ 1.0f, 0.8f }, 10.0f);
+		}
+		list.MarkContent();
+		list.SetColor(LinearColor{ 255, 255, 255, 255 });
+		list.SetPosition(Vector2{ 120, 720 });
+		list.DrawTexture(&cover, 0.8f, 5.0f);
+		list.SetPosition(Vector2{ 240, 720 });
+		list.DrawString("Title: A title", 2.0f, 2.0f);
+		list.DrawProgress(Vector2{ 110, 824 }, Vector2{ 740, 828 }, LinearColor{ 80, 80, 80, 255 }, LinearColor{ 255, 255, 255, 255 });
+
+		constexpr int replays = 1000;
+		CountingDrawTarget target;
+		double micros = bench::MedianMicros(5, [&] {
+			for (int run = 0; run < replays; ++run) {
+				list.Replay(target, 0.5f, 0);
+			}
+		});
+		std::printf("  %-8s %zu commands, %.1f draw calls, %.0f ns a frame\n", names[i], list.Size(),
+			static_cast<double>(target.DrawCalls()) / (replays * 5), micros * 1000.0 / replays);
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// The benchmarks of the portable modules, registered like the tests. BENCH
+// registers a benchmark, musicsync_bench runs the ones named on its command
+// line, or all of them. Each prints its own results.
+namespace bench {
+	using BenchFunction = void (*)();
+
+	struct Registrar {
+		Registrar(const char* name, BenchFunction run);
+	};
+
+	// Keeps the compiler from dropping work whose result is not used otherwise
+	template <typename T>
+	void Keep(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r"(&value) : "memory");
+#else
+		static const volatile void* sink;
+		sink = &value;
+#endif
+	}
+
+	// Median of rounds runs of run, in microseconds
+	template <typename Run>
+	double MedianMicros(int rounds, Run&& run)
+	{
+		std::vector<double> micros;
+		for (int i = 0; i < rounds; ++i) {
+			auto start = std::chrono::steady_clock::now();
+			run();
+			micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(micros.begin(), micros.end());
+		return micros[micros.size() / 2];
+	}
+
+	// The value below which fraction of the samples lie, 0 for no samples
+	inline double Percentile(std::vector<double> samples, double fraction)
+	{
+		if (samples.empty()) {
+			return 0.0;
+		}
+		size_t index = (std::min)(static_cast<size_t>(fraction * samples.size()), samples.size() - 1);
+		std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+		return samples[index];
+	}
+}
+
+#define BENCH(name) \
+	static void Bench_##name(); \
+	static bench::Registrar Bench_##name##_registrar(#name, Bench_##name); \
+	static void Bench_##name()
@@ -0,0 +1,42 @@
+#include "Bench.h"
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Benchmark {
+		const char* name;
+		bench::BenchFunction run;
+	};
+
+	std::vector<Benchmark>& Benchmarks()
+	{
+		static std::vector<Benchmark> benchmarks;
+		return benchmarks;
+	}
+}
+
+bench::Registrar::Registrar(const char* name, BenchFunction run)
+{
+	Benchmarks().push_back({ name, run });
+}
+
+int main(int argc, char** argv)
+{
+	std::set<std::string> names(argv + 1, argv + argc);
+	int ran = 0;
+	for (const Benchmark& benchmark : Benchmarks()) {
+		if (!names.empty() && !names.contains(benchmark.name)) {
+			continue;
+		}
+		std::printf("%s\n", benchmark.name);
+		benchmark.run();
+		ran++;
+	}
+	if (ran == 0) {
+		std::printf("No benchmark matched\n");
+	}
+	return ran == 0 ? 1 : 0;
+}
@@ -0,0 +1,44 @@
+#include "Bench.h"
+#include "TestFonts.h"
+#include "rendering/Compositor.h"
+
+#include <cstdio>
+
+// Composing the overlay texture per kernel: the golden scene, which has no
+// text, and the overlay's own size with three lines in whichever font is found
+BENCH(Compositor)
+{
+	GlyphFont font;
+	if (!AddTestFont(font)) {
+		std::printf("  no font found, the lines are left out\n");
+	}
+
+	CompositorScene timed = GoldenScene();
+	timed.width = 650;
+	timed.height = 128;
+	const char* lines[] = { "Title: A title that is long enough to be cut by the overlay", "By: Artist", "From Album" };
+	for (int i = 0; i < 3; ++i) {
+		CompositorLine& line = timed.lines.emplace_back();
+		line.text = lines[i];
+		line.pixelHeight = 28.0f;
+		line.x = 90;
+		line.y = 8 + 38 * i;
+		line.maxWidth = 540;
+	}
+
+	Bitmap bitmap;
+	for (BlendKernel kernel : { BlendKernel::Scalar, BlendKernel::Sse2 }) {
+		if (kernel == BlendKernel::Sse2 && BestBlendKernel() != BlendKernel::Sse2) {
+			continue;
+		}
+		const char* name = kernel == BlendKernel::Sse2 ? "SSE2" : "scalar";
+		double golden = bench::MedianMicros(50, [&] { Compose(GoldenScene(), font, bitmap, kernel); });
+		bool matches = HashPixels(bitmap) == goldenSceneHash;
+		for (GlyphRendering mode : { GlyphRendering::Sdf, GlyphRendering::Outline }) {
+			font.SetRendering(mode);
+			double withText = bench::MedianMicros(50, [&] { Compose(timed, font, bitmap, kernel); });
+			std::printf("  %-6s golden %s in %.0f us, %dx%d with %s text in %.0f us\n", name, matches ? "matches" : "DIFFERS",
+				golden, timed.width, timed.height, mode == GlyphRendering::Sdf ? "SDF" : "outline", withText);
+		}
+	}
+}
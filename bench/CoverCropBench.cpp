@@ -0,0 +1,50 @@
+#include "Bench.h"
+#include "SimdLevels.h"
+#include "imaging/CoverImage.h"
+
+#include <cstdio>
+#include <vector>
+
+// Pillarboxed 4:3 frames inside 16:9 thumbnails, with the noise a JPEG leaves in
+// the bars. Every kernel has to find the same crop.
+BENCH(CoverCrop)
+{
+	struct Case {
+		const char* name;
+		int width;
+		int height;
+	};
+	const Case cases[] = {
+		{ "1280x720", 1280, 720 },
+		{ "3840x2160", 3840, 2160 },
+	};
+
+	for (const Case& test : cases) {
+		int bar = (test.width - test.height * 4 / 3) / 2;
+		std::vector<uint8_t> src(static_cast<size_t>(test.width) * test.height * 4);
+		for (int y = 0; y < test.height; ++y) {
+			for (int x = 0; x < test.width; ++x) {
+				uint8_t* pixel = &src[(static_cast<size_t>(y) * test.width + x) * 4];
+				bool inBar = x < bar || x >= test.width - bar;
+				uint8_t noise = static_cast<uint8_t>((x * 7 + y * 13) % 9);
+				pixel[0] = inBar ? noise : static_cast<uint8_t>(x * 255 / test.width);
+				pixel[1] = inBar ? noise : static_cast<uint8_t>(y * 255 / test.height);
+				pixel[2] = inBar ? noise : static_cast<uint8_t>(((x / 40 + y / 40) % 2) * 200);
+				pixel[3] = 255;
+			}
+		}
+		ImageRect expected = CenterCrop(ImageRect{ bar, 0, test.width - bar * 2, test.height }, coverAspect);
+
+		std::vector<uint8_t> dst;
+		for (SimdLevel kernel : SupportedSimdLevels()) {
+			ImageRect crop;
+			double findMicros = bench::MedianMicros(5, [&] {
+				crop = FindCoverCrop(src.data(), test.width, test.height, coverAspect, kernel);
+			});
+			dst.resize(static_cast<size_t>(crop.width) * crop.height * 4);
+			double copyMicros = bench::MedianMicros(5, [&] { CopyRect(src.data(), test.width, crop, dst.data()); });
+			std::printf("  %s %-6s found %dx%d at %d,%d in %.0f us, copied in %.0f us, %s\n", test.name, SimdLevelName(kernel),
+				crop.width, crop.height, crop.x, crop.y, findMicros, copyMicros, crop == expected ? "as expected" : "WRONG");
+		}
+	}
+}
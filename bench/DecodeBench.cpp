@@ -0,0 +1,72 @@
+#include "Bench.h"
+#include "imaging/CoverDecoder.h"
+
+#include <winrt/base.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Real thumbnails in the folder named by MUSICSYNC_THUMBNAILS, or thumbnails in
+// the working directory, e.g. copies of the covers musicsync_export_cover wrote.
+// Each is decoded at full size and at the size the overlay draws covers at its
+// default scale.
+BENCH(Decode)
+{
+	const char* folderVariable = std::getenv("MUSICSYNC_THUMBNAILS");
+	std::filesystem::path folder = folderVariable ? folderVariable : "thumbnails";
+	std::vector<std::filesystem::path> files;
+	std::error_code ec;
+	for (const auto& file : std::filesystem::directory_iterator(folder, ec)) {
+		if (file.is_regular_file(ec)) {
+			files.push_back(file.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	if (files.empty()) {
+		std::printf("  no files in %s\n", folder.string().c_str());
+		return;
+	}
+
+	winrt::init_apartment();
+	int maxSize = static_cast<int>(std::ceil(coverDisplaySize));
+	struct Total {
+		double micros = 0;
+		size_t peakBytes = 0;
+	} totals[2];
+	for (const std::filesystem::path& path : files) {
+		std::ifstream file(path, std::ios::binary);
+		std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		ImageFormat format = SniffImageFormat(bytes.data(), bytes.size());
+
+		CoverImage decoded[2];
+		CoverDecodeStats stats[2];
+		double micros[2] = {};
+		bool ok = true;
+		for (int i = 0; i < 2; ++i) {
+			micros[i] = bench::MedianMicros(3, [&] {
+				ok = DecodeCover(bytes, format, i == 0 ? 0 : maxSize, decoded[i], &stats[i]) >= 0 && ok;
+			});
+		}
+		if (!ok) {
+			std::printf("  %s: not decodable\n", path.filename().string().c_str());
+			continue;
+		}
+		for (int i = 0; i < 2; ++i) {
+			totals[i].micros += micros[i];
+			totals[i].peakBytes = (std::max)(totals[i].peakBytes, stats[i].peakBytes);
+		}
+		std::printf("  %s (%s, %zu KB): full %dx%d in %.0f us, %zu KB; for %d px 1/%d %s %dx%d in %.0f us, %zu KB\n",
+			path.filename().string().c_str(), ImageFormatExtension(format), bytes.size() / 1024, decoded[0].width,
+			decoded[0].height, micros[0], stats[0].peakBytes / 1024, maxSize, stats[1].reduction,
+			stats[1].native ? "by the codec" : "scaled", decoded[1].width, decoded[1].height, micros[1], stats[1].peakBytes / 1024);
+	}
+	std::printf("  %zu files: full %.0f us, largest %zu KB; reduced %.0f us, largest %zu KB (pixel buffers, WIC's own not counted)\n",
+		files.size(), totals[0].micros, totals[0].peakBytes / 1024, totals[1].micros, totals[1].peakBytes / 1024);
+	winrt::uninit_apartment();
+}
@@ -0,0 +1,44 @@
+#include "Bench.h"
+#include "TestFonts.h"
+#include "rendering/DrawTarget.h"
+#include "rendering/GlyphFont.h"
+
+#include <cstdio>
+#include <string>
+
+// One SDF atlas for a track's lines against the bitmap atlases the same glyphs
+// need at every overlay scale, then the cost of drawing a line from each
+BENCH(GlyphAtlas)
+{
+	GlyphFont font;
+	if (!AddTestFont(font)) {
+		std::printf("  no font found\n");
+		return;
+	}
+
+	const std::string title = "Title: The quick brown fox jumps over the lazy dog";
+	const std::string text = title + "By: An Artist With A Long Name" + "From An Album Title (Deluxe Edition)";
+	font.PrepareSdf(text);
+	GlyphAtlasStats sdf = font.SdfStats();
+
+	// Same sizes the composited overlay uses across the scale slider
+	size_t bitmapBytes = 0;
+	uint64_t bitmapMicros = 0;
+	int sizes = 0;
+	for (float scale = 0.5f; scale <= 2.5f; scale += 0.25f) {
+		GlyphAtlasStats bitmap = font.BuildBitmapAtlas(text, canvasFontPixels * 2.0f * scale);
+		bitmapBytes += bitmap.bytes;
+		bitmapMicros += bitmap.buildMicros;
+		sizes++;
+	}
+	std::printf("  SDF %zu glyphs, %zu KB, %llu us; %d bitmap atlases %zu KB, %llu us\n", sdf.glyphs,
+		sdf.bytes / 1024, static_cast<unsigned long long>(sdf.buildMicros), sizes, bitmapBytes / 1024,
+		static_cast<unsigned long long>(bitmapMicros));
+
+	CoverageMask mask;
+	for (GlyphRendering mode : { GlyphRendering::Sdf, GlyphRendering::Outline }) {
+		font.SetRendering(mode);
+		double micros = bench::MedianMicros(20, [&] { font.Rasterize(title, canvasFontPixels * 2.0f * 2.5f, mask); });
+		std::printf("  %-7s line at scale 2.5 in %.0f us\n", mode == GlyphRendering::Sdf ? "SDF" : "outline", micros);
+	}
+}
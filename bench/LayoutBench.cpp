@@ -0,0 +1,48 @@
+#include "Bench.h"
+#include "rendering/OverlayLayout.h"
+
+#include <cstdio>
+
+// What a frame spends on the layout: computing it from its inputs every frame,
+// as the overlay used to, against comparing the inputs with those of the cached
+// layout, which is all a steady frame does now. The settings lookups the old
+// path also made need the game and are left out.
+BENCH(Layout)
+{
+	constexpr int frames = 100000;
+	OverlayLayoutInput input;
+	input.screenWidth = 1920;
+	input.screenHeight = 1080;
+	input.scale = 1.25f;
+	input.xPercent = 2.0f;
+	input.yPercent = 70.0f;
+	input.coverWidth = 136;
+	input.coverHeight = 136;
+	input.lineCount = 3;
+
+	int checksum = 0;
+	double computed = bench::MedianMicros(5, [&] {
+		for (int frame = 0; frame < frames; ++frame) {
+			OverlayLayoutInput current = input;
+			bench::Keep(current);
+			checksum += OverlayLayout::Compute(current).textX;
+		}
+	});
+
+	OverlayLayout cached = OverlayLayout::Compute(input);
+	int builds = 0;
+	double compared = bench::MedianMicros(5, [&] {
+		for (int frame = 0; frame < frames; ++frame) {
+			OverlayLayoutInput current = input;
+			bench::Keep(current);
+			if (current != cached.input) {
+				cached = OverlayLayout::Compute(current);
+				builds++;
+			}
+			checksum += cached.textX;
+		}
+	});
+
+	std::printf("  per frame: %.1f ns computed, %.1f ns compared with the cached layout, %d rebuilds (%s)\n",
+		computed * 1000.0 / frames, compared * 1000.0 / frames, builds, checksum != 0 ? "ok" : "empty");
+}
@@ -0,0 +1,34 @@
+#include "Bench.h"
+#include "rendering/Marquee.h"
+
+#include <cstdio>
+#include <string>
+
+// What a scrolling line costs a frame at 360 fps: turning the clock reading
+// into the window of graphemes to draw. Everything measured is done in Prepare.
+BENCH(Marquee)
+{
+	TextWidthOracle fixedAdvance = [](const std::string& text, float scale) {
+		size_t graphemes = 0;
+		for (size_t offset = 0; offset < text.size(); offset = NextGrapheme(text, offset)) {
+			graphemes++;
+		}
+		return graphemes * 9.0f * scale;
+	};
+	constexpr uint64_t second = 1'000'000'000;
+	constexpr uint64_t frames = 360 * 10;
+
+	Marquee marquee;
+	marquee.Prepare("Title: A title that is long enough to scroll through the overlay", 2.0f, 300.0f, fixedAdvance, 0);
+	size_t checksum = 0;
+	double micros = bench::MedianMicros(9, [&] {
+		for (uint64_t frame = 0; frame < frames; ++frame) {
+			checksum += marquee.At(frame * second / 360).text.size();
+		}
+	});
+	double prepareMicros = bench::MedianMicros(9, [&] {
+		marquee.Reset();
+		marquee.Prepare("Title: A title that is long enough to scroll through the overlay", 2.0f, 300.0f, fixedAdvance, 0);
+	});
+	std::printf("  %.1f ns per frame, prepared in %.1f us (%s)\n", micros * 1000.0 / frames, prepareMicros, checksum != 0 ? "ok" : "empty");
+}
@@ -0,0 +1,62 @@
+#include "Bench.h"
+#include "SimdLevels.h"
+#include "imaging/Palette.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// A flat disc on a gradient, the kind of cover median cut splits most. The
+// pipeline extracts from a mip of at most 64 pixels, the full cover size shows
+// what the histogram costs when it is the bulk of the work.
+BENCH(Palette)
+{
+	constexpr auto budget = std::chrono::milliseconds(2);
+
+	for (int size : { 64, 544 }) {
+		std::vector<uint8_t> src(static_cast<size_t>(size) * size * 4);
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				uint8_t* pixel = &src[(static_cast<size_t>(y) * size + x) * 4];
+				int dx = x - size / 2;
+				int dy = y - size / 2;
+				bool disc = dx * dx + dy * dy < size * size / 9;
+				pixel[0] = disc ? 220 : static_cast<uint8_t>(20 + x * 30 / size);
+				pixel[1] = disc ? 180 : 30;
+				pixel[2] = disc ? 40 : static_cast<uint8_t>(90 + y * 20 / size);
+				pixel[3] = 255;
+			}
+		}
+
+		std::vector<PaletteColor> reference;
+		for (SimdLevel kernel : SupportedSimdLevels()) {
+			std::vector<uint32_t> counts(static_cast<size_t>(paletteBins) * paletteLanes);
+			double histogramMicros = bench::MedianMicros(20, [&] {
+				PaletteHistogram(src.data(), static_cast<size_t>(size) * size, counts.data(), kernel);
+			});
+
+			std::vector<PaletteColor> palette;
+			bool inBudget = true;
+			double extractMicros = bench::MedianMicros(20, [&] {
+				inBudget = ExtractPalette(src.data(), size, size, 8, std::chrono::steady_clock::now() + budget, palette, kernel) && inBudget;
+			});
+
+			bool same = reference.empty() || (palette.size() == reference.size() &&
+				std::equal(palette.begin(), palette.end(), reference.begin(), [](const PaletteColor& a, const PaletteColor& b) {
+					return a.count == b.count && std::equal(a.rgb, a.rgb + 3, b.rgb);
+				}));
+			if (reference.empty()) {
+				reference = palette;
+			}
+			std::printf("  %dx%d %-6s histogram %.0f us, extraction %.0f us of a %lld us budget%s, %s\n", size, size,
+				SimdLevelName(kernel), histogramMicros, extractMicros, static_cast<long long>(budget.count() * 1000),
+				inBudget ? "" : " (OVER)", same ? "same palette as scalar" : "DIFFERS from scalar");
+		}
+
+		CoverTheme theme = PickTheme(reference);
+		std::printf("  %dx%d %zu colors, background (%d,%d,%d), text (%d,%d,%d), contrast %.1f\n", size, size, reference.size(),
+			theme.background[0], theme.background[1], theme.background[2], theme.text[0], theme.text[1], theme.text[2],
+			ContrastRatio(theme.background, theme.text));
+	}
+}
@@ -0,0 +1,88 @@
+#include "Bench.h"
+#include "CountingDrawTarget.h"
+#include "rendering/PanelSkin.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+	// Rounded rectangle as one rect per row of the corner arcs and one for the
+	// middle, how the canvas would have to draw it without a texture
+	void DrawRoundedRows(DrawTarget& target, Vector2 min, Vector2 max, int radius)
+	{
+		radius = (std::min)({ radius, (max.X - min.X) / 2, (max.Y - min.Y) / 2 });
+		for (int row = 0; row < radius; ++row) {
+			float dy = radius - row - 0.5f;
+			int inset = radius - static_cast<int>(std::lround(std::sqrt(radius * radius - dy * dy)));
+			target.DrawRect(Vector2{ min.X + inset, min.Y + row }, Vector2{ max.X - inset, min.Y + row + 1 }, 0.0f);
+			target.DrawRect(Vector2{ min.X + inset, max.Y - row - 1 }, Vector2{ max.X - inset, max.Y - row }, 0.0f);
+		}
+		target.DrawRect(Vector2{ min.X, min.Y + radius }, Vector2{ max.X, max.Y - radius }, 0.0f);
+	}
+
+	// The look of a panel skin from primitives: the shadow as one faint ring per
+	// pixel of its size, the outline and the fill on top
+	void DrawPanelPrimitives(DrawTarget& target, const PanelStyle& style, Vector2 min, Vector2 max)
+	{
+		int offset = style.shadow / 3;
+		for (int ring = style.shadow; ring > 0; --ring) {
+			target.SetColor(LinearColor{ 0, 0, 0, 115.0f / style.shadow });
+			DrawRoundedRows(target, Vector2{ min.X - ring, min.Y - ring + offset }, Vector2{ max.X + ring, max.Y + ring + offset },
+				style.radius + ring);
+		}
+		if (style.outline > 0) {
+			target.SetColor(LinearColor{ static_cast<float>(style.outlineColor[0]), static_cast<float>(style.outlineColor[1]),
+				static_cast<float>(style.outlineColor[2]), static_cast<float>(style.outlineColor[3]) });
+			DrawRoundedRows(target, min, max, style.radius);
+		}
+		target.SetColor(LinearColor{ static_cast<float>(style.fill[0]), static_cast<float>(style.fill[1]),
+			static_cast<float>(style.fill[2]), static_cast<float>(style.fill[3]) });
+		int inset = style.outline;
+		DrawRoundedRows(target, Vector2{ min.X + inset, min.Y + inset }, Vector2{ max.X - inset, max.Y - inset },
+			(std::max)(style.radius - inset, 0));
+	}
+}
+
+// Builds the skin of a sample panel style and compares drawing it as 9-slice
+// quads with drawing the same look from rects. Each canvas draw call is a
+// separate call into the game, far more than the bookkeeping timed here.
+BENCH(Panel)
+{
+	PanelStyle style;
+	style.radius = 10;
+	style.shadow = 12;
+	style.outline = 2;
+	style.fill[3] = 200;
+	style.outlineColor[3] = 96;
+	const Vector2 min{ 100, 100 };
+	const Vector2 max{ 500, 220 };
+
+	PanelSkin skin;
+	double buildMicros = bench::MedianMicros(10, [&] { skin = BuildPanelSkin(style); });
+	std::printf("  radius %d, shadow %d, outline %d: %dx%d skin built in %.0f us\n", style.radius, style.shadow, style.outline,
+		skin.size, skin.size, buildMicros);
+
+	constexpr int replays = 1000;
+	CountingDrawTarget sliced;
+	double slicedMicros = bench::MedianMicros(5, [&] {
+		for (int run = 0; run < replays; ++run) {
+			std::array<PanelSlice, 9> slices;
+			size_t count = SlicePanel(skin, min, max, slices);
+			sliced.SetColor(LinearColor{ 255, 255, 255, 255 });
+			for (size_t i = 0; i < count; ++i) {
+				sliced.DrawTile(nullptr, slices[i].min, slices[i].max, slices[i].uv0, slices[i].uv1, 0.0f);
+			}
+		}
+	});
+	CountingDrawTarget primitives;
+	double primitiveMicros = bench::MedianMicros(5, [&] {
+		for (int run = 0; run < replays; ++run) {
+			DrawPanelPrimitives(primitives, style, min, max);
+		}
+	});
+	std::printf("  per frame: 9-slice %llu draw calls (%.0f ns to issue), primitives %llu draw calls (%.0f ns to issue)\n",
+		static_cast<unsigned long long>(sliced.DrawCalls() / (replays * 5)), slicedMicros * 1000.0 / replays,
+		static_cast<unsigned long long>(primitives.DrawCalls() / (replays * 5)), primitiveMicros * 1000.0 / replays);
+}
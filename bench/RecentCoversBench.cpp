@@ -0,0 +1,71 @@
+#include "Bench.h"
+#include "CountingDrawTarget.h"
+#include "rendering/CoverAtlas.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Packs a full strip of stand-in covers at the default overlay scale and steps
+// one track change. The strip drawn from the atlas is then compared with one
+// texture per cover: draw calls, texture switches (ImGui batches) and the
+// bytes uploaded per track change.
+BENCH(RecentCovers)
+{
+	const int count = maxRecentCovers;
+	const int thumbSize = (std::max)(1, static_cast<int>(coverDisplaySize * 0.4f));
+	const int coverSize = static_cast<int>(coverDisplaySize);
+
+	// One more than the strip holds, the newest joins on the track change
+	std::vector<std::shared_ptr<const CoverImage>> covers;
+	for (int i = 0; i <= count; ++i) {
+		auto cover = std::make_shared<CoverImage>();
+		cover->width = coverSize;
+		cover->height = coverSize;
+		cover->rgba.assign(static_cast<size_t>(coverSize) * coverSize * 4, static_cast<uint8_t>(40 + i * 20));
+		cover->texturePath = "recent_bench_" + std::to_string(i);
+		covers.push_back(std::move(cover));
+	}
+
+	CoverAtlas atlas;
+	std::vector<std::shared_ptr<const CoverImage>> strip(covers.begin() + 1, covers.end());
+	atlas.Update(strip, thumbSize, count);
+	CoverAtlasStats built = atlas.GetStats();
+	strip.pop_back();
+	strip.insert(strip.begin(), covers.front());
+	atlas.Update(strip, thumbSize, count);
+	CoverAtlasStats changed = atlas.GetStats();
+	std::printf("  atlas: %d covers of %d px in %dx%d, built in %llu us\n", count, thumbSize, atlas.Width(), atlas.Height(),
+		static_cast<unsigned long long>(built.updateMicros));
+	std::printf("  track change: %llu us, %llu scaled, %llu kept, %llu evicted, %llu holes reused, %llu repacks\n",
+		static_cast<unsigned long long>(changed.updateMicros - built.updateMicros),
+		static_cast<unsigned long long>(changed.thumbnails - built.thumbnails), static_cast<unsigned long long>(changed.kept - built.kept),
+		static_cast<unsigned long long>(changed.evicted - built.evicted),
+		static_cast<unsigned long long>(changed.holesReused - built.holesReused),
+		static_cast<unsigned long long>(changed.repacks - built.repacks));
+
+	// Stand-in textures, the counting target only compares the pointers
+	std::vector<uint8_t> textures(count);
+	CountingDrawTarget separate;
+	for (int i = 0; i < count; ++i) {
+		separate.DrawTexture(reinterpret_cast<ImageWrapper*>(&textures[i]), 1.0f, 0.0f);
+	}
+	CountingDrawTarget atlased;
+	for (const CoverAtlasTile& tile : atlas.Tiles()) {
+		atlased.DrawTile(reinterpret_cast<ImageWrapper*>(textures.data()), Vector2{ 0, 0 }, Vector2{ tile.width, tile.height },
+			tile.uv0, tile.uv1, 0.0f);
+	}
+	std::printf("  per frame: atlas %llu draw calls in %llu batch, one texture per cover %llu draw calls in %llu batches\n",
+		static_cast<unsigned long long>(atlased.DrawCalls()), static_cast<unsigned long long>(atlased.TextureSwitches()),
+		static_cast<unsigned long long>(separate.DrawCalls()), static_cast<unsigned long long>(separate.TextureSwitches()));
+
+	// The atlas is uploaded whole, a texture per cover only the new thumbnail
+	size_t thumbBytes = static_cast<size_t>(thumbSize) * thumbSize * 4;
+	size_t coverBytes = static_cast<size_t>(coverSize) * coverSize * 4;
+	std::printf("  per track change: atlas uploads %zu KB (%zu KB resident, 1 texture); a thumbnail texture per cover uploads "
+		"%zu KB (%zu KB resident, %d textures); drawing the full covers uploads nothing new (%zu KB resident, %d textures)\n",
+		atlas.Pixels().size() / 1024, atlas.Pixels().size() / 1024, thumbBytes / 1024, thumbBytes * count / 1024, count,
+		coverBytes * count / 1024, count);
+}
@@ -0,0 +1,42 @@
+#include "Bench.h"
+#include "SimdLevels.h"
+#include "imaging/Resampler.h"
+
+#include <cstdio>
+#include <vector>
+
+// Throughput of every kernel this CPU supports on a large thumbnail shrunk to the
+// cover size and a small one enlarged for a scaled up overlay, in source MPix/s
+BENCH(Resampler)
+{
+	struct Case {
+		const char* name;
+		int srcSize;
+		int dstSize;
+	};
+	const Case cases[] = {
+		{ "1200 -> 109", 1200, 109 },
+		{ "300 -> 272", 300, 272 },
+	};
+
+	for (const Case& test : cases) {
+		std::vector<uint8_t> src(static_cast<size_t>(test.srcSize) * test.srcSize * 4);
+		for (size_t i = 0; i < src.size(); ++i) {
+			src[i] = static_cast<uint8_t>(i * 31 + (i >> 10));
+		}
+		std::vector<uint8_t> dst(static_cast<size_t>(test.dstSize) * test.dstSize * 4);
+		std::vector<uint8_t> reference;
+
+		for (SimdLevel kernel : SupportedSimdLevels()) {
+			double micros = bench::MedianMicros(5, [&] {
+				ResampleLanczos(src.data(), test.srcSize, test.srcSize, dst.data(), test.dstSize, test.dstSize, kernel);
+			});
+			if (reference.empty()) {
+				reference = dst;
+			}
+			double megapixels = static_cast<double>(test.srcSize) * test.srcSize / 1e6;
+			std::printf("  %s %-6s %.1f MPix/s, %s\n", test.name, SimdLevelName(kernel), megapixels / (micros / 1e6),
+				dst == reference ? "same pixels as scalar" : "DIFFERS from scalar");
+		}
+	}
+}
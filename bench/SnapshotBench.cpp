@@ -0,0 +1,122 @@
+#include "Bench.h"
+#include "media/MediaSnapshot.h"
+#include "media/TripleBuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	MediaInfo MakeInfo(uint64_t track)
+	{
+		// Long enough that every copy allocates
+		MediaInfo info;
+		info.title = "A title long enough to leave the small string buffer #" + std::to_string(track);
+		info.artist = "An artist with a name that does not fit either #" + std::to_string(track);
+		info.album = "An album, also more than fifteen characters #" + std::to_string(track);
+		info.albumCoverPath = "C:/Users/someone/AppData/Roaming/bakkesmod/data/MusicSync/thumbnails/" + std::to_string(track) + ".png";
+		info.isValid = true;
+		return info;
+	}
+
+	struct FrameStats {
+		std::vector<double> micros; // Spent getting the media, per frame
+		uint64_t changes = 0;       // Frames that saw a new track
+	};
+
+	// Runs frames at hz for duration while a writer changes the track every writerPeriod.
+	// read returns true when the frame saw a new track.
+	template <typename Write, typename Read>
+	FrameStats RunFrames(int hz, Clock::duration duration, Clock::duration writerPeriod, Write write, Read read)
+	{
+		std::atomic<bool> stop{ false };
+		std::thread writer([&] {
+			uint64_t track = 0;
+			while (!stop.load(std::memory_order_relaxed)) {
+				write(MakeInfo(++track));
+				std::this_thread::sleep_for(writerPeriod);
+			}
+		});
+
+		FrameStats stats;
+		auto frame = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+		auto end = Clock::now() + duration;
+		for (auto next = Clock::now(); next < end; next += frame) {
+			std::this_thread::sleep_until(next);
+			auto start = Clock::now();
+			stats.changes += read();
+			stats.micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+		}
+		stop = true;
+		writer.join();
+		return stats;
+	}
+
+	void Print(const char* name, const FrameStats& stats)
+	{
+		std::printf("  %-14s p50 %6.3f us  p99 %7.3f us  max %8.3f us  %llu changes seen\n", name,
+			bench::Percentile(stats.micros, 0.5), bench::Percentile(stats.micros, 0.99), bench::Percentile(stats.micros, 1.0),
+			static_cast<unsigned long long>(stats.changes));
+	}
+}
+
+// What a frame spends getting the current media while the media thread keeps
+// publishing: the triple buffer the overlay reads against the mutex and copy it
+// replaced, at 240 and 500 Hz, with a track change every millisecond to make it contend
+BENCH(SnapshotContention)
+{
+	constexpr auto duration = 1s;
+	constexpr auto writerPeriod = 1ms;
+	for (int hz : { 240, 500 }) {
+		std::printf(" %d Hz\n", hz);
+
+		TripleBuffer<MediaSnapshot> snapshots;
+		uint64_t generation = 0;
+		uint64_t renderedGeneration = 0;
+		FrameStats tripleBuffer = RunFrames(hz, duration, writerPeriod,
+			[&](const MediaInfo& info) {
+				MediaSnapshot& snapshot = snapshots.Back();
+				snapshot.info = info;
+				snapshot.generation = ++generation;
+				snapshots.Publish();
+			},
+			[&] {
+				snapshots.Acquire();
+				const MediaSnapshot& snapshot = snapshots.Front();
+				bench::Keep(snapshot.info.title.size());
+				bool changed = snapshot.generation != renderedGeneration;
+				renderedGeneration = snapshot.generation;
+				return changed;
+			});
+		Print("triple buffer", tripleBuffer);
+
+		// The writer converts the strings under the lock, like the media thread did
+		std::mutex mutex;
+		MediaInfo current;
+		MediaInfo rendered;
+		FrameStats locked = RunFrames(hz, duration, writerPeriod,
+			[&](const MediaInfo& info) {
+				std::lock_guard<std::mutex> lock(mutex);
+				current = MakeInfo(std::stoull(info.title.substr(info.title.rfind('#') + 1)));
+			},
+			[&] {
+				MediaInfo info;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					info = current;
+				}
+				bool changed = info != rendered;
+				rendered = std::move(info);
+				return changed;
+			});
+		Print("mutex and copy", locked);
+	}
+}
@@ -0,0 +1,128 @@
+#include "Bench.h"
+#include "FakeExecutor.h"
+#include "media/MediaStages.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace std::chrono_literals;
+using Duration = FakeExecutor::Duration;
+
+namespace {
+	// What FetchSelected did before the stages: one property request after the other
+	Stage<int> FetchOneByOne(FakeMediaBackend backend, std::vector<FakeMediaBackend::Session> sessions)
+	{
+		int fetched = 0;
+		for (const auto& session : sessions) {
+			co_await RequestProperties(backend, session);
+			fetched++;
+		}
+		co_return fetched;
+	}
+
+	double Millis(Duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	Stage<int> Immediate()
+	{
+		co_return co_await StageCall<int>([](StageCall<int>::Complete complete) {
+			StageResult<int> result;
+			result.status = StageStatus::Ok;
+			result.value = 1;
+			complete(result);
+			return std::function<void()>();
+		});
+	}
+}
+
+// Virtual time to fetch the properties of a growing number of apps, each
+// answering in 20-300 ms, one by one and all at once
+BENCH(StageFetchLatency)
+{
+	const Duration latencies[] = { 40ms, 300ms, 20ms, 120ms, 80ms, 200ms, 60ms, 150ms };
+	for (size_t count = 1; count <= std::size(latencies); count *= 2) {
+		std::vector<FakeMediaBackend::Session> sessions;
+		for (size_t i = 0; i < count; ++i) {
+			sessions.push_back({ "App" + std::to_string(i), latencies[i] });
+		}
+
+		FakeExecutor sequential;
+		StartStage(FetchOneByOne(FakeMediaBackend{ &sequential }, sessions));
+		sequential.Run();
+		FakeExecutor concurrent;
+		StartStage(FetchProperties(FakeMediaBackend{ &concurrent }, sessions));
+		concurrent.Run();
+		std::printf("  %zu apps: %.0f ms one by one, %.0f ms concurrently\n", count, Millis(sequential.Now()), Millis(concurrent.Now()));
+	}
+}
+
+// Cancels a cover read every 1 ms of its 30 ms open and 80 ms read and reports
+// how long the stage took to end after the cancel and whether anything started after it
+BENCH(StageCancelLatency)
+{
+	Duration worst{ 0 };
+	uint64_t startedAfterCancel = 0;
+	int cancels = 0;
+	for (Duration cancelAt = 0ms; cancelAt < 110ms; cancelAt += 1ms) {
+		FakeExecutor executor;
+		auto operation = StartStage(ReadCover(FakeMediaBackend{ &executor }, FakeMediaBackend::Thumbnail{ 500000, 30ms, 80ms }, 10 << 20));
+		uint64_t startedBefore = 0;
+		Duration endedAt = Duration::max();
+		executor.Schedule(cancelAt, [&] {
+			startedBefore = executor.GetCounts().started;
+			operation->Cancel();
+		});
+		// Polled at every virtual microsecond after the cancel until the stage is done
+		executor.Run(cancelAt);
+		for (Duration at = cancelAt; endedAt == Duration::max() && at < 200ms; at += 1us) {
+			executor.Run(at);
+			if (operation->Done()) {
+				endedAt = at;
+			}
+		}
+		executor.Run();
+		worst = (std::max)(worst, endedAt - cancelAt);
+		startedAfterCancel += executor.GetCounts().started - startedBefore;
+		cancels++;
+	}
+	std::printf("  %d cancels: at most %.3f ms to end, %llu calls started after a cancel\n", cancels, Millis(worst),
+		static_cast<unsigned long long>(startedAfterCancel));
+}
+
+// Real cost of a stage around a call that completes at once, and of a cancel
+// reaching a call completed from another thread
+BENCH(StageOverhead)
+{
+	constexpr int stages = 10000;
+	double micros = bench::MedianMicros(9, [] {
+		for (int i = 0; i < stages; ++i) {
+			auto operation = StartStage(Immediate());
+			bench::Keep(operation->Wait(std::chrono::steady_clock::now()));
+		}
+	});
+	std::printf("  start and wait: %.3f us per stage\n", micros / stages);
+
+	double cancelMicros = bench::MedianMicros(21, [] {
+		StageCall<int>::Complete complete;
+		std::thread platform;
+		auto operation = StartStage([](StageCall<int>::Complete& complete, std::thread& platform) -> Stage<int> {
+			co_return co_await StageCall<int>([&](StageCall<int>::Complete done) {
+				complete = done;
+				return std::function<void()>([&] {
+					platform = std::thread([&] {
+						StageResult<int> result;
+						result.status = StageStatus::Cancelled;
+						complete(result);
+					});
+				});
+			});
+		}(complete, platform));
+		operation->Cancel();
+		operation->Wait(std::chrono::steady_clock::now() + 1s);
+		platform.join();
+	});
+	std::printf("  cancel to end, completed on another thread: %.1f us\n", cancelMicros);
+}
@@ -0,0 +1,25 @@
+#include "Bench.h"
+#include "rendering/Transition.h"
+
+#include <cstdio>
+
+// Per-frame cost of evaluating every transition channel, which is all a
+// transition adds to a frame besides the second replay
+BENCH(Transition)
+{
+	constexpr int frames = 100000;
+	constexpr uint64_t frameStep = 1'000'000'000 / 360;
+	const char* names[] = { "fade", "slide", "scale" };
+	Transition transition;
+	for (int style = 1; style <= 3; ++style) {
+		transition.Start(static_cast<TransitionStyle>(style), 0, 60.0f);
+		float checksum = 0.0f;
+		double micros = bench::MedianMicros(5, [&] {
+			for (int frame = 0; frame < frames; ++frame) {
+				TransitionFrame evaluated = transition.Evaluate((frame % 200) * frameStep, Vector2{ 0, 0 });
+				checksum += evaluated.incoming.alpha + evaluated.outgoing.offsetX + evaluated.incoming.scale;
+			}
+		});
+		std::printf("  %-5s %.1f ns per frame (%s)\n", names[style - 1], micros * 1000.0 / frames, checksum != 0.0f ? "ok" : "empty");
+	}
+}
@@ -0,0 +1,279 @@
+#include "support/Test.h"
+#include "support/FakeExecutor.h"
+#include "media/MediaStages.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+using Duration = FakeExecutor::Duration;
+
+namespace {
+	Stage<int> AddTwo(FakeExecutor& executor, Duration first, Duration second)
+	{
+		int a = co_await executor.Call(first, 40);
+		int b = co_await executor.Call(second, 2);
+		co_return a + b;
+	}
+
+	Stage<int> Nested(FakeExecutor& executor)
+	{
+		int inner = co_await AddTwo(executor, 10ms, 10ms);
+		co_return inner + co_await executor.Call(Duration(5ms), 1);
+	}
+
+	// Completed by hand, from whichever thread the test likes
+	struct ManualCall {
+		StageCall<int>::Complete complete;
+		bool completeOnCancel = true;
+
+		StageCall<int> Call()
+		{
+			return StageCall<int>([this](StageCall<int>::Complete done) {
+				complete = done;
+				return std::function<void()>([this] {
+					if (completeOnCancel) {
+						StageResult<int> result;
+						result.status = StageStatus::Cancelled;
+						complete(result);
+					}
+				});
+			});
+		}
+	};
+
+	Stage<int> AwaitManual(ManualCall& call)
+	{
+		co_return co_await call.Call();
+	}
+}
+
+TEST(AsyncStage, StagesRunInSequence)
+{
+	FakeExecutor executor;
+	auto operation = StartStage(Nested(executor));
+	CHECK(!operation->Done());
+	executor.Run();
+	CHECK(operation->Done());
+
+	StageResult<int> result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Ok);
+	CHECK(result.value == 43);
+	CHECK(executor.Now() == 25ms);
+	CHECK(executor.GetCounts().started == 3);
+}
+
+TEST(AsyncStage, FailureEndsTheStage)
+{
+	FakeExecutor executor;
+	auto failing = [](FakeExecutor& executor) -> Stage<int> {
+		int value = co_await executor.Call(Duration(1ms), 1, -5);
+		co_return value + co_await executor.Call(Duration(1ms), 2);
+	};
+	auto operation = StartStage(failing(executor));
+	executor.Run();
+
+	StageResult<int> result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Failed);
+	CHECK(result.code == -5);
+	CHECK(executor.GetCounts().started == 1);
+}
+
+TEST(AsyncStage, CancelStopsTheCallInFlight)
+{
+	FakeExecutor executor;
+	auto operation = StartStage(AddTwo(executor, 10ms, 100ms));
+	executor.Schedule(30ms, [&] { operation->Cancel(); });
+
+	// The stage ends when it is cancelled, not when the call would have finished
+	executor.Run(30ms);
+	CHECK(operation->Done());
+	executor.Run();
+	StageResult<int> result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Cancelled);
+	CHECK(executor.GetCounts().cancelled == 1);
+	CHECK(executor.GetCounts().started == 2);
+}
+
+TEST(AsyncStage, CancelledBeforeTheNextCall)
+{
+	FakeExecutor executor;
+	auto operation = StartStage(AddTwo(executor, 10ms, 10ms));
+	operation->Cancel();
+	executor.Run(0ms);
+	CHECK(operation->Done());
+	executor.Run();
+
+	CHECK(operation->Wait(std::chrono::steady_clock::now()).status == StageStatus::Cancelled);
+	CHECK(executor.GetCounts().started == 1);
+}
+
+TEST(AsyncStage, WhenAllTakesTheSlowest)
+{
+	FakeExecutor executor;
+	std::vector<Stage<int>> stages;
+	stages.push_back(AddTwo(executor, 10ms, 10ms));
+	stages.push_back(AddTwo(executor, 50ms, 30ms));
+	stages.push_back(AddTwo(executor, 5ms, 5ms));
+	auto operation = StartStage(WhenAll(std::move(stages)));
+	executor.Run();
+
+	auto result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Ok);
+	CHECK(result.value && result.value->size() == 3);
+	CHECK(executor.Now() == 80ms);
+	for (const auto& each : *result.value) {
+		CHECK(each.status == StageStatus::Ok && each.value == 42);
+	}
+}
+
+TEST(AsyncStage, WhenAllOfNothing)
+{
+	auto operation = StartStage(WhenAll(std::vector<Stage<int>>{}));
+	auto result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Ok);
+	CHECK(result.value && result.value->empty());
+}
+
+TEST(AsyncStage, CompletesFromAnotherThread)
+{
+	ManualCall call;
+	auto operation = StartStage(AwaitManual(call));
+	std::thread platform([&] {
+		std::this_thread::sleep_for(10ms);
+		StageResult<int> result;
+		result.status = StageStatus::Ok;
+		result.value = 7;
+		call.complete(result);
+	});
+
+	StageResult<int> result = operation->Wait(std::chrono::steady_clock::now() + 5s);
+	platform.join();
+	CHECK(result.status == StageStatus::Ok);
+	CHECK(result.value == 7);
+}
+
+TEST(AsyncStage, CompletesBeforeSuspending)
+{
+	auto immediate = []() -> Stage<int> {
+		co_return co_await StageCall<int>([](StageCall<int>::Complete complete) {
+			StageResult<int> result;
+			result.status = StageStatus::Ok;
+			result.value = 3;
+			complete(result);
+			return std::function<void()>();
+		});
+	};
+	auto operation = StartStage(immediate());
+	CHECK(operation->Done());
+	CHECK(operation->Wait(std::chrono::steady_clock::now()).value == 3);
+}
+
+// A call still running at the deadline is cancelled and reports what it ended with
+TEST(AsyncStage, WaitCancelsAtTheDeadline)
+{
+	ManualCall call;
+	auto operation = StartStage(AwaitManual(call));
+	StageResult<int> result = operation->Wait(std::chrono::steady_clock::now() + 20ms);
+	CHECK(result.status == StageStatus::Cancelled);
+}
+
+TEST(AsyncStage, WaitGivesUpOnAHungCall)
+{
+	ManualCall call;
+	call.completeOnCancel = false;
+	auto operation = StartStage(AwaitManual(call));
+	StageResult<int> result = operation->Wait(std::chrono::steady_clock::now() + 20ms);
+	CHECK(result.status == StageStatus::TimedOut);
+
+	// The call finishing late still ends the stage cleanly
+	StageResult<int> late;
+	late.status = StageStatus::Cancelled;
+	call.complete(late);
+	CHECK(operation->Done());
+}
+
+TEST(MediaStages, PropertiesAreFetchedConcurrently)
+{
+	FakeExecutor executor;
+	FakeMediaBackend backend{ &executor };
+	std::vector<FakeMediaBackend::Session> sessions = {
+		{ "Spotify", 40ms },
+		{ "Browser", 300ms },
+		{ "Broken", 20ms, -1 },
+		{ "Player", 120ms },
+	};
+	auto operation = StartStage(FetchProperties(backend, sessions));
+	executor.Run();
+
+	// As long as the slowest app, not the sum of all
+	CHECK(executor.Now() == 300ms);
+	auto result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Ok);
+	CHECK(result.value && result.value->size() == 4);
+	const auto& each = *result.value;
+	CHECK(each[0].value == "Title of Spotify");
+	CHECK(each[1].value == "Title of Browser");
+	CHECK(each[2].status == StageStatus::Failed && each[2].code == -1);
+	CHECK(each[3].value == "Title of Player");
+}
+
+TEST(MediaStages, SlowAppIsCancelledAlone)
+{
+	FakeExecutor executor;
+	FakeMediaBackend backend{ &executor };
+	std::vector<FakeMediaBackend::Session> sessions = { { "Fast", 10ms }, { "Hung", 1h } };
+	auto operation = StartStage(FetchProperties(backend, sessions));
+	executor.Schedule(5s, [&] { operation->Cancel(); });
+	executor.Run(5s);
+	CHECK(operation->Done());
+	executor.Run();
+
+	auto result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Ok);
+	CHECK(result.value && (*result.value)[0].status == StageStatus::Ok);
+	CHECK(result.value && (*result.value)[1].status == StageStatus::Cancelled);
+}
+
+TEST(MediaStages, ReadsTheCover)
+{
+	FakeExecutor executor;
+	FakeMediaBackend backend{ &executor };
+	auto operation = StartStage(ReadCover(backend, FakeMediaBackend::Thumbnail{ 5000, 30ms, 80ms }, 1 << 20));
+	executor.Run();
+
+	CHECK(executor.Now() == 110ms);
+	auto result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Ok);
+	CHECK(result.value && result.value->size() == 5000);
+}
+
+TEST(MediaStages, OversizedCoverIsNotRead)
+{
+	FakeExecutor executor;
+	FakeMediaBackend backend{ &executor };
+	auto operation = StartStage(ReadCover(backend, FakeMediaBackend::Thumbnail{ 2 << 20, 30ms, 80ms }, 1 << 20));
+	executor.Run();
+
+	auto result = operation->Wait(std::chrono::steady_clock::now());
+	CHECK(result.status == StageStatus::Ok);
+	CHECK(result.value && result.value->empty());
+	CHECK(executor.GetCounts().started == 1);
+}
+
+// Wherever the cancel lands, the read ends right there and nothing after it starts
+TEST(MediaStages, CancelAnywhereInTheRead)
+{
+	for (Duration cancelAt = 0ms; cancelAt < 110ms; cancelAt += 5ms) {
+		FakeExecutor executor;
+		FakeMediaBackend backend{ &executor };
+		auto operation = StartStage(ReadCover(backend, FakeMediaBackend::Thumbnail{ 5000, 30ms, 80ms }, 1 << 20));
+		executor.Schedule(cancelAt, [&] { operation->Cancel(); });
+		executor.Run(cancelAt);
+		CHECK(operation->Done());
+		executor.Run();
+
+		CHECK(operation->Wait(std::chrono::steady_clock::now()).status == StageStatus::Cancelled);
+		CHECK(executor.GetCounts().started == (cancelAt < 30ms ? 1u : 2u));
+	}
+}
@@ -0,0 +1,47 @@
+#include "support/Test.h"
+#include "support/SimdLevels.h"
+#include "imaging/Blur.h"
+
+#include <vector>
+
+namespace {
+	std::vector<uint8_t> Pattern(int width, int height)
+	{
+		std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+		for (size_t i = 0; i < rgba.size(); ++i) {
+			rgba[i] = static_cast<uint8_t>(i * 37 + (i >> 7) * 11);
+		}
+		return rgba;
+	}
+}
+
+// Odd sizes leave tails after every vector step, and the radii reach past the
+// edges of the smallest image
+TEST(Blur, KernelsBlurAlike)
+{
+	struct Case {
+		int width;
+		int height;
+		float sigma;
+	};
+	const Case cases[] = {
+		{ 1, 1, 2.0f },
+		{ 5, 3, 4.0f },
+		{ 37, 23, 1.5f },
+		{ 136, 136, 13.6f },
+		{ 131, 67, 40.0f },
+	};
+
+	for (const Case& test : cases) {
+		const std::vector<uint8_t> source = Pattern(test.width, test.height);
+		std::vector<uint8_t> reference;
+		for (SimdLevel kernel : SupportedSimdLevels()) {
+			std::vector<uint8_t> pixels = source;
+			BlurGaussian(pixels.data(), test.width, test.height, test.sigma, kernel);
+			if (reference.empty()) {
+				reference = pixels;
+			}
+			CHECK(pixels == reference);
+		}
+	}
+}
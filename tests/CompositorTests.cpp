@@ -0,0 +1,190 @@
+#include "support/Test.h"
+#include "support/TestFonts.h"
+#include "imaging/BmpWriter.h"
+#include "rendering/Compositor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	std::vector<BlendKernel> Kernels()
+	{
+		std::vector<BlendKernel> kernels = { BlendKernel::Scalar };
+		if (BestBlendKernel() == BlendKernel::Sse2) {
+			kernels.push_back(BlendKernel::Sse2);
+		}
+		return kernels;
+	}
+
+	const char* Name(BlendKernel kernel)
+	{
+		return kernel == BlendKernel::Sse2 ? "sse2" : "scalar";
+	}
+
+	const uint8_t* Pixel(const Bitmap& bitmap, int x, int y)
+	{
+		return bitmap.pixels.data() + (static_cast<size_t>(y) * bitmap.width + x) * 4;
+	}
+
+	// Leaves what a kernel composed next to the test binary, for comparing by eye
+	void SaveForInspection(const Bitmap& bitmap, const std::string& name)
+	{
+		std::vector<uint8_t> rgba;
+		Unpremultiply(bitmap, rgba);
+		std::string path = "compositor_" + name + ".bmp";
+		if (WriteBmp(path, rgba.data(), bitmap.width, bitmap.height)) {
+			std::printf("  wrote %s\n", path.c_str());
+		}
+	}
+
+	CompositorScene SceneWithText()
+	{
+		CompositorScene scene = GoldenScene();
+		const char* lines[] = { "Title: A title that is long enough to be cut by the overlay", "By: Artist", "From Album" };
+		for (int i = 0; i < 3; ++i) {
+			CompositorLine& line = scene.lines.emplace_back();
+			line.text = lines[i];
+			line.pixelHeight = 16.0f;
+			line.x = 80;
+			line.y = 4 + 20 * i;
+			line.maxWidth = 230;
+		}
+		return scene;
+	}
+}
+
+// The golden image is the fixed scene's pixels, pinned by their hash. Every
+// kernel has to produce exactly those pixels.
+TEST(Compositor, GoldenImage)
+{
+	GlyphFont noFonts;
+	for (BlendKernel kernel : Kernels()) {
+		Bitmap bitmap;
+		Compose(GoldenScene(), noFonts, bitmap, kernel);
+		CHECK(bitmap.width == 330 && bitmap.height == 70);
+		bool matches = HashPixels(bitmap) == goldenSceneHash;
+		CHECK(matches);
+		if (!matches) {
+			SaveForInspection(bitmap, Name(kernel));
+		}
+	}
+}
+
+// What the golden image has to look like, so a changed hash can be told apart from a broken compositor
+TEST(Compositor, GoldenImageShape)
+{
+	GlyphFont noFonts;
+	Bitmap bitmap;
+	Compose(GoldenScene(), noFonts, bitmap, BlendKernel::Scalar);
+
+	// Premultiplied: no channel above alpha
+	bool premultiplied = true;
+	for (size_t i = 0; i < bitmap.pixels.size(); i += 4) {
+		uint8_t alpha = bitmap.pixels[i + 3];
+		premultiplied = premultiplied && bitmap.pixels[i] <= alpha && bitmap.pixels[i + 1] <= alpha && bitmap.pixels[i + 2] <= alpha;
+	}
+	CHECK(premultiplied);
+
+	// Rounded corners: clear in the corner, partly covered along the curve, background inside
+	CHECK(Pixel(bitmap, 0, 0)[3] == 0);
+	CHECK(Pixel(bitmap, 329, 69)[3] == 0);
+	uint8_t edge = Pixel(bitmap, 2, 5)[3];
+	CHECK(edge > 0 && edge < 200);
+	CHECK(Pixel(bitmap, 200, 35)[3] == 200);
+	CHECK(Pixel(bitmap, 200, 35)[2] == (90 * 200 + 127) / 255);
+
+	// The cover is drawn over it, opaque enough on its right side to cover the background
+	const uint8_t* cover = Pixel(bitmap, 65, 35);
+	CHECK(cover[3] > 200);
+	CHECK(cover[0] > cover[2]);
+}
+
+TEST(Compositor, KernelsBlendAlike)
+{
+	std::mt19937 random(7);
+	std::uniform_int_distribution<int> byte(0, 255);
+	constexpr size_t pixels = 1027; // Not a multiple of any vector width
+	std::vector<uint8_t> source(pixels * 4);
+	std::vector<uint8_t> coverage(pixels);
+	std::vector<uint8_t> base(pixels * 4);
+	for (size_t i = 0; i < pixels; ++i) {
+		uint8_t alpha = static_cast<uint8_t>(byte(random));
+		uint8_t baseAlpha = static_cast<uint8_t>(byte(random));
+		for (int c = 0; c < 3; ++c) {
+			source[i * 4 + c] = static_cast<uint8_t>(byte(random) * alpha / 255);
+			base[i * 4 + c] = static_cast<uint8_t>(byte(random) * baseAlpha / 255);
+		}
+		source[i * 4 + 3] = alpha;
+		base[i * 4 + 3] = baseAlpha;
+		coverage[i] = static_cast<uint8_t>(byte(random));
+	}
+	const uint8_t color[4] = { 40, 120, 200, 220 };
+
+	std::vector<uint8_t> over[2];
+	std::vector<uint8_t> covered[2];
+	for (BlendKernel kernel : Kernels()) {
+		int k = static_cast<int>(kernel);
+		over[k] = base;
+		BlendOver(over[k].data(), source.data(), pixels, kernel);
+		covered[k] = base;
+		BlendCoverage(covered[k].data(), coverage.data(), color, pixels, kernel);
+	}
+	if (Kernels().size() > 1) {
+		CHECK(over[0] == over[1]);
+		CHECK(covered[0] == covered[1]);
+	}
+
+	// Opaque source replaces, transparent source keeps
+	std::vector<uint8_t> opaque = { 10, 20, 30, 255 };
+	std::vector<uint8_t> clear = { 0, 0, 0, 0 };
+	std::vector<uint8_t> target = { 100, 100, 100, 200 };
+	BlendOver(target.data(), clear.data(), 1, BlendKernel::Scalar);
+	CHECK(target == std::vector<uint8_t>({ 100, 100, 100, 200 }));
+	BlendOver(target.data(), opaque.data(), 1, BlendKernel::Scalar);
+	CHECK(target == opaque);
+}
+
+// Text depends on the installed font, so it is checked against itself: every
+// kernel gives the same pixels, and the cut line stays inside its width
+TEST(Compositor, TextIsKernelIndependent)
+{
+	GlyphFont font;
+	if (!AddTestFont(font)) {
+		std::printf("  no font found, skipped\n");
+		return;
+	}
+	CompositorScene scene = SceneWithText();
+	uint64_t hashes[2] = {};
+	for (BlendKernel kernel : Kernels()) {
+		for (GlyphRendering mode : { GlyphRendering::Sdf, GlyphRendering::Outline }) {
+			font.SetRendering(mode);
+			Bitmap bitmap;
+			Compose(scene, font, bitmap, kernel);
+			if (mode == GlyphRendering::Sdf) {
+				hashes[static_cast<int>(kernel)] = HashPixels(bitmap);
+			}
+
+			// Some text made it in, and nothing past the longest line's width
+			Bitmap plain;
+			GlyphFont noFonts;
+			Compose(GoldenScene(), noFonts, plain, kernel);
+			int rightmost = -1;
+			for (int y = 0; y < bitmap.height; ++y) {
+				for (int x = 80; x < bitmap.width; ++x) {
+					if (std::memcmp(Pixel(bitmap, x, y), Pixel(plain, x, y), 4) != 0) {
+						rightmost = (std::max)(rightmost, x);
+					}
+				}
+			}
+			CHECK(rightmost >= 80);
+			CHECK(rightmost < 80 + 230);
+		}
+	}
+	if (Kernels().size() > 1) {
+		CHECK(hashes[0] == hashes[1]);
+	}
+}
@@ -0,0 +1,61 @@
+#include "support/Test.h"
+#include "support/SimdLevels.h"
+#include "imaging/CoverCrop.h"
+
+#include <vector>
+
+namespace {
+	// Noisy dark bars of the given widths around a busy picture
+	std::vector<uint8_t> Letterboxed(int width, int height, int left, int top, int right, int bottom)
+	{
+		std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+		for (int y = 0; y < height; ++y) {
+			for (int x = 0; x < width; ++x) {
+				uint8_t* pixel = &rgba[(static_cast<size_t>(y) * width + x) * 4];
+				bool inBar = x < left || x >= width - right || y < top || y >= height - bottom;
+				uint8_t noise = static_cast<uint8_t>((x * 7 + y * 13) % 9);
+				pixel[0] = inBar ? noise : static_cast<uint8_t>(x * 53 + y * 3);
+				pixel[1] = inBar ? noise : static_cast<uint8_t>(y * 41);
+				pixel[2] = inBar ? noise : static_cast<uint8_t>((x ^ y) * 29);
+				pixel[3] = 255;
+			}
+		}
+		return rgba;
+	}
+}
+
+// Odd widths leave tails after every vector step of the row and column scans
+TEST(CoverCrop, KernelsFindTheSameBorders)
+{
+	struct Case {
+		int width;
+		int height;
+		int left;
+		int top;
+		int right;
+		int bottom;
+	};
+	const Case cases[] = {
+		{ 3, 3, 0, 0, 0, 0 },
+		{ 37, 21, 5, 0, 4, 0 },
+		{ 131, 75, 17, 3, 16, 2 },
+		{ 1283, 721, 281, 0, 282, 0 },
+		{ 67, 101, 0, 13, 0, 14 },
+	};
+
+	for (const Case& test : cases) {
+		const std::vector<uint8_t> source = Letterboxed(test.width, test.height, test.left, test.top, test.right, test.bottom);
+		ImageRect expected{ test.left, test.top, test.width - test.left - test.right, test.height - test.top - test.bottom };
+		for (SimdLevel kernel : SupportedSimdLevels()) {
+			CHECK(FindUniformBorders(source.data(), test.width, test.height, 24, kernel) == expected);
+		}
+	}
+}
+
+TEST(CoverCrop, UniformImageIsKeptWhole)
+{
+	std::vector<uint8_t> flat(static_cast<size_t>(45) * 29 * 4, 7);
+	for (SimdLevel kernel : SupportedSimdLevels()) {
+		CHECK((FindUniformBorders(flat.data(), 45, 29, 24, kernel) == ImageRect{ 0, 0, 45, 29 }));
+	}
+}
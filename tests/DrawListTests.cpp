@@ -0,0 +1,192 @@
+#include "support/Test.h"
+#include "support/CountingDrawTarget.h"
+#include "rendering/AllocationCounter.h"
+#include "rendering/DrawList.h"
+
+#include <memory>
+#include <string>
+
+namespace {
+	constexpr uint64_t frameNanos = 1'000'000'000 / 240;
+
+	// Remembers what reached it without keeping any of it on the heap
+	class RecordingTarget : public DrawTarget
+	{
+	public:
+		OverlayBackend Backend() const override { return OverlayBackend::Canvas; }
+		Vector2 GetSize() override { return { 1920, 1080 }; }
+		uintptr_t MetricsId() const override { return 1; }
+
+		void SetColor(const LinearColor& color) override { lastAlpha = color.A; }
+		void SetPosition(Vector2 position) override { lastPosition = position; }
+		void DrawRect(Vector2, Vector2, float) override { drawCalls++; }
+		void DrawTexture(ImageWrapper*, float, float) override { drawCalls++; }
+		void DrawTile(ImageWrapper*, Vector2, Vector2, Vector2F, Vector2F, float) override { drawCalls++; }
+		void DrawString(std::string_view text, float, float) override
+		{
+			drawCalls++;
+			textBytes += text.size();
+		}
+		float MeasureString(const std::string& text, float scale) override { return text.size() * 9.0f * scale; }
+
+		float lastAlpha = 0.0f;
+		Vector2 lastPosition{ 0, 0 };
+		size_t textBytes = 0;
+	};
+
+	float FixedAdvance(const std::string& text, float scale)
+	{
+		return text.size() * 9.0f * scale;
+	}
+
+	// The overlay's list: background, cover, three lines, one of them scrolling, and the bar
+	void RecordOverlay(DrawList& list, ImageWrapper* cover, const Marquee& marquee)
+	{
+		list.Clear();
+		list.SetColor(LinearColor{ 0, 0, 0, 150 });
+		list.DrawRect(Vector2{ 0, 0 }, Vector2{ 650, 200 }, 12.0f);
+		list.MarkContent();
+		list.SetPosition(Vector2{ 10, 10 });
+		list.SetColor(LinearColor{ 255, 255, 255, 255 });
+		list.DrawTexture(cover, 0.5f, 6.0f);
+		list.DrawMarquee(Vector2{ 200, 20 }, &marquee, 2.0f, 2.0f);
+		list.SetPosition(Vector2{ 200, 60 });
+		list.DrawString("By an artist whose name is far longer than the small string buffer", 1.5f, 1.5f);
+		list.SetPosition(Vector2{ 200, 100 });
+		list.DrawString("From an album whose name is also longer than the small string buffer", 1.5f, 1.5f);
+		list.DrawProgress(Vector2{ 200, 160 }, Vector2{ 630, 170 }, LinearColor{ 80, 80, 80, 255 }, LinearColor{ 255, 255, 255, 255 });
+	}
+}
+
+// Guards the other tests: a zero count only means something if allocations are counted
+TEST(DrawList, AllocationsAreCounted)
+{
+	CHECK(AllocationCounter::enabled);
+	AllocationCounter::Start();
+	auto counted = std::make_unique<std::string>("counted");
+	AllocationCounter::Pause();
+	auto skipped = std::make_unique<int>(1);
+	AllocationCounter::Resume();
+	uint64_t allocations = AllocationCounter::Stop();
+	CHECK(allocations == 1);
+}
+
+// A steady frame is a replay, and a replay never touches the heap, scrolling
+// line and progress bar included
+TEST(DrawList, SteadyFramesDoNotAllocate)
+{
+	ImageWrapper cover("cover.png", true);
+	Marquee marquee;
+	marquee.Prepare("Title: A title long enough to scroll through the whole overlay and then some", 2.0f, 400.0f, FixedAdvance, 0);
+	CHECK(marquee.Scrolls());
+	DrawList list;
+	RecordOverlay(list, &cover, marquee);
+	CHECK(!list.Overflowed());
+
+	RecordingTarget target;
+	CanvasWrapper canvasWrapper;
+	CanvasDrawTarget canvas(canvasWrapper);
+	DrawTransform fading;
+	fading.alpha = 0.5f;
+	fading.scale = 0.9f;
+
+	AllocationCounter::Start();
+	for (uint64_t frame = 0; frame < 2400; ++frame) {
+		uint64_t now = frame * frameNanos;
+		float progress = frame / 2400.0f;
+		list.Replay(target, progress, now);
+		list.Replay(canvas, progress, now, fading, DrawPart::Content);
+	}
+	uint64_t allocations = AllocationCounter::Stop();
+	CHECK(allocations == 0);
+
+	// Background, cover, three lines and the bar's two rects every frame
+	CHECK(target.DrawCalls() == 2400 * 7);
+	CHECK(target.textBytes > 0);
+}
+
+// Recording the same track again after a layout change reuses the string buffers
+TEST(DrawList, RecordingAgainReusesStrings)
+{
+	ImageWrapper cover("cover.png", true);
+	Marquee marquee;
+	marquee.Prepare("Short title", 2.0f, 400.0f, FixedAdvance, 0);
+	DrawList list;
+	RecordOverlay(list, &cover, marquee);
+
+	AllocationCounter::Start();
+	RecordOverlay(list, &cover, marquee);
+	uint64_t allocations = AllocationCounter::Stop();
+	CHECK(allocations == 0);
+}
+
+// A frozen list keeps the text the marquee showed after the marquee moves on
+TEST(DrawList, FrozenMarqueeKeepsItsText)
+{
+	ImageWrapper cover("cover.png", true);
+	Marquee marquee;
+	marquee.Prepare("Title: A title long enough to scroll through the whole overlay and then some", 2.0f, 400.0f, FixedAdvance, 0);
+	DrawList list;
+	RecordOverlay(list, &cover, marquee);
+
+	uint64_t at = Marquee::pauseNanos + 3'000'000'000ull;
+	RecordingTarget live;
+	list.Replay(live, 0.0f, at);
+	list.Freeze(at);
+	marquee.Prepare("Another track", 2.0f, 400.0f, FixedAdvance, at);
+
+	RecordingTarget frozen;
+	list.Replay(frozen, 0.0f, at + 5'000'000'000ull);
+	CHECK(frozen.textBytes == live.textBytes);
+	CHECK(frozen.DrawCalls() == live.DrawCalls());
+}
+
+TEST(DrawList, OverflowIsReported)
+{
+	DrawList list;
+	for (size_t i = 0; i < DrawList::maxCommands; ++i) {
+		list.SetColor(LinearColor{ 0, 0, 0, 255 });
+	}
+	CHECK(!list.Overflowed());
+	list.DrawRect(Vector2{ 0, 0 }, Vector2{ 1, 1 });
+	CHECK(list.Overflowed());
+	CHECK(list.Size() == DrawList::maxCommands);
+
+	RecordingTarget target;
+	list.Replay(target, 0.0f, 0);
+	CHECK(target.DrawCalls() == 0);
+}
+
+// The blurred cover backdrop replaces the background rect with one tile, so the
+// render thread does exactly as much as with the flat background
+TEST(DrawList, BackdropCostsTheSameAsTheFlatBackground)
+{
+	ImageWrapper backdrop("backdrop.bmp", true);
+	ImageWrapper cover("cover.bmp", true);
+	DrawList lists[2];
+	for (int i = 0; i < 2; ++i) {
+		DrawList& list = lists[i];
+		list.SetColor(LinearColor{ 0, 0, 0, 150 });
+		if (i == 0) {
+			list.DrawRect(Vector2{ 100, 700 }, Vector2{ 750, 828 }, 10.0f);
+		}
+		else {
+			list.DrawTile(&backdrop, Vector2{ 100, 700 }, Vector2{ 750, 828 }, Vector2F{ 0.0f, 0.2f }, Vector2F{ 1.0f, 0.8f }, 10.0f);
+		}
+		list.MarkContent();
+		list.SetColor(LinearColor{ 255, 255, 255, 255 });
+		list.SetPosition(Vector2{ 120, 720 });
+		list.DrawTexture(&cover, 0.8f, 5.0f);
+		list.SetPosition(Vector2{ 240, 720 });
+		list.DrawString("Title: A title", 2.0f, 2.0f);
+		list.DrawProgress(Vector2{ 110, 824 }, Vector2{ 740, 828 }, LinearColor{ 80, 80, 80, 255 }, LinearColor{ 255, 255, 255, 255 });
+	}
+	CHECK(lists[0].Size() == lists[1].Size());
+
+	CountingDrawTarget flat;
+	CountingDrawTarget blurred;
+	lists[0].Replay(flat, 0.5f, 0);
+	lists[1].Replay(blurred, 0.5f, 0);
+	CHECK(flat.DrawCalls() > 0);
+	CHECK(flat.DrawCalls() == blurred.DrawCalls());
+}
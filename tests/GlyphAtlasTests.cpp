@@ -0,0 +1,82 @@
+#include "support/Test.h"
+#include "rendering/GlyphAtlas.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+	void AddGlyph(GlyphAtlas& atlas, uint64_t key, int width, int height)
+	{
+		std::vector<uint8_t> pixels(static_cast<size_t>(width) * height, static_cast<uint8_t>(key));
+		atlas.Add(key, pixels.data(), width, height, 0, 0);
+	}
+
+	template <typename T>
+	void Put(std::vector<uint8_t>& out, T value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	// A cache file the way Write lays it out, holding one glyph
+	std::vector<uint8_t> OneGlyphFile(int32_t width, int32_t height, int32_t x, int32_t y, int32_t glyphWidth, int32_t glyphHeight)
+	{
+		std::vector<uint8_t> file;
+		Put<int32_t>(file, width);
+		Put<int32_t>(file, height);
+		Put<uint32_t>(file, 1);
+		Put<uint64_t>(file, 'A');
+		for (int32_t value : { x, y, glyphWidth, glyphHeight, 0, 0 }) {
+			Put<int32_t>(file, value);
+		}
+		file.resize(file.size() + static_cast<size_t>(width) * height, 0x80);
+		return file;
+	}
+}
+
+TEST(GlyphAtlas, ReadsWhatItWrote)
+{
+	GlyphAtlas atlas(64, 16);
+	for (uint64_t key = 1; key <= 20; ++key) {
+		AddGlyph(atlas, key, 5 + static_cast<int>(key % 7), 6 + static_cast<int>(key % 5));
+	}
+	std::vector<uint8_t> file;
+	atlas.Write(file);
+
+	GlyphAtlas loaded;
+	CHECK(loaded.Read(file.data(), file.size()));
+	CHECK(loaded.Width() == 64);
+	for (uint64_t key = 1; key <= 20; ++key) {
+		const AtlasGlyph* glyph = loaded.Find(key);
+		CHECK(glyph && glyph->width == 5 + static_cast<int>(key % 7));
+		if (glyph) {
+			CHECK(loaded.Row(glyph->y)[glyph->x] == static_cast<uint8_t>(key));
+		}
+	}
+}
+
+// A glyph as wide as the atlas leaves no room for the gap, so it could never be
+// packed again. Repacking it used to double the height until it overflowed.
+TEST(GlyphAtlas, RejectsGlyphsThatCannotBePacked)
+{
+	GlyphAtlas atlas(64, 16);
+	AddGlyph(atlas, 'B', 8, 8);
+	std::vector<uint8_t> file = OneGlyphFile(64, 16, 0, 0, 64, 8);
+	CHECK(!atlas.Read(file.data(), file.size()));
+
+	// Unchanged
+	CHECK(atlas.Width() == 64);
+	CHECK(atlas.Find('B') != nullptr);
+	CHECK(atlas.Find('A') == nullptr);
+}
+
+TEST(GlyphAtlas, RejectsPositionsThatWrapAround)
+{
+	GlyphAtlas atlas(64, 16);
+	std::vector<uint8_t> file = OneGlyphFile(64, 16, INT_MAX - 2, 0, 8, 8);
+	CHECK(!atlas.Read(file.data(), file.size()));
+	file = OneGlyphFile(64, 16, 0, INT_MAX - 2, 8, 8);
+	CHECK(!atlas.Read(file.data(), file.size()));
+}
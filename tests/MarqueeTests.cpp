@@ -0,0 +1,73 @@
+#include "support/Test.h"
+#include "rendering/Marquee.h"
+
+#include <string>
+
+namespace {
+	constexpr uint64_t second = 1'000'000'000;
+	constexpr float scale = 2.0f;
+	const std::string line = "Title: A title that is long enough to scroll through the overlay";
+
+	// 9 px a grapheme at scale 1, so nothing depends on the game's font
+	float FixedAdvance(const std::string& text, float textScale)
+	{
+		size_t graphemes = 0;
+		for (size_t offset = 0; offset < text.size(); offset = NextGrapheme(text, offset)) {
+			graphemes++;
+		}
+		return graphemes * 9.0f * textScale;
+	}
+}
+
+TEST(Marquee, ShortLinesDoNotScroll)
+{
+	Marquee marquee;
+	marquee.Prepare("Short", scale, 300.0f, FixedAdvance, 0);
+	CHECK(!marquee.Scrolls());
+	CHECK(marquee.At(5 * second).text.empty());
+}
+
+// The window is a function of the clock alone: every 6th frame at 360 fps
+// falls on a 60 fps frame and shows the same text at the same offset
+TEST(Marquee, SameWindowAtAnyFrameRate)
+{
+	Marquee slow;
+	Marquee fast;
+	slow.Prepare(line, scale, 300.0f, FixedAdvance, 0);
+	fast.Prepare(line, scale, 300.0f, FixedAdvance, 0);
+	CHECK(slow.Scrolls());
+
+	int mismatches = 0;
+	for (uint64_t frame = 0; frame < 60 * 10; ++frame) {
+		Marquee::Window a = slow.At(frame * second / 60);
+		Marquee::Window b = fast.At(frame * 6 * second / 360);
+		mismatches += a.text != b.text || a.x != b.x;
+	}
+	CHECK(mismatches == 0);
+}
+
+TEST(Marquee, ScrollsAtItsSpeedAfterThePause)
+{
+	Marquee marquee;
+	marquee.Prepare(line, scale, 300.0f, FixedAdvance, 0);
+	CHECK(marquee.OffsetAt(Marquee::pauseNanos / 2) == 0.0f);
+	CHECK_NEAR(marquee.OffsetAt(Marquee::pauseNanos + second), Marquee::baseSpeed * scale, 0.01);
+
+	// Graphemes crossing an edge of the clip region are left out
+	for (uint64_t at = 0; at < 20 * second; at += second / 7) {
+		Marquee::Window window = marquee.At(at);
+		CHECK(window.x >= 0.0f);
+		CHECK(window.x + FixedAdvance(std::string(window.text), scale) <= 300.0f + 0.01f);
+	}
+}
+
+// Preparing the same line again, e.g. after an unrelated layout change, keeps the scroll position
+TEST(Marquee, PrepareAgainKeepsThePosition)
+{
+	Marquee marquee;
+	marquee.Prepare(line, scale, 300.0f, FixedAdvance, 0);
+	marquee.Prepare(line, scale, 300.0f, FixedAdvance, 7 * second);
+	CHECK(marquee.OffsetAt(Marquee::pauseNanos + second) > 0.0f);
+	marquee.Prepare(line, scale, 250.0f, FixedAdvance, 7 * second);
+	CHECK(marquee.OffsetAt(Marquee::pauseNanos + second) == 0.0f);
+}
@@ -0,0 +1,69 @@
+#include "support/Test.h"
+#include "support/SimdLevels.h"
+#include "imaging/Palette.h"
+
+#include <chrono>
+#include <vector>
+
+namespace {
+	// Colors spread over many bins, with some pixels under half alpha
+	std::vector<uint8_t> Pattern(size_t pixels)
+	{
+		std::vector<uint8_t> rgba(pixels * 4);
+		for (size_t i = 0; i < pixels; ++i) {
+			rgba[i * 4 + 0] = static_cast<uint8_t>(i * 37);
+			rgba[i * 4 + 1] = static_cast<uint8_t>((i / 3) * 53);
+			rgba[i * 4 + 2] = static_cast<uint8_t>((i / 11) * 29);
+			rgba[i * 4 + 3] = static_cast<uint8_t>(i % 5 == 0 ? 90 : 255);
+		}
+		return rgba;
+	}
+
+	std::vector<uint32_t> BinTotals(const std::vector<uint32_t>& counts)
+	{
+		std::vector<uint32_t> totals(paletteBins, 0);
+		for (size_t i = 0; i < counts.size(); ++i) {
+			totals[i / paletteLanes] += counts[i];
+		}
+		return totals;
+	}
+}
+
+// Odd pixel counts leave tails after every vector step
+TEST(Palette, KernelsCountAlike)
+{
+	for (size_t pixels : { 1, 3, 7, 17, 33, 4097, 64 * 64 + 5 }) {
+		const std::vector<uint8_t> source = Pattern(pixels);
+		std::vector<uint32_t> reference;
+		for (SimdLevel kernel : SupportedSimdLevels()) {
+			std::vector<uint32_t> counts(static_cast<size_t>(paletteBins) * paletteLanes, 0);
+			PaletteHistogram(source.data(), pixels, counts.data(), kernel);
+			std::vector<uint32_t> totals = BinTotals(counts);
+			if (reference.empty()) {
+				reference = totals;
+			}
+			CHECK(totals == reference);
+		}
+	}
+}
+
+TEST(Palette, KernelsExtractTheSamePalette)
+{
+	const int width = 61;
+	const int height = 37;
+	const std::vector<uint8_t> source = Pattern(static_cast<size_t>(width) * height);
+	std::vector<PaletteColor> reference;
+	for (SimdLevel kernel : SupportedSimdLevels()) {
+		std::vector<PaletteColor> palette;
+		CHECK(ExtractPalette(source.data(), width, height, 8, std::chrono::steady_clock::time_point::max(), palette, kernel));
+		if (reference.empty()) {
+			reference = palette;
+		}
+		CHECK(palette.size() == reference.size());
+		for (size_t i = 0; i < palette.size() && i < reference.size(); ++i) {
+			CHECK(palette[i].count == reference[i].count);
+			CHECK(palette[i].rgb[0] == reference[i].rgb[0] && palette[i].rgb[1] == reference[i].rgb[1] &&
+				palette[i].rgb[2] == reference[i].rgb[2]);
+		}
+	}
+}
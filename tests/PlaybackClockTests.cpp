@@ -0,0 +1,168 @@
+#include "support/Test.h"
+#include "media/PlaybackClock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace {
+	constexpr int64_t nanosPerSecond = 1'000'000'000;
+	constexpr int64_t frameNanos = nanosPerSecond / 144;
+
+	int64_t Seconds(double seconds)
+	{
+		return static_cast<int64_t>(seconds * nanosPerSecond);
+	}
+
+	// A media app on a fake clock. Its real position runs at trueRate, what it
+	// reports is read latencyNanos late and stamped when it arrives, like SMTC.
+	struct FakeApp {
+		double positionAtZero = 0.0;
+		double trueRate = 1.0;
+		double reportedRate = 1.0;
+		double endSeconds = 180.0;
+		int64_t latencyNanos = 0;
+
+		double TruePosition(int64_t nowNanos) const
+		{
+			return std::clamp(positionAtZero + nowNanos * 1e-9 * trueRate, 0.0, endSeconds);
+		}
+
+		TimelineSample Report(int64_t nowNanos) const
+		{
+			TimelineSample sample;
+			sample.endSeconds = endSeconds;
+			sample.positionSeconds = TruePosition(nowNanos - latencyNanos);
+			sample.playbackRate = reportedRate;
+			sample.capturedAtNanos = nowNanos;
+			sample.playing = true;
+			sample.valid = true;
+			return sample;
+		}
+	};
+
+	// Largest difference between the extrapolated and the true position over
+	// every 144 Hz frame of the span, with a real update every updateNanos
+	double MaxDrift(const FakeApp& app, int64_t spanNanos, int64_t updateNanos)
+	{
+		PlaybackClock clock;
+		int64_t nextUpdate = 0;
+		double drift = 0.0;
+		for (int64_t now = 0; now < spanNanos; now += frameNanos) {
+			if (now >= nextUpdate) {
+				clock.Publish(app.Report(now));
+				nextUpdate += updateNanos;
+			}
+			drift = (std::max)(drift, std::abs(clock.Read().PositionAt(now) - app.TruePosition(now)));
+		}
+		return drift;
+	}
+}
+
+TEST(PlaybackClock, ExactReportsDoNotDrift)
+{
+	FakeApp app;
+	CHECK(MaxDrift(app, Seconds(170), Seconds(4)) < 1e-6);
+}
+
+// A late report is off by the latency, and stays off by just that until the
+// next one instead of growing
+TEST(PlaybackClock, LatencyBoundsTheDrift)
+{
+	FakeApp app;
+	app.latencyNanos = Seconds(0.03);
+	double drift = MaxDrift(app, Seconds(170), Seconds(4));
+	CHECK_NEAR(drift, 0.03, 1e-6);
+	CHECK(MaxDrift(app, Seconds(170), Seconds(30)) <= drift + 1e-6);
+}
+
+// An app clock running 0.1% fast drifts linearly, and each update resets it
+TEST(PlaybackClock, RateErrorResetsOnUpdate)
+{
+	FakeApp app;
+	app.trueRate = 1.001;
+	CHECK(MaxDrift(app, Seconds(170), Seconds(4)) <= 4 * 0.001 + 1e-6);
+	CHECK(MaxDrift(app, Seconds(170), Seconds(30)) <= 30 * 0.001 + 1e-6);
+}
+
+TEST(PlaybackClock, FollowsTheRate)
+{
+	FakeApp app;
+	app.trueRate = 1.5;
+	app.reportedRate = 1.5;
+	app.endSeconds = 600.0;
+	CHECK(MaxDrift(app, Seconds(300), Seconds(10)) < 1e-6);
+
+	TimelineSample sample = app.Report(0);
+	CHECK_NEAR(sample.PositionAt(Seconds(2)), 3.0, 1e-9);
+}
+
+TEST(PlaybackClock, PauseHoldsStill)
+{
+	TimelineSample sample;
+	sample.endSeconds = 180.0;
+	sample.positionSeconds = 42.0;
+	sample.capturedAtNanos = Seconds(10);
+	sample.playing = false;
+	sample.valid = true;
+	CHECK_NEAR(sample.PositionAt(Seconds(10)), 42.0, 1e-9);
+	CHECK_NEAR(sample.PositionAt(Seconds(100)), 42.0, 1e-9);
+}
+
+// A seek is only known from the next sample, which then replaces the old one entirely
+TEST(PlaybackClock, SeekTakesTheNewSample)
+{
+	FakeApp app;
+	PlaybackClock clock;
+	clock.Publish(app.Report(0));
+	CHECK_NEAR(clock.Read().PositionAt(Seconds(5)), 5.0, 1e-9);
+
+	app.positionAtZero = 90.0 - 5.0;
+	clock.Publish(app.Report(Seconds(5)));
+	CHECK_NEAR(clock.Read().PositionAt(Seconds(5)), 90.0, 1e-9);
+	CHECK_NEAR(clock.Read().PositionAt(Seconds(6)), 91.0, 1e-9);
+}
+
+TEST(PlaybackClock, ClampsToTheTrack)
+{
+	FakeApp app;
+	app.endSeconds = 10.0;
+	TimelineSample sample = app.Report(Seconds(9));
+	CHECK_NEAR(sample.PositionAt(Seconds(60)), 10.0, 1e-9);
+	CHECK_NEAR(sample.ProgressAt(Seconds(60)), 1.0, 1e-6);
+
+	// A stamp from before the sample never moves it backwards
+	CHECK_NEAR(sample.PositionAt(Seconds(8)), 9.0, 1e-9);
+
+	TimelineSample invalid;
+	CHECK(invalid.ProgressAt(Seconds(1)) == 0.0f);
+}
+
+// Readers never see half of one sample and half of another
+TEST(PlaybackClock, ReadsAreNeverTorn)
+{
+	PlaybackClock clock;
+	std::atomic<bool> done = false;
+	std::thread writer([&] {
+		for (int i = 1; i <= 200000; ++i) {
+			TimelineSample sample;
+			sample.startSeconds = i;
+			sample.endSeconds = i * 2.0;
+			sample.positionSeconds = i * 3.0;
+			sample.capturedAtNanos = i;
+			sample.valid = true;
+			clock.Publish(sample);
+		}
+		done = true;
+	});
+
+	int torn = 0;
+	while (!done) {
+		TimelineSample sample = clock.Read();
+		double i = sample.startSeconds;
+		torn += sample.endSeconds != i * 2.0 || sample.positionSeconds != i * 3.0 || sample.capturedAtNanos != static_cast<int64_t>(i);
+	}
+	writer.join();
+	CHECK(torn == 0);
+}
@@ -0,0 +1,188 @@
+#include "support/Test.h"
+#include "media/PollScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = PollScheduler::Clock;
+
+namespace {
+	// Something the plugin counts as a change: a new track, play/pause or a seek
+	struct Change {
+		Clock::duration at;
+		bool playing;
+	};
+
+	// 08:00-12:00 and 13:00-18:00 of music, 2.5-5 minute tracks, a seek every
+	// few tracks and a coffee break pause. Nothing plays the rest of the day.
+	std::vector<Change> SyntheticDay()
+	{
+		std::mt19937 random(20240601);
+		auto between = [&](int low, int high) { return low + static_cast<int>(random() % static_cast<unsigned>(high - low + 1)); };
+
+		std::vector<Change> changes;
+		for (auto [from, to] : { std::pair{ 8h, 12h }, std::pair{ 13h, 18h } }) {
+			Clock::duration at = from;
+			bool paused = false;
+			while (at < to) {
+				changes.push_back({ at, true });
+				Clock::duration length = std::chrono::seconds(between(150, 300));
+				if (between(0, 4) == 0) {
+					changes.push_back({ at + length / 3, true });
+				}
+				if (!paused && at > from + 2h) {
+					changes.push_back({ at + length / 2, false });
+					changes.push_back({ at + length / 2 + 10min, true });
+					at += 10min;
+					paused = true;
+				}
+				at += length;
+			}
+			changes.push_back({ to, false });
+		}
+		std::sort(changes.begin(), changes.end(), [](const Change& a, const Change& b) { return a.at < b.at; });
+		return changes;
+	}
+
+	struct DayResult {
+		uint64_t polls = 0;
+		uint64_t wakeups = 0;
+		Clock::duration maxLatency{}; // From a change to the poll that saw it
+	};
+
+	// Runs the scheduler through the day on simulated time, with the media
+	// thread's loop around it. Apps only wake it when change events are on.
+	DayResult SimulateDay(const std::vector<Change>& changes, bool eventsActive)
+	{
+		PollScheduler scheduler;
+		Clock::time_point start = Clock::now();
+		Clock::time_point end = start + 24h;
+		Clock::time_point now = start;
+		size_t happened = 0;
+		size_t seen = 0;
+		DayResult result;
+		while (now < end) {
+			Clock::time_point due;
+			if (scheduler.PollIfDue(now, due)) {
+				result.polls++;
+				bool changed = happened != seen;
+				if (changed) {
+					result.maxLatency = (std::max)(result.maxLatency, now - (start + changes[seen].at));
+					seen = happened;
+				}
+				bool playing = happened > 0 && changes[happened - 1].playing;
+				scheduler.ReportPoll(changed, playing, eventsActive);
+				continue;
+			}
+
+			if (happened < changes.size() && start + changes[happened].at <= due) {
+				now = start + changes[happened++].at;
+				if (eventsActive) {
+					scheduler.NotifyChanged(now);
+					result.wakeups++;
+				}
+				continue;
+			}
+			now = due;
+			result.wakeups++;
+		}
+		return result;
+	}
+
+	// The loop PollScheduler replaced: 100 ms sleep slices, a poll every 2 s
+	constexpr uint64_t fixedWakeups = 24 * 3600 * 10;
+	constexpr uint64_t fixedPolls = 24 * 3600 / 2;
+	constexpr auto fixedLatency = 2s;
+
+	void Report(const char* name, const DayResult& result)
+	{
+		std::printf("  %s: %llu polls, %llu wakeups, changes seen within %lld ms "
+			"(fixed loop: %llu polls, %llu wakeups, within %lld ms)\n",
+			name, static_cast<unsigned long long>(result.polls), static_cast<unsigned long long>(result.wakeups),
+			static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(result.maxLatency).count()),
+			static_cast<unsigned long long>(fixedPolls), static_cast<unsigned long long>(fixedWakeups),
+			static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(fixedLatency).count()));
+	}
+}
+
+TEST(PollScheduler, DayWithChangeEvents)
+{
+	std::vector<Change> changes = SyntheticDay();
+	CHECK(changes.size() > 100);
+
+	DayResult result = SimulateDay(changes, true);
+	Report("change events", result);
+	CHECK(result.wakeups * 50 < fixedWakeups);
+	CHECK(result.polls * 5 < fixedPolls);
+	// Every change is picked up once the event burst has settled
+	CHECK(result.maxLatency <= 50ms);
+}
+
+TEST(PollScheduler, DayPollingOnly)
+{
+	DayResult result = SimulateDay(SyntheticDay(), false);
+	Report("polling only", result);
+	CHECK(result.wakeups * 20 < fixedWakeups);
+	CHECK(result.polls < fixedPolls);
+	// Within the playing cap mid-session, the idle cap when music starts
+	CHECK(result.maxLatency <= 10s);
+}
+
+TEST(PollScheduler, BacksOffWhileStable)
+{
+	auto period = 500ms;
+	for (int stable = 0; stable < 3; ++stable) {
+		CHECK(PollScheduler::NextPeriod(period, stable, true, false) == 500ms);
+	}
+	std::chrono::milliseconds playing = 500ms;
+	std::chrono::milliseconds idle = 500ms;
+	std::chrono::milliseconds events = 500ms;
+	for (int stable = 3; stable < 40; ++stable) {
+		std::chrono::milliseconds next = PollScheduler::NextPeriod(playing, stable, true, false);
+		CHECK(next >= playing);
+		playing = next;
+		idle = PollScheduler::NextPeriod(idle, stable, false, false);
+		events = PollScheduler::NextPeriod(events, stable, true, true);
+	}
+	CHECK(playing == 4s);
+	CHECK(idle == 10s);
+	CHECK(events == 30s);
+
+	// A change drops straight back to the fast period
+	CHECK(PollScheduler::NextPeriod(30s, 0, true, true) == 500ms);
+}
+
+TEST(PollScheduler, EventBurstIsOnePoll)
+{
+	PollScheduler scheduler;
+	Clock::time_point now = Clock::now();
+	scheduler.ReportPoll(false, true, true);
+	for (int i = 0; i < 5; ++i) {
+		scheduler.NotifyChanged(now + std::chrono::milliseconds(i * 5));
+	}
+
+	Clock::time_point due;
+	CHECK(!scheduler.PollIfDue(now + 20ms, due));
+	CHECK(due <= now + 50ms);
+	CHECK(scheduler.PollIfDue(due, due) == PollReason::Changed);
+	CHECK(!scheduler.PollIfDue(now + 100ms, due));
+	CHECK(scheduler.GetStats().changedPolls == 1);
+}
+
+TEST(PollScheduler, RefreshAndStopAreImmediate)
+{
+	PollScheduler scheduler;
+	Clock::time_point now = Clock::now();
+	Clock::time_point due;
+	CHECK(!scheduler.PollIfDue(now, due));
+
+	scheduler.RequestRefresh();
+	CHECK(scheduler.PollIfDue(now, due) == PollReason::Refresh);
+
+	scheduler.Stop();
+	CHECK(scheduler.WaitForNextPoll() == PollReason::Shutdown);
+}
@@ -0,0 +1,63 @@
+#include "support/Test.h"
+#include "support/SimdLevels.h"
+#include "imaging/Resampler.h"
+
+#include <vector>
+
+namespace {
+	std::vector<uint8_t> Pattern(int width, int height)
+	{
+		std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+		for (size_t i = 0; i < rgba.size(); ++i) {
+			rgba[i] = static_cast<uint8_t>(i * 31 + (i >> 6) * 7);
+		}
+		return rgba;
+	}
+}
+
+// Odd sizes leave tails after every vector step, both when shrinking and when enlarging
+TEST(Resampler, KernelsResampleAlike)
+{
+	struct Case {
+		int srcWidth;
+		int srcHeight;
+		int dstWidth;
+		int dstHeight;
+	};
+	const Case cases[] = {
+		{ 1, 1, 3, 5 },
+		{ 7, 5, 3, 2 },
+		{ 301, 173, 109, 109 },
+		{ 37, 41, 133, 97 },
+		{ 1200, 9, 17, 1 },
+	};
+
+	for (const Case& test : cases) {
+		const std::vector<uint8_t> source = Pattern(test.srcWidth, test.srcHeight);
+		std::vector<uint8_t> reference;
+		for (SimdLevel kernel : SupportedSimdLevels()) {
+			std::vector<uint8_t> dst(static_cast<size_t>(test.dstWidth) * test.dstHeight * 4);
+			ResampleLanczos(source.data(), test.srcWidth, test.srcHeight, dst.data(), test.dstWidth, test.dstHeight, kernel);
+			if (reference.empty()) {
+				reference = dst;
+			}
+			CHECK(dst == reference);
+		}
+	}
+}
+
+TEST(Resampler, KernelsDownsampleAlike)
+{
+	for (int side : { 1, 3, 17, 33, 255 }) {
+		const std::vector<uint8_t> source = Pattern(side, side + 2);
+		std::vector<uint8_t> reference;
+		for (SimdLevel kernel : SupportedSimdLevels()) {
+			std::vector<uint8_t> dst(static_cast<size_t>((side + 1) / 2) * ((side + 3) / 2) * 4);
+			DownsampleBox(source.data(), side, side + 2, dst.data(), kernel);
+			if (reference.empty()) {
+				reference = dst;
+			}
+			CHECK(dst == reference);
+		}
+	}
+}
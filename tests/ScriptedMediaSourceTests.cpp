@@ -0,0 +1,188 @@
+#include "support/Test.h"
+#include "media/PollScheduler.h"
+#include "media/ScriptedMediaSource.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+	MediaInfo Track(std::string title, bool playing = true)
+	{
+		MediaInfo info;
+		info.title = std::move(title);
+		info.artist = "Artist";
+		info.isValid = true;
+		info.timeline.endSeconds = 60.0;
+		info.timeline.playing = playing;
+		info.timeline.valid = true;
+		return info;
+	}
+
+	// The player thread applies steps on its own, wait until it got through them
+	bool WaitForSteps(const ScriptedMediaSource& source, uint64_t steps)
+	{
+		auto deadline = std::chrono::steady_clock::now() + 5s;
+		while (source.StepsApplied() < steps) {
+			if (std::chrono::steady_clock::now() > deadline) {
+				return false;
+			}
+			std::this_thread::sleep_for(1ms);
+		}
+		return true;
+	}
+}
+
+TEST(ScriptedMediaSource, FiresAnEventPerStep)
+{
+	ScriptedMediaSource source({
+		{ 0ms, Track("One") },
+		{ 5ms, Track("Two") },
+		{ 5ms, MediaInfo{} },
+	}, false);
+
+	// The callback may read the source, as the plugin's does
+	std::mutex mutex;
+	std::vector<std::string> seen;
+	source.Subscribe([&] {
+		MediaInfo info = source.FetchCurrent();
+		std::lock_guard<std::mutex> lock(mutex);
+		seen.push_back(info.isValid ? info.title : "-");
+	});
+
+	CHECK(WaitForSteps(source, 3));
+	std::this_thread::sleep_for(10ms);
+	std::lock_guard<std::mutex> lock(mutex);
+	// The first step may run before Subscribe
+	CHECK(seen.size() == 2 || seen.size() == 3);
+	CHECK(!seen.empty() && seen.back() == "-");
+	CHECK(!source.FetchCurrent().isValid);
+}
+
+TEST(ScriptedMediaSource, StampsTheTimeline)
+{
+	int64_t before = PlaybackClock::NowNanos();
+	ScriptedMediaSource source({ { 0ms, Track("One") } }, false);
+	CHECK(WaitForSteps(source, 1));
+
+	MediaInfo info = source.FetchCurrent();
+	CHECK(info.timeline.valid);
+	CHECK(info.timeline.capturedAtNanos >= before);
+	CHECK(info.timeline.capturedAtNanos <= PlaybackClock::NowNanos());
+}
+
+TEST(ScriptedMediaSource, UnsubscribeStopsEvents)
+{
+	std::atomic<int> events = 0;
+	ScriptedMediaSource source({ { 0ms, Track("One") }, { 20ms, Track("Two") } }, false);
+	source.Subscribe([&] { events++; });
+	CHECK(source.EventsActive());
+	source.Unsubscribe();
+	CHECK(!source.EventsActive());
+	CHECK(WaitForSteps(source, 2));
+	CHECK(events <= 1);
+	CHECK(source.FetchCurrent().title == "Two");
+}
+
+TEST(ScriptedMediaSource, PlayingSessionWins)
+{
+	MediaInfo paused = Track("Paused", false);
+	ScriptedMediaSource source({
+		{ 0ms, Track("Playing"), "Spotify" },
+		{ 0ms, paused, "Browser" },
+	}, false);
+	CHECK(WaitForSteps(source, 2));
+
+	// The paused app changed last and is what Windows calls current, playing still wins
+	CHECK(source.FetchCurrent().title == "Playing");
+	std::vector<std::string> sessions = source.DescribeSessions();
+	CHECK(sessions.size() == 2);
+	CHECK(sessions.size() == 2 && (sessions[0].rfind("* Spotify", 0) == 0 || sessions[1].rfind("* Spotify", 0) == 0));
+}
+
+TEST(ScriptedMediaSource, PolicyPicksTheSession)
+{
+	ScriptedMediaSource source({
+		{ 0ms, Track("From Spotify"), "Spotify" },
+		{ 0ms, Track("From Browser"), "Browser" },
+	}, false);
+	CHECK(WaitForSteps(source, 2));
+	CHECK(source.FetchCurrent().title == "From Browser"); // Most recent
+
+	source.SetSessionPolicy(SessionPolicy::Parse("", "", "spotify"));
+	CHECK(source.FetchCurrent().title == "From Spotify");
+
+	source.SetSessionPolicy(SessionPolicy::Parse("", "SPOTIFY", ""));
+	CHECK(source.FetchCurrent().title == "From Browser");
+
+	source.SetSessionPolicy(SessionPolicy::Parse("Other", "", ""));
+	CHECK(!source.FetchCurrent().isValid);
+}
+
+TEST(ScriptedMediaSource, StoppedAppHandsOver)
+{
+	ScriptedMediaSource source({
+		{ 0ms, Track("From Spotify"), "Spotify" },
+		{ 0ms, Track("From Browser"), "Browser" },
+		{ 0ms, MediaInfo{}, "Browser" },
+	}, false);
+	CHECK(WaitForSteps(source, 3));
+	CHECK(source.FetchCurrent().title == "From Spotify");
+	CHECK(source.DescribeSessions().size() == 1);
+}
+
+// The plugin's media thread: events wake the scheduler, which polls the source
+TEST(ScriptedMediaSource, EventsDrivePolls)
+{
+	PollScheduler scheduler;
+	ScriptedMediaSource source({
+		{ 100ms, Track("One") },
+		{ 200ms, Track("Two") },
+	}, false);
+	CHECK(source.Subscribe([&] { scheduler.NotifyChanged(); }));
+
+	std::vector<std::string> polled;
+	std::atomic<bool> done = false;
+	std::thread media([&] {
+		while (scheduler.WaitForNextPoll() != PollReason::Shutdown) {
+			MediaInfo info = source.FetchCurrent();
+			bool changed = info.isValid && (polled.empty() || polled.back() != info.title);
+			if (changed) {
+				polled.push_back(info.title);
+			}
+			scheduler.ReportPoll(changed, info.timeline.playing, true);
+			if (polled.size() == 2) {
+				done = true;
+				return;
+			}
+		}
+	});
+
+	auto deadline = std::chrono::steady_clock::now() + 5s;
+	while (!done && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(5ms);
+	}
+	scheduler.Stop();
+	media.join();
+
+	CHECK(polled.size() == 2);
+	CHECK(polled.size() == 2 && polled[0] == "One" && polled[1] == "Two");
+	// Each track showed up through its change event, well before the 500 ms timer
+	CHECK(scheduler.GetStats().changedPolls >= 2);
+}
+
+TEST(ScriptedMediaSource, PreviewScriptLoops)
+{
+	std::vector<ScriptStep> script = ScriptedMediaSource::PreviewScript();
+	CHECK(!script.empty());
+	for (ScriptStep& step : script) {
+		step.delay = 0ms;
+	}
+	ScriptedMediaSource source(script, true);
+	CHECK(WaitForSteps(source, script.size() * 2 + 1));
+}
@@ -0,0 +1,55 @@
+#include "support/Test.h"
+
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+	struct Case {
+		const char* suite;
+		const char* name;
+		test::CaseFunction run;
+	};
+
+	std::vector<Case>& Cases()
+	{
+		static std::vector<Case> cases;
+		return cases;
+	}
+
+	int failures = 0;
+}
+
+test::Registrar::Registrar(const char* suite, const char* name, CaseFunction run)
+{
+	Cases().push_back({ suite, name, run });
+}
+
+void test::Fail(const char* file, int line, const std::string& message)
+{
+	std::printf("  %s:%d: %s\n", file, line, message.c_str());
+	failures++;
+}
+
+int main(int argc, char** argv)
+{
+	std::set<std::string> suites(argv + 1, argv + argc);
+	int ran = 0;
+	int failed = 0;
+	for (const Case& testCase : Cases()) {
+		if (!suites.empty() && !suites.contains(testCase.suite)) {
+			continue;
+		}
+		int before = failures;
+		auto start = std::chrono::steady_clock::now();
+		testCase.run();
+		auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		std::printf("%s %s.%s (%lld ms)\n", failures == before ? "ok  " : "FAIL", testCase.suite, testCase.name, static_cast<long long>(millis));
+		ran++;
+		failed += failures != before;
+	}
+	std::printf("%d of %d passed\n", ran - failed, ran);
+	return ran == 0 || failed != 0 ? 1 : 0;
+}
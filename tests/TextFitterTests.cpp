@@ -0,0 +1,170 @@
+#include "support/Test.h"
+#include "rendering/OverlayLayout.h"
+#include "rendering/TextFitter.h"
+
+#include <string>
+
+namespace {
+	// Every code point 9 px at scale 1, two-column ones (CJK, emoji) 18 px.
+	// Counts its calls, the fitter must not measure more than it has to.
+	struct FixedMetrics {
+		int calls = 0;
+
+		TextWidthOracle Oracle()
+		{
+			return [this](const std::string& text, float scale) {
+				calls++;
+				float width = 0.0f;
+				for (size_t offset = 0; offset < text.size();) {
+					char32_t codePoint;
+					size_t length = DecodeUtf8(text, offset, codePoint);
+					CHECK(length != 0);
+					width += codePoint >= 0x1100 ? 18.0f : 9.0f;
+					offset += length != 0 ? length : 1;
+				}
+				return width * scale;
+			};
+		}
+	};
+
+	bool IsValidUtf8(const std::string& text)
+	{
+		return SanitizeUtf8(text) == text;
+	}
+
+	std::vector<std::string> Graphemes(std::string_view text)
+	{
+		std::vector<std::string> graphemes;
+		for (size_t offset = 0; offset < text.size();) {
+			size_t end = NextGrapheme(text, offset);
+			graphemes.emplace_back(text.substr(offset, end - offset));
+			offset = end;
+		}
+		return graphemes;
+	}
+}
+
+TEST(TextFitter, DecodesOnlyValidUtf8)
+{
+	char32_t codePoint = 0;
+	CHECK(DecodeUtf8("A", 0, codePoint) == 1 && codePoint == U'A');
+	CHECK(DecodeUtf8("\xC3\xA9", 0, codePoint) == 2 && codePoint == 0xE9);
+	CHECK(DecodeUtf8("\xE6\x97\xA5", 0, codePoint) == 3 && codePoint == 0x65E5);
+	CHECK(DecodeUtf8("\xF0\x9F\x8E\xB5", 0, codePoint) == 4 && codePoint == 0x1F3B5);
+
+	CHECK(DecodeUtf8("\xC0\xAF", 0, codePoint) == 0);     // Overlong
+	CHECK(DecodeUtf8("\xED\xA0\x80", 0, codePoint) == 0); // Surrogate
+	CHECK(DecodeUtf8("\xE6\x97", 0, codePoint) == 0);     // Cut short
+	CHECK(DecodeUtf8("\x97", 0, codePoint) == 0);         // Continuation byte alone
+	CHECK(DecodeUtf8("\xF4\x90\x80\x80", 0, codePoint) == 0); // Past the last plane
+
+	CHECK(SanitizeUtf8("a\xE6\x97" "b") == "a??b");
+	CHECK(SanitizeUtf8("\xE6\x97\xA5\xE6\x9C\xAC") == "\xE6\x97\xA5\xE6\x9C\xAC");
+}
+
+TEST(TextFitter, GraphemesStayTogether)
+{
+	// e and a combining acute, a flag, a family, a thumbs up with a skin tone, Hangul jamo
+	auto graphemes = Graphemes("e\xCC\x81"
+		"\xF0\x9F\x87\xAF\xF0\x9F\x87\xB5"
+		"\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7"
+		"\xF0\x9F\x91\x8D\xF0\x9F\x8F\xBD"
+		"\xE1\x84\x92\xE1\x85\xA1\xE1\x86\xAB"
+		"x");
+	CHECK(graphemes.size() == 6);
+	CHECK(graphemes.size() == 6 && graphemes[0] == "e\xCC\x81");
+	CHECK(graphemes.size() == 6 && graphemes[2].size() == 18);
+	CHECK(graphemes.size() == 6 && graphemes[5] == "x");
+	CHECK(Graphemes("\r\n").size() == 1);
+}
+
+TEST(TextFitter, FitsToThePixelWidth)
+{
+	FixedMetrics metrics;
+	TextFitter fitter(metrics.Oracle());
+	CHECK(fitter.Fit("Short", 1.0f, 100.0f) == "Short");
+
+	// 9 px a character and 27 for the ellipsis: 6 characters fit in 81 px
+	CHECK(fitter.Fit("Long title here", 1.0f, 81.0f) == "Long t...");
+	// 5 in 72 px, and the space before the cut is dropped
+	CHECK(fitter.Fit("Long title here", 1.0f, 72.0f) == "Long...");
+	CHECK(fitter.Fit("Long title here", 2.0f, 144.0f) == "Long...");
+	CHECK(fitter.Fit("Long title here", 1.0f, 27.0f) == "...");
+	CHECK(fitter.Fit("Long title here", 1.0f, 20.0f).empty());
+}
+
+// CJK and emoji titles are cut between characters, never inside one
+TEST(TextFitter, NeverSplitsACharacter)
+{
+	FixedMetrics metrics;
+	TextFitter fitter(metrics.Oracle());
+	const std::string title = "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE6\x9B\xB2\xE5\x90\x8D "
+		"\xF0\x9F\x91\xA8\xE2\x80\x8D\xF0\x9F\x91\xA9\xE2\x80\x8D\xF0\x9F\x91\xA7 e\xCC\x81t\xC3\xA9";
+	float full = fitter.Measure(title, 1.0f);
+	for (float width = 0.0f; width <= full + 10.0f; width += 1.0f) {
+		std::string fitted = fitter.Fit(title, 1.0f, width);
+		CHECK(IsValidUtf8(fitted));
+		CHECK(fitter.Measure(fitted, 1.0f) <= width);
+		if (!fitted.empty() && fitted != title) {
+			std::string kept = fitted.substr(0, fitted.size() - 3);
+			CHECK(title.compare(0, kept.size(), kept) == 0);
+			CHECK(kept.empty() || NextGrapheme(title, kept.size() - 1) >= kept.size());
+		}
+	}
+
+	// Broken bytes from an app are replaced, not passed to the font
+	CHECK(fitter.Fit("bad \xE6\x97 bytes", 1.0f, 1000.0f) == "bad ?? bytes");
+}
+
+// Fitting the same track again costs no measurements, and a cut costs about
+// log2 of the number of graphemes
+TEST(TextFitter, WidthsAreCached)
+{
+	FixedMetrics metrics;
+	TextFitter fitter(metrics.Oracle());
+	const std::string title(200, 'x');
+	std::string first = fitter.Fit(title, 1.0f, 400.0f);
+	int firstCalls = metrics.calls;
+	CHECK(firstCalls <= 12);
+
+	CHECK(fitter.Fit(title, 1.0f, 400.0f) == first);
+	CHECK(metrics.calls == firstCalls);
+	CHECK(fitter.GetStats().cacheHits > 0);
+
+	// Another scale is measured again, a cleared cache too
+	fitter.Fit(title, 1.5f, 400.0f);
+	CHECK(metrics.calls > firstCalls);
+	fitter.Clear();
+	CHECK(fitter.GetStats().entries == 0);
+	int beforeRefit = metrics.calls;
+	fitter.Fit(title, 1.0f, 400.0f);
+	CHECK(metrics.calls > beforeRefit);
+}
+
+TEST(TextFitter, CacheIsBounded)
+{
+	FixedMetrics metrics;
+	TextFitter fitter(metrics.Oracle());
+	for (size_t i = 0; i < TextFitter::maxEntries * 3; ++i) {
+		fitter.Measure("Track " + std::to_string(i), 1.0f);
+		CHECK(fitter.GetStats().entries <= TextFitter::maxEntries);
+	}
+	CHECK(fitter.GetStats().measurements == TextFitter::maxEntries * 3);
+}
+
+// With autoWidth the background ends one padding after the widest line, never past the full width
+TEST(TextFitter, BackgroundFollowsTheText)
+{
+	OverlayLayoutInput input;
+	input.screenWidth = 1920;
+	input.screenHeight = 1080;
+	input.lineCount = 3;
+	OverlayLayout fixed = OverlayLayout::Compute(input);
+	CHECK(fixed.BackgroundRight(50) == fixed.backgroundMax.X);
+
+	input.autoWidth = true;
+	OverlayLayout fitted = OverlayLayout::Compute(input);
+	CHECK(fitted.BackgroundRight(50) == fitted.textX + 50 + fitted.padding);
+	CHECK(fitted.BackgroundRight(fitted.textMaxWidth) == fitted.backgroundMax.X);
+	CHECK(fitted.BackgroundRight(100000) == fitted.backgroundMax.X);
+}
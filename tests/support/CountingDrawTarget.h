@@ -0,0 +1,34 @@
+#pragma once
+#include "rendering/DrawTarget.h"
+
+// Counts what a replay would draw without drawing it
+class CountingDrawTarget : public DrawTarget
+{
+public:
+	OverlayBackend Backend() const override { return OverlayBackend::Canvas; }
+	Vector2 GetSize() override { return Vector2{ 1920, 1080 }; }
+	uintptr_t MetricsId() const override { return 0; }
+
+	void SetColor(const LinearColor&) override {}
+	void SetPosition(Vector2) override {}
+	void DrawRect(Vector2, Vector2, float) override { drawCalls++; }
+	void DrawTexture(ImageWrapper* texture, float, float) override { Bind(texture); drawCalls++; }
+	void DrawTile(ImageWrapper* texture, Vector2, Vector2, Vector2F, Vector2F, float) override { Bind(texture); drawCalls++; }
+	void DrawString(std::string_view, float, float) override { drawCalls++; }
+	float MeasureString(const std::string&, float) override { return 0.0f; }
+
+	// Times the texture changed between textured draws, ImGui starts a new batch for each
+	uint64_t TextureSwitches() const { return textureSwitches; }
+
+private:
+	void Bind(const ImageWrapper* texture)
+	{
+		if (textureSwitches == 0 || texture != boundTexture) {
+			textureSwitches++;
+			boundTexture = texture;
+		}
+	}
+
+	const ImageWrapper* boundTexture = nullptr;
+	uint64_t textureSwitches = 0;
+};
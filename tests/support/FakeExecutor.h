@@ -0,0 +1,148 @@
+#pragma once
+#include "media/AsyncStage.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Stands in for the platform under AsyncStage: calls complete on a virtual
+// clock after the latency they were given, all on the thread calling Run.
+// Cancelling a call completes it as Cancelled at the current virtual time.
+class FakeExecutor
+{
+public:
+	using Duration = std::chrono::microseconds;
+
+	struct Counts {
+		uint64_t started = 0;
+		uint64_t completed = 0;
+		uint64_t failed = 0;
+		uint64_t cancelled = 0;
+	};
+
+	Duration Now() const { return now; }
+	const Counts& GetCounts() const { return counts; }
+
+	// A call that succeeds with value after latency, or fails with failCode if it is not 0
+	template <typename T>
+	StageCall<T> Call(Duration latency, T value, int32_t failCode = 0)
+	{
+		return StageCall<T>([this, latency, value = std::move(value), failCode](typename StageCall<T>::Complete complete) {
+			counts.started++;
+			auto done = std::make_shared<bool>(false);
+			Schedule(now + latency, [this, done, complete, value, failCode] {
+				if (*done) {
+					return;
+				}
+				*done = true;
+				StageResult<T> result;
+				if (failCode != 0) {
+					result.code = failCode;
+					counts.failed++;
+				}
+				else {
+					result.status = StageStatus::Ok;
+					result.value = value;
+					counts.completed++;
+				}
+				complete(std::move(result));
+			});
+			return std::function<void()>([this, done, complete] {
+				if (*done) {
+					return;
+				}
+				*done = true;
+				Schedule(now, [this, complete] {
+					StageResult<T> result;
+					result.status = StageStatus::Cancelled;
+					counts.cancelled++;
+					complete(std::move(result));
+				});
+			});
+		});
+	}
+
+	// Runs something at a virtual time, e.g. a cancellation in the middle of a stage
+	void Schedule(Duration at, std::function<void()> run)
+	{
+		timers.push_back({ (std::max)(at, now), order++, std::move(run) });
+		std::push_heap(timers.begin(), timers.end(), Later);
+	}
+
+	// Fires timers in time order until none are left or the next is after until
+	void Run(Duration until = Duration::max())
+	{
+		while (!timers.empty() && timers.front().at <= until) {
+			std::pop_heap(timers.begin(), timers.end(), Later);
+			Timer timer = std::move(timers.back());
+			timers.pop_back();
+			now = timer.at;
+			timer.run();
+		}
+		if (until != Duration::max()) {
+			now = (std::max)(now, until);
+		}
+	}
+
+private:
+	struct Timer {
+		Duration at;
+		uint64_t order;
+		std::function<void()> run;
+	};
+
+	static bool Later(const Timer& a, const Timer& b)
+	{
+		return a.at != b.at ? a.at > b.at : a.order > b.order;
+	}
+
+	Duration now{ 0 };
+	uint64_t order = 0;
+	std::vector<Timer> timers;
+	Counts counts;
+};
+
+// MediaStages backend on a FakeExecutor. Sessions and thumbnails carry the
+// latencies their calls take.
+struct FakeMediaBackend {
+	struct Session {
+		std::string appId;
+		FakeExecutor::Duration latency{ 0 };
+		int32_t failCode = 0;
+	};
+
+	struct Thumbnail {
+		uint64_t size = 0;
+		FakeExecutor::Duration openLatency{ 0 };
+		FakeExecutor::Duration readLatency{ 0 };
+	};
+
+	using Properties = std::string; // The title
+	using Stream = Thumbnail;
+	using Buffer = std::vector<uint8_t>;
+
+	FakeExecutor* executor = nullptr;
+
+	StageCall<Properties> RequestProperties(const Session& session)
+	{
+		return executor->Call<Properties>(session.latency, "Title of " + session.appId, session.failCode);
+	}
+
+	StageCall<Stream> OpenThumbnail(const Thumbnail& thumbnail)
+	{
+		return executor->Call<Stream>(thumbnail.openLatency, thumbnail);
+	}
+
+	uint64_t StreamSize(const Stream& stream) const { return stream.size; }
+
+	StageCall<Buffer> ReadStream(const Stream& stream, uint32_t size)
+	{
+		return executor->Call<Buffer>(stream.readLatency, Buffer(size, 0xCD));
+	}
+
+	std::vector<uint8_t> BufferBytes(const Buffer& buffer) const { return buffer; }
+};
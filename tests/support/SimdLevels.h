@@ -0,0 +1,14 @@
+#pragma once
+#include "imaging/Simd.h"
+
+#include <vector>
+
+// Every kernel level this CPU can run, scalar first so it is the reference
+inline std::vector<SimdLevel> SupportedSimdLevels()
+{
+	std::vector<SimdLevel> levels = { SimdLevel::Scalar, SimdLevel::Sse2 };
+	if (BestSimdLevel() == SimdLevel::Avx2) {
+		levels.push_back(SimdLevel::Avx2);
+	}
+	return levels;
+}
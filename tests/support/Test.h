@@ -0,0 +1,37 @@
+#pragma once
+#include <cmath>
+#include <string>
+
+// Just enough of a test framework for the portable modules. TEST registers a
+// case under a suite, CHECK records a failure and carries on. musicsync_tests
+// runs the suites named on its command line, or all of them.
+namespace test {
+	using CaseFunction = void (*)();
+
+	struct Registrar {
+		Registrar(const char* suite, const char* name, CaseFunction run);
+	};
+
+	void Fail(const char* file, int line, const std::string& message);
+}
+
+#define TEST(suite, name) \
+	static void suite##_##name(); \
+	static test::Registrar suite##_##name##_registrar(#suite, #name, suite##_##name); \
+	static void suite##_##name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			test::Fail(__FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { \
+		double checkActual = static_cast<double>(actual); \
+		double checkExpected = static_cast<double>(expected); \
+		if (!(std::abs(checkActual - checkExpected) <= (tolerance))) { \
+			test::Fail(__FILE__, __LINE__, #actual " is " + std::to_string(checkActual) + ", expected " + std::to_string(checkExpected)); \
+		} \
+	} while (0)
@@ -0,0 +1,26 @@
+#pragma once
+#include "rendering/GlyphFont.h"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Adds the first font found where Windows and common Linux installs keep one.
+// False when there is none, text checks are then skipped.
+inline bool AddTestFont(GlyphFont& font)
+{
+	const char* paths[] = {
+		"C:/Windows/Fonts/segoeui.ttf",
+		"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+		"/usr/share/fonts/TTF/DejaVuSans.ttf",
+		"/usr/share/fonts/dejavu/DejaVuSans.ttf",
+		"/System/Library/Fonts/Supplemental/Arial.ttf",
+	};
+	for (const char* path : paths) {
+		std::ifstream file(path, std::ios::binary);
+		if (file && font.AddFont(std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()))) {
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// Stands in for MusicSync/pch.h when the portable modules are built for the
+// tests and benchmarks. It declares just enough of the BakkesMod SDK for them
+// to compile; nothing here draws or loads anything.
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct LinearColor {
+	float R, G, B, A;
+};
+
+struct Vector2 {
+	int X, Y;
+};
+
+struct Vector2F {
+	float X, Y;
+};
+
+#include "IMGUI/imgui.h"
+
+class ImageWrapper
+{
+public:
+	ImageWrapper(std::string /*path*/, bool /*canvas*/ = false, bool /*imgui*/ = false) {}
+	void* GetImGuiTex() { return nullptr; }
+	bool IsLoadedForCanvas() { return true; }
+	Vector2 GetSize() { return { 1, 1 }; }
+};
+
+class CanvasWrapper
+{
+public:
+	void SetColor(float, float, float, float) {}
+	void SetPosition(Vector2) {}
+	void DrawRect(Vector2, Vector2) {}
+	void DrawTexture(ImageWrapper*, float) {}
+	void DrawTile(ImageWrapper*, float, float, float, float, float, float, LinearColor, unsigned int, unsigned char) {}
+	void DrawString(std::string, float, float) {}
+	Vector2 GetSize() { return { 1, 1 }; }
+	Vector2F GetStringSize(std::string, float, float) { return { 1, 1 }; }
+};
+
+// The plugin logs through the game console, the tests stay quiet
+#define LOG(...) ((void)0)